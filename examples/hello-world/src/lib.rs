@@ -11,7 +11,7 @@ use tempeh_window::input::InputManager;
 use tempeh_window::Runner;
 use tempeh_window_winit::WinitWindow;
 
-#[system(for_each)]
+#[system(par_for_each, min_batch = 256)]
 fn update_positions(
     transform: &mut Transform,
     #[resource] input_manager: &InputManager,
@@ -32,7 +32,7 @@ fn update_positions(
     }
     if input_manager.is_key_pressed(&VirtualKeyCode::W)
         || input_manager.is_mouse_pressed(&MouseButton::Left)
-        || input_manager.touch_presses.len() > 0
+        || input_manager.touch_count() > 0
     {
         transform.position = transform.position.add(tempeh_math::Vector2::<f32>::new(
             0.0,
@@ -19,18 +19,16 @@ use crate::renderer::{Renderer, SceneEditorRendererPipeline, WindowSize};
 use crate::scene::run_game;
 use crate::toolchain::Toolchain;
 use crate::ui::filetree::{imgui_file_tree, FileTree};
-use async_std::channel;
-use async_std::prelude::*;
-use async_std::task;
 use imgui::*;
-use pollster::block_on;
 use simplelog::*;
 use simplelog::{CombinedLogger, Config, LevelFilter, WriteLogger};
 use std::io::Write;
 use std::path::{Path, PathBuf};
 use std::rc::Rc;
+use std::sync::mpsc;
 use std::sync::{Arc, Mutex};
 use std::time::Instant;
+use tempeh_core::tasks::TaskExecutor;
 use wgpu::TextureViewDescriptor;
 use winit::monitor::VideoMode;
 use winit::window::Fullscreen;
@@ -48,8 +46,7 @@ const LINE_ENDING: &'static str = "\r\n";
 #[cfg(not(windows))]
 const LINE_ENDING: &'static str = "\n";
 
-#[async_std::main]
-async fn main() {
+fn main() {
     logger::init();
     let mut project = Project::new();
     let project_path =
@@ -57,7 +54,8 @@ async fn main() {
     project.open(&project_path);
     let file_tree = FileTree::from(&project_path);
 
-    let toolchain = Arc::new(Toolchain::from().await);
+    let toolchain = Arc::new(Toolchain::from());
+    let executor = TaskExecutor::new();
 
     // Set up window and GPU
     let event_loop = EventLoop::new();
@@ -176,8 +174,7 @@ async fn main() {
     let mut last_frame = Instant::now();
 
     let mut last_cursor = None;
-    let (sender, receiver) = channel::unbounded::<String>();
-    let sender = Arc::new(sender);
+    let (sender, receiver) = mpsc::channel::<String>();
 
     let mut app = App::new();
 
@@ -190,14 +187,12 @@ async fn main() {
                 Message::Play => {
                     app.ui_state.play_log.clear();
                     let toolchain_ = Arc::clone(&toolchain);
-                    let mut sender_ = Arc::clone(&sender);
-                    task::spawn(async move {
-                        toolchain_
-                            .compile_and_record(
-                                &sender_,
-                                "C:\\Users\\andra\\Projects\\tempeh-engine\\examples\\hello-world",
-                            )
-                            .await;
+                    let sender_ = sender.clone();
+                    executor.spawn_blocking(move || {
+                        toolchain_.compile_and_record(
+                            &sender_,
+                            "C:\\Users\\andra\\Projects\\tempeh-engine\\examples\\hello-world",
+                        );
                         println!("Done");
                         run_game();
                     });
@@ -1,8 +1,8 @@
-use async_std::task;
 use core::iter;
 use imgui::{Context, TextureId};
 use imgui_wgpu::{Renderer as RendererImGui, RendererConfig};
 use imgui_wgpu::{Texture as TextureImGui, TextureConfig};
+use tempeh_core::tasks::block_on;
 use wgpu::{SamplerBindingType, SurfaceConfiguration};
 use winit::dpi::PhysicalSize;
 
@@ -25,12 +25,12 @@ impl Renderer {
     ) -> Self {
         let instance = wgpu::Instance::new(wgpu::Backends::PRIMARY);
         let surface = unsafe { instance.create_surface(window) };
-        let adapter = task::block_on(instance.request_adapter(&wgpu::RequestAdapterOptions {
+        let adapter = block_on(instance.request_adapter(&wgpu::RequestAdapterOptions {
             compatible_surface: Some(&surface),
             power_preference: wgpu::PowerPreference::HighPerformance,
             force_fallback_adapter: false,
         }));
-        let (device, queue) = task::block_on(adapter.unwrap().request_device(
+        let (device, queue) = block_on(adapter.unwrap().request_device(
             &wgpu::DeviceDescriptor {
                 label: None,
                 features: wgpu::Features::empty(),
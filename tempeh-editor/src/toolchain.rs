@@ -1,10 +1,8 @@
-use async_std::channel::SendError;
-use async_std::channel::Sender;
-use async_std::io::BufReader;
-use async_std::prelude::*;
-use async_std::process::{Child, Command, Stdio};
 use std::io;
+use std::io::{BufRead, BufReader};
 use std::path::PathBuf;
+use std::process::{Child, Command, Stdio};
+use std::sync::mpsc::{SendError, Sender};
 
 pub enum ToolchainError {
     IOError(io::Error),
@@ -28,7 +26,7 @@ pub struct Toolchain {
 }
 
 impl Toolchain {
-    pub async fn from() -> Self {
+    pub fn from() -> Self {
         let toolchain_dir = PathBuf::from("C:/Users/andra/.cargo/bin/");
         let cargo_path = toolchain_dir.join("cargo.exe");
 
@@ -38,7 +36,7 @@ impl Toolchain {
             .stdout(Stdio::null())
             .status();
 
-        if let Ok(exit_status) = cargo_run.await {
+        if let Ok(exit_status) = cargo_run {
             if !cargo_path.is_file() || !exit_status.success() {}
         }
 
@@ -57,19 +55,16 @@ impl Toolchain {
             .spawn()?)
     }
 
-    pub async fn compile_and_record(
+    /// Forwards the compiler output line by line while it runs. Blocks until cargo closes its
+    /// stderr, so it is meant to be run with `TaskExecutor::spawn_blocking`.
+    pub fn compile_and_record(
         &self,
         recorder: &Sender<String>,
         pwd: &str,
     ) -> Result<(), ToolchainError> {
         let mut child = self.compile(pwd)?;
-        let mut stderr_lines = BufReader::new(child.stderr.take().unwrap()).lines();
-        loop {
-            if let Some(stderr_line) = stderr_lines.next().await {
-                recorder.send(stderr_line?).await?;
-            } else {
-                break;
-            }
+        for stderr_line in BufReader::new(child.stderr.take().unwrap()).lines() {
+            recorder.send(stderr_line?)?;
         }
         Ok(())
     }
@@ -0,0 +1,218 @@
+use std::collections::{HashMap, VecDeque};
+use std::ffi::CString;
+use std::sync::atomic::{AtomicU32, Ordering};
+use std::thread::JoinHandle;
+
+use tempeh_engine::ring::Producer;
+use tempeh_filesystem::cooked::CookedAudio;
+use tempeh_filesystem::{Vfs, VfsError};
+use tempeh_miniaudio::voice::VoiceCategory;
+
+/// Sound of the audio thread, chosen by the game so commands can refer to it before the audio
+/// thread has even seen the `Play`.
+#[derive(Debug, Copy, Clone, PartialEq, Eq, Hash)]
+pub struct SoundId(u32);
+
+impl SoundId {
+    pub fn next() -> Self {
+        static NEXT: AtomicU32 = AtomicU32::new(0);
+        Self(NEXT.fetch_add(1, Ordering::Relaxed))
+    }
+}
+
+#[derive(Debug)]
+pub enum AudioCommand {
+    Play {
+        id: SoundId,
+        /// Sound file, see `AudioCommands::open`
+        path: CString,
+        volume: f32,
+        looping: bool,
+        /// World position of a spatialized sound, `None` plays it unattenuated
+        position: Option<[f32; 3]>,
+        /// Weight against other sounds when more are playing than the voice limits allow
+        priority: f32,
+        category: VoiceCategory,
+        /// Released by the audio thread once it has played to the end
+        one_shot: bool,
+        /// Decoded in chunks while playing instead of once into the shared clip cache, for music
+        /// and other long tracks
+        streaming: bool,
+    },
+    /// A sound that is not a loose file, played from memory under `path`. Sent by
+    /// `AudioCommands::open` before the first command referring to it
+    Register {
+        path: CString,
+        data: SoundData,
+    },
+    /// Decodes a clip into the cache ahead of its first play
+    Preload(CString),
+    /// Frees a cached clip once its playing voices are done, and the bytes of a registered one
+    Unload(CString),
+    /// Resumes a paused sound where it was
+    Resume(SoundId),
+    /// Pauses the sound, keeping its position
+    Stop(SoundId),
+    SetVolume(SoundId, f32),
+    SetPosition(SoundId, [f32; 3]),
+    /// Stops the sound and frees it
+    Release(SoundId),
+    SetListenerPosition([f32; 3]),
+    SetMasterVolume(f32),
+    Shutdown,
+}
+
+/// Sound held in memory by the audio thread, which miniaudio reads in place.
+#[derive(Debug)]
+pub enum SoundData {
+    /// Bytes of a sound file in any format miniaudio decodes
+    Encoded(Box<[u8]>),
+    /// Interleaved samples cooked by `tempeh-cooker`, played without decoding
+    Pcm {
+        samples: Box<[i16]>,
+        channels: u32,
+        sample_rate: u32,
+    },
+}
+
+/// A sound as the audio thread knows it.
+#[derive(Debug, Clone)]
+pub struct SoundFile {
+    pub path: CString,
+    /// Encoded size in bytes
+    pub len: u64,
+}
+
+/// Sending end of the audio thread's command queue.
+///
+/// Commands are pushed straight into the queue. When it is full they wait in an overflow list on
+/// the game side, which is retried by `flush` at the end of every frame, so the audio thread
+/// never has to allocate or lock to receive them.
+pub struct AudioCommands {
+    producer: Producer<AudioCommand>,
+    overflow: VecDeque<AudioCommand>,
+    thread: Option<JoinHandle<()>>,
+    /// Sounds sent with `Register`, by asset path
+    registered: HashMap<String, SoundFile>,
+}
+
+impl AudioCommands {
+    pub(crate) fn new(producer: Producer<AudioCommand>, thread: JoinHandle<()>) -> Self {
+        Self {
+            producer,
+            overflow: VecDeque::new(),
+            thread: Some(thread),
+            registered: HashMap::new(),
+        }
+    }
+
+    pub fn send(&mut self, command: AudioCommand) {
+        if let AudioCommand::Unload(path) = &command {
+            self.registered.retain(|_, file| file.path != *path);
+        }
+        // Keeps the commands in order behind the ones that did not fit
+        if !self.overflow.is_empty() {
+            self.overflow.push_back(command);
+            return;
+        }
+        if let Err(command) = self.producer.push(command) {
+            self.overflow.push_back(command);
+        }
+    }
+
+    /// The sound file of the asset at `path`, for `Play`, `Preload` and `Unload`. A loose file is
+    /// played straight from disk, which lets long tracks stream. Anything else, like a sound in a
+    /// pack, is read through `vfs` the first time and handed to the audio thread, which plays it
+    /// from memory. Cooked sounds (`CookedAudio`) are handed over as the PCM they hold.
+    pub fn open(&mut self, vfs: &Vfs, path: &str) -> Result<SoundFile, VfsError> {
+        let invalid = || VfsError::InvalidPath(path.to_owned());
+        if let Some(file) = vfs.file_path(path) {
+            let len = std::fs::metadata(&file)?.len();
+            let path = CString::new(file.to_string_lossy().into_owned()).map_err(|_| invalid())?;
+            return Ok(SoundFile { path, len });
+        }
+        if let Some(file) = self.registered.get(path) {
+            return Ok(file.clone());
+        }
+
+        let bytes = vfs.read(path)?;
+        // Kept apart from file paths, which share miniaudio's namespace
+        let file = SoundFile {
+            path: CString::new(format!("vfs:{}", path)).map_err(|_| invalid())?,
+            len: bytes.len() as u64,
+        };
+        let data = match CookedAudio::parse(&bytes) {
+            // Copied as the samples are not necessarily aligned in the pack
+            Some(cooked) => SoundData::Pcm {
+                samples: cooked
+                    .samples
+                    .chunks_exact(2)
+                    .map(|sample| i16::from_ne_bytes([sample[0], sample[1]]))
+                    .collect(),
+                channels: cooked.channels,
+                sample_rate: cooked.sample_rate,
+            },
+            None => SoundData::Encoded(bytes.into_owned().into_boxed_slice()),
+        };
+        self.send(AudioCommand::Register {
+            path: file.path.clone(),
+            data,
+        });
+        self.registered.insert(path.to_owned(), file.clone());
+        Ok(file)
+    }
+
+    /// Plays the sound file at `path` once, unattenuated.
+    pub fn play_once(&mut self, path: CString, volume: f32) -> SoundId {
+        let id = SoundId::next();
+        self.send(AudioCommand::Play {
+            id,
+            path,
+            volume,
+            looping: false,
+            position: None,
+            priority: 1.0,
+            category: VoiceCategory::default(),
+            one_shot: true,
+            streaming: false,
+        });
+        id
+    }
+
+    /// Moves overflowed commands into the queue and wakes the audio thread up to apply them.
+    pub fn flush(&mut self) {
+        let thread = match &self.thread {
+            Some(thread) => thread,
+            None => return,
+        };
+        if thread.is_finished() {
+            // The engine failed to start, nothing will ever drain the queue
+            self.overflow.clear();
+            return;
+        }
+        while let Some(command) = self.overflow.pop_front() {
+            if let Err(command) = self.producer.push(command) {
+                self.overflow.push_front(command);
+                break;
+            }
+        }
+        thread.thread().unpark();
+    }
+}
+
+impl Drop for AudioCommands {
+    fn drop(&mut self) {
+        self.overflow.clear();
+        self.overflow.push_back(AudioCommand::Shutdown);
+        while !self.overflow.is_empty() {
+            self.flush();
+            if self.thread.as_ref().map_or(true, JoinHandle::is_finished) {
+                break;
+            }
+            std::thread::yield_now();
+        }
+        if let Some(thread) = self.thread.take() {
+            let _ = thread.join();
+        }
+    }
+}
@@ -0,0 +1,184 @@
+use std::collections::HashMap;
+
+use tempeh_core_component::Transform;
+use tempeh_ecs::prelude::*;
+use tempeh_ecs::world::SubWorld;
+use tempeh_ecs::{Entity, EntityStore};
+use tempeh_filesystem::Vfs;
+use tempeh_miniaudio::voice::VoiceCategory;
+
+use crate::command::{AudioCommand, AudioCommands, SoundId};
+
+/// Encoded size above which sounds are streamed by default, about ten seconds of compressed
+/// stereo music.
+pub const STREAM_THRESHOLD: u64 = 256 * 1024;
+
+/// Sound played by an entity. The fields describe what the game wants; `audio_source_sync` sends
+/// whatever changed to the audio thread once per frame, along with the entity's position.
+pub struct AudioSource {
+    /// Asset path of the sound, read through the `Vfs`
+    pub path: String,
+    pub volume: f32,
+    pub looping: bool,
+    /// Attenuated and panned by the distance to the `AudioListener`, using the entity's
+    /// `Transform`
+    pub spatial: bool,
+    /// Whether the sound is decoded while playing instead of once into the shared clip cache;
+    /// `None` streams files larger than `STREAM_THRESHOLD`
+    pub stream: Option<bool>,
+    /// Weight against other sounds when more are playing than `AudioPlugin::voice_limits`
+    /// allows, the least audible ones are virtualized
+    pub priority: f32,
+    pub category: VoiceCategory,
+    pub playing: bool,
+    id: SoundId,
+    synced: Option<Synced>,
+}
+
+/// State last sent to the audio thread.
+struct Synced {
+    volume: f32,
+    playing: bool,
+    position: Option<[f32; 3]>,
+}
+
+impl AudioSource {
+    /// A spatial source that starts playing at the next frame.
+    pub fn new(path: &str) -> Self {
+        Self {
+            path: path.to_owned(),
+            volume: 1.0,
+            looping: false,
+            spatial: true,
+            stream: None,
+            priority: 1.0,
+            category: VoiceCategory::default(),
+            playing: true,
+            id: SoundId::next(),
+            synced: None,
+        }
+    }
+
+    pub fn id(&self) -> SoundId {
+        self.id
+    }
+}
+
+/// Marks the entity whose `Transform` is the ears of the player.
+#[derive(Default)]
+pub struct AudioListener;
+
+fn position(transform: Option<&Transform>) -> Option<[f32; 3]> {
+    transform.map(|transform| [transform.position.x, transform.position.y, 0.0])
+}
+
+#[system(for_each)]
+pub fn audio_source_sync(
+    source: &mut AudioSource,
+    transform: Option<&Transform>,
+    #[resource] commands: &mut AudioCommands,
+    #[resource] vfs: &Vfs,
+) {
+    let position = if source.spatial {
+        position(transform)
+    } else {
+        None
+    };
+    let id = source.id;
+    let synced = match &mut source.synced {
+        Some(synced) => synced,
+        None if !source.playing => return,
+        None => {
+            let file = match commands.open(vfs, &source.path) {
+                Ok(file) => file,
+                Err(error) => {
+                    log::error!("Unable to open sound `{}`: {}", source.path, error);
+                    source.playing = false;
+                    return;
+                }
+            };
+            let streaming = source.stream.unwrap_or_else(|| file.len > STREAM_THRESHOLD);
+            commands.send(AudioCommand::Play {
+                id,
+                path: file.path,
+                volume: source.volume,
+                looping: source.looping,
+                position,
+                priority: source.priority,
+                category: source.category,
+                one_shot: false,
+                streaming,
+            });
+            source.synced = Some(Synced {
+                volume: source.volume,
+                playing: true,
+                position,
+            });
+            return;
+        }
+    };
+
+    if synced.playing != source.playing {
+        commands.send(if source.playing {
+            AudioCommand::Resume(id)
+        } else {
+            AudioCommand::Stop(id)
+        });
+        synced.playing = source.playing;
+    }
+    if synced.volume != source.volume {
+        commands.send(AudioCommand::SetVolume(id, source.volume));
+        synced.volume = source.volume;
+    }
+    if synced.position != position {
+        if let Some(position) = position {
+            commands.send(AudioCommand::SetPosition(id, position));
+        }
+        synced.position = position;
+    }
+}
+
+/// Frees the sounds of removed sources on the audio thread.
+#[system]
+#[read_component(AudioSource)]
+pub fn audio_source_cleanup(
+    world: &SubWorld,
+    #[state] reader: &mut ComponentEventReader<AudioSource>,
+    #[state] sounds: &mut HashMap<Entity, SoundId>,
+    #[resource] source_events: &ComponentEvents<AudioSource>,
+    #[resource] commands: &mut AudioCommands,
+) {
+    for event in reader.read(source_events) {
+        match event {
+            ComponentEvent::Added(entity) => {
+                if let Ok(entry) = world.entry_ref(*entity) {
+                    if let Ok(source) = entry.get_component::<AudioSource>() {
+                        sounds.insert(*entity, source.id);
+                    }
+                }
+            }
+            ComponentEvent::Removed(entity) => {
+                if let Some(id) = sounds.remove(entity) {
+                    commands.send(AudioCommand::Release(id));
+                }
+            }
+            _ => {}
+        }
+    }
+}
+
+#[system(for_each)]
+pub fn audio_listener_sync(
+    _listener: &AudioListener,
+    transform: &Transform,
+    #[state] synced: &mut Option<[f32; 3]>,
+    #[resource] commands: &mut AudioCommands,
+) {
+    let position = position(Some(transform));
+    if *synced != position {
+        if let Some(position) = position {
+            commands.send(AudioCommand::SetListenerPosition(position));
+        }
+        *synced = position;
+    }
+}
@@ -0,0 +1,16 @@
+//! Audio for tempeh apps. A miniaudio engine is owned by a dedicated audio thread; systems only
+//! ever talk to it through `AudioCommands`, a lock-free queue, so neither side waits on the other.
+
+pub mod command;
+pub mod component;
+pub mod plugins;
+pub mod stats;
+pub(crate) mod thread;
+
+pub mod prelude {
+    pub use crate::command::{AudioCommand, AudioCommands, SoundId};
+    pub use crate::component::{AudioListener, AudioSource};
+    pub use crate::plugins::AudioPlugin;
+    pub use crate::stats::AudioStats;
+    pub use tempeh_miniaudio::voice::{VoiceCategory, VoiceLimits};
+}
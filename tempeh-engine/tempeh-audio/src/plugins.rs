@@ -0,0 +1,51 @@
+use tempeh_core::plugins::Plugin;
+use tempeh_core::AppBuilder;
+use tempeh_ecs::events::ComponentEventReader;
+use tempeh_ecs::{Resources, World};
+use tempeh_miniaudio::voice::VoiceLimits;
+
+use crate::command::AudioCommands;
+use crate::component::{
+    audio_listener_sync_system, audio_source_cleanup_system, audio_source_sync_system, AudioSource,
+};
+use crate::stats::AudioStats;
+
+pub struct AudioPlugin {
+    /// Commands the queue to the audio thread holds before they wait on the game side
+    pub command_capacity: usize,
+    /// Sounds mixed at once, the least audible ones beyond them are virtualized
+    pub voice_limits: VoiceLimits,
+}
+
+impl Default for AudioPlugin {
+    fn default() -> Self {
+        Self {
+            command_capacity: 1024,
+            voice_limits: VoiceLimits::default(),
+        }
+    }
+}
+
+impl<W: tempeh_window::Runner> Plugin<W> for AudioPlugin {
+    fn inject(&self, app: &mut AppBuilder<W>) {
+        app.track_changes::<AudioSource>();
+        let stats = AudioStats::default();
+        app.add_resource(crate::thread::spawn(
+            self.command_capacity,
+            self.voice_limits.clone(),
+            stats.clone(),
+        ));
+        app.add_resource(stats);
+        app.add_postupdate_system(audio_source_sync_system());
+        app.add_postupdate_system(audio_source_cleanup_system(
+            ComponentEventReader::default(),
+            Default::default(),
+        ));
+        app.add_postupdate_system(audio_listener_sync_system(None));
+        app.add_frame_end_fn(|_world: &mut World, resources: &mut Resources| {
+            if let Some(mut commands) = resources.get_mut::<AudioCommands>() {
+                commands.flush();
+            }
+        });
+    }
+}
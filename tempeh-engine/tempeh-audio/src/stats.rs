@@ -0,0 +1,33 @@
+use std::sync::{Arc, Mutex};
+
+use tempeh_miniaudio::load::LoadStats;
+use tempeh_miniaudio::voice::VoiceStats;
+
+#[derive(Default)]
+struct Published {
+    voices: VoiceStats,
+    mixer: LoadStats,
+}
+
+/// What the audio thread is doing, published by it a few times per second for profiling
+/// overlays and logs.
+#[derive(Clone, Default)]
+pub struct AudioStats(Arc<Mutex<Published>>);
+
+impl AudioStats {
+    /// Voices mixed and virtual right now, and the transitions between them since the start.
+    pub fn voices(&self) -> VoiceStats {
+        self.0.lock().unwrap().voices
+    }
+
+    /// Mixer load averaged over the last quarter of a second.
+    pub fn mixer(&self) -> LoadStats {
+        self.0.lock().unwrap().mixer
+    }
+
+    pub(crate) fn publish(&self, voices: VoiceStats, mixer: LoadStats) {
+        let mut published = self.0.lock().unwrap();
+        published.voices = voices;
+        published.mixer = mixer;
+    }
+}
@@ -0,0 +1,257 @@
+use std::collections::HashMap;
+use std::ffi::{CStr, CString};
+use std::time::{Duration, Instant};
+
+use tempeh_engine::ring::{ring_buffer, Consumer};
+use tempeh_miniaudio::engine::Engine;
+use tempeh_miniaudio::pool::VoicePool;
+use tempeh_miniaudio::sound::{Sound, SoundFlags};
+use tempeh_miniaudio::voice::{VoiceLimits, VoiceManager, VoiceParams};
+
+use crate::command::{AudioCommand, AudioCommands, SoundData, SoundId};
+use crate::stats::AudioStats;
+
+/// Stopped voices kept per clip for the next plays, enough for rapid fire of one sound.
+const MAX_IDLE_VOICES_PER_CLIP: usize = 16;
+
+/// How long the audio thread sleeps between checks for finished one-shot sounds when no command
+/// wakes it up.
+const IDLE_TIMEOUT: Duration = Duration::from_millis(50);
+
+/// Period over which the mixer load is averaged before being published to `AudioStats`.
+pub(crate) const STATS_WINDOW: Duration = Duration::from_millis(250);
+
+/// What the voice manager does not know about a sound.
+struct Voice {
+    one_shot: bool,
+    path: CString,
+    /// A pooled voice goes back to the pool instead of being uninitialized
+    pooled: bool,
+}
+
+/// A sound sent with `AudioCommand::Register`.
+struct Registered {
+    _data: SoundData,
+    /// Unregistered once no voice plays it anymore
+    unloaded: bool,
+}
+
+struct Voices<'a> {
+    engine: &'a Engine,
+    pool: VoicePool<'a>,
+    manager: VoiceManager<'a, SoundId>,
+    playing: HashMap<SoundId, Voice>,
+    /// Declared after every field holding sounds, so it is dropped after them
+    registered: HashMap<CString, Registered>,
+}
+
+impl<'a> Voices<'a> {
+    fn release(&mut self, id: SoundId) {
+        if let Some(voice) = self.playing.remove(&id) {
+            if let Some(sound) = self.manager.remove(id) {
+                self.recycle(&voice, sound);
+            }
+            self.unregister_unused(&voice.path);
+        }
+    }
+
+    fn recycle(&mut self, voice: &Voice, sound: Sound<'a>) {
+        if voice.pooled {
+            self.pool.release(&voice.path, sound);
+        }
+    }
+
+    fn register(&mut self, path: CString, data: SoundData) {
+        // The bytes are the same when a sound is registered again after an `Unload`, and voices
+        // may still be reading the first ones
+        if let Some(registered) = self.registered.get_mut(&path) {
+            registered.unloaded = false;
+            return;
+        }
+        // Safety: the data is kept in `registered` until no sound uses it
+        let result = unsafe {
+            match &data {
+                SoundData::Encoded(bytes) => self.engine.register_encoded_data(&path, bytes),
+                SoundData::Pcm {
+                    samples,
+                    channels,
+                    sample_rate,
+                } => self
+                    .engine
+                    .register_decoded_data(&path, samples, *channels, *sample_rate),
+            }
+        };
+        match result {
+            Ok(()) => {
+                self.registered.insert(
+                    path,
+                    Registered {
+                        _data: data,
+                        unloaded: false,
+                    },
+                );
+            }
+            Err(error) => log::error!("Unable to register sound {:?}: {:?}", path, error),
+        }
+    }
+
+    fn unload(&mut self, path: CString) {
+        self.pool.unload(&path);
+        if let Some(registered) = self.registered.get_mut(&path) {
+            registered.unloaded = true;
+            self.unregister_unused(&path);
+        }
+    }
+
+    fn unregister_unused(&mut self, path: &CStr) {
+        let unused = self.registered.get(path).map_or(false, |registered| {
+            registered.unloaded
+                && self
+                    .playing
+                    .values()
+                    .all(|voice| voice.path.as_c_str() != path)
+        });
+        if unused {
+            self.engine.unregister_data(path);
+            self.registered.remove(path);
+        }
+    }
+
+    fn release_finished_one_shots(&mut self) {
+        let finished: Vec<SoundId> = self
+            .playing
+            .iter()
+            .filter(|(id, voice)| voice.one_shot && self.manager.is_finished(**id))
+            .map(|(id, _)| *id)
+            .collect();
+        for id in finished {
+            self.release(id);
+        }
+    }
+}
+
+/// Starts the audio thread, which owns the miniaudio engine for as long as the returned queue is
+/// alive. miniaudio mixes on its own device thread; this one only applies commands to it and
+/// decides which sounds are mixed within `limits`.
+pub(crate) fn spawn(capacity: usize, limits: VoiceLimits, stats: AudioStats) -> AudioCommands {
+    let (producer, consumer) = ring_buffer(capacity);
+    let thread = std::thread::Builder::new()
+        .name("tempeh-audio".to_owned())
+        .spawn(move || run(consumer, limits, stats))
+        .expect("Unable to spawn audio thread");
+    AudioCommands::new(producer, thread)
+}
+
+fn run(mut commands: Consumer<AudioCommand>, limits: VoiceLimits, stats: AudioStats) {
+    let engine = match Engine::new() {
+        Ok(engine) => engine,
+        Err(error) => {
+            log::error!("Unable to start the audio engine: {:?}", error);
+            return;
+        }
+    };
+    let mut voices = Voices {
+        engine: &engine,
+        pool: VoicePool::new(&engine, MAX_IDLE_VOICES_PER_CLIP),
+        manager: VoiceManager::new(limits),
+        playing: HashMap::new(),
+        registered: HashMap::new(),
+    };
+    let mut window_start = Instant::now();
+    loop {
+        while let Some(command) = commands.pop() {
+            if let AudioCommand::Shutdown = command {
+                return;
+            }
+            apply(&engine, &mut voices, command);
+        }
+        voices.manager.update();
+        voices.release_finished_one_shots();
+        if window_start.elapsed() >= STATS_WINDOW {
+            stats.publish(voices.manager.stats(), engine.load().take());
+            window_start = Instant::now();
+        }
+        std::thread::park_timeout(IDLE_TIMEOUT);
+    }
+}
+
+fn apply<'a>(engine: &'a Engine, voices: &mut Voices<'a>, command: AudioCommand) {
+    match command {
+        AudioCommand::Play {
+            id,
+            path,
+            volume,
+            looping,
+            position,
+            priority,
+            category,
+            one_shot,
+            streaming,
+        } => {
+            let sound = if streaming {
+                let flags = match position {
+                    Some(_) => SoundFlags::ASYNC,
+                    None => SoundFlags::ASYNC | SoundFlags::NO_SPATIALIZATION,
+                };
+                // A registered sound is already in memory, it is decoded from there while playing
+                let flags = if voices.registered.contains_key(&path) {
+                    flags
+                } else {
+                    flags | SoundFlags::STREAM
+                };
+                engine.create_sound_from_file(&path, flags)
+            } else {
+                voices.pool.acquire(&path).map(|mut sound| {
+                    sound.set_spatialization_enabled(position.is_some());
+                    sound
+                })
+            };
+            let sound = match sound {
+                Ok(sound) => sound,
+                Err(error) => {
+                    log::error!("Unable to load sound {:?}: {:?}", path, error);
+                    return;
+                }
+            };
+            let voice = Voice {
+                one_shot,
+                path,
+                pooled: !streaming,
+            };
+            let params = VoiceParams {
+                priority,
+                category,
+                volume,
+                position,
+                looping,
+            };
+            // Started by the next `VoiceManager::update` if it is among the most audible
+            let previous = voices.manager.insert(id, sound, params);
+            let previous_voice = voices.playing.insert(id, voice);
+            if let (Some(sound), Some(voice)) = (previous, previous_voice) {
+                voices.recycle(&voice, sound);
+                voices.unregister_unused(&voice.path);
+            }
+        }
+        AudioCommand::Register { path, data } => voices.register(path, data),
+        AudioCommand::Preload(path) => {
+            if let Err(error) = voices.pool.preload(&path) {
+                log::error!("Unable to load sound {:?}: {:?}", path, error);
+            }
+        }
+        AudioCommand::Unload(path) => voices.unload(path),
+        AudioCommand::Resume(id) => voices.manager.resume(id),
+        AudioCommand::Stop(id) => voices.manager.pause(id),
+        AudioCommand::SetVolume(id, volume) => voices.manager.set_volume(id, volume),
+        AudioCommand::SetPosition(id, position) => voices.manager.set_position(id, position),
+        AudioCommand::Release(id) => voices.release(id),
+        AudioCommand::SetListenerPosition(position) => {
+            engine.set_listener_position(0, position);
+            voices.manager.set_listener_position(position);
+        }
+        AudioCommand::SetMasterVolume(volume) => {
+            let _ = engine.set_volume(volume);
+        }
+        AudioCommand::Shutdown => {}
+    }
+}
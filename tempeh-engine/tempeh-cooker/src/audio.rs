@@ -0,0 +1,207 @@
+//! Decoding and resampling of audio sources to the engine's mixing rate.
+
+use std::convert::TryInto;
+use std::io::Cursor;
+
+pub struct Pcm {
+    pub sample_rate: u32,
+    pub channels: u32,
+    /// Interleaved samples in [-1, 1]
+    pub samples: Vec<f32>,
+}
+
+pub fn decode(extension: &str, bytes: &[u8]) -> Result<Pcm, String> {
+    match extension {
+        "wav" => decode_wav(bytes),
+        "ogg" => decode_ogg(bytes),
+        _ => Err(format!("unsupported audio format `{}`", extension)),
+    }
+}
+
+fn decode_ogg(bytes: &[u8]) -> Result<Pcm, String> {
+    let mut reader = lewton::inside_ogg::OggStreamReader::new(Cursor::new(bytes))
+        .map_err(|error| error.to_string())?;
+    let sample_rate = reader.ident_hdr.audio_sample_rate;
+    let channels = reader.ident_hdr.audio_channels as u32;
+    let mut samples = Vec::new();
+    while let Some(packet) = reader
+        .read_dec_packet_itl()
+        .map_err(|error| error.to_string())?
+    {
+        samples.extend(packet.iter().map(|&sample| sample as f32 / 32768.0));
+    }
+    Ok(Pcm {
+        sample_rate,
+        channels,
+        samples,
+    })
+}
+
+fn read_u16(bytes: &[u8], offset: usize) -> Option<u16> {
+    Some(u16::from_le_bytes(
+        bytes.get(offset..offset + 2)?.try_into().ok()?,
+    ))
+}
+
+fn read_u32(bytes: &[u8], offset: usize) -> Option<u32> {
+    Some(u32::from_le_bytes(
+        bytes.get(offset..offset + 4)?.try_into().ok()?,
+    ))
+}
+
+/// RIFF WAVE with integer PCM of 8 to 32 bits or 32 bit float samples.
+fn decode_wav(bytes: &[u8]) -> Result<Pcm, String> {
+    if bytes.len() < 12 || &bytes[0..4] != b"RIFF" || &bytes[8..12] != b"WAVE" {
+        return Err("not a RIFF WAVE file".to_owned());
+    }
+
+    let mut format = None;
+    let mut data = None;
+    let mut offset = 12;
+    while let Some(chunk_len) = read_u32(bytes, offset + 4) {
+        let start = offset + 8;
+        let end = start
+            .checked_add(chunk_len as usize)
+            .filter(|end| *end <= bytes.len())
+            .ok_or("truncated chunk")?;
+        match &bytes[offset..offset + 4] {
+            b"fmt " => format = Some(&bytes[start..end]),
+            b"data" => data = Some(&bytes[start..end]),
+            _ => {}
+        }
+        // Chunks are padded to an even size
+        offset = end + (chunk_len as usize & 1);
+    }
+    let format = format.ok_or("missing fmt chunk")?;
+    let data = data.ok_or("missing data chunk")?;
+
+    let tag = read_u16(format, 0).ok_or("truncated fmt chunk")?;
+    let channels = read_u16(format, 2).ok_or("truncated fmt chunk")? as u32;
+    let sample_rate = read_u32(format, 4).ok_or("truncated fmt chunk")?;
+    let bits = read_u16(format, 14).ok_or("truncated fmt chunk")?;
+    if channels == 0 {
+        return Err("no channels".to_owned());
+    }
+    if sample_rate == 0 {
+        return Err("sample rate of 0".to_owned());
+    }
+
+    // 1 is integer PCM, 3 is IEEE float, 0xfffe is WAVE_FORMAT_EXTENSIBLE which keeps the real
+    // tag in its sub format and is treated like the matching plain tag
+    let is_float = match (tag, bits) {
+        (1, 8) | (1, 16) | (1, 24) | (1, 32) => false,
+        (3, 32) => true,
+        (0xfffe, 32) => read_u16(format, 24) == Some(3),
+        (0xfffe, 8) | (0xfffe, 16) | (0xfffe, 24) => false,
+        _ => {
+            return Err(format!(
+                "unsupported sample format {} with {} bits",
+                tag, bits
+            ))
+        }
+    };
+    let width = bits as usize / 8;
+    let samples = data
+        .chunks_exact(width)
+        .map(|sample| match (width, is_float) {
+            (1, _) => (sample[0] as f32 - 128.0) / 128.0,
+            (2, _) => i16::from_le_bytes([sample[0], sample[1]]) as f32 / 32768.0,
+            (3, _) => {
+                (i32::from_le_bytes([0, sample[0], sample[1], sample[2]]) >> 8) as f32 / 8_388_608.0
+            }
+            (_, true) => f32::from_le_bytes([sample[0], sample[1], sample[2], sample[3]]),
+            (_, false) => {
+                i32::from_le_bytes([sample[0], sample[1], sample[2], sample[3]]) as f32
+                    / 2_147_483_648.0
+            }
+        })
+        .collect();
+
+    Ok(Pcm {
+        sample_rate,
+        channels,
+        samples,
+    })
+}
+
+/// Linear interpolation, which is enough for the usual 44.1 kHz to 48 kHz conversion of effects
+/// and music.
+pub fn resample(pcm: &Pcm, sample_rate: u32) -> Vec<f32> {
+    let channels = pcm.channels as usize;
+    let frames = pcm.samples.len() / channels;
+    if pcm.sample_rate == sample_rate || frames == 0 {
+        return pcm.samples[..frames * channels].to_vec();
+    }
+
+    let step = pcm.sample_rate as f64 / sample_rate as f64;
+    let out_frames = ((frames as f64) / step).floor() as usize;
+    let mut out = Vec::with_capacity(out_frames * channels);
+    for frame in 0..out_frames {
+        let position = frame as f64 * step;
+        let index = position as usize;
+        let next = (index + 1).min(frames - 1);
+        let fraction = (position - index as f64) as f32;
+        for channel in 0..channels {
+            let a = pcm.samples[index * channels + channel];
+            let b = pcm.samples[next * channels + channel];
+            out.push(a + (b - a) * fraction);
+        }
+    }
+    out
+}
+
+pub fn to_i16(samples: &[f32]) -> Vec<i16> {
+    samples
+        .iter()
+        .map(|sample| (sample.max(-1.0).min(1.0) * 32767.0).round() as i16)
+        .collect()
+}
+
+#[cfg(test)]
+pub(crate) mod tests {
+    use super::*;
+
+    /// 16 bit integer PCM.
+    pub(crate) fn wav(channels: u16, sample_rate: u32, samples: &[i16]) -> Vec<u8> {
+        let data_len = samples.len() as u32 * 2;
+        let mut wav = Vec::new();
+        wav.extend_from_slice(b"RIFF");
+        wav.extend_from_slice(&(36 + data_len).to_le_bytes());
+        wav.extend_from_slice(b"WAVEfmt ");
+        wav.extend_from_slice(&16_u32.to_le_bytes());
+        wav.extend_from_slice(&1_u16.to_le_bytes());
+        wav.extend_from_slice(&channels.to_le_bytes());
+        wav.extend_from_slice(&sample_rate.to_le_bytes());
+        wav.extend_from_slice(&(sample_rate * channels as u32 * 2).to_le_bytes());
+        wav.extend_from_slice(&(channels * 2).to_le_bytes());
+        wav.extend_from_slice(&16_u16.to_le_bytes());
+        wav.extend_from_slice(b"data");
+        wav.extend_from_slice(&data_len.to_le_bytes());
+        for sample in samples {
+            wav.extend_from_slice(&sample.to_le_bytes());
+        }
+        wav
+    }
+
+    #[test]
+    fn decodes_and_resamples_wav() {
+        let wav = wav(1, 24_000, &[0, 16384, -16384, 32767]);
+
+        let pcm = decode("wav", &wav).unwrap();
+        assert_eq!(
+            (pcm.sample_rate, pcm.channels, pcm.samples.len()),
+            (24_000, 1, 4)
+        );
+        assert_eq!(pcm.samples[1], 0.5);
+
+        let resampled = to_i16(&resample(&pcm, 48_000));
+        assert_eq!(resampled.len(), 8);
+        assert_eq!(&resampled[..3], &[0, 8192, 16384]);
+    }
+
+    #[test]
+    fn rejects_wav_without_rate_or_channels() {
+        assert!(decode("wav", &wav(1, 0, &[0, 1])).is_err());
+        assert!(decode("wav", &wav(0, 24_000, &[0, 1])).is_err());
+    }
+}
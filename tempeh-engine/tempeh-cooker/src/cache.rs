@@ -0,0 +1,110 @@
+use std::fmt;
+use std::io;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+/// Hash of everything a cooked output depends on: the source bytes, the cooker that ran and its
+/// settings. Two sources with the same content share one cache entry.
+#[derive(Debug, Copy, Clone, PartialEq, Eq, Hash)]
+pub struct CacheKey(pub [u8; 32]);
+
+impl fmt::Display for CacheKey {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        for byte in &self.0 {
+            write!(f, "{:02x}", byte)?;
+        }
+        Ok(())
+    }
+}
+
+/// Directory of cooked outputs named by their `CacheKey`.
+pub struct BuildCache {
+    dir: PathBuf,
+}
+
+impl BuildCache {
+    pub fn open<P: Into<PathBuf>>(dir: P) -> io::Result<Self> {
+        let dir = dir.into();
+        std::fs::create_dir_all(&dir)?;
+        Ok(Self { dir })
+    }
+
+    fn path(&self, key: &CacheKey) -> PathBuf {
+        self.dir.join(key.to_string())
+    }
+
+    pub fn get(&self, key: &CacheKey) -> Option<Vec<u8>> {
+        std::fs::read(self.path(key)).ok()
+    }
+
+    /// Writes through a temporary file, so an interrupted cook never leaves a truncated entry
+    /// behind under a valid key.
+    ///
+    /// Sources with the same content share a key and are cooked in parallel, so every writer gets
+    /// its own temporary file. Whichever rename lands last wins, and since the outputs are
+    /// identical a destination that already exists counts as written.
+    pub fn insert(&self, key: &CacheKey, bytes: &[u8]) -> io::Result<()> {
+        static NEXT_WRITER: AtomicUsize = AtomicUsize::new(0);
+
+        let path = self.path(key);
+        let temporary = self.dir.join(format!(
+            "{}.{}-{}.tmp",
+            key,
+            std::process::id(),
+            NEXT_WRITER.fetch_add(1, Ordering::Relaxed)
+        ));
+        std::fs::write(&temporary, bytes)?;
+        match std::fs::rename(&temporary, &path) {
+            Ok(()) => Ok(()),
+            // Renaming over an existing file fails on Windows
+            Err(_) if path.is_file() => std::fs::remove_file(&temporary),
+            Err(error) => {
+                let _ = std::fs::remove_file(&temporary);
+                Err(error)
+            }
+        }
+    }
+
+    /// Removes every entry whose key is not in `keep`, returns how many were removed.
+    pub fn prune(&self, keep: &std::collections::HashSet<String>) -> io::Result<usize> {
+        let mut removed = 0;
+        for entry in std::fs::read_dir(&self.dir)? {
+            let entry = entry?;
+            let name = entry.file_name().to_string_lossy().into_owned();
+            if !keep.contains(&name) {
+                std::fs::remove_file(entry.path())?;
+                removed += 1;
+            }
+        }
+        Ok(removed)
+    }
+
+    pub fn dir(&self) -> &Path {
+        &self.dir
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn entries_are_found_by_key() {
+        let dir = std::env::temp_dir().join(format!("tempeh-cooker-cache-{}", std::process::id()));
+        let _ = std::fs::remove_dir_all(&dir);
+        let cache = BuildCache::open(&dir).unwrap();
+        let (fresh, stale) = (CacheKey([1; 32]), CacheKey([2; 32]));
+        assert_eq!(cache.get(&fresh), None);
+
+        cache.insert(&fresh, b"cooked").unwrap();
+        cache.insert(&fresh, b"cooked").unwrap();
+        cache.insert(&stale, b"stale").unwrap();
+        assert_eq!(cache.get(&fresh).as_deref(), Some(&b"cooked"[..]));
+
+        // No temporary file is left behind to be pruned
+        let keep = std::iter::once(fresh.to_string()).collect();
+        assert_eq!(cache.prune(&keep).unwrap(), 1);
+        assert!(cache.get(&fresh).is_some() && cache.get(&stale).is_none());
+        std::fs::remove_dir_all(&dir).unwrap();
+    }
+}
@@ -0,0 +1,276 @@
+use std::path::{Path, PathBuf};
+
+use serde::Serialize;
+use tempeh_filesystem::cooked::{CookedAudio, CookedTexture};
+
+use crate::audio;
+use crate::cache::{BuildCache, CacheKey};
+
+/// Bumped whenever a cooker changes its output, which invalidates every cache entry.
+const COOKER_VERSION: u32 = 1;
+
+#[derive(Debug, Clone)]
+pub struct CookSettings {
+    /// Rate all audio is resampled to, the rate the mixer runs at
+    pub sample_rate: u32,
+}
+
+impl Default for CookSettings {
+    fn default() -> Self {
+        Self {
+            sample_rate: 48_000,
+        }
+    }
+}
+
+#[derive(Debug, Copy, Clone, PartialEq, Eq, Serialize)]
+pub enum AssetKind {
+    Texture,
+    Shader,
+    Audio,
+    /// Copied unchanged
+    Raw,
+}
+
+impl AssetKind {
+    pub fn detect(extension: &str) -> Self {
+        match extension {
+            "png" | "jpg" | "jpeg" | "bmp" | "tga" | "gif" => AssetKind::Texture,
+            "vert" | "frag" | "comp" => AssetKind::Shader,
+            "wav" | "ogg" => AssetKind::Audio,
+            _ => AssetKind::Raw,
+        }
+    }
+
+    fn tag(self) -> &'static str {
+        match self {
+            AssetKind::Texture => "texture",
+            AssetKind::Shader => "shader",
+            AssetKind::Audio => "audio",
+            AssetKind::Raw => "raw",
+        }
+    }
+}
+
+pub struct SourceAsset {
+    /// Path relative to the asset root, `/` separated
+    pub path: String,
+    pub file: PathBuf,
+    pub kind: AssetKind,
+}
+
+impl SourceAsset {
+    fn extension(&self) -> String {
+        self.file
+            .extension()
+            .map(|extension| extension.to_string_lossy().to_ascii_lowercase())
+            .unwrap_or_default()
+    }
+
+    /// Path of the cooked asset in the pack. Shaders are looked up by their SPIR-V name, the same
+    /// one the renderer's build script produces; everything else keeps its source path.
+    pub fn output_path(&self) -> String {
+        match self.kind {
+            AssetKind::Shader => format!("{}.spv", self.path),
+            _ => self.path.clone(),
+        }
+    }
+}
+
+pub struct CookedAsset {
+    pub path: String,
+    pub kind: AssetKind,
+    pub key: CacheKey,
+    pub bytes: Vec<u8>,
+    /// Whether the output came from the cache instead of being cooked again
+    pub cached: bool,
+}
+
+/// Every file under `root`, sorted by path. Hidden files and directories are skipped.
+pub fn find_sources(root: &Path) -> std::io::Result<Vec<SourceAsset>> {
+    fn walk(root: &Path, dir: &Path, out: &mut Vec<SourceAsset>) -> std::io::Result<()> {
+        for entry in std::fs::read_dir(dir)? {
+            let entry = entry?;
+            let file = entry.path();
+            if entry.file_name().to_string_lossy().starts_with('.') {
+                continue;
+            }
+            if entry.file_type()?.is_dir() {
+                walk(root, &file, out)?;
+                continue;
+            }
+            let path = file
+                .strip_prefix(root)
+                .expect("Walked file is under the root")
+                .components()
+                .map(|component| component.as_os_str().to_string_lossy())
+                .collect::<Vec<_>>()
+                .join("/");
+            let extension = file
+                .extension()
+                .map(|extension| extension.to_string_lossy().to_ascii_lowercase())
+                .unwrap_or_default();
+            out.push(SourceAsset {
+                path,
+                kind: AssetKind::detect(&extension),
+                file,
+            });
+        }
+        Ok(())
+    }
+
+    let mut sources = Vec::new();
+    walk(root, root, &mut sources)?;
+    sources.sort_by(|a, b| a.path.cmp(&b.path));
+    Ok(sources)
+}
+
+fn cache_key(source: &SourceAsset, settings: &CookSettings, bytes: &[u8]) -> CacheKey {
+    let mut hasher = blake3::Hasher::new();
+    hasher.update(&COOKER_VERSION.to_le_bytes());
+    hasher.update(source.kind.tag().as_bytes());
+    match source.kind {
+        AssetKind::Audio => {
+            hasher.update(&settings.sample_rate.to_le_bytes());
+        }
+        // Shader stages are picked by extension, and the file name shows up in diagnostics
+        AssetKind::Shader => {
+            hasher.update(source.path.as_bytes());
+        }
+        AssetKind::Texture | AssetKind::Raw => {}
+    }
+    hasher.update(bytes);
+    CacheKey(*hasher.finalize().as_bytes())
+}
+
+/// Cooks `source`, or takes the output from `cache` if the same input was cooked with the same
+/// settings before.
+pub fn cook(
+    source: &SourceAsset,
+    settings: &CookSettings,
+    cache: &BuildCache,
+) -> Result<CookedAsset, String> {
+    let bytes = std::fs::read(&source.file).map_err(|error| error.to_string())?;
+    let key = cache_key(source, settings, &bytes);
+    let (bytes, cached) = match cache.get(&key) {
+        Some(cooked) => (cooked, true),
+        None => {
+            let cooked = match source.kind {
+                AssetKind::Texture => cook_texture(&bytes)?,
+                AssetKind::Shader => cook_shader(source, &bytes)?,
+                AssetKind::Audio => cook_audio(&source.extension(), &bytes, settings)?,
+                AssetKind::Raw => bytes,
+            };
+            cache
+                .insert(&key, &cooked)
+                .map_err(|error| format!("unable to write cache entry: {}", error))?;
+            (cooked, false)
+        }
+    };
+    Ok(CookedAsset {
+        path: source.output_path(),
+        kind: source.kind,
+        key,
+        bytes,
+        cached,
+    })
+}
+
+/// Decodes to tightly packed RGBA8, the format textures are uploaded in.
+fn cook_texture(bytes: &[u8]) -> Result<Vec<u8>, String> {
+    let image = image::load_from_memory(bytes).map_err(|error| error.to_string())?;
+    let rgba = image.to_rgba8();
+    Ok(CookedTexture::encode(
+        rgba.width(),
+        rgba.height(),
+        rgba.as_raw(),
+    ))
+}
+
+fn cook_shader(source: &SourceAsset, bytes: &[u8]) -> Result<Vec<u8>, String> {
+    let kind = match source.extension().as_str() {
+        "vert" => shaderc::ShaderKind::Vertex,
+        "frag" => shaderc::ShaderKind::Fragment,
+        _ => shaderc::ShaderKind::Compute,
+    };
+    let glsl = std::str::from_utf8(bytes).map_err(|_| "shader is not UTF-8".to_owned())?;
+    // Compilers are not shareable between threads, and creating one is cheap next to compiling
+    let mut compiler = shaderc::Compiler::new().ok_or("unable to create shader compiler")?;
+    let compiled = compiler
+        .compile_into_spirv(glsl, kind, &source.path, "main", None)
+        .map_err(|error| error.to_string())?;
+    Ok(compiled.as_binary_u8().to_vec())
+}
+
+fn cook_audio(extension: &str, bytes: &[u8], settings: &CookSettings) -> Result<Vec<u8>, String> {
+    let pcm = audio::decode(extension, bytes)?;
+    let samples = audio::to_i16(&audio::resample(&pcm, settings.sample_rate));
+    Ok(CookedAudio::encode(
+        settings.sample_rate,
+        pcm.channels,
+        &samples,
+    ))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::audio::tests::wav;
+
+    #[test]
+    fn cooks_once_then_hits_the_cache() {
+        let dir = std::env::temp_dir().join(format!("tempeh-cooker-cook-{}", std::process::id()));
+        let _ = std::fs::remove_dir_all(&dir);
+        let assets = dir.join("assets");
+        std::fs::create_dir_all(assets.join("sounds")).unwrap();
+        std::fs::write(assets.join("notes.txt"), b"notes").unwrap();
+        let hit = wav(2, 24_000, &[0, 0, 16384, -16384]);
+        std::fs::write(assets.join("sounds/hit.wav"), hit).unwrap();
+        let cache = BuildCache::open(dir.join("cache")).unwrap();
+        let settings = CookSettings::default();
+
+        let sources = find_sources(&assets).unwrap();
+        let found: Vec<_> = sources
+            .iter()
+            .map(|source| (source.path.as_str(), source.kind))
+            .collect();
+        assert_eq!(
+            found,
+            [
+                ("notes.txt", AssetKind::Raw),
+                ("sounds/hit.wav", AssetKind::Audio)
+            ]
+        );
+
+        let notes = cook(&sources[0], &settings, &cache).unwrap();
+        assert_eq!((&notes.bytes[..], notes.cached), (&b"notes"[..], false));
+
+        let sound = cook(&sources[1], &settings, &cache).unwrap();
+        assert_eq!(
+            (sound.path.as_str(), sound.cached),
+            ("sounds/hit.wav", false)
+        );
+        let cooked = CookedAudio::parse(&sound.bytes).unwrap();
+        assert_eq!(
+            (cooked.sample_rate, cooked.channels, cooked.frame_count),
+            (48_000, 2, 4)
+        );
+        let samples: Vec<i16> = cooked
+            .samples
+            .chunks_exact(2)
+            .map(|sample| i16::from_ne_bytes([sample[0], sample[1]]))
+            .collect();
+        assert_eq!(samples, [0, 0, 8192, -8192, 16384, -16384, 16384, -16384]);
+
+        let again = cook(&sources[1], &settings, &cache).unwrap();
+        assert!(again.cached);
+        assert_eq!((again.key, &again.bytes), (sound.key, &sound.bytes));
+
+        // The settings are part of the key
+        let settings = CookSettings {
+            sample_rate: 24_000,
+        };
+        assert!(!cook(&sources[1], &settings, &cache).unwrap().cached);
+        std::fs::remove_dir_all(&dir).unwrap();
+    }
+}
@@ -0,0 +1,176 @@
+//! Offline asset cooker.
+//!
+//! Walks an asset directory, converts every asset into the form the runtime uses directly and
+//! writes the results into an asset pack for the `Vfs`:
+//!
+//! - images become RGBA8 textures (`tempeh_filesystem::cooked::CookedTexture`)
+//! - GLSL shaders are compiled to SPIR-V
+//! - WAV and Ogg Vorbis sounds are resampled to the mixing rate
+//!   (`tempeh_filesystem::cooked::CookedAudio`)
+//! - anything else is copied
+//!
+//! Outputs are cached by the hash of their input and settings, so a cook only redoes the assets
+//! that changed since the last one. The pack's hashed table of contents is the manifest the
+//! runtime looks assets up in; a readable listing is written next to it.
+//!
+//! ```text
+//! tempeh-cooker [--assets DIR] [--out FILE] [--cache DIR] [--sample-rate HZ]
+//!               [--compression none|lz4] [--prune]
+//! ```
+
+mod audio;
+mod cache;
+mod cook;
+
+use std::collections::HashSet;
+use std::path::PathBuf;
+use std::time::Instant;
+
+use rayon::prelude::*;
+use serde::Serialize;
+use tempeh_filesystem::{Compression, PackBuilder, DEFAULT_ASSET_DIR, DEFAULT_ASSET_PACK};
+
+use crate::cache::BuildCache;
+use crate::cook::{AssetKind, CookSettings};
+
+struct Options {
+    assets: PathBuf,
+    out: PathBuf,
+    cache: PathBuf,
+    settings: CookSettings,
+    compression: Compression,
+    prune: bool,
+}
+
+impl Options {
+    fn parse() -> Result<Self, String> {
+        let mut options = Self {
+            assets: PathBuf::from(DEFAULT_ASSET_DIR),
+            out: PathBuf::from(DEFAULT_ASSET_PACK),
+            cache: PathBuf::from("target/asset-cache"),
+            settings: CookSettings::default(),
+            compression: Compression::Lz4,
+            prune: false,
+        };
+        let mut args = std::env::args().skip(1);
+        while let Some(arg) = args.next() {
+            let mut value = || args.next().ok_or(format!("missing value for {}", arg));
+            match arg.as_str() {
+                "--assets" => options.assets = value()?.into(),
+                "--out" => options.out = value()?.into(),
+                "--cache" => options.cache = value()?.into(),
+                "--sample-rate" => {
+                    options.settings.sample_rate = value()?
+                        .parse()
+                        .map_err(|_| "sample rate is not a number".to_owned())?
+                }
+                "--compression" => {
+                    options.compression = match value()?.as_str() {
+                        "none" => Compression::None,
+                        "lz4" => Compression::Lz4,
+                        other => return Err(format!("unknown compression `{}`", other)),
+                    }
+                }
+                "--prune" => options.prune = true,
+                other => return Err(format!("unknown argument `{}`", other)),
+            }
+        }
+        Ok(options)
+    }
+}
+
+#[derive(Serialize)]
+struct ManifestEntry {
+    path: String,
+    kind: AssetKind,
+    key: String,
+    len: usize,
+}
+
+fn run(options: &Options) -> Result<(), String> {
+    let start = Instant::now();
+    let cache = BuildCache::open(&options.cache).map_err(|error| {
+        format!(
+            "unable to open cache {}: {}",
+            options.cache.display(),
+            error
+        )
+    })?;
+    let sources = cook::find_sources(&options.assets)
+        .map_err(|error| format!("unable to read {}: {}", options.assets.display(), error))?;
+
+    let results: Vec<_> = sources
+        .par_iter()
+        .map(|source| {
+            cook::cook(source, &options.settings, &cache)
+                .map_err(|error| format!("{}: {}", source.path, error))
+        })
+        .collect();
+
+    let mut builder = PackBuilder::new();
+    let mut manifest = Vec::with_capacity(results.len());
+    let mut failed = 0;
+    let mut cooked = 0;
+    for result in results {
+        let asset = match result {
+            Ok(asset) => asset,
+            Err(error) => {
+                log::error!("{}", error);
+                failed += 1;
+                continue;
+            }
+        };
+        if !asset.cached {
+            log::info!("Cooked {}", asset.path);
+            cooked += 1;
+        }
+        builder
+            .add(&asset.path, &asset.bytes, options.compression)
+            .map_err(|error| error.to_string())?;
+        manifest.push(ManifestEntry {
+            path: asset.path,
+            kind: asset.kind,
+            key: asset.key.to_string(),
+            len: asset.bytes.len(),
+        });
+    }
+    if failed > 0 {
+        return Err(format!("{} assets failed to cook", failed));
+    }
+
+    builder
+        .write_to_file(&options.out)
+        .map_err(|error| format!("unable to write {}: {}", options.out.display(), error))?;
+    let listing = ron::ser::to_string_pretty(&manifest, ron::ser::PrettyConfig::default())
+        .map_err(|error| error.to_string())?;
+    let listing_path = options.out.with_extension("manifest.ron");
+    std::fs::write(&listing_path, listing)
+        .map_err(|error| format!("unable to write {}: {}", listing_path.display(), error))?;
+
+    if options.prune {
+        let keep: HashSet<String> = manifest.iter().map(|entry| entry.key.clone()).collect();
+        let removed = cache
+            .prune(&keep)
+            .map_err(|error| format!("unable to prune {}: {}", cache.dir().display(), error))?;
+        log::info!("Pruned {} stale cache entries", removed);
+    }
+
+    println!(
+        "{} assets, {} cooked, {} from cache, in {:?} -> {}",
+        manifest.len(),
+        cooked,
+        manifest.len() - cooked,
+        start.elapsed(),
+        options.out.display()
+    );
+    Ok(())
+}
+
+fn main() {
+    env_logger::Builder::from_env(env_logger::Env::default().default_filter_or("info")).init();
+    let result = Options::parse().and_then(|options| run(&options));
+    if let Err(error) = result {
+        log::error!("{}", error);
+        std::process::exit(1);
+    }
+}
@@ -0,0 +1,67 @@
+//! Batched transform kernels against the per-entity vertex code the sprite renderer used before.
+//!
+//! Run with `cargo bench -p tempeh-core-component --bench transform_batch`.
+
+use std::time::{Duration, Instant};
+
+use tempeh_core_component::batch::BatchKernel;
+use tempeh_core_component::Transform;
+use tempeh_math::Point2;
+
+const STRIDE: usize = 5;
+
+/// The per-entity code of the old `sprite_render_queue`, extended with scale and rotation so it
+/// does the same amount of work as the kernels.
+fn per_entity(transforms: &[Transform], out: &mut [f32]) {
+    for (transform, vertices) in transforms.iter().zip(out.chunks_mut(4 * STRIDE)) {
+        let (sin, cos) = transform.rotation.sin_cos();
+        let corners = [[1.0, -1.0], [1.0, 1.0], [-1.0, -1.0], [-1.0, 1.0]];
+        for (corner, [ux, uy]) in corners.iter().enumerate() {
+            let x = ux * transform.scale.x;
+            let y = uy * transform.scale.y;
+            let vertex = &mut vertices[corner * STRIDE..];
+            vertex[0] = transform.position.x + x * cos - y * sin;
+            vertex[1] = -(transform.position.y + x * sin + y * cos);
+        }
+    }
+}
+
+fn measure<F: FnMut(&[Transform], &mut [f32])>(count: usize, mut f: F) -> Duration {
+    let transforms = (0..count)
+        .map(|i| Transform {
+            position: Point2::new(i as f32, i as f32 * 0.5),
+            scale: Point2::new(1.0, 2.0),
+            rotation: i as f32 * 0.01,
+        })
+        .collect::<Vec<_>>();
+    let mut out = vec![0.0_f32; count * 4 * STRIDE];
+    let iterations = (10_000_000 / count).max(10);
+    f(&transforms, &mut out);
+    let start = Instant::now();
+    for _ in 0..iterations {
+        f(&transforms, &mut out);
+    }
+    std::hint::black_box(&out);
+    start.elapsed() / iterations as u32
+}
+
+fn main() {
+    let detected = BatchKernel::detect();
+    println!(
+        "{:>10} {:>12} {:>12} {:>12}",
+        "sprites",
+        "per entity",
+        "scalar",
+        format!("{:?}", detected)
+    );
+    for &count in &[100, 1_000, 10_000, 100_000] {
+        println!(
+            "{:>10} {:>12?} {:>12?} {:>12?}",
+            count,
+            measure(count, per_entity),
+            measure(count, |t, out| BatchKernel::Scalar
+                .write_quad_corners(t, out, STRIDE)),
+            measure(count, |t, out| detected.write_quad_corners(t, out, STRIDE)),
+        );
+    }
+}
@@ -0,0 +1,593 @@
+//! Batched transform kernels.
+//!
+//! Computes world matrices and sprite quad corners for whole slices of `Transform`s, such as the
+//! component slice of a legion chunk. Transforms are loaded a block of lanes at a time into
+//! structure-of-arrays registers (4 lanes for SSE2 and NEON, 8 for AVX2 + FMA), so the sine and
+//! cosine of the rotation, which dominate the cost, are evaluated for a whole block at once. The
+//! kernel is picked at runtime with `BatchKernel::detect`; every kernel produces the same results
+//! as the scalar fallback up to float rounding.
+//!
+//! `Transform` is in y-down screen space while vertex positions are y-up, so quad corners are
+//! written with the y axis flipped, the same as the sprite renderer always did.
+
+use bytemuck::{Pod, Zeroable};
+
+use crate::Transform;
+
+/// Column-major 2x3 affine matrix.
+#[repr(C)]
+#[derive(Debug, Default, Clone, Copy, PartialEq, Pod, Zeroable)]
+pub struct Affine2 {
+    pub x_axis: [f32; 2],
+    pub y_axis: [f32; 2],
+    pub translation: [f32; 2],
+}
+
+impl Affine2 {
+    pub const IDENTITY: Self = Self {
+        x_axis: [1.0, 0.0],
+        y_axis: [0.0, 1.0],
+        translation: [0.0, 0.0],
+    };
+
+    pub fn from_transform(transform: &Transform) -> Self {
+        let (sin, cos) = transform.rotation.sin_cos();
+        Self {
+            x_axis: [transform.scale.x * cos, transform.scale.x * sin],
+            y_axis: [-transform.scale.y * sin, transform.scale.y * cos],
+            translation: [transform.position.x, transform.position.y],
+        }
+    }
+
+    pub fn transform_point(&self, point: [f32; 2]) -> [f32; 2] {
+        [
+            self.x_axis[0] * point[0] + self.y_axis[0] * point[1] + self.translation[0],
+            self.x_axis[1] * point[0] + self.y_axis[1] * point[1] + self.translation[1],
+        ]
+    }
+}
+
+/// `a * b` applies `b` first, then `a`.
+impl std::ops::Mul for Affine2 {
+    type Output = Self;
+
+    fn mul(self, rhs: Self) -> Self {
+        let transform_vector = |v: [f32; 2]| {
+            [
+                self.x_axis[0] * v[0] + self.y_axis[0] * v[1],
+                self.x_axis[1] * v[0] + self.y_axis[1] * v[1],
+            ]
+        };
+        Self {
+            x_axis: transform_vector(rhs.x_axis),
+            y_axis: transform_vector(rhs.y_axis),
+            translation: self.transform_point(rhs.translation),
+        }
+    }
+}
+
+/// Local corners of a sprite quad in the order of the sprite vertex buffer, in y-down space.
+pub const QUAD_CORNERS: [[f32; 2]; 4] = [[1.0, -1.0], [1.0, 1.0], [-1.0, -1.0], [-1.0, 1.0]];
+
+const MAX_LANES: usize = 8;
+
+/// Output of one block: the four matrix coefficients, the translation and the corners, one array
+/// per value with one element per lane.
+#[derive(Default)]
+struct Block {
+    m00: [f32; MAX_LANES],
+    m01: [f32; MAX_LANES],
+    m10: [f32; MAX_LANES],
+    m11: [f32; MAX_LANES],
+    px: [f32; MAX_LANES],
+    py: [f32; MAX_LANES],
+    corner_x: [[f32; MAX_LANES]; 4],
+    corner_y: [[f32; MAX_LANES]; 4],
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum BatchKernel {
+    Scalar,
+    #[cfg(target_arch = "x86_64")]
+    Sse2,
+    #[cfg(target_arch = "x86_64")]
+    Avx2,
+    #[cfg(target_arch = "aarch64")]
+    Neon,
+}
+
+impl BatchKernel {
+    /// The widest kernel supported by the running CPU.
+    pub fn detect() -> Self {
+        #[cfg(target_arch = "x86_64")]
+        {
+            if is_x86_feature_detected!("avx2") && is_x86_feature_detected!("fma") {
+                return BatchKernel::Avx2;
+            }
+            // SSE2 is part of the x86_64 baseline
+            return BatchKernel::Sse2;
+        }
+        #[cfg(target_arch = "aarch64")]
+        {
+            // NEON is part of the aarch64 baseline
+            return BatchKernel::Neon;
+        }
+        #[allow(unreachable_code)]
+        BatchKernel::Scalar
+    }
+
+    pub fn lanes(self) -> usize {
+        match self {
+            BatchKernel::Scalar => 1,
+            #[cfg(target_arch = "x86_64")]
+            BatchKernel::Sse2 => 4,
+            #[cfg(target_arch = "x86_64")]
+            BatchKernel::Avx2 => 8,
+            #[cfg(target_arch = "aarch64")]
+            BatchKernel::Neon => 4,
+        }
+    }
+
+    /// Writes the world matrix of every transform into `out`, which must be at least as long as
+    /// `transforms`.
+    pub fn compute_affines(self, transforms: &[Transform], out: &mut [Affine2]) {
+        assert!(out.len() >= transforms.len(), "Output is too small");
+        self.for_each_block(transforms, |first, len, block| {
+            for lane in 0..len {
+                out[first + lane] = Affine2 {
+                    x_axis: [block.m00[lane], block.m10[lane]],
+                    y_axis: [block.m01[lane], block.m11[lane]],
+                    translation: [block.px[lane], block.py[lane]],
+                };
+            }
+        });
+    }
+
+    /// Writes the four corners of every transform's quad as y-up positions into `out`.
+    ///
+    /// `out` is viewed as an array of vertices of `stride` floats each; corner `c` of transform
+    /// `i` goes to the first two floats of vertex `4 * i + c`, the rest of the vertex is left
+    /// untouched. This way the corners can be written straight into an interleaved vertex upload
+    /// buffer.
+    pub fn write_quad_corners(self, transforms: &[Transform], out: &mut [f32], stride: usize) {
+        assert!(stride >= 2, "Stride must leave room for a position");
+        assert!(
+            out.len() >= transforms.len() * 4 * stride,
+            "Output is too small"
+        );
+        self.for_each_block(transforms, |first, len, block| {
+            for lane in 0..len {
+                let base = (first + lane) * 4 * stride;
+                for corner in 0..4 {
+                    let vertex = base + corner * stride;
+                    out[vertex] = block.corner_x[corner][lane];
+                    out[vertex + 1] = block.corner_y[corner][lane];
+                }
+            }
+        });
+    }
+
+    /// Same as `write_quad_corners` for matrices that are already computed, such as the
+    /// `GlobalTransform`s of the hierarchy. Without a rotation to evaluate every kernel comes down
+    /// to the same multiply-adds, which are left to the compiler to vectorize.
+    pub fn write_affine_quad_corners(self, affines: &[Affine2], out: &mut [f32], stride: usize) {
+        assert!(stride >= 2, "Stride must leave room for a position");
+        assert!(
+            out.len() >= affines.len() * 4 * stride,
+            "Output is too small"
+        );
+        for (affine, vertices) in affines.iter().zip(out.chunks_mut(4 * stride)) {
+            for (corner, vertex) in QUAD_CORNERS.iter().zip(vertices.chunks_mut(stride)) {
+                let [x, y] = affine.transform_point(*corner);
+                vertex[0] = x;
+                vertex[1] = -y;
+            }
+        }
+    }
+
+    fn for_each_block<F: FnMut(usize, usize, &Block)>(self, transforms: &[Transform], mut sink: F) {
+        let lanes = self.lanes();
+        let mut block = Block::default();
+        let mut first = 0;
+        while first < transforms.len() {
+            let remaining = &transforms[first..];
+            let len = if remaining.len() >= lanes {
+                // Safety: the kernel was either detected on this CPU or is part of the baseline of
+                // the target, and `remaining` holds at least `lanes` transforms
+                unsafe { self.compute_block(remaining, &mut block) };
+                lanes
+            } else {
+                // The tail of the slice that does not fill a block
+                scalar::compute_block(&remaining[..1], &mut block);
+                1
+            };
+            sink(first, len, &block);
+            first += len;
+        }
+    }
+
+    unsafe fn compute_block(self, transforms: &[Transform], block: &mut Block) {
+        match self {
+            BatchKernel::Scalar => scalar::compute_block(&transforms[..1], block),
+            #[cfg(target_arch = "x86_64")]
+            BatchKernel::Sse2 => x86::compute_block_sse2(transforms, block),
+            #[cfg(target_arch = "x86_64")]
+            BatchKernel::Avx2 => x86::compute_block_avx2(transforms, block),
+            #[cfg(target_arch = "aarch64")]
+            BatchKernel::Neon => neon::compute_block(transforms, block),
+        }
+    }
+}
+
+impl Default for BatchKernel {
+    fn default() -> Self {
+        Self::detect()
+    }
+}
+
+// Cody-Waite reduction by pi/2 followed by the single precision minimax polynomials from Cephes.
+// Accurate to a few ulp for |x| < 8192, far beyond any sensible rotation.
+const FRAC_2_PI: f32 = std::f32::consts::FRAC_2_PI;
+const PIO2_HI: f32 = 1.570_796_4;
+const PIO2_LO: f32 = -4.371_139e-8;
+const SIN_C1: f32 = -1.666_665_5e-1;
+const SIN_C2: f32 = 8.332_161e-3;
+const SIN_C3: f32 = -1.951_529_6e-4;
+const COS_C1: f32 = 4.166_664_6e-2;
+const COS_C2: f32 = -1.388_731_6e-3;
+const COS_C3: f32 = 2.443_315_7e-5;
+
+mod scalar {
+    use super::*;
+
+    pub fn sin_cos(x: f32) -> (f32, f32) {
+        let quadrant = (x * FRAC_2_PI).round() as i32;
+        let q = quadrant as f32;
+        let r = x - q * PIO2_HI - q * PIO2_LO;
+        let z = r * r;
+        let sin_r = r + r * z * (SIN_C1 + z * (SIN_C2 + z * SIN_C3));
+        let cos_r = 1.0 - 0.5 * z + z * z * (COS_C1 + z * (COS_C2 + z * COS_C3));
+        let (sin, cos) = if quadrant & 1 == 0 {
+            (sin_r, cos_r)
+        } else {
+            (cos_r, sin_r)
+        };
+        let sin = if quadrant & 2 == 0 { sin } else { -sin };
+        let cos = if quadrant.wrapping_add(1) & 2 == 0 {
+            cos
+        } else {
+            -cos
+        };
+        (sin, cos)
+    }
+
+    /// Computes lane 0 of `block` from `transforms[0]`.
+    pub fn compute_block(transforms: &[Transform], block: &mut Block) {
+        let transform = &transforms[0];
+        let (sin, cos) = sin_cos(transform.rotation);
+        let m00 = transform.scale.x * cos;
+        let m01 = -transform.scale.y * sin;
+        let m10 = transform.scale.x * sin;
+        let m11 = transform.scale.y * cos;
+        let px = transform.position.x;
+        let py = transform.position.y;
+        block.m00[0] = m00;
+        block.m01[0] = m01;
+        block.m10[0] = m10;
+        block.m11[0] = m11;
+        block.px[0] = px;
+        block.py[0] = py;
+        for (corner, [ux, uy]) in QUAD_CORNERS.iter().enumerate() {
+            block.corner_x[corner][0] = px + ux * m00 + uy * m01;
+            block.corner_y[corner][0] = -(py + ux * m10 + uy * m11);
+        }
+    }
+}
+
+/// Transposes the first `N` transforms into one array per field.
+#[inline(always)]
+fn gather<const N: usize>(transforms: &[Transform]) -> [[f32; N]; 5] {
+    let mut lanes = [[0.0; N]; 5];
+    for (lane, transform) in transforms[..N].iter().enumerate() {
+        lanes[0][lane] = transform.position.x;
+        lanes[1][lane] = transform.position.y;
+        lanes[2][lane] = transform.scale.x;
+        lanes[3][lane] = transform.scale.y;
+        lanes[4][lane] = transform.rotation;
+    }
+    lanes
+}
+
+#[cfg(target_arch = "x86_64")]
+mod x86 {
+    use super::*;
+    use std::arch::x86_64::*;
+
+    #[target_feature(enable = "sse2")]
+    unsafe fn sin_cos_sse2(x: __m128) -> (__m128, __m128) {
+        let quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(FRAC_2_PI)));
+        let q = _mm_cvtepi32_ps(quadrant);
+        let r = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(PIO2_HI)));
+        let r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(PIO2_LO)));
+        let z = _mm_mul_ps(r, r);
+
+        let sin_poly = _mm_add_ps(_mm_set1_ps(SIN_C2), _mm_mul_ps(z, _mm_set1_ps(SIN_C3)));
+        let sin_poly = _mm_add_ps(_mm_set1_ps(SIN_C1), _mm_mul_ps(z, sin_poly));
+        let sin_r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), sin_poly));
+
+        let cos_poly = _mm_add_ps(_mm_set1_ps(COS_C2), _mm_mul_ps(z, _mm_set1_ps(COS_C3)));
+        let cos_poly = _mm_add_ps(_mm_set1_ps(COS_C1), _mm_mul_ps(z, cos_poly));
+        let cos_r = _mm_sub_ps(_mm_set1_ps(1.0), _mm_mul_ps(_mm_set1_ps(0.5), z));
+        let cos_r = _mm_add_ps(cos_r, _mm_mul_ps(_mm_mul_ps(z, z), cos_poly));
+
+        let swap = _mm_castsi128_ps(_mm_cmpeq_epi32(
+            _mm_and_si128(quadrant, _mm_set1_epi32(1)),
+            _mm_set1_epi32(1),
+        ));
+        let sin = _mm_or_ps(_mm_and_ps(swap, cos_r), _mm_andnot_ps(swap, sin_r));
+        let cos = _mm_or_ps(_mm_and_ps(swap, sin_r), _mm_andnot_ps(swap, cos_r));
+        let sin_sign = _mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30);
+        let cos_sign = _mm_slli_epi32(
+            _mm_and_si128(
+                _mm_add_epi32(quadrant, _mm_set1_epi32(1)),
+                _mm_set1_epi32(2),
+            ),
+            30,
+        );
+        (
+            _mm_xor_ps(sin, _mm_castsi128_ps(sin_sign)),
+            _mm_xor_ps(cos, _mm_castsi128_ps(cos_sign)),
+        )
+    }
+
+    #[target_feature(enable = "sse2")]
+    pub unsafe fn compute_block_sse2(transforms: &[Transform], block: &mut Block) {
+        let [px, py, sx, sy, rotation] = gather::<4>(transforms);
+        let px = _mm_loadu_ps(px.as_ptr());
+        let py = _mm_loadu_ps(py.as_ptr());
+        let sx = _mm_loadu_ps(sx.as_ptr());
+        let sy = _mm_loadu_ps(sy.as_ptr());
+        let (sin, cos) = sin_cos_sse2(_mm_loadu_ps(rotation.as_ptr()));
+
+        let m00 = _mm_mul_ps(sx, cos);
+        let m01 = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sy, sin));
+        let m10 = _mm_mul_ps(sx, sin);
+        let m11 = _mm_mul_ps(sy, cos);
+        _mm_storeu_ps(block.m00.as_mut_ptr(), m00);
+        _mm_storeu_ps(block.m01.as_mut_ptr(), m01);
+        _mm_storeu_ps(block.m10.as_mut_ptr(), m10);
+        _mm_storeu_ps(block.m11.as_mut_ptr(), m11);
+        _mm_storeu_ps(block.px.as_mut_ptr(), px);
+        _mm_storeu_ps(block.py.as_mut_ptr(), py);
+
+        let negative_py = _mm_sub_ps(_mm_setzero_ps(), py);
+        for (corner, [ux, uy]) in QUAD_CORNERS.iter().enumerate() {
+            let ux = _mm_set1_ps(*ux);
+            let uy = _mm_set1_ps(*uy);
+            let x = _mm_add_ps(px, _mm_add_ps(_mm_mul_ps(ux, m00), _mm_mul_ps(uy, m01)));
+            let y = _mm_sub_ps(
+                negative_py,
+                _mm_add_ps(_mm_mul_ps(ux, m10), _mm_mul_ps(uy, m11)),
+            );
+            _mm_storeu_ps(block.corner_x[corner].as_mut_ptr(), x);
+            _mm_storeu_ps(block.corner_y[corner].as_mut_ptr(), y);
+        }
+    }
+
+    #[target_feature(enable = "avx2,fma")]
+    unsafe fn sin_cos_avx2(x: __m256) -> (__m256, __m256) {
+        let quadrant = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(FRAC_2_PI)));
+        let q = _mm256_cvtepi32_ps(quadrant);
+        let r = _mm256_fnmadd_ps(q, _mm256_set1_ps(PIO2_HI), x);
+        let r = _mm256_fnmadd_ps(q, _mm256_set1_ps(PIO2_LO), r);
+        let z = _mm256_mul_ps(r, r);
+
+        let sin_poly = _mm256_fmadd_ps(z, _mm256_set1_ps(SIN_C3), _mm256_set1_ps(SIN_C2));
+        let sin_poly = _mm256_fmadd_ps(z, sin_poly, _mm256_set1_ps(SIN_C1));
+        let sin_r = _mm256_fmadd_ps(_mm256_mul_ps(r, z), sin_poly, r);
+
+        let cos_poly = _mm256_fmadd_ps(z, _mm256_set1_ps(COS_C3), _mm256_set1_ps(COS_C2));
+        let cos_poly = _mm256_fmadd_ps(z, cos_poly, _mm256_set1_ps(COS_C1));
+        let cos_r = _mm256_fnmadd_ps(_mm256_set1_ps(0.5), z, _mm256_set1_ps(1.0));
+        let cos_r = _mm256_fmadd_ps(_mm256_mul_ps(z, z), cos_poly, cos_r);
+
+        let swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+            _mm256_and_si256(quadrant, _mm256_set1_epi32(1)),
+            _mm256_set1_epi32(1),
+        ));
+        let sin = _mm256_blendv_ps(sin_r, cos_r, swap);
+        let cos = _mm256_blendv_ps(cos_r, sin_r, swap);
+        let sin_sign = _mm256_slli_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(2)), 30);
+        let cos_sign = _mm256_slli_epi32(
+            _mm256_and_si256(
+                _mm256_add_epi32(quadrant, _mm256_set1_epi32(1)),
+                _mm256_set1_epi32(2),
+            ),
+            30,
+        );
+        (
+            _mm256_xor_ps(sin, _mm256_castsi256_ps(sin_sign)),
+            _mm256_xor_ps(cos, _mm256_castsi256_ps(cos_sign)),
+        )
+    }
+
+    #[target_feature(enable = "avx2,fma")]
+    pub unsafe fn compute_block_avx2(transforms: &[Transform], block: &mut Block) {
+        let [px, py, sx, sy, rotation] = gather::<8>(transforms);
+        let px = _mm256_loadu_ps(px.as_ptr());
+        let py = _mm256_loadu_ps(py.as_ptr());
+        let sx = _mm256_loadu_ps(sx.as_ptr());
+        let sy = _mm256_loadu_ps(sy.as_ptr());
+        let (sin, cos) = sin_cos_avx2(_mm256_loadu_ps(rotation.as_ptr()));
+
+        let m00 = _mm256_mul_ps(sx, cos);
+        let m01 = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(sy, sin));
+        let m10 = _mm256_mul_ps(sx, sin);
+        let m11 = _mm256_mul_ps(sy, cos);
+        _mm256_storeu_ps(block.m00.as_mut_ptr(), m00);
+        _mm256_storeu_ps(block.m01.as_mut_ptr(), m01);
+        _mm256_storeu_ps(block.m10.as_mut_ptr(), m10);
+        _mm256_storeu_ps(block.m11.as_mut_ptr(), m11);
+        _mm256_storeu_ps(block.px.as_mut_ptr(), px);
+        _mm256_storeu_ps(block.py.as_mut_ptr(), py);
+
+        let negative_py = _mm256_sub_ps(_mm256_setzero_ps(), py);
+        for (corner, [ux, uy]) in QUAD_CORNERS.iter().enumerate() {
+            let ux = _mm256_set1_ps(*ux);
+            let uy = _mm256_set1_ps(*uy);
+            let x = _mm256_fmadd_ps(ux, m00, _mm256_fmadd_ps(uy, m01, px));
+            let y = _mm256_fnmadd_ps(ux, m10, _mm256_fnmadd_ps(uy, m11, negative_py));
+            _mm256_storeu_ps(block.corner_x[corner].as_mut_ptr(), x);
+            _mm256_storeu_ps(block.corner_y[corner].as_mut_ptr(), y);
+        }
+    }
+}
+
+#[cfg(target_arch = "aarch64")]
+mod neon {
+    use super::*;
+    use std::arch::aarch64::*;
+
+    #[target_feature(enable = "neon")]
+    unsafe fn sin_cos(x: float32x4_t) -> (float32x4_t, float32x4_t) {
+        let quadrant = vcvtnq_s32_f32(vmulq_n_f32(x, FRAC_2_PI));
+        let q = vcvtq_f32_s32(quadrant);
+        let r = vfmsq_f32(x, q, vdupq_n_f32(PIO2_HI));
+        let r = vfmsq_f32(r, q, vdupq_n_f32(PIO2_LO));
+        let z = vmulq_f32(r, r);
+
+        let sin_poly = vfmaq_f32(vdupq_n_f32(SIN_C2), z, vdupq_n_f32(SIN_C3));
+        let sin_poly = vfmaq_f32(vdupq_n_f32(SIN_C1), z, sin_poly);
+        let sin_r = vfmaq_f32(r, vmulq_f32(r, z), sin_poly);
+
+        let cos_poly = vfmaq_f32(vdupq_n_f32(COS_C2), z, vdupq_n_f32(COS_C3));
+        let cos_poly = vfmaq_f32(vdupq_n_f32(COS_C1), z, cos_poly);
+        let cos_r = vfmsq_f32(vdupq_n_f32(1.0), vdupq_n_f32(0.5), z);
+        let cos_r = vfmaq_f32(cos_r, vmulq_f32(z, z), cos_poly);
+
+        let swap = vtstq_s32(quadrant, vdupq_n_s32(1));
+        let sin = vbslq_f32(swap, cos_r, sin_r);
+        let cos = vbslq_f32(swap, sin_r, cos_r);
+        let sin_sign = vreinterpretq_u32_s32(vshlq_n_s32(vandq_s32(quadrant, vdupq_n_s32(2)), 30));
+        let cos_sign = vreinterpretq_u32_s32(vshlq_n_s32(
+            vandq_s32(vaddq_s32(quadrant, vdupq_n_s32(1)), vdupq_n_s32(2)),
+            30,
+        ));
+        (
+            vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(sin), sin_sign)),
+            vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(cos), cos_sign)),
+        )
+    }
+
+    #[target_feature(enable = "neon")]
+    pub unsafe fn compute_block(transforms: &[Transform], block: &mut Block) {
+        let [px, py, sx, sy, rotation] = gather::<4>(transforms);
+        let px = vld1q_f32(px.as_ptr());
+        let py = vld1q_f32(py.as_ptr());
+        let sx = vld1q_f32(sx.as_ptr());
+        let sy = vld1q_f32(sy.as_ptr());
+        let (sin, cos) = sin_cos(vld1q_f32(rotation.as_ptr()));
+
+        let m00 = vmulq_f32(sx, cos);
+        let m01 = vnegq_f32(vmulq_f32(sy, sin));
+        let m10 = vmulq_f32(sx, sin);
+        let m11 = vmulq_f32(sy, cos);
+        vst1q_f32(block.m00.as_mut_ptr(), m00);
+        vst1q_f32(block.m01.as_mut_ptr(), m01);
+        vst1q_f32(block.m10.as_mut_ptr(), m10);
+        vst1q_f32(block.m11.as_mut_ptr(), m11);
+        vst1q_f32(block.px.as_mut_ptr(), px);
+        vst1q_f32(block.py.as_mut_ptr(), py);
+
+        let negative_py = vnegq_f32(py);
+        for (corner, [ux, uy]) in QUAD_CORNERS.iter().enumerate() {
+            let x = vfmaq_n_f32(vfmaq_n_f32(px, m01, *uy), m00, *ux);
+            let y = vfmsq_f32(
+                vfmsq_f32(negative_py, m11, vdupq_n_f32(*uy)),
+                m10,
+                vdupq_n_f32(*ux),
+            );
+            vst1q_f32(block.corner_x[corner].as_mut_ptr(), x);
+            vst1q_f32(block.corner_y[corner].as_mut_ptr(), y);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use tempeh_math::Point2;
+
+    fn transforms(count: usize) -> Vec<Transform> {
+        (0..count)
+            .map(|i| Transform {
+                position: Point2::new(i as f32 * 0.5, -(i as f32)),
+                scale: Point2::new(1.0 + i as f32 * 0.01, 2.0),
+                rotation: (i as f32 - 50.0) * 0.37,
+            })
+            .collect()
+    }
+
+    #[test]
+    fn sin_cos_matches_std() {
+        let mut x = -100.0_f32;
+        while x < 100.0 {
+            let (sin, cos) = scalar::sin_cos(x);
+            assert!((sin - x.sin()).abs() < 1e-5, "sin({})", x);
+            assert!((cos - x.cos()).abs() < 1e-5, "cos({})", x);
+            x += 0.01;
+        }
+    }
+
+    #[test]
+    fn detected_kernel_matches_scalar() {
+        // 103 is not a multiple of any lane count so the scalar tail is exercised as well
+        let transforms = transforms(103);
+        let kernel = BatchKernel::detect();
+
+        let mut expected = vec![Affine2::default(); transforms.len()];
+        let mut actual = expected.clone();
+        BatchKernel::Scalar.compute_affines(&transforms, &mut expected);
+        kernel.compute_affines(&transforms, &mut actual);
+        for (expected, actual) in expected.iter().zip(&actual) {
+            let expected = bytemuck::cast::<_, [f32; 6]>(*expected);
+            let actual = bytemuck::cast::<_, [f32; 6]>(*actual);
+            for (e, a) in expected.iter().zip(&actual) {
+                assert!((e - a).abs() < 1e-4, "{:?} != {:?}", expected, actual);
+            }
+        }
+
+        let stride = 5;
+        let mut expected = vec![7.0; transforms.len() * 4 * stride];
+        let mut actual = expected.clone();
+        BatchKernel::Scalar.write_quad_corners(&transforms, &mut expected, stride);
+        kernel.write_quad_corners(&transforms, &mut actual, stride);
+        for (e, a) in expected.iter().zip(&actual) {
+            assert!((e - a).abs() < 1e-3);
+        }
+        // Everything past the position is left untouched
+        assert!(actual.chunks(stride).all(|vertex| vertex[2..] == [7.0; 3]));
+    }
+
+    #[test]
+    fn affine_corners_match_transform_corners() {
+        let transforms = transforms(9);
+        let mut affines = vec![Affine2::default(); transforms.len()];
+        BatchKernel::Scalar.compute_affines(&transforms, &mut affines);
+
+        let mut expected = vec![0.0; transforms.len() * 8];
+        let mut actual = expected.clone();
+        BatchKernel::Scalar.write_quad_corners(&transforms, &mut expected, 2);
+        BatchKernel::detect().write_affine_quad_corners(&affines, &mut actual, 2);
+        for (e, a) in expected.iter().zip(&actual) {
+            assert!((e - a).abs() < 1e-4);
+        }
+    }
+
+    #[test]
+    fn default_transform_gives_unit_quad() {
+        let mut corners = [0.0; 8];
+        BatchKernel::detect().write_quad_corners(&[Transform::default()], &mut corners, 2);
+        assert_eq!(corners, [1.0, 1.0, 1.0, -1.0, -1.0, 1.0, -1.0, -1.0]);
+    }
+}
@@ -1,21 +1,48 @@
+pub mod batch;
+
+use serde::{Deserialize, Serialize};
+
+use crate::batch::Affine2;
 use tempeh_math::prelude::*;
 
+// Laid out as five consecutive f32 so scenes can store it as a plain column blob. Relative to the
+// parent when the entity has a `tempeh_core::hierarchy::Parent`.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq, Serialize, Deserialize)]
 pub struct Transform {
     pub position: Point2<f32>,
     pub scale: Point2<f32>,
     pub rotation: f32,
 }
 
+unsafe impl bytemuck::Zeroable for Transform {}
+unsafe impl bytemuck::Pod for Transform {}
+
 impl Default for Transform {
     fn default() -> Self {
         Self {
             position: Point2::new(0.0, 0.0),
-            scale: Point2::new(0.0, 0.0),
+            scale: Point2::new(1.0, 1.0),
             rotation: 0.0,
         }
     }
 }
 
+/// World-space matrix of an entity, the product of its own `Transform` and those of all its
+/// ancestors. Maintained by the transform hierarchy, never written by user code.
+#[repr(transparent)]
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct GlobalTransform(pub Affine2);
+
+unsafe impl bytemuck::Zeroable for GlobalTransform {}
+unsafe impl bytemuck::Pod for GlobalTransform {}
+
+impl Default for GlobalTransform {
+    fn default() -> Self {
+        Self(Affine2::IDENTITY)
+    }
+}
+
 pub mod prelude {
-    pub use crate::Transform;
+    pub use crate::{GlobalTransform, Transform};
 }
@@ -0,0 +1,84 @@
+//! Transform propagation in a 100k node scene where 1% of the nodes move every frame.
+//!
+//! Run with `cargo bench -p tempeh-core --bench hierarchy`.
+
+use std::time::{Duration, Instant};
+
+use tempeh_core::hierarchy::{Parent, TransformHierarchy};
+use tempeh_core_component::Transform;
+use tempeh_ecs::events::ChangeTracker;
+use tempeh_ecs::{Entity, Resources, World};
+use tempeh_math::Point2;
+
+const ROOTS: usize = 1_000;
+const CHILDREN: usize = 9;
+const GRANDCHILDREN: usize = 10;
+const FRAMES: u32 = 200;
+
+fn at(x: f32, y: f32) -> Transform {
+    Transform {
+        position: Point2::new(x, y),
+        ..Transform::default()
+    }
+}
+
+fn build_scene(world: &mut World) -> Vec<Entity> {
+    let mut nodes = Vec::new();
+    for root in 0..ROOTS {
+        let root = world.push((at(root as f32, 0.0),));
+        nodes.push(root);
+        for child in 0..CHILDREN {
+            let child = world.push((at(child as f32, 1.0), Parent(root)));
+            nodes.push(child);
+            for grandchild in 0..GRANDCHILDREN {
+                nodes.push(world.push((at(grandchild as f32, 1.0), Parent(child))));
+            }
+        }
+    }
+    nodes
+}
+
+fn main() {
+    let mut world = World::default();
+    let mut resources = Resources::default();
+    let mut tracker = ChangeTracker::new();
+    tracker.track::<Transform>(&mut world, &mut resources);
+    tracker.track::<Parent>(&mut world, &mut resources);
+    let nodes = build_scene(&mut world);
+    let mut hierarchy = TransformHierarchy::default();
+
+    let start = Instant::now();
+    tracker.update(&world, &mut resources);
+    hierarchy.update(&mut world, &resources);
+    println!("{} nodes, initial build {:?}", nodes.len(), start.elapsed());
+    // Let the archetype moves of the first build settle
+    tracker.update(&world, &mut resources);
+    hierarchy.update(&mut world, &resources);
+
+    let moving = nodes.len() / 100;
+    let mut seed = 0x2545_f491_u32;
+    let mut total = Duration::default();
+    let mut dirty_nodes = 0;
+    for frame in 0..FRAMES {
+        for _ in 0..moving {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            let entity = nodes[seed as usize % nodes.len()];
+            let mut entry = world.entry_mut(entity).unwrap();
+            entry.get_component_mut::<Transform>().unwrap().rotation = frame as f32 * 0.01;
+        }
+        tracker.update(&world, &mut resources);
+
+        let start = Instant::now();
+        hierarchy.update(&mut world, &resources);
+        total += start.elapsed();
+        dirty_nodes += hierarchy.stats().dirty_nodes;
+    }
+    println!(
+        "{} moving nodes per frame: {:?} per frame, {} dirty nodes per frame",
+        moving,
+        total / FRAMES,
+        dirty_nodes / FRAMES as usize
+    );
+}
@@ -0,0 +1,93 @@
+//! Overhead of spawning, chaining and stealing jobs, compared with spawning on rayon directly.
+//!
+//! Run with `cargo bench -p tempeh-core --bench jobs`.
+
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+use tempeh_core::jobs::{JobCounter, JobSystem};
+use tempeh_ecs::rayon;
+
+const JOBS: usize = 100_000;
+const CHAIN: usize = 10_000;
+
+fn report(name: &str, count: usize, elapsed: Duration) {
+    println!(
+        "{:<28} {:>8} jobs in {:?} ({:?} per job)",
+        name,
+        count,
+        elapsed,
+        elapsed / count as u32
+    );
+}
+
+fn main() {
+    let jobs = JobSystem::new();
+    let done = Arc::new(AtomicUsize::new(0));
+
+    // Baseline: the pool the job system runs on, without counters or stats
+    let start = Instant::now();
+    for _ in 0..JOBS {
+        let done = done.clone();
+        rayon::spawn(move || {
+            done.fetch_add(1, Ordering::Relaxed);
+        });
+    }
+    while done.load(Ordering::Acquire) < JOBS {
+        std::thread::yield_now();
+    }
+    report("rayon::spawn", JOBS, start.elapsed());
+
+    // Spawned from the main thread, so every job is injected into the pool and stolen from there
+    let start = Instant::now();
+    let counter = JobCounter::new();
+    for _ in 0..JOBS {
+        jobs.spawn_with(&counter, || {});
+    }
+    counter.wait();
+    report("spawn_with", JOBS, start.elapsed());
+
+    // Spawned from a single worker, so the other workers have to steal from its deque
+    let start = Instant::now();
+    let counter = JobCounter::new();
+    {
+        let jobs_inner = jobs.clone();
+        let counter_inner = counter.clone();
+        jobs.spawn_with(&counter, move || {
+            for _ in 0..JOBS {
+                jobs_inner.spawn_with(&counter_inner, || {});
+            }
+        });
+    }
+    counter.wait();
+    report("spawn_with from worker", JOBS, start.elapsed());
+
+    // Every job depends on the previous one, so this measures the latency of a dependency
+    let start = Instant::now();
+    let mut previous = jobs.spawn(|| {});
+    for _ in 1..CHAIN {
+        previous = jobs.spawn_after(&[&previous], || {});
+    }
+    previous.wait();
+    report("spawn_after chain", CHAIN, start.elapsed());
+
+    let start = Instant::now();
+    let mut values = vec![0_u64; JOBS];
+    jobs.scope(|scope| {
+        for value in values.iter_mut() {
+            scope.spawn(move || *value += 1);
+        }
+    });
+    report("scope spawn", JOBS, start.elapsed());
+
+    for (index, worker) in jobs.utilization().iter().enumerate() {
+        println!(
+            "worker {:>2}: {:>7} jobs, busy {:?}, {:.1}% utilization",
+            index,
+            worker.jobs,
+            worker.busy,
+            worker.utilization * 100.0
+        );
+    }
+}
@@ -1,40 +1,59 @@
+use crate::assets::{AssetGraph, AssetLoader, AssetResidency, Assets};
+use crate::jobs::JobSystem;
 use crate::plugins::Plugin;
+use crate::tasks::TaskExecutor;
 use rapier2d::prelude::*;
-use tempeh_ecs::storage::IntoComponentSource;
-use tempeh_ecs::systems::{Executor, ParallelRunnable, Resource, Step};
+use tempeh_ecs::events::ChangeTracker;
+use tempeh_ecs::storage::{Component, IntoComponentSource};
+use tempeh_ecs::systems::{Executor, Fetch, FetchMut, ParallelRunnable, Resource, Step};
 use tempeh_ecs::{Resources, Schedule, World};
 use tempeh_engine::{Physic};
+use tempeh_filesystem::Vfs;
 
 struct Systems {
+    frame_start_fn: Vec<Box<dyn FnMut(&mut World, &mut Resources)>>,
     startup_system: Vec<Box<dyn ParallelRunnable + 'static>>,
     preupdate_system: Vec<Box<dyn ParallelRunnable + 'static>>,
     update_system: Vec<Box<dyn ParallelRunnable + 'static>>,
+    update_end_fn: Vec<Box<dyn FnMut(&mut World, &mut Resources)>>,
     postupdate_system: Vec<Box<dyn ParallelRunnable + 'static>>,
+    frame_end_fn: Vec<Box<dyn FnMut(&mut World, &mut Resources)>>,
 }
 
-pub struct AppBuilder<W: tempeh_window::TempehWindow + tempeh_window::Runner> {
+pub struct AppBuilder<W: tempeh_window::Runner> {
     name: Option<String>,
     plugins: Vec<Box<dyn Plugin<W>>>,
     world: World,
     resources: Resources,
     pub window: Option<W>,
     systems: Systems,
+    change_tracker: ChangeTracker,
 }
 
-impl<'a, W: tempeh_window::TempehWindow + tempeh_window::Runner> AppBuilder<W> {
+impl<'a, W: tempeh_window::Runner> AppBuilder<W> {
     pub fn new(window: W) -> Self {
+        let mut resources = Resources::default();
+        resources.insert(JobSystem::new());
+        resources.insert(TaskExecutor::new());
+        resources.insert(Vfs::with_default_mounts());
+        resources.insert(AssetGraph::default());
+        resources.insert(AssetResidency::default());
         Self {
             name: None,
             plugins: vec![],
             world: World::default(),
-            resources: Resources::default(),
+            resources,
             window: Some(window),
             systems: Systems {
+                frame_start_fn: vec![],
                 startup_system: vec![],
                 preupdate_system: vec![],
                 update_system: vec![],
+                update_end_fn: vec![],
                 postupdate_system: vec![],
+                frame_end_fn: vec![],
             },
+            change_tracker: ChangeTracker::new(),
         }
     }
 
@@ -51,7 +70,11 @@ impl<'a, W: tempeh_window::TempehWindow + tempeh_window::Runner> AppBuilder<W> {
             Schedule::from(startup_schedule_steps).execute(&mut _world, &mut _resources);
         }
 
-        let mut schedule_steps = Vec::new();
+        // Async results from the previous frame are visible to every system of this one
+        let mut schedule_steps = vec![Step::ThreadLocalFn(Box::new(TaskExecutor::run_frame_point))];
+        for frame_start_fn in self.systems.frame_start_fn.drain(..) {
+            schedule_steps.push(Step::ThreadLocalFn(frame_start_fn));
+        }
         if self.systems.preupdate_system.len() > 0 {
             let mut systems_consumer = Vec::new();
             std::mem::swap(&mut self.systems.preupdate_system, &mut systems_consumer);
@@ -64,12 +87,29 @@ impl<'a, W: tempeh_window::TempehWindow + tempeh_window::Runner> AppBuilder<W> {
             schedule_steps.push(Step::Systems(Executor::new(systems_consumer)));
             schedule_steps.push(Step::FlushCmdBuffers);
         }
+        for update_end_fn in self.systems.update_end_fn.drain(..) {
+            schedule_steps.push(Step::ThreadLocalFn(update_end_fn));
+        }
         if self.systems.postupdate_system.len() > 0 {
             let mut systems_consumer = Vec::new();
             std::mem::swap(&mut self.systems.postupdate_system, &mut systems_consumer);
             schedule_steps.push(Step::Systems(Executor::new(systems_consumer)));
             schedule_steps.push(Step::FlushCmdBuffers);
         }
+        for frame_end_fn in self.systems.frame_end_fn.drain(..) {
+            schedule_steps.push(Step::ThreadLocalFn(frame_end_fn));
+        }
+        if !self.change_tracker.is_empty() {
+            // Publish what happened before the first frame, then track changes made by every
+            // system and frame end fn, so events are readable from the next frame on
+            let mut change_tracker = std::mem::take(&mut self.change_tracker);
+            change_tracker.update(&_world, &mut _resources);
+            schedule_steps.push(Step::ThreadLocalFn(Box::new(
+                move |world: &mut World, resources: &mut Resources| {
+                    change_tracker.update(world, resources)
+                },
+            )));
+        }
 
         self.window.take().unwrap().run(tempeh_engine::Engine {
             world: _world,
@@ -113,6 +153,12 @@ impl<'a, W: tempeh_window::TempehWindow + tempeh_window::Runner> AppBuilder<W> {
         self
     }
 
+    /// Direct access to the world before the app starts, for bulk loaders that would be slowed
+    /// down by going through `add_component` one entity at a time.
+    pub fn world_mut(&mut self) -> &mut World {
+        &mut self.world
+    }
+
     pub fn add_startup_system<T: ParallelRunnable + 'static>(&mut self, system: T) -> &mut Self {
         self.systems.startup_system.push(Box::new(system));
         self
@@ -133,8 +179,65 @@ impl<'a, W: tempeh_window::TempehWindow + tempeh_window::Runner> AppBuilder<W> {
         self
     }
 
+    /// Runs `f` on the main thread with exclusive world access between the update and postupdate
+    /// systems, for work that depends on what update systems wrote and that postupdate systems
+    /// read (transform propagation).
+    pub fn add_update_end_fn<F: FnMut(&mut World, &mut Resources) + 'static>(
+        &mut self,
+        f: F,
+    ) -> &mut Self {
+        self.systems.update_end_fn.push(Box::new(f));
+        self
+    }
+
+    /// Runs `f` on the main thread with exclusive world access after every other system of the
+    /// frame has finished, for work that cannot be expressed as a system (merging worlds, bulk
+    /// removal).
+    pub fn add_frame_end_fn<F: FnMut(&mut World, &mut Resources) + 'static>(
+        &mut self,
+        f: F,
+    ) -> &mut Self {
+        self.systems.frame_end_fn.push(Box::new(f));
+        self
+    }
+
+    /// Adds an `Assets<T>` resource whose assets are loaded from the `Vfs` by `loader`. Loads,
+    /// unloads and reloads are applied at the start of every frame, before any system runs.
+    pub fn add_asset<T, L>(&mut self, loader: L) -> &mut Self
+    where
+        T: Send + Sync + 'static,
+        L: AssetLoader<T>,
+    {
+        let graph = self
+            .resources
+            .get_or_insert_with(AssetGraph::default)
+            .clone();
+        self.resources.insert(Assets::with_loader(graph, loader));
+        self.systems
+            .frame_start_fn
+            .push(Box::new(Assets::<T>::update_resource));
+        self
+    }
+
+    /// Publishes `ComponentEvents<T>` as a resource, see `tempeh_ecs::events`.
+    pub fn track_changes<T: Component>(&mut self) -> &mut Self {
+        self.change_tracker
+            .track::<T>(&mut self.world, &mut self.resources);
+        self
+    }
+
     pub fn add_resource<T: Resource>(&mut self, resource: T) -> &mut Self {
         self.resources.insert(resource);
         self
     }
+
+    /// Resources added so far, for plugins that need one while they are being injected (the
+    /// `Vfs` to load their assets from).
+    pub fn get_resource<T: Resource>(&self) -> Option<Fetch<'_, T>> {
+        self.resources.get::<T>()
+    }
+
+    pub fn get_resource_mut<T: Resource>(&mut self) -> Option<FetchMut<'_, T>> {
+        self.resources.get_mut::<T>()
+    }
 }
@@ -0,0 +1,76 @@
+use std::any::TypeId;
+use std::collections::{HashMap, HashSet};
+use std::sync::{Arc, Mutex};
+
+use super::handle::{AssetId, UntypedAssetId};
+
+#[derive(Default)]
+struct Edges {
+    /// Assets that depend on the key, for propagating reloads
+    dependents: HashMap<UntypedAssetId, HashSet<UntypedAssetId>>,
+    /// Assets whose dependencies were modified, per asset type, until their `Assets<T>` picks
+    /// them up
+    notified: HashMap<TypeId, Vec<AssetId>>,
+}
+
+/// Dependency edges between assets of every type (material -> texture -> atlas). Shared by every
+/// `Assets<T>` of an app, which is how a reloaded atlas reaches the materials using it.
+#[derive(Clone, Default)]
+pub struct AssetGraph(Arc<Mutex<Edges>>);
+
+impl AssetGraph {
+    pub(crate) fn add_edge(&self, dependent: UntypedAssetId, dependency: UntypedAssetId) {
+        let mut edges = self.0.lock().unwrap();
+        edges
+            .dependents
+            .entry(dependency)
+            .or_default()
+            .insert(dependent);
+    }
+
+    /// Forgets an unloaded asset, given the dependencies it had.
+    pub(crate) fn remove(&self, asset: UntypedAssetId, dependencies: &[UntypedAssetId]) {
+        let mut edges = self.0.lock().unwrap();
+        edges.dependents.remove(&asset);
+        for dependency in dependencies {
+            if let Some(dependents) = edges.dependents.get_mut(dependency) {
+                dependents.remove(&asset);
+                if dependents.is_empty() {
+                    edges.dependents.remove(dependency);
+                }
+            }
+        }
+    }
+
+    /// Notifies everything that transitively depends on `modified`.
+    pub(crate) fn propagate(&self, modified: UntypedAssetId) {
+        let mut edges = self.0.lock().unwrap();
+        let mut visited = HashSet::new();
+        let mut stack = vec![modified];
+        while let Some(asset) = stack.pop() {
+            let dependents: Vec<UntypedAssetId> = match edges.dependents.get(&asset) {
+                Some(dependents) => dependents.iter().copied().collect(),
+                None => continue,
+            };
+            for dependent in dependents {
+                if visited.insert(dependent) {
+                    edges
+                        .notified
+                        .entry(dependent.type_id)
+                        .or_default()
+                        .push(dependent.id);
+                    stack.push(dependent);
+                }
+            }
+        }
+    }
+
+    pub(crate) fn take_notified(&self, type_id: TypeId) -> Vec<AssetId> {
+        self.0
+            .lock()
+            .unwrap()
+            .notified
+            .remove(&type_id)
+            .unwrap_or_default()
+    }
+}
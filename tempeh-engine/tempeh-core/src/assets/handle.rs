@@ -0,0 +1,168 @@
+use std::any::TypeId;
+use std::fmt;
+use std::hash::{Hash, Hasher};
+use std::marker::PhantomData;
+use std::sync::{Arc, Mutex, Weak};
+
+/// Generational index of an asset within its `Assets<T>`. A slot is reused once its asset is
+/// unloaded, with a new generation, so an old id never resolves to a different asset.
+#[derive(Debug, Copy, Clone, PartialEq, Eq, Hash, PartialOrd, Ord)]
+pub struct AssetId {
+    pub(crate) index: u32,
+    pub(crate) generation: u32,
+}
+
+/// `AssetId` together with the asset type, for edges between assets of different types.
+#[derive(Debug, Copy, Clone, PartialEq, Eq, Hash)]
+pub struct UntypedAssetId {
+    pub type_id: TypeId,
+    pub id: AssetId,
+}
+
+/// Queue of assets whose last strong handle was dropped, drained by the owning `Assets<T>`.
+pub(crate) type DropQueue = Arc<Mutex<Vec<AssetId>>>;
+
+pub(crate) struct HandleInner {
+    pub(crate) id: AssetId,
+    drops: DropQueue,
+}
+
+impl HandleInner {
+    pub(crate) fn new(id: AssetId, drops: DropQueue) -> Arc<Self> {
+        Arc::new(Self { id, drops })
+    }
+}
+
+impl Drop for HandleInner {
+    fn drop(&mut self) {
+        self.drops.lock().unwrap().push(self.id);
+    }
+}
+
+/// Strong reference to an asset of type `T`. The asset stays loaded while at least one strong
+/// handle to it exists; cloning a handle never clones the asset.
+pub struct Handle<T> {
+    pub(crate) inner: Arc<HandleInner>,
+    _marker: PhantomData<fn() -> T>,
+}
+
+impl<T: 'static> Handle<T> {
+    pub(crate) fn from_inner(inner: Arc<HandleInner>) -> Self {
+        Self {
+            inner,
+            _marker: PhantomData,
+        }
+    }
+
+    pub fn id(&self) -> AssetId {
+        self.inner.id
+    }
+
+    pub fn untyped_id(&self) -> UntypedAssetId {
+        UntypedAssetId {
+            type_id: TypeId::of::<T>(),
+            id: self.id(),
+        }
+    }
+
+    /// Type-erased strong handle, for keeping the asset alive as a dependency of another one.
+    pub fn untyped(&self) -> UntypedHandle {
+        UntypedHandle {
+            id: self.untyped_id(),
+            _inner: self.inner.clone(),
+        }
+    }
+
+    pub fn downgrade(&self) -> WeakHandle<T> {
+        WeakHandle {
+            id: self.id(),
+            inner: Arc::downgrade(&self.inner),
+            _marker: PhantomData,
+        }
+    }
+
+    pub fn strong_count(&self) -> usize {
+        Arc::strong_count(&self.inner)
+    }
+}
+
+impl<T> Clone for Handle<T> {
+    fn clone(&self) -> Self {
+        Self {
+            inner: self.inner.clone(),
+            _marker: PhantomData,
+        }
+    }
+}
+
+impl<T> PartialEq for Handle<T> {
+    fn eq(&self, other: &Self) -> bool {
+        self.inner.id == other.inner.id
+    }
+}
+
+impl<T> Eq for Handle<T> {}
+
+impl<T> Hash for Handle<T> {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        self.inner.id.hash(state);
+    }
+}
+
+impl<T> fmt::Debug for Handle<T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(
+            f,
+            "Handle<{}>({:?})",
+            std::any::type_name::<T>(),
+            self.inner.id
+        )
+    }
+}
+
+/// Reference to an asset that does not keep it loaded.
+pub struct WeakHandle<T> {
+    id: AssetId,
+    inner: Weak<HandleInner>,
+    _marker: PhantomData<fn() -> T>,
+}
+
+impl<T: 'static> WeakHandle<T> {
+    pub fn id(&self) -> AssetId {
+        self.id
+    }
+
+    /// Returns `None` once the asset was unloaded.
+    pub fn upgrade(&self) -> Option<Handle<T>> {
+        self.inner.upgrade().map(Handle::from_inner)
+    }
+}
+
+impl<T> Clone for WeakHandle<T> {
+    fn clone(&self) -> Self {
+        Self {
+            id: self.id,
+            inner: self.inner.clone(),
+            _marker: PhantomData,
+        }
+    }
+}
+
+/// Strong handle of any asset type.
+#[derive(Clone)]
+pub struct UntypedHandle {
+    id: UntypedAssetId,
+    _inner: Arc<HandleInner>,
+}
+
+impl UntypedHandle {
+    pub fn id(&self) -> UntypedAssetId {
+        self.id
+    }
+}
+
+impl fmt::Debug for UntypedHandle {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(f, "UntypedHandle({:?})", self.id)
+    }
+}
@@ -0,0 +1,751 @@
+//! Shared, reference-counted assets.
+//!
+//! Every asset type has an `Assets<T>` resource. Components and other assets refer to assets
+//! through `Handle<T>`, a generational id with strong reference counting: the asset is unloaded at
+//! the start of the frame after its last strong handle was dropped, and `WeakHandle<T>` refers to
+//! it without keeping it alive. An asset can depend on assets of other types; the dependent keeps
+//! its dependencies loaded, and is notified when one of them is reloaded.
+//!
+//! Assets loaded from a path are read through the `Vfs`. When they come from a loose file, that
+//! file is watched and the asset is reloaded in place when it changes, so every handle sees the
+//! new data. Assets served from a pack are never reloaded.
+//!
+//! Loads start at the start of the frame, highest `LoadPriority` first, until the frame's load
+//! budget is spent. A store can also opt into the memory budgets of `AssetResidency`, which keeps
+//! unreferenced assets around as a cache and evicts them when their category is over budget.
+
+mod graph;
+mod handle;
+mod residency;
+
+use std::any::TypeId;
+use std::collections::{BinaryHeap, HashMap};
+use std::path::PathBuf;
+use std::time::{Duration, Instant, SystemTime};
+
+use tempeh_ecs::{Resources, World};
+use tempeh_filesystem::{normalize_path, Vfs};
+
+pub use graph::AssetGraph;
+pub use handle::{AssetId, Handle, UntypedAssetId, UntypedHandle, WeakHandle};
+pub use residency::{AssetCategory, AssetResidency, AssetSize, CategoryStats, LoadPriority};
+
+use handle::{DropQueue, HandleInner};
+use residency::QueuedLoad;
+
+/// Turns the bytes of a file into an asset.
+pub trait AssetLoader<T>: Send + Sync + 'static {
+    fn load(&self, path: &str, bytes: &[u8]) -> Result<T, String>;
+}
+
+impl<T, F> AssetLoader<T> for F
+where
+    F: Fn(&str, &[u8]) -> Result<T, String> + Send + Sync + 'static,
+{
+    fn load(&self, path: &str, bytes: &[u8]) -> Result<T, String> {
+        self(path, bytes)
+    }
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum LoadState {
+    Loading,
+    Loaded,
+    Failed(String),
+}
+
+/// Changes to the assets of one type, published by `Assets::update` at the start of the frame
+/// after they happened.
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub enum AssetEvent {
+    Loaded(AssetId),
+    /// The data under the id was replaced, by a reload or `Assets::set`
+    Modified(AssetId),
+    /// One of the asset's dependencies, direct or indirect, was modified
+    DependencyModified(AssetId),
+    Failed(AssetId),
+    Unloaded(AssetId),
+}
+
+struct Entry<T> {
+    value: Option<T>,
+    state: LoadState,
+    path: Option<String>,
+    handle: std::sync::Weak<HandleInner>,
+    dependencies: Vec<UntypedHandle>,
+    /// File the asset was loaded from and its modification time at that point, for hot reload
+    watched: Option<(PathBuf, SystemTime)>,
+    priority: LoadPriority,
+}
+
+/// Set by `Assets::track_residency`.
+struct Tracking<T> {
+    residency: AssetResidency,
+    category: AssetCategory,
+    size: fn(&T) -> AssetSize,
+}
+
+struct Slot<T> {
+    generation: u32,
+    entry: Option<Entry<T>>,
+}
+
+/// Storage for every asset of type `T`, see the module documentation.
+pub struct Assets<T> {
+    slots: Vec<Slot<T>>,
+    free: Vec<u32>,
+    by_path: HashMap<String, AssetId>,
+    pending: BinaryHeap<QueuedLoad>,
+    load_sequence: u64,
+    load_budget: Option<Duration>,
+    drops: DropQueue,
+    loader: Option<Box<dyn AssetLoader<T>>>,
+    graph: AssetGraph,
+    /// Published by `update`
+    events: Vec<AssetEvent>,
+    pending_events: Vec<AssetEvent>,
+    reload_interval: Option<Duration>,
+    last_reload_check: Option<Instant>,
+    tracking: Option<Tracking<T>>,
+}
+
+impl<T: Send + Sync + 'static> Assets<T> {
+    /// Storage for assets that are only ever added in code.
+    pub fn new(graph: AssetGraph) -> Self {
+        Self {
+            slots: Vec::new(),
+            free: Vec::new(),
+            by_path: HashMap::new(),
+            pending: BinaryHeap::new(),
+            load_sequence: 0,
+            load_budget: Some(Duration::from_millis(4)),
+            drops: DropQueue::default(),
+            loader: None,
+            graph,
+            events: Vec::new(),
+            pending_events: Vec::new(),
+            reload_interval: Some(Duration::from_millis(500)),
+            last_reload_check: None,
+            tracking: None,
+        }
+    }
+
+    pub fn with_loader<L: AssetLoader<T>>(graph: AssetGraph, loader: L) -> Self {
+        Self {
+            loader: Some(Box::new(loader)),
+            ..Self::new(graph)
+        }
+    }
+
+    /// How often loose files are checked for changes; `None` disables hot reload.
+    pub fn set_reload_interval(&mut self, interval: Option<Duration>) {
+        self.reload_interval = interval;
+    }
+
+    /// Time spent loading at the start of a frame before the remaining loads are left for the
+    /// next one; at least one load is started every frame. `None` finishes every pending load.
+    pub fn set_load_budget(&mut self, budget: Option<Duration>) {
+        self.load_budget = budget;
+    }
+
+    /// Accounts the assets of this store, measured by `size`, against the budget of `category`.
+    pub fn track_residency(
+        &mut self,
+        residency: AssetResidency,
+        category: AssetCategory,
+        size: fn(&T) -> AssetSize,
+    ) {
+        let loaded: Vec<AssetId> = self.iter().map(|(id, _)| id).collect();
+        self.tracking = Some(Tracking {
+            residency,
+            category,
+            size,
+        });
+        for id in loaded {
+            self.track(id);
+        }
+    }
+
+    fn untyped(id: AssetId) -> UntypedAssetId {
+        UntypedAssetId {
+            type_id: TypeId::of::<T>(),
+            id,
+        }
+    }
+
+    /// Records the current size of a loaded asset with the residency manager.
+    fn track(&self, id: AssetId) {
+        if let (Some(tracking), Some(entry)) = (&self.tracking, self.entry(id)) {
+            if let Some(value) = &entry.value {
+                tracking.residency.insert(
+                    Self::untyped(id),
+                    tracking.category,
+                    (tracking.size)(value),
+                    entry.path.as_deref(),
+                );
+            }
+        }
+    }
+
+    fn allocate(&mut self, mut entry: Entry<T>) -> Handle<T> {
+        let index = match self.free.pop() {
+            Some(index) => index,
+            None => {
+                self.slots.push(Slot {
+                    generation: 0,
+                    entry: None,
+                });
+                (self.slots.len() - 1) as u32
+            }
+        };
+        let slot = &mut self.slots[index as usize];
+        let id = AssetId {
+            index,
+            generation: slot.generation,
+        };
+        let inner = HandleInner::new(id, self.drops.clone());
+        entry.handle = std::sync::Arc::downgrade(&inner);
+        slot.entry = Some(entry);
+        Handle::from_inner(inner)
+    }
+
+    fn entry(&self, id: AssetId) -> Option<&Entry<T>> {
+        let slot = self.slots.get(id.index as usize)?;
+        if slot.generation != id.generation {
+            return None;
+        }
+        slot.entry.as_ref()
+    }
+
+    fn entry_mut(&mut self, id: AssetId) -> Option<&mut Entry<T>> {
+        let slot = self.slots.get_mut(id.index as usize)?;
+        if slot.generation != id.generation {
+            return None;
+        }
+        slot.entry.as_mut()
+    }
+
+    pub fn add(&mut self, value: T) -> Handle<T> {
+        let handle = self.allocate(Entry {
+            value: Some(value),
+            state: LoadState::Loaded,
+            path: None,
+            handle: std::sync::Weak::new(),
+            dependencies: Vec::new(),
+            watched: None,
+            priority: LoadPriority::NORMAL,
+        });
+        self.track(handle.id());
+        self.pending_events.push(AssetEvent::Loaded(handle.id()));
+        handle
+    }
+
+    /// Returns a handle to the asset at `path`, which is loaded at the start of the next frame.
+    /// Loading a path that is already loaded returns a handle to the same asset.
+    pub fn load(&mut self, path: &str) -> Handle<T> {
+        self.load_with_priority(path, LoadPriority::NORMAL)
+    }
+
+    /// `load`, with the asset loaded ahead of the pending loads of a lower priority.
+    pub fn load_with_priority(&mut self, path: &str, priority: LoadPriority) -> Handle<T> {
+        let path = match normalize_path(path) {
+            Ok(path) => path.into_owned(),
+            Err(error) => {
+                log::error!("{}", error);
+                path.to_owned()
+            }
+        };
+        if let Some(id) = self.by_path.get(&path).copied() {
+            if let Some(handle) = self.revive(id) {
+                self.raise_priority(&handle, priority);
+                return handle;
+            }
+        }
+
+        let handle = self.allocate(Entry {
+            value: None,
+            state: LoadState::Loading,
+            path: Some(path.clone()),
+            handle: std::sync::Weak::new(),
+            dependencies: Vec::new(),
+            watched: None,
+            priority,
+        });
+        self.by_path.insert(path, handle.id());
+        self.queue_load(handle.id(), priority);
+        handle
+    }
+
+    /// A strong handle to an asset that is still stored, including one kept loaded by the
+    /// residency manager after its last handle was dropped.
+    fn revive(&mut self, id: AssetId) -> Option<Handle<T>> {
+        let drops = self.drops.clone();
+        let entry = self.entry_mut(id)?;
+        if let Some(inner) = entry.handle.upgrade() {
+            return Some(Handle::from_inner(inner));
+        }
+        let inner = HandleInner::new(id, drops);
+        entry.handle = std::sync::Arc::downgrade(&inner);
+        if let Some(tracking) = &self.tracking {
+            tracking.residency.acquire(Self::untyped(id));
+        }
+        Some(Handle::from_inner(inner))
+    }
+
+    fn queue_load(&mut self, id: AssetId, priority: LoadPriority) {
+        self.load_sequence += 1;
+        self.pending.push(QueuedLoad {
+            priority,
+            sequence: self.load_sequence,
+            id,
+        });
+    }
+
+    /// Moves a pending load within the queue, for priorities that change over time (the distance
+    /// to the camera). Does nothing once the asset is loaded.
+    pub fn set_priority(&mut self, handle: &Handle<T>, priority: LoadPriority) {
+        let id = handle.id();
+        match self.entry_mut(id) {
+            Some(entry) if entry.state == LoadState::Loading && entry.priority != priority => {
+                entry.priority = priority;
+            }
+            _ => return,
+        }
+        // The previous queue entry is skipped when it comes up
+        self.queue_load(id, priority);
+    }
+
+    /// `set_priority` that never lowers the priority of a pending load, for callers that report
+    /// the same asset from several places (every sprite that uses a texture).
+    pub fn raise_priority(&mut self, handle: &Handle<T>, priority: LoadPriority) {
+        if self
+            .entry(handle.id())
+            .map_or(false, |entry| priority > entry.priority)
+        {
+            self.set_priority(handle, priority);
+        }
+    }
+
+    /// Loads that have not started yet.
+    pub fn pending_loads(&self) -> usize {
+        self.slots
+            .iter()
+            .filter_map(|slot| slot.entry.as_ref())
+            .filter(|entry| entry.state == LoadState::Loading)
+            .count()
+    }
+
+    pub fn get(&self, handle: &Handle<T>) -> Option<&T> {
+        self.get_by_id(handle.id())
+    }
+
+    pub fn get_by_id(&self, id: AssetId) -> Option<&T> {
+        self.entry(id)?.value.as_ref()
+    }
+
+    /// Mutable access counts as a modification, dependents are notified.
+    pub fn get_mut(&mut self, handle: &Handle<T>) -> Option<&mut T> {
+        let id = handle.id();
+        if self.entry(id)?.value.is_none() {
+            return None;
+        }
+        self.modified(handle.untyped_id());
+        self.entry_mut(id)?.value.as_mut()
+    }
+
+    /// Replaces the data under `handle`, which every holder of the handle sees from now on.
+    pub fn set(&mut self, handle: &Handle<T>, value: T) {
+        if let Some(entry) = self.entry_mut(handle.id()) {
+            entry.value = Some(value);
+            entry.state = LoadState::Loaded;
+            self.track(handle.id());
+            self.modified(handle.untyped_id());
+        }
+    }
+
+    pub fn state(&self, handle: &Handle<T>) -> Option<&LoadState> {
+        self.entry(handle.id()).map(|entry| &entry.state)
+    }
+
+    /// Keeps `dependency` loaded for as long as `dependent` is, and notifies `dependent` whenever
+    /// `dependency` or anything it depends on is modified.
+    pub fn add_dependency(&mut self, dependent: &Handle<T>, dependency: UntypedHandle) {
+        let dependent_id = dependent.untyped_id();
+        let graph = self.graph.clone();
+        if let Some(entry) = self.entry_mut(dependent.id()) {
+            graph.add_edge(dependent_id, dependency.id());
+            entry.dependencies.push(dependency);
+        }
+    }
+
+    pub fn len(&self) -> usize {
+        self.slots.len() - self.free.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    pub fn iter(&self) -> impl Iterator<Item = (AssetId, &T)> {
+        self.slots.iter().enumerate().filter_map(|(index, slot)| {
+            let value = slot.entry.as_ref()?.value.as_ref()?;
+            let id = AssetId {
+                index: index as u32,
+                generation: slot.generation,
+            };
+            Some((id, value))
+        })
+    }
+
+    /// Everything that happened to the assets of this type between the last two updates, that is
+    /// during the previous frame and at the start of this one.
+    pub fn events(&self) -> &[AssetEvent] {
+        &self.events
+    }
+
+    fn modified(&mut self, id: UntypedAssetId) {
+        self.pending_events.push(AssetEvent::Modified(id.id));
+        self.graph.propagate(id);
+    }
+
+    fn load_entry(&mut self, id: AssetId, vfs: &Vfs) {
+        let path = match self.entry(id).and_then(|entry| entry.path.clone()) {
+            Some(path) => path,
+            None => return,
+        };
+        let result = match &self.loader {
+            Some(loader) => vfs
+                .read(&path)
+                .map_err(|error| error.to_string())
+                .and_then(|bytes| loader.load(&path, &bytes)),
+            None => Err(format!(
+                "no loader registered for {}",
+                std::any::type_name::<T>()
+            )),
+        };
+        let watched = vfs.file_path(&path).and_then(|file| {
+            let modified = std::fs::metadata(&file).ok()?.modified().ok()?;
+            Some((file, modified))
+        });
+
+        let was_loaded = self.get_by_id(id).is_some();
+        let entry = self.entry_mut(id).expect("Entry was checked above");
+        entry.watched = watched;
+        match result {
+            Ok(value) => {
+                entry.value = Some(value);
+                entry.state = LoadState::Loaded;
+                self.track(id);
+                if was_loaded {
+                    log::info!("Reloaded {}", path);
+                    self.modified(UntypedAssetId {
+                        type_id: TypeId::of::<T>(),
+                        id,
+                    });
+                } else {
+                    self.pending_events.push(AssetEvent::Loaded(id));
+                }
+            }
+            // A failed reload keeps the previous data, so a half-saved file does not take the
+            // asset away from everything using it
+            Err(error) => {
+                log::error!("Unable to load {}: {}", path, error);
+                if !was_loaded {
+                    entry.state = LoadState::Failed(error);
+                    self.pending_events.push(AssetEvent::Failed(id));
+                }
+            }
+        }
+    }
+
+    /// The last strong handle of `id` was dropped: the asset stays in the residency manager's
+    /// cache if its category has a budget, and is unloaded otherwise.
+    fn release(&mut self, id: AssetId) {
+        let cached = match (&self.tracking, self.entry(id)) {
+            (Some(tracking), Some(entry)) => {
+                entry.value.is_some()
+                    && entry.handle.upgrade().is_none()
+                    && tracking.residency.is_budgeted(tracking.category)
+            }
+            _ => false,
+        };
+        match &self.tracking {
+            Some(tracking) if cached => tracking.residency.release(Self::untyped(id)),
+            _ => self.unload(id),
+        }
+    }
+
+    fn evict(&mut self, id: AssetId) {
+        let referenced = self
+            .entry(id)
+            .map_or(false, |entry| entry.handle.upgrade().is_some());
+        if referenced {
+            // `load` revived it after it was chosen, it is resident again
+            self.track(id);
+        } else {
+            self.unload(id);
+        }
+    }
+
+    fn unload(&mut self, id: AssetId) {
+        let slot = match self.slots.get_mut(id.index as usize) {
+            Some(slot) if slot.generation == id.generation => slot,
+            _ => return,
+        };
+        // `load` may have handed out a new strong handle between the drop and now
+        if slot
+            .entry
+            .as_ref()
+            .map_or(true, |entry| entry.handle.upgrade().is_some())
+        {
+            return;
+        }
+        let entry = slot.entry.take().expect("Entry was checked above");
+        slot.generation = slot.generation.wrapping_add(1);
+        self.free.push(id.index);
+        if let Some(path) = &entry.path {
+            if self.by_path.get(path) == Some(&id) {
+                self.by_path.remove(path);
+            }
+        }
+        let dependencies: Vec<UntypedAssetId> =
+            entry.dependencies.iter().map(UntypedHandle::id).collect();
+        self.graph.remove(
+            UntypedAssetId {
+                type_id: TypeId::of::<T>(),
+                id,
+            },
+            &dependencies,
+        );
+        if let Some(tracking) = &self.tracking {
+            tracking.residency.remove(Self::untyped(id));
+        }
+        self.pending_events.push(AssetEvent::Unloaded(id));
+        // Dropping the entry releases its dependencies, which are unloaded by their own storage
+        // if nothing else holds them
+    }
+
+    /// Unloads assets without strong handles, finishes pending loads and reloads changed files.
+    /// Runs at the start of every frame, see `AppBuilder::add_asset`.
+    pub fn update(&mut self, vfs: &Vfs) {
+        let dropped = std::mem::take(&mut *self.drops.lock().unwrap());
+        for id in dropped {
+            self.release(id);
+        }
+
+        let started = Instant::now();
+        while let Some(queued) = self.pending.pop() {
+            // Skips the queue entries left behind by `set_priority` and unloads
+            let current = match self.entry(queued.id) {
+                Some(entry) => {
+                    entry.state == LoadState::Loading && entry.priority == queued.priority
+                }
+                None => false,
+            };
+            if !current {
+                continue;
+            }
+            self.load_entry(queued.id, vfs);
+            if self
+                .load_budget
+                .map_or(false, |budget| started.elapsed() >= budget)
+            {
+                break;
+            }
+        }
+
+        let check_files = self.reload_interval.map_or(false, |interval| {
+            self.last_reload_check
+                .map_or(true, |last| last.elapsed() >= interval)
+        });
+        if check_files {
+            self.last_reload_check = Some(Instant::now());
+            let changed: Vec<AssetId> = self
+                .slots
+                .iter()
+                .enumerate()
+                .filter_map(|(index, slot)| {
+                    let (file, modified) = slot.entry.as_ref()?.watched.as_ref()?;
+                    let current = std::fs::metadata(file).ok()?.modified().ok()?;
+                    if current != *modified {
+                        Some(AssetId {
+                            index: index as u32,
+                            generation: slot.generation,
+                        })
+                    } else {
+                        None
+                    }
+                })
+                .collect();
+            for id in changed {
+                self.load_entry(id, vfs);
+            }
+        }
+
+        if let Some(tracking) = &self.tracking {
+            for id in tracking.residency.take_evicted(TypeId::of::<T>()) {
+                self.evict(id);
+            }
+        }
+
+        for id in self.graph.take_notified(TypeId::of::<T>()) {
+            if self.entry(id).is_some() {
+                self.pending_events.push(AssetEvent::DependencyModified(id));
+            }
+        }
+        self.events = std::mem::take(&mut self.pending_events);
+    }
+
+    /// Frame start step registered by `AppBuilder::add_asset`.
+    pub(crate) fn update_resource(_world: &mut World, resources: &mut Resources) {
+        // Taken out for the update, so the Vfs can be borrowed at the same time
+        let mut assets = match resources.remove::<Assets<T>>() {
+            Some(assets) => assets,
+            None => return,
+        };
+        match resources.get::<Vfs>() {
+            Some(vfs) => assets.update(&vfs),
+            None => assets.update(&Vfs::new()),
+        }
+        resources.insert(assets);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use tempeh_filesystem::Embedded;
+
+    fn vfs() -> Vfs {
+        let mut vfs = Vfs::new();
+        vfs.mount(
+            "",
+            Embedded::new(&[("atlas.txt", b"atlas"), ("texture.txt", b"texture")]),
+        );
+        vfs
+    }
+
+    fn text_loader(_path: &str, bytes: &[u8]) -> Result<String, String> {
+        String::from_utf8(bytes.to_vec()).map_err(|error| error.to_string())
+    }
+
+    #[test]
+    fn handles_share_and_unload() {
+        let vfs = vfs();
+        let mut assets = Assets::with_loader(AssetGraph::default(), text_loader);
+        let first = assets.load("./atlas.txt");
+        let second = assets.load("atlas.txt");
+        assert_eq!(first, second);
+        assert!(assets.get(&first).is_none());
+
+        assets.update(&vfs);
+        assert_eq!(assets.get(&second).map(String::as_str), Some("atlas"));
+        assert_eq!(assets.events(), &[AssetEvent::Loaded(first.id())]);
+
+        let weak = first.downgrade();
+        let id = first.id();
+        drop(first);
+        assets.update(&vfs);
+        assert!(weak.upgrade().is_some());
+        drop(second);
+        assets.update(&vfs);
+        assert!(weak.upgrade().is_none());
+        assert!(assets.get_by_id(id).is_none());
+        assert_eq!(assets.events(), &[AssetEvent::Unloaded(id)]);
+
+        // The slot is reused with a new generation
+        let reused = assets.add("new".to_owned());
+        assert_eq!(reused.id().index, id.index);
+        assert_ne!(reused.id(), id);
+    }
+
+    #[test]
+    fn dependencies_stay_loaded_and_are_propagated() {
+        let vfs = vfs();
+        let graph = AssetGraph::default();
+        let mut textures = Assets::with_loader(graph.clone(), text_loader);
+        let mut materials = Assets::<u32>::new(graph);
+
+        let atlas = textures.load("atlas.txt");
+        let texture = textures.load("texture.txt");
+        textures.add_dependency(&texture, atlas.untyped());
+        let material = materials.add(1);
+        materials.add_dependency(&material, texture.untyped());
+        let atlas_id = atlas.id();
+        drop(atlas);
+        drop(texture);
+        textures.update(&vfs);
+        materials.update(&vfs);
+        assert!(textures.get_by_id(atlas_id).is_some());
+
+        let atlas = textures.load("atlas.txt");
+        textures.set(&atlas, "new atlas".to_owned());
+        textures.update(&vfs);
+        materials.update(&vfs);
+        assert!(textures
+            .events()
+            .iter()
+            .any(|event| matches!(event, AssetEvent::DependencyModified(_))));
+        assert_eq!(
+            materials.events(),
+            &[AssetEvent::DependencyModified(material.id())]
+        );
+
+        drop(atlas);
+        drop(material);
+        materials.update(&vfs);
+        textures.update(&vfs);
+        textures.update(&vfs);
+        assert!(textures.is_empty());
+    }
+
+    #[test]
+    fn budget_evicts_least_recently_released() {
+        let vfs = vfs();
+        let residency = AssetResidency::default();
+        residency.set_budget(AssetCategory::Texture, AssetSize::new(u64::MAX, 12));
+        let mut textures = Assets::with_loader(AssetGraph::default(), text_loader);
+        textures.track_residency(residency.clone(), AssetCategory::Texture, |text| {
+            AssetSize::new(0, text.len() as u64)
+        });
+
+        // Loaded in priority order, one per frame
+        textures.set_load_budget(Some(Duration::from_secs(0)));
+        let texture = textures.load("texture.txt");
+        let atlas = textures.load_with_priority("atlas.txt", LoadPriority::from_distance(1.0));
+        textures.update(&vfs);
+        assert_eq!(textures.events(), &[AssetEvent::Loaded(atlas.id())]);
+        assert_eq!(textures.pending_loads(), 1);
+        textures.update(&vfs);
+        assert_eq!(textures.events(), &[AssetEvent::Loaded(texture.id())]);
+
+        // Unreferenced assets stay cached while the category is under budget
+        let (atlas_id, texture_id) = (atlas.id(), texture.id());
+        drop(atlas);
+        textures.update(&vfs);
+        assert!(textures.get_by_id(atlas_id).is_some());
+        assert_eq!(residency.stats(AssetCategory::Texture).unreferenced, 1);
+        let atlas = textures.load("atlas.txt");
+        assert_eq!(atlas.id(), atlas_id);
+
+        // Over budget, the least recently released one goes first
+        drop(texture);
+        drop(atlas);
+        textures.add("0123456789".to_owned());
+        textures.update(&vfs);
+        assert!(textures.get_by_id(texture_id).is_none());
+        assert!(textures.get_by_id(atlas_id).is_none());
+        let stats = residency.stats(AssetCategory::Texture);
+        assert_eq!(stats.evictions, 2);
+        assert_eq!(stats.resident, AssetSize::new(0, 10));
+
+        let _texture = textures.load("texture.txt");
+        textures.update(&vfs);
+        assert_eq!(
+            residency
+                .stats(AssetCategory::Texture)
+                .reloads_after_eviction,
+            1
+        );
+    }
+}
@@ -0,0 +1,353 @@
+use std::any::TypeId;
+use std::cmp::Ordering;
+use std::collections::{BTreeMap, HashMap, HashSet};
+use std::ops::{Add, Sub};
+use std::sync::{Arc, Mutex};
+
+use super::handle::{AssetId, UntypedAssetId};
+
+/// Memory an asset occupies, in bytes.
+#[derive(Debug, Copy, Clone, Default, PartialEq, Eq)]
+pub struct AssetSize {
+    pub cpu: u64,
+    /// Memory the asset takes once uploaded (texture, vertex buffer)
+    pub gpu: u64,
+}
+
+impl AssetSize {
+    pub const ZERO: Self = Self { cpu: 0, gpu: 0 };
+    pub const UNLIMITED: Self = Self {
+        cpu: u64::MAX,
+        gpu: u64::MAX,
+    };
+
+    pub fn new(cpu: u64, gpu: u64) -> Self {
+        Self { cpu, gpu }
+    }
+
+    /// Whether either kind of memory exceeds the one in `budget`.
+    pub fn exceeds(&self, budget: AssetSize) -> bool {
+        self.cpu > budget.cpu || self.gpu > budget.gpu
+    }
+}
+
+impl Add for AssetSize {
+    type Output = Self;
+
+    fn add(self, other: Self) -> Self {
+        Self {
+            cpu: self.cpu.saturating_add(other.cpu),
+            gpu: self.gpu.saturating_add(other.gpu),
+        }
+    }
+}
+
+impl Sub for AssetSize {
+    type Output = Self;
+
+    fn sub(self, other: Self) -> Self {
+        Self {
+            cpu: self.cpu.saturating_sub(other.cpu),
+            gpu: self.gpu.saturating_sub(other.gpu),
+        }
+    }
+}
+
+/// Budgets are set per category, so a level full of sounds cannot evict the textures on screen.
+#[derive(Debug, Copy, Clone, PartialEq, Eq, Hash)]
+pub enum AssetCategory {
+    Texture,
+    Audio,
+    Other,
+}
+
+impl AssetCategory {
+    pub const ALL: [AssetCategory; 3] = [
+        AssetCategory::Texture,
+        AssetCategory::Audio,
+        AssetCategory::Other,
+    ];
+}
+
+/// Order in which pending loads are started, higher first. Loads of the same priority start in
+/// the order they were requested.
+#[derive(Debug, Copy, Clone, PartialEq, Eq, PartialOrd, Ord, Hash)]
+pub struct LoadPriority(pub u32);
+
+impl LoadPriority {
+    pub const LOW: Self = Self(0);
+    pub const NORMAL: Self = Self(1 << 16);
+    pub const HIGH: Self = Self(1 << 24);
+
+    /// `HIGH` at the camera, falling off with the distance; assets further than 255 units load
+    /// after `NORMAL` ones.
+    pub fn from_distance(distance: f32) -> Self {
+        let distance = if distance.is_finite() {
+            distance.max(0.0)
+        } else {
+            f32::MAX
+        };
+        Self((Self::HIGH.0 as f32 / (1.0 + distance)) as u32)
+    }
+}
+
+impl Default for LoadPriority {
+    fn default() -> Self {
+        Self::NORMAL
+    }
+}
+
+/// Pending load, ordered for a max-heap.
+#[derive(PartialEq, Eq)]
+pub(crate) struct QueuedLoad {
+    pub(crate) priority: LoadPriority,
+    /// Request order, the earlier request wins on equal priority
+    pub(crate) sequence: u64,
+    pub(crate) id: AssetId,
+}
+
+impl Ord for QueuedLoad {
+    fn cmp(&self, other: &Self) -> Ordering {
+        self.priority
+            .cmp(&other.priority)
+            .then_with(|| other.sequence.cmp(&self.sequence))
+    }
+}
+
+impl PartialOrd for QueuedLoad {
+    fn partial_cmp(&self, other: &Self) -> Option<Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+#[derive(Debug, Copy, Clone, Default, PartialEq, Eq)]
+pub struct CategoryStats {
+    pub budget: AssetSize,
+    pub resident: AssetSize,
+    pub assets: usize,
+    /// Assets kept loaded without any strong handle, evicted first when over budget
+    pub unreferenced: usize,
+    pub evictions: u64,
+    pub evicted_bytes: AssetSize,
+    /// Loads of paths that were evicted before, a sign of a budget too small for the working set
+    pub reloads_after_eviction: u64,
+}
+
+struct Resident {
+    category: AssetCategory,
+    size: AssetSize,
+    path: Option<String>,
+    /// Position in the category's LRU list while the asset has no strong handle
+    unreferenced_since: Option<u64>,
+}
+
+#[derive(Default)]
+struct Category {
+    stats: CategoryStats,
+    /// Unreferenced assets, least recently released first
+    lru: BTreeMap<u64, UntypedAssetId>,
+}
+
+struct State {
+    categories: HashMap<AssetCategory, Category>,
+    residents: HashMap<UntypedAssetId, Resident>,
+    clock: u64,
+    /// Chosen for eviction, per asset type, until their `Assets<T>` unloads them
+    evicted: HashMap<TypeId, Vec<AssetId>>,
+    evicted_paths: HashSet<(TypeId, String)>,
+}
+
+impl Default for State {
+    fn default() -> Self {
+        let categories = AssetCategory::ALL
+            .iter()
+            .map(|category| {
+                let mut state = Category::default();
+                state.stats.budget = AssetSize::UNLIMITED;
+                (*category, state)
+            })
+            .collect();
+        Self {
+            categories,
+            residents: HashMap::new(),
+            clock: 0,
+            evicted: HashMap::new(),
+            evicted_paths: HashSet::new(),
+        }
+    }
+}
+
+impl State {
+    fn category(&mut self, category: AssetCategory) -> &mut Category {
+        self.categories.entry(category).or_default()
+    }
+
+    fn evict_over_budget(&mut self) {
+        for category in AssetCategory::ALL.iter() {
+            loop {
+                let state = self.category(*category);
+                if !state.stats.resident.exceeds(state.stats.budget) {
+                    break;
+                }
+                let victim = match state.lru.keys().next().copied() {
+                    Some(tick) => state.lru.remove(&tick).expect("Key was just found"),
+                    None => break,
+                };
+                let resident = self
+                    .residents
+                    .remove(&victim)
+                    .expect("LRU entries are resident");
+                let stats = &mut self.category(*category).stats;
+                stats.resident = stats.resident - resident.size;
+                stats.assets -= 1;
+                stats.unreferenced -= 1;
+                stats.evictions += 1;
+                stats.evicted_bytes = stats.evicted_bytes + resident.size;
+                if let Some(path) = resident.path {
+                    self.evicted_paths.insert((victim.type_id, path));
+                }
+                self.evicted
+                    .entry(victim.type_id)
+                    .or_default()
+                    .push(victim.id);
+            }
+        }
+    }
+}
+
+/// Memory budgets and LRU eviction for the assets of every type that opted in with
+/// `Assets::track_residency`. Shared by every `Assets<T>` of an app, like `AssetGraph`.
+///
+/// In a category with a budget, an asset whose last strong handle is dropped stays loaded, so
+/// loading it again is free, until the category goes over budget; then unreferenced assets are
+/// evicted, least recently released first. Assets that are still referenced are never evicted,
+/// so a working set larger than the budget shows up as `resident` exceeding `budget`. Categories
+/// without a budget unload unreferenced assets right away.
+#[derive(Clone, Default)]
+pub struct AssetResidency(Arc<Mutex<State>>);
+
+impl AssetResidency {
+    pub fn set_budget(&self, category: AssetCategory, budget: AssetSize) {
+        let mut state = self.0.lock().unwrap();
+        state.category(category).stats.budget = budget;
+        state.evict_over_budget();
+    }
+
+    pub fn budget(&self, category: AssetCategory) -> AssetSize {
+        self.0.lock().unwrap().category(category).stats.budget
+    }
+
+    pub fn is_budgeted(&self, category: AssetCategory) -> bool {
+        self.budget(category) != AssetSize::UNLIMITED
+    }
+
+    pub fn stats(&self, category: AssetCategory) -> CategoryStats {
+        self.0.lock().unwrap().category(category).stats
+    }
+
+    /// Clears the eviction counters, keeping the resident totals.
+    pub fn reset_stats(&self) {
+        let mut state = self.0.lock().unwrap();
+        for category in state.categories.values_mut() {
+            category.stats.evictions = 0;
+            category.stats.evicted_bytes = AssetSize::ZERO;
+            category.stats.reloads_after_eviction = 0;
+        }
+        state.evicted_paths.clear();
+    }
+
+    /// Records a loaded asset, or the new size of a reloaded one.
+    pub(crate) fn insert(
+        &self,
+        asset: UntypedAssetId,
+        category: AssetCategory,
+        size: AssetSize,
+        path: Option<&str>,
+    ) {
+        let mut state = self.0.lock().unwrap();
+        let previous = state.residents.remove(&asset);
+        let reloaded = match (&previous, path) {
+            (None, Some(path)) => state
+                .evicted_paths
+                .remove(&(asset.type_id, path.to_owned())),
+            _ => false,
+        };
+        let unreferenced_since = previous.as_ref().and_then(|r| r.unreferenced_since);
+        let stats = &mut state.category(category).stats;
+        match &previous {
+            Some(previous) => stats.resident = stats.resident - previous.size,
+            None => stats.assets += 1,
+        }
+        stats.resident = stats.resident + size;
+        if reloaded {
+            stats.reloads_after_eviction += 1;
+        }
+        state.residents.insert(
+            asset,
+            Resident {
+                category,
+                size,
+                path: path.map(str::to_owned),
+                unreferenced_since,
+            },
+        );
+        state.evict_over_budget();
+    }
+
+    /// Forgets an unloaded asset.
+    pub(crate) fn remove(&self, asset: UntypedAssetId) {
+        let mut state = self.0.lock().unwrap();
+        if let Some(resident) = state.residents.remove(&asset) {
+            let category = state.category(resident.category);
+            if let Some(tick) = resident.unreferenced_since {
+                category.lru.remove(&tick);
+                category.stats.unreferenced -= 1;
+            }
+            category.stats.resident = category.stats.resident - resident.size;
+            category.stats.assets -= 1;
+        }
+    }
+
+    /// The asset lost its last strong handle and becomes a candidate for eviction.
+    pub(crate) fn release(&self, asset: UntypedAssetId) {
+        let mut state = self.0.lock().unwrap();
+        state.clock += 1;
+        let tick = state.clock;
+        let category = match state.residents.get_mut(&asset) {
+            Some(resident) if resident.unreferenced_since.is_none() => {
+                resident.unreferenced_since = Some(tick);
+                resident.category
+            }
+            _ => return,
+        };
+        let category = state.category(category);
+        category.lru.insert(tick, asset);
+        category.stats.unreferenced += 1;
+        state.evict_over_budget();
+    }
+
+    /// The asset has a strong handle again.
+    pub(crate) fn acquire(&self, asset: UntypedAssetId) {
+        let mut state = self.0.lock().unwrap();
+        let (category, tick) = match state.residents.get_mut(&asset) {
+            Some(resident) => match resident.unreferenced_since.take() {
+                Some(tick) => (resident.category, tick),
+                None => return,
+            },
+            None => return,
+        };
+        let category = state.category(category);
+        category.lru.remove(&tick);
+        category.stats.unreferenced -= 1;
+    }
+
+    /// Assets of type `type_id` chosen for eviction since the last call.
+    pub(crate) fn take_evicted(&self, type_id: TypeId) -> Vec<AssetId> {
+        self.0
+            .lock()
+            .unwrap()
+            .evicted
+            .remove(&type_id)
+            .unwrap_or_default()
+    }
+}
@@ -0,0 +1,713 @@
+//! Parent/child relationships between transforms.
+//!
+//! `Parent` is the source of truth; `Children` and `GlobalTransform` are maintained by
+//! `TransformHierarchy`. Every entity with a `Transform` is a node, and the nodes are kept in a
+//! flat array in depth-first order, so every subtree is a contiguous range that follows its root.
+//! Propagation walks those ranges linearly and only for subtrees whose root moved.
+//!
+//! Local transforms are diffed against a cached copy only in chunks that legion reports as
+//! written, so a frame where a few nodes move touches those nodes and their descendants rather than
+//! the whole scene. Structural changes (`Parent` or `Transform` added or removed) are picked up from
+//! the change events of `tempeh_ecs::events` and batched per update: only the trees they touch are
+//! relinked and appended to the end of the array, leaving dead nodes behind at their old position.
+//! The array is compacted once dead nodes outnumber the live ones.
+
+use std::collections::{HashMap, HashSet};
+use std::ops::Range;
+
+use tempeh_core_component::batch::{Affine2, BatchKernel};
+use tempeh_core_component::{GlobalTransform, Transform};
+use tempeh_ecs::events::{ComponentEvent, ComponentEventReader, ComponentEvents};
+use tempeh_ecs::storage::Component;
+use tempeh_ecs::{component, maybe_changed, Entity, IntoQuery, Read, Resources, World};
+
+use crate::app::AppBuilder;
+use crate::plugins::Plugin;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Parent(pub Entity);
+
+/// Direct children of an entity, in traversal order.
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct Children(Vec<Entity>);
+
+impl Children {
+    pub fn iter(&self) -> impl Iterator<Item = &Entity> {
+        self.0.iter()
+    }
+
+    pub fn len(&self) -> usize {
+        self.0.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.0.is_empty()
+    }
+}
+
+/// Position of the entity in the flat node array.
+#[derive(Debug, Clone, Copy)]
+struct NodeIndex(u32);
+
+const NO_PARENT: u32 = u32::MAX;
+/// Parent of a node whose tree was appended again further down the array.
+const DEAD: u32 = u32::MAX - 1;
+/// Index of a node that has not been appended to the array yet.
+const UNPLACED: u32 = u32::MAX;
+
+#[derive(Clone, Copy)]
+struct Node {
+    entity: Entity,
+    parent: u32,
+    subtree_end: u32,
+}
+
+/// Structure of the hierarchy by entity. The flat node array is derived from it a tree at a time.
+struct Link {
+    /// Parent named by the entity's `Parent`
+    declared: Option<Entity>,
+    /// `declared` if that is a node and does not close a cycle
+    parent: Option<Entity>,
+    children: Vec<Entity>,
+    index: u32,
+}
+
+#[derive(Debug, Default, Clone, Copy)]
+pub struct HierarchyStats {
+    pub nodes: usize,
+    pub dirty_nodes: usize,
+    pub dirty_subtrees: usize,
+    /// Nodes of trees that changed structure, which were appended to the array again
+    pub relinked_nodes: usize,
+    /// The array was built from scratch, on the first update and when dead nodes outnumbered the
+    /// live ones
+    pub rebuilt: bool,
+}
+
+/// Cached local transforms in node order, and the nodes whose transform changed this frame.
+#[derive(Default)]
+struct Locals {
+    transforms: Vec<Transform>,
+    affines: Vec<Affine2>,
+    dirty: Vec<u32>,
+}
+
+/// Propagates `Transform`s down the hierarchy into `GlobalTransform`s.
+///
+/// Requires `ComponentEvents<Parent>` and `ComponentEvents<Transform>`, see `HierarchyPlugin`.
+pub struct TransformHierarchy {
+    nodes: Vec<Node>,
+    dead_nodes: usize,
+    links: HashMap<Entity, Link>,
+    /// Nodes whose `Parent` has no `Transform`, by that parent. They are roots until it gets one.
+    orphans: HashMap<Entity, Vec<Entity>>,
+    locals: Locals,
+    globals: Vec<Affine2>,
+    needs_rebuild: bool,
+    parent_events: ComponentEventReader<Parent>,
+    transform_events: ComponentEventReader<Transform>,
+    diff_locals: Box<dyn FnMut(&World, &mut Locals)>,
+    kernel: BatchKernel,
+    stats: HierarchyStats,
+}
+
+impl Default for TransformHierarchy {
+    fn default() -> Self {
+        Self {
+            nodes: Vec::new(),
+            dead_nodes: 0,
+            links: HashMap::new(),
+            orphans: HashMap::new(),
+            locals: Locals::default(),
+            globals: Vec::new(),
+            needs_rebuild: true,
+            parent_events: ComponentEventReader::default(),
+            transform_events: ComponentEventReader::default(),
+            diff_locals: diff_locals(),
+            kernel: BatchKernel::detect(),
+            stats: HierarchyStats::default(),
+        }
+    }
+}
+
+impl TransformHierarchy {
+    /// Subtrees with fewer dirty nodes than this are propagated on the calling thread.
+    pub const PARALLEL_THRESHOLD: usize = 4096;
+
+    pub fn stats(&self) -> HierarchyStats {
+        self.stats
+    }
+
+    pub fn update(&mut self, world: &mut World, resources: &Resources) {
+        let mut rebuilt = false;
+        let mut changed = Vec::new();
+        if self.needs_rebuild {
+            self.needs_rebuild = false;
+            rebuilt = true;
+            let mut query = <Entity>::query().filter(component::<Transform>());
+            changed.extend(query.iter(world).copied());
+        }
+        {
+            let parent_events = resources
+                .get::<ComponentEvents<Parent>>()
+                .expect("Parent changes are not tracked, see HierarchyPlugin");
+            let transform_events = resources
+                .get::<ComponentEvents<Transform>>()
+                .expect("Transform changes are not tracked, see HierarchyPlugin");
+            // Changed events are reported per chunk, so only a parent that differs from the one
+            // the node was linked with counts
+            for event in self.parent_events.read(&parent_events) {
+                match event {
+                    ComponentEvent::Changed(entity) if !self.parent_differs(world, *entity) => {}
+                    event => changed.push(event.entity()),
+                }
+            }
+            changed.extend(
+                self.transform_events
+                    .read(&transform_events)
+                    .filter(|event| !matches!(event, ComponentEvent::Changed(_)))
+                    .map(|event| event.entity()),
+            );
+        }
+
+        self.locals.dirty.clear();
+        let mut relinked_nodes = 0;
+        if !changed.is_empty() {
+            relinked_nodes = self.relink(world, changed);
+        }
+        if self.dead_nodes * 2 > self.nodes.len() {
+            rebuilt = true;
+            relinked_nodes = self.compact(world);
+        }
+        // Relinked nodes changed archetype, which makes their chunks look written to. Their
+        // cached transforms were just read, so the diff only catches up with them.
+        (self.diff_locals)(world, &mut self.locals);
+
+        let ranges = self.dirty_ranges();
+        self.propagate(&ranges);
+        for range in &ranges {
+            for index in range.clone() {
+                if let Ok(mut entry) = world.entry_mut(self.nodes[index].entity) {
+                    if let Ok(global) = entry.get_component_mut::<GlobalTransform>() {
+                        *global = GlobalTransform(self.globals[index]);
+                    }
+                }
+            }
+        }
+
+        self.stats = HierarchyStats {
+            nodes: self.nodes.len() - self.dead_nodes,
+            dirty_nodes: ranges.iter().map(|range| range.len()).sum(),
+            dirty_subtrees: ranges.len(),
+            relinked_nodes,
+            rebuilt,
+        };
+    }
+
+    fn parent_differs(&self, world: &World, entity: Entity) -> bool {
+        let link = match self.links.get(&entity) {
+            Some(link) => link,
+            // Not a node, or one that is about to be linked for its new Transform
+            None => return false,
+        };
+        let parent = world
+            .entry_ref(entity)
+            .ok()
+            .and_then(|entry| entry.get_component::<Parent>().ok().map(|parent| parent.0));
+        parent != link.declared
+    }
+
+    /// Applies the structural changes of `changed` to the links and appends every tree they
+    /// touched to the node array again. The nodes of the old trees are marked dead and left in
+    /// place, so untouched trees keep their indices. Returns the number of appended nodes.
+    fn relink(&mut self, world: &mut World, mut changed: Vec<Entity>) -> usize {
+        let mut seen = HashSet::new();
+        changed.retain(|entity| seen.insert(*entity));
+
+        // Old trees by the index of their root, and entities whose tree is appended again
+        let mut old_trees = Vec::new();
+        let mut touched = Vec::new();
+        for &entity in &changed {
+            if !self.links.contains_key(&entity) {
+                continue;
+            }
+            let root = self.root_of(entity);
+            old_trees.push(self.links[&root].index);
+            touched.push(root);
+            self.detach(entity);
+            if has_transform(world, entity) {
+                continue;
+            }
+            let link = self.links.remove(&entity).unwrap();
+            for child in link.children {
+                // Roots until the entity gets a Transform again
+                self.links.get_mut(&child).unwrap().parent = None;
+                self.orphans.entry(entity).or_default().push(child);
+                touched.push(child);
+            }
+            let has_children = world
+                .entry_ref(entity)
+                .map_or(false, |entry| entry.get_component::<Children>().is_ok());
+            if has_children {
+                set_component(world, entity, Children::default());
+            }
+        }
+        for &entity in &changed {
+            if !has_transform(world, entity) {
+                continue;
+            }
+            if !self.links.contains_key(&entity) {
+                let children = self.orphans.remove(&entity).unwrap_or_default();
+                for child in &children {
+                    let link = self.links.get_mut(child).unwrap();
+                    link.parent = Some(entity);
+                    if link.index != UNPLACED {
+                        old_trees.push(link.index);
+                    }
+                }
+                self.links.insert(
+                    entity,
+                    Link {
+                        declared: None,
+                        parent: None,
+                        children,
+                        index: UNPLACED,
+                    },
+                );
+            }
+            self.attach(world, entity);
+            touched.push(entity);
+        }
+
+        let mut roots = Vec::new();
+        let mut seen = HashSet::new();
+        for entity in touched {
+            if self.links.contains_key(&entity) {
+                let root = self.root_of(entity);
+                if seen.insert(root) {
+                    roots.push(root);
+                }
+            }
+        }
+        // A tree that gained a subtree is appended again as well
+        old_trees.extend(
+            roots
+                .iter()
+                .map(|root| self.links[root].index)
+                .filter(|index| *index != UNPLACED),
+        );
+        for root in old_trees {
+            let end = self.nodes[root as usize].subtree_end as usize;
+            for node in &mut self.nodes[root as usize..end] {
+                // Trees overlap when several changes hit the same one
+                if node.parent != DEAD {
+                    node.parent = DEAD;
+                    self.dead_nodes += 1;
+                }
+            }
+        }
+        self.append_trees(world, &roots)
+    }
+
+    /// Drops the dead nodes by appending every tree again from the start of the array.
+    fn compact(&mut self, world: &mut World) -> usize {
+        let mut roots = self
+            .links
+            .iter()
+            .filter(|(_, link)| link.parent.is_none())
+            .map(|(entity, _)| *entity)
+            .collect::<Vec<_>>();
+        // Keeps the trees in their current order
+        roots.sort_unstable_by_key(|root| self.links[root].index);
+        self.nodes.clear();
+        self.locals.transforms.clear();
+        self.locals.dirty.clear();
+        self.dead_nodes = 0;
+        self.append_trees(world, &roots)
+    }
+
+    /// Appends the trees under `roots` in depth-first order and marks them dirty.
+    fn append_trees(&mut self, world: &mut World, roots: &[Entity]) -> usize {
+        let start = self.nodes.len();
+        let mut stack = Vec::new();
+        for root in roots {
+            stack.push((*root, NO_PARENT));
+            while let Some((entity, parent)) = stack.pop() {
+                let index = self.nodes.len() as u32;
+                self.nodes.push(Node {
+                    entity,
+                    parent,
+                    subtree_end: index + 1,
+                });
+                let link = self.links.get_mut(&entity).unwrap();
+                link.index = index;
+                // Reversed so children come out of the stack in order
+                stack.extend(link.children.iter().rev().map(|child| (*child, index)));
+                let children = link.children.clone();
+
+                let (has_global, has_children) = {
+                    let entry = world.entry_ref(entity).unwrap();
+                    self.locals
+                        .transforms
+                        .push(*entry.get_component::<Transform>().unwrap());
+                    (
+                        entry.get_component::<GlobalTransform>().is_ok(),
+                        entry.get_component::<Children>().is_ok(),
+                    )
+                };
+                set_component(world, entity, NodeIndex(index));
+                if !has_global {
+                    world
+                        .entry(entity)
+                        .unwrap()
+                        .add_component(GlobalTransform::default());
+                }
+                if has_children || !children.is_empty() {
+                    set_component(world, entity, Children(children));
+                }
+            }
+        }
+        // In depth-first order a subtree ends where the last subtree of its children ends
+        for index in (start..self.nodes.len()).rev() {
+            let node = self.nodes[index];
+            if node.parent != NO_PARENT {
+                let parent = &mut self.nodes[node.parent as usize];
+                parent.subtree_end = parent.subtree_end.max(node.subtree_end);
+            }
+        }
+
+        self.locals
+            .affines
+            .resize(self.nodes.len(), Affine2::IDENTITY);
+        self.globals.resize(self.nodes.len(), Affine2::IDENTITY);
+        self.kernel.compute_affines(
+            &self.locals.transforms[start..],
+            &mut self.locals.affines[start..],
+        );
+        let nodes = &self.nodes;
+        self.locals.dirty.extend(
+            (start..nodes.len())
+                .filter(|index| nodes[*index].parent == NO_PARENT)
+                .map(|index| index as u32),
+        );
+        nodes.len() - start
+    }
+
+    fn root_of(&self, mut entity: Entity) -> Entity {
+        while let Some(parent) = self.links[&entity].parent {
+            entity = parent;
+        }
+        entity
+    }
+
+    /// Unlinks a node from its parent, or from the orphans waiting for its parent.
+    fn detach(&mut self, entity: Entity) {
+        let link = self.links.get_mut(&entity).unwrap();
+        let (declared, parent) = (link.declared.take(), link.parent.take());
+        match (parent, declared) {
+            (Some(parent), _) => {
+                let siblings = &mut self.links.get_mut(&parent).unwrap().children;
+                siblings.retain(|sibling| *sibling != entity);
+            }
+            (None, Some(declared)) => {
+                if let Some(siblings) = self.orphans.get_mut(&declared) {
+                    siblings.retain(|sibling| *sibling != entity);
+                    if siblings.is_empty() {
+                        self.orphans.remove(&declared);
+                    }
+                }
+            }
+            (None, None) => {}
+        }
+    }
+
+    /// Links a detached node under the parent named by its `Parent`.
+    fn attach(&mut self, world: &World, entity: Entity) {
+        let declared = world
+            .entry_ref(entity)
+            .ok()
+            .and_then(|entry| entry.get_component::<Parent>().ok().map(|parent| parent.0));
+        let parent = match declared {
+            Some(parent) if self.links.contains_key(&parent) => {
+                let mut ancestor = Some(parent);
+                while let Some(node) = ancestor.filter(|node| *node != entity) {
+                    ancestor = self.links[&node].parent;
+                }
+                if ancestor.is_some() {
+                    log::warn!(
+                        "{:?} is part of a parent cycle, treating it as a root",
+                        entity
+                    );
+                    None
+                } else {
+                    Some(parent)
+                }
+            }
+            Some(parent) => {
+                // A parent that gets its Transform later in the same update adopts it then
+                if !has_transform(world, parent) {
+                    log::warn!(
+                        "{:?} has a parent without a Transform, treating it as a root",
+                        entity
+                    );
+                }
+                self.orphans.entry(parent).or_default().push(entity);
+                None
+            }
+            None => None,
+        };
+        if let Some(parent) = parent {
+            self.links.get_mut(&parent).unwrap().children.push(entity);
+        }
+        let link = self.links.get_mut(&entity).unwrap();
+        link.declared = declared;
+        link.parent = parent;
+    }
+
+    /// Turns the dirty nodes into the disjoint, sorted ranges of their subtrees.
+    fn dirty_ranges(&mut self) -> Vec<Range<usize>> {
+        self.locals.dirty.sort_unstable();
+        let mut ranges = Vec::<Range<usize>>::new();
+        for index in self.locals.dirty.iter().map(|index| *index as usize) {
+            if ranges.last().map_or(false, |range| range.contains(&index)) {
+                continue;
+            }
+            ranges.push(index..self.nodes[index].subtree_end as usize);
+        }
+        ranges
+    }
+
+    fn propagate(&mut self, ranges: &[Range<usize>]) {
+        // The parent of a range's root lies outside every dirty range, so it is read up front and
+        // the ranges are handed out as disjoint mutable slices
+        let bases = ranges
+            .iter()
+            .map(|range| match self.nodes[range.start].parent {
+                NO_PARENT => Affine2::IDENTITY,
+                parent => self.globals[parent as usize],
+            })
+            .collect::<Vec<_>>();
+        let mut jobs = Vec::with_capacity(ranges.len());
+        let mut rest = &mut self.globals[..];
+        let mut rest_start = 0;
+        for (range, base) in ranges.iter().zip(bases) {
+            let (_, tail) = std::mem::take(&mut rest).split_at_mut(range.start - rest_start);
+            let (globals, tail) = tail.split_at_mut(range.len());
+            rest = tail;
+            rest_start = range.end;
+            jobs.push((base, range.start, globals));
+        }
+
+        let nodes = &self.nodes;
+        let locals = &self.locals.affines;
+        let run = |(base, start, globals): (Affine2, usize, &mut [Affine2])| {
+            propagate_range(nodes, locals, base, start, globals)
+        };
+        #[cfg(not(target_arch = "wasm32"))]
+        {
+            let dirty_nodes = ranges.iter().map(|range| range.len()).sum::<usize>();
+            if dirty_nodes >= Self::PARALLEL_THRESHOLD && jobs.len() > 1 {
+                use tempeh_ecs::rayon::prelude::*;
+                jobs.into_par_iter().for_each(run);
+                return;
+            }
+        }
+        jobs.into_iter().for_each(run);
+    }
+}
+
+fn propagate_range(
+    nodes: &[Node],
+    locals: &[Affine2],
+    base: Affine2,
+    start: usize,
+    globals: &mut [Affine2],
+) {
+    for offset in 0..globals.len() {
+        let index = start + offset;
+        let parent = if offset == 0 {
+            base
+        } else {
+            // Parents precede their children and the range is a whole subtree
+            globals[nodes[index].parent as usize - start]
+        };
+        globals[offset] = parent * locals[index];
+    }
+}
+
+/// Builds the closure that compares the transforms of chunks written to since its last run
+/// against the cached copies.
+fn diff_locals() -> Box<dyn FnMut(&World, &mut Locals)> {
+    let mut query =
+        <(Read<Transform>, Read<NodeIndex>)>::query().filter(maybe_changed::<Transform>());
+    Box::new(move |world, locals| {
+        for chunk in query.iter_chunks(world) {
+            let (transforms, indices) = chunk.into_components();
+            for (transform, NodeIndex(index)) in transforms.iter().zip(indices) {
+                let cached = match locals.transforms.get_mut(*index as usize) {
+                    Some(cached) => cached,
+                    // Not part of the hierarchy until the next rebuild
+                    None => continue,
+                };
+                if cached != transform {
+                    *cached = *transform;
+                    locals.affines[*index as usize] = Affine2::from_transform(transform);
+                    locals.dirty.push(*index);
+                }
+            }
+        }
+    })
+}
+
+fn has_transform(world: &World, entity: Entity) -> bool {
+    world
+        .entry_ref(entity)
+        .map_or(false, |entry| entry.get_component::<Transform>().is_ok())
+}
+
+/// Overwrites the component if the entity has one, adds it otherwise.
+fn set_component<T: Component>(world: &mut World, entity: Entity, value: T) {
+    let mut entry = world.entry(entity).unwrap();
+    match entry.get_component_mut::<T>() {
+        Ok(component) => *component = value,
+        Err(_) => entry.add_component(value),
+    }
+}
+
+/// Keeps `GlobalTransform` up to date for every entity with a `Transform`, taking `Parent` into
+/// account. Plugins that read `GlobalTransform` add it themselves; adding it again does nothing.
+pub struct HierarchyPlugin;
+
+/// Marks the hierarchy as installed.
+struct HierarchyInstalled;
+
+impl<W: tempeh_window::Runner> Plugin<W> for HierarchyPlugin {
+    fn inject(&self, app: &mut AppBuilder<W>) {
+        if app.get_resource::<HierarchyInstalled>().is_some() {
+            return;
+        }
+        app.add_resource(HierarchyInstalled);
+        app.track_changes::<Transform>();
+        app.track_changes::<Parent>();
+        let mut hierarchy = TransformHierarchy::default();
+        app.add_update_end_fn(move |world, resources| hierarchy.update(world, resources));
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use tempeh_ecs::events::ChangeTracker;
+    use tempeh_math::Point2;
+
+    fn at(x: f32, y: f32) -> Transform {
+        Transform {
+            position: Point2::new(x, y),
+            ..Transform::default()
+        }
+    }
+
+    fn global_position(world: &World, entity: Entity) -> [f32; 2] {
+        world
+            .entry_ref(entity)
+            .unwrap()
+            .get_component::<GlobalTransform>()
+            .unwrap()
+            .0
+            .translation
+    }
+
+    #[test]
+    fn propagates_only_moved_subtrees() {
+        let mut world = World::default();
+        let mut resources = Resources::default();
+        let mut tracker = ChangeTracker::new();
+        tracker.track::<Transform>(&mut world, &mut resources);
+        tracker.track::<Parent>(&mut world, &mut resources);
+        let mut hierarchy = TransformHierarchy::default();
+
+        let root = world.push((at(10.0, 0.0),));
+        let child = world.push((at(1.0, 0.0), Parent(root)));
+        let grandchild = world.push((at(0.0, 1.0), Parent(child)));
+        let other_root = world.push((at(-5.0, -5.0),));
+        tracker.update(&world, &mut resources);
+        hierarchy.update(&mut world, &resources);
+
+        assert!(hierarchy.stats().rebuilt);
+        assert_eq!(hierarchy.stats().nodes, 4);
+        assert_eq!(global_position(&world, grandchild), [11.0, 1.0]);
+        assert_eq!(global_position(&world, other_root), [-5.0, -5.0]);
+        let children = world.entry_ref(root).unwrap();
+        let children = children.get_component::<Children>().unwrap();
+        assert_eq!(children.iter().copied().collect::<Vec<_>>(), vec![child]);
+
+        *world
+            .entry_mut(child)
+            .unwrap()
+            .get_component_mut::<Transform>()
+            .unwrap() = at(2.0, 0.0);
+        tracker.update(&world, &mut resources);
+        hierarchy.update(&mut world, &resources);
+
+        let stats = hierarchy.stats();
+        assert!(!stats.rebuilt);
+        assert_eq!((stats.dirty_subtrees, stats.dirty_nodes), (1, 2));
+        assert_eq!(global_position(&world, grandchild), [12.0, 1.0]);
+    }
+
+    #[test]
+    fn relinks_only_touched_trees() {
+        let mut world = World::default();
+        let mut resources = Resources::default();
+        let mut tracker = ChangeTracker::new();
+        tracker.track::<Transform>(&mut world, &mut resources);
+        tracker.track::<Parent>(&mut world, &mut resources);
+        let mut hierarchy = TransformHierarchy::default();
+        let mut update = |world: &mut World, resources: &mut Resources| {
+            tracker.update(world, resources);
+            hierarchy.update(world, resources);
+            hierarchy.stats()
+        };
+
+        let root = world.push((at(10.0, 0.0),));
+        let child = world.push((at(1.0, 0.0), Parent(root)));
+        let other_root = world.push((at(-5.0, -5.0),));
+        let bystander = world.push((Transform::default(),));
+        for _ in 0..3 {
+            world.push((Transform::default(), Parent(bystander)));
+        }
+        update(&mut world, &mut resources);
+
+        // Only the tree that gains a node is appended again
+        let late = world.push((at(0.0, 1.0), Parent(other_root)));
+        let stats = update(&mut world, &mut resources);
+        assert!(!stats.rebuilt);
+        assert_eq!((stats.nodes, stats.relinked_nodes), (8, 2));
+        assert_eq!(global_position(&world, late), [-5.0, -4.0]);
+
+        // Both the old and the new tree of a reparented node are
+        *world
+            .entry_mut(child)
+            .unwrap()
+            .get_component_mut::<Parent>()
+            .unwrap() = Parent(other_root);
+        let stats = update(&mut world, &mut resources);
+        assert!(!stats.rebuilt);
+        assert_eq!(stats.relinked_nodes, 4);
+        assert_eq!(global_position(&world, child), [-4.0, -5.0]);
+        let entry = world.entry_ref(root).unwrap();
+        assert!(entry.get_component::<Children>().unwrap().is_empty());
+
+        // Children of a node that loses its Transform become roots, and the dead nodes left behind
+        // by now outnumber the live ones
+        world
+            .entry(other_root)
+            .unwrap()
+            .remove_component::<Transform>();
+        let stats = update(&mut world, &mut resources);
+        assert!(stats.rebuilt);
+        assert_eq!((stats.nodes, stats.relinked_nodes), (7, 7));
+        assert_eq!(global_position(&world, child), [1.0, 0.0]);
+        assert_eq!(global_position(&world, late), [0.0, 1.0]);
+    }
+}
@@ -0,0 +1,392 @@
+//! Fine-grained parallel work for systems: pathfinding batches, procedural generation, asset
+//! decoding.
+//!
+//! Jobs run on the same rayon pool as legion's parallel executor and `par_for_each` systems, so
+//! game code and the ECS never compete with two sets of worker threads. That pool already keeps a
+//! work-stealing deque per worker: a job spawned from a worker is pushed onto its own deque and
+//! idle workers steal from the others. `JobSystem` adds what systems need on top of it:
+//! completion counters, dependencies between jobs, and per-worker utilization stats. On the web,
+//! where there are no threads, every job runs inline.
+
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::{Arc, Condvar, Mutex};
+use std::time::{Duration, Instant};
+
+type Job = Box<dyn FnOnce() + Send + 'static>;
+
+#[cfg(not(target_arch = "wasm32"))]
+use tempeh_ecs::rayon;
+
+#[cfg(not(target_arch = "wasm32"))]
+fn worker_count() -> usize {
+    rayon::current_num_threads()
+}
+
+#[cfg(target_arch = "wasm32")]
+fn worker_count() -> usize {
+    1
+}
+
+/// Index of the calling pool worker, or of the shared slot used by every thread outside the pool.
+#[cfg(not(target_arch = "wasm32"))]
+fn worker_index(workers: usize) -> usize {
+    rayon::current_thread_index()
+        .unwrap_or(workers)
+        .min(workers)
+}
+
+#[cfg(target_arch = "wasm32")]
+fn worker_index(workers: usize) -> usize {
+    workers
+}
+
+struct WorkerStats {
+    busy_nanos: AtomicU64,
+    jobs: AtomicU64,
+}
+
+struct Stats {
+    workers: Box<[WorkerStats]>,
+    since: Mutex<Instant>,
+}
+
+impl Stats {
+    fn run<R>(&self, f: impl FnOnce() -> R) -> R {
+        let start = Instant::now();
+        let result = f();
+        let worker = &self.workers[worker_index(self.workers.len() - 1)];
+        worker
+            .busy_nanos
+            .fetch_add(start.elapsed().as_nanos() as u64, Ordering::Relaxed);
+        worker.jobs.fetch_add(1, Ordering::Relaxed);
+        result
+    }
+}
+
+#[derive(Debug, Clone, Copy)]
+pub struct WorkerUtilization {
+    /// Time spent running jobs since the stats were last reset
+    pub busy: Duration,
+    pub jobs: u64,
+    /// `busy` divided by the wall-clock time since the stats were last reset
+    pub utilization: f32,
+}
+
+struct CounterState {
+    pending: usize,
+    continuations: Vec<Job>,
+}
+
+struct CounterInner {
+    state: Mutex<CounterState>,
+    done: Condvar,
+}
+
+/// Number of unfinished jobs attached to it. Jobs can be made to wait for a counter with
+/// `JobSystem::spawn_after`, which is how dependencies are expressed.
+#[derive(Clone)]
+pub struct JobCounter(Arc<CounterInner>);
+
+impl Default for JobCounter {
+    fn default() -> Self {
+        Self(Arc::new(CounterInner {
+            state: Mutex::new(CounterState {
+                pending: 0,
+                continuations: Vec::new(),
+            }),
+            done: Condvar::new(),
+        }))
+    }
+}
+
+impl JobCounter {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn pending(&self) -> usize {
+        self.0.state.lock().unwrap().pending
+    }
+
+    pub fn is_done(&self) -> bool {
+        self.pending() == 0
+    }
+
+    /// Blocks until every attached job has finished. Must not be called from inside a job, since
+    /// the worker would stop taking part in the work it waits for; chain the work with
+    /// `JobSystem::spawn_after` instead.
+    pub fn wait(&self) {
+        let mut state = self.0.state.lock().unwrap();
+        while state.pending > 0 {
+            state = self.0.done.wait(state).unwrap();
+        }
+    }
+
+    fn increment(&self) {
+        self.0.state.lock().unwrap().pending += 1;
+    }
+
+    fn decrement(&self) {
+        let continuations = {
+            let mut state = self.0.state.lock().unwrap();
+            state.pending -= 1;
+            if state.pending > 0 {
+                return;
+            }
+            self.0.done.notify_all();
+            std::mem::take(&mut state.continuations)
+        };
+        for continuation in continuations {
+            continuation();
+        }
+    }
+
+    /// Runs `f` as soon as the counter reaches zero, immediately if it already has.
+    fn when_done(&self, f: Job) {
+        let mut state = self.0.state.lock().unwrap();
+        if state.pending == 0 {
+            drop(state);
+            f();
+        } else {
+            state.continuations.push(f);
+        }
+    }
+}
+
+/// Engine resource for spawning parallel jobs, see the module documentation.
+#[derive(Clone)]
+pub struct JobSystem {
+    stats: Arc<Stats>,
+}
+
+impl Default for JobSystem {
+    fn default() -> Self {
+        // One slot per pool worker and one shared by all other threads
+        let workers = (0..worker_count() + 1)
+            .map(|_| WorkerStats {
+                busy_nanos: AtomicU64::new(0),
+                jobs: AtomicU64::new(0),
+            })
+            .collect();
+        Self {
+            stats: Arc::new(Stats {
+                workers,
+                since: Mutex::new(Instant::now()),
+            }),
+        }
+    }
+}
+
+impl JobSystem {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn worker_count(&self) -> usize {
+        self.stats.workers.len() - 1
+    }
+
+    /// Spawns `f` and returns a counter that reaches zero once it has finished.
+    pub fn spawn<F: FnOnce() + Send + 'static>(&self, f: F) -> JobCounter {
+        let counter = JobCounter::new();
+        self.spawn_with(&counter, f);
+        counter
+    }
+
+    /// Spawns `f` and attaches it to `counter`, for waiting on a group of jobs at once.
+    pub fn spawn_with<F: FnOnce() + Send + 'static>(&self, counter: &JobCounter, f: F) {
+        counter.increment();
+        let counter = counter.clone();
+        let stats = self.stats.clone();
+        self.launch(Box::new(move || {
+            stats.run(f);
+            counter.decrement();
+        }));
+    }
+
+    /// Spawns `f` once every counter in `dependencies` has reached zero. Returns a counter for `f`
+    /// itself, so chains and graphs of jobs can be built without ever blocking a worker.
+    pub fn spawn_after<F: FnOnce() + Send + 'static>(
+        &self,
+        dependencies: &[&JobCounter],
+        f: F,
+    ) -> JobCounter {
+        let counter = JobCounter::new();
+        counter.increment();
+
+        let job_system = self.clone();
+        let job_counter = counter.clone();
+        let start: Job = Box::new(move || {
+            let stats = job_system.stats.clone();
+            job_system.launch(Box::new(move || {
+                stats.run(f);
+                job_counter.decrement();
+            }));
+        });
+
+        // The last dependency to finish starts the job
+        let remaining = Arc::new(AtomicUsize::new(dependencies.len() + 1));
+        let start = Arc::new(Mutex::new(Some(start)));
+        let release = move |remaining: &AtomicUsize, start: &Mutex<Option<Job>>| {
+            if remaining.fetch_sub(1, Ordering::AcqRel) == 1 {
+                if let Some(start) = start.lock().unwrap().take() {
+                    start();
+                }
+            }
+        };
+        for dependency in dependencies {
+            let remaining = remaining.clone();
+            let start = start.clone();
+            dependency.when_done(Box::new(move || release(&remaining, &start)));
+        }
+        // Accounts for the extra count, so the job cannot start while dependencies are still
+        // being registered
+        release(&remaining, &start);
+        counter
+    }
+
+    /// Runs `f` with a scope whose jobs may borrow data from the caller, such as the components a
+    /// system is iterating. Returns once every job spawned in the scope has finished.
+    #[cfg(not(target_arch = "wasm32"))]
+    pub fn scope<'scope, F, R>(&self, f: F) -> R
+    where
+        F: FnOnce(&JobScope<'_, 'scope>) -> R + Send,
+        R: Send,
+    {
+        rayon::scope(|scope| {
+            f(&JobScope {
+                scope,
+                stats: &self.stats,
+            })
+        })
+    }
+
+    #[cfg(target_arch = "wasm32")]
+    pub fn scope<'scope, F, R>(&self, f: F) -> R
+    where
+        F: FnOnce(&JobScope<'_, 'scope>) -> R + Send,
+        R: Send,
+    {
+        f(&JobScope {
+            stats: &self.stats,
+            _marker: std::marker::PhantomData,
+        })
+    }
+
+    /// Busy time per pool worker since the last `reset_stats`, followed by one entry for all
+    /// threads outside of the pool.
+    pub fn utilization(&self) -> Vec<WorkerUtilization> {
+        let elapsed = self.stats.since.lock().unwrap().elapsed().as_secs_f32();
+        self.stats
+            .workers
+            .iter()
+            .map(|worker| {
+                let busy = Duration::from_nanos(worker.busy_nanos.load(Ordering::Relaxed));
+                WorkerUtilization {
+                    busy,
+                    jobs: worker.jobs.load(Ordering::Relaxed),
+                    utilization: if elapsed > 0.0 {
+                        busy.as_secs_f32() / elapsed
+                    } else {
+                        0.0
+                    },
+                }
+            })
+            .collect()
+    }
+
+    pub fn reset_stats(&self) {
+        let mut since = self.stats.since.lock().unwrap();
+        for worker in self.stats.workers.iter() {
+            worker.busy_nanos.store(0, Ordering::Relaxed);
+            worker.jobs.store(0, Ordering::Relaxed);
+        }
+        *since = Instant::now();
+    }
+
+    #[cfg(not(target_arch = "wasm32"))]
+    fn launch(&self, job: Job) {
+        rayon::spawn(job);
+    }
+
+    #[cfg(target_arch = "wasm32")]
+    fn launch(&self, job: Job) {
+        job();
+    }
+}
+
+/// Spawns jobs that may borrow from the enclosing `JobSystem::scope` call.
+#[cfg(not(target_arch = "wasm32"))]
+pub struct JobScope<'a, 'scope> {
+    scope: &'a rayon::Scope<'scope>,
+    stats: &'a Arc<Stats>,
+}
+
+#[cfg(not(target_arch = "wasm32"))]
+impl<'a, 'scope> JobScope<'a, 'scope> {
+    pub fn spawn<F: FnOnce() + Send + 'scope>(&self, f: F) {
+        let stats = self.stats.clone();
+        self.scope.spawn(move |_| stats.run(f));
+    }
+}
+
+#[cfg(target_arch = "wasm32")]
+pub struct JobScope<'a, 'scope> {
+    stats: &'a Arc<Stats>,
+    _marker: std::marker::PhantomData<&'scope ()>,
+}
+
+#[cfg(target_arch = "wasm32")]
+impl<'a, 'scope> JobScope<'a, 'scope> {
+    pub fn spawn<F: FnOnce() + Send + 'scope>(&self, f: F) {
+        self.stats.run(f);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn dependencies_run_in_order() {
+        let jobs = JobSystem::new();
+        let log = Arc::new(Mutex::new(Vec::new()));
+
+        let group = JobCounter::new();
+        for i in 0..8 {
+            let log = log.clone();
+            jobs.spawn_with(&group, move || {
+                std::thread::sleep(Duration::from_millis(1));
+                log.lock().unwrap().push(i);
+            });
+        }
+        let single = {
+            let log = log.clone();
+            jobs.spawn(move || log.lock().unwrap().push(100))
+        };
+        let last = {
+            let log = log.clone();
+            jobs.spawn_after(&[&group, &single], move || log.lock().unwrap().push(200))
+        };
+        last.wait();
+
+        let log = log.lock().unwrap();
+        assert_eq!(log.len(), 10);
+        assert_eq!(*log.last().unwrap(), 200);
+        assert!(group.is_done() && single.is_done());
+    }
+
+    #[test]
+    fn scoped_jobs_borrow() {
+        let jobs = JobSystem::new();
+        let mut values = vec![1_u64; 1000];
+        jobs.scope(|scope| {
+            for chunk in values.chunks_mut(100) {
+                scope.spawn(move || chunk.iter_mut().for_each(|value| *value *= 2));
+            }
+        });
+        assert_eq!(values.iter().sum::<u64>(), 2000);
+        let jobs_run: u64 = jobs.utilization().iter().map(|worker| worker.jobs).sum();
+        assert_eq!(jobs_run, 10);
+    }
+}
@@ -1,9 +1,20 @@
 pub mod app;
+pub mod assets;
+pub mod hierarchy;
+pub mod jobs;
 pub mod plugins;
+pub mod tasks;
 
 pub use app::AppBuilder;
 
 pub mod prelude {
+    pub use crate::assets::{
+        AssetCategory, AssetEvent, AssetResidency, AssetSize, Assets, Handle, LoadPriority,
+        LoadState, WeakHandle,
+    };
+    pub use crate::hierarchy::{Children, HierarchyPlugin, Parent};
+    pub use crate::jobs::{JobCounter, JobSystem};
+    pub use crate::tasks::{TaskExecutor, TaskHandle};
     pub use crate::AppBuilder;
 }
 
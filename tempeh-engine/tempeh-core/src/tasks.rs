@@ -0,0 +1,440 @@
+//! Engine-owned async executor for file I/O, asset loading and other work that waits more than it
+//! computes.
+//!
+//! Futures spawned on the `TaskExecutor` resource are polled on the job system's worker threads
+//! whenever they are woken, never on the frame thread, so a slow future cannot stall a frame.
+//! Systems either check a `TaskHandle` for the result whenever they run, or attach a completion
+//! callback that runs with exclusive world access at the start of the next frame. Callbacks share
+//! a per-frame time budget; the ones that do not fit are carried over to the following frame.
+//!
+//! On the web there are no worker threads, so woken futures are polled at the start of the frame
+//! instead.
+
+use std::collections::VecDeque;
+use std::future::Future;
+use std::panic::{catch_unwind, AssertUnwindSafe};
+use std::pin::Pin;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, Mutex};
+use std::task::{Context, Poll, Wake, Waker};
+use std::time::{Duration, Instant};
+
+use tempeh_ecs::{Resources, World};
+
+#[cfg(not(target_arch = "wasm32"))]
+use tempeh_ecs::rayon;
+
+type BoxFuture = Pin<Box<dyn Future<Output = ()> + Send + 'static>>;
+type Completion = Box<dyn FnOnce(&mut World, &mut Resources) + Send + 'static>;
+
+/// Runs a future to completion on the calling thread. Only meant for startup code such as creating
+/// the GPU device; systems should spawn on the `TaskExecutor` instead.
+pub fn block_on<F: Future>(future: F) -> F::Output {
+    struct ThreadWaker(std::thread::Thread);
+
+    impl Wake for ThreadWaker {
+        fn wake(self: Arc<Self>) {
+            self.0.unpark();
+        }
+    }
+
+    let waker = Waker::from(Arc::new(ThreadWaker(std::thread::current())));
+    let mut context = Context::from_waker(&waker);
+    let mut future = Box::pin(future);
+    loop {
+        if let Poll::Ready(output) = future.as_mut().poll(&mut context) {
+            return output;
+        }
+        std::thread::park();
+    }
+}
+
+enum SlotState<T> {
+    Pending(Option<Waker>),
+    Ready(T),
+    Taken,
+    Panicked,
+}
+
+/// Where a task leaves its output for the `TaskHandle`.
+struct Slot<T>(Mutex<SlotState<T>>);
+
+impl<T> Slot<T> {
+    fn finish(&self, state: SlotState<T>) {
+        let previous = std::mem::replace(&mut *self.0.lock().unwrap(), state);
+        if let SlotState::Pending(Some(waker)) = previous {
+            waker.wake();
+        }
+    }
+}
+
+/// Result of a spawned task. Dropping the handle does not cancel the task.
+pub struct TaskHandle<T>(Arc<Slot<T>>);
+
+impl<T> TaskHandle<T> {
+    pub fn is_finished(&self) -> bool {
+        !matches!(*self.0 .0.lock().unwrap(), SlotState::Pending(_))
+    }
+
+    /// Takes the output if the task has finished and it was not taken before.
+    pub fn try_take(&mut self) -> Option<T> {
+        let mut state = self.0 .0.lock().unwrap();
+        match std::mem::replace(&mut *state, SlotState::Taken) {
+            SlotState::Ready(output) => Some(output),
+            other => {
+                *state = other;
+                None
+            }
+        }
+    }
+
+    /// Whether the task panicked, in which case it never produces an output.
+    pub fn is_panicked(&self) -> bool {
+        matches!(*self.0 .0.lock().unwrap(), SlotState::Panicked)
+    }
+}
+
+/// Lets tasks await each other.
+impl<T> Future for TaskHandle<T> {
+    type Output = T;
+
+    fn poll(self: Pin<&mut Self>, context: &mut Context<'_>) -> Poll<T> {
+        let mut state = self.0 .0.lock().unwrap();
+        match std::mem::replace(&mut *state, SlotState::Taken) {
+            SlotState::Ready(output) => Poll::Ready(output),
+            SlotState::Pending(_) => {
+                *state = SlotState::Pending(Some(context.waker().clone()));
+                Poll::Pending
+            }
+            SlotState::Taken => panic!("Task output was already taken"),
+            SlotState::Panicked => panic!("Awaited task panicked"),
+        }
+    }
+}
+
+struct Task {
+    future: Mutex<Option<BoxFuture>>,
+    /// Set while the task sits in a run queue, so a burst of wakes schedules a single poll
+    scheduled: AtomicBool,
+    #[cfg(target_arch = "wasm32")]
+    shared: Arc<Shared>,
+}
+
+impl Task {
+    fn schedule(self: Arc<Self>) {
+        if self.scheduled.swap(true, Ordering::AcqRel) {
+            return;
+        }
+        #[cfg(not(target_arch = "wasm32"))]
+        rayon::spawn(move || self.run());
+        #[cfg(target_arch = "wasm32")]
+        self.shared.ready.lock().unwrap().push_back(self.clone());
+    }
+
+    fn run(self: Arc<Self>) {
+        self.scheduled.store(false, Ordering::Release);
+        let mut future = self.future.lock().unwrap();
+        let finished = match future.as_mut() {
+            Some(inner) => {
+                let waker = Waker::from(self.clone());
+                let mut context = Context::from_waker(&waker);
+                inner.as_mut().poll(&mut context).is_ready()
+            }
+            None => false,
+        };
+        if finished {
+            *future = None;
+        }
+    }
+}
+
+impl Wake for Task {
+    fn wake(self: Arc<Self>) {
+        self.schedule();
+    }
+}
+
+#[derive(Default)]
+struct Shared {
+    completions: Mutex<VecDeque<Completion>>,
+    #[cfg(target_arch = "wasm32")]
+    ready: Mutex<VecDeque<Arc<Task>>>,
+}
+
+#[derive(Debug, Default, Clone, Copy)]
+pub struct TaskStats {
+    pub completions_run: usize,
+    pub completions_pending: usize,
+    pub completion_time: Duration,
+}
+
+/// Engine resource for spawning futures, see the module documentation.
+pub struct TaskExecutor {
+    shared: Arc<Shared>,
+    completion_budget: Duration,
+    stats: TaskStats,
+}
+
+impl Default for TaskExecutor {
+    fn default() -> Self {
+        Self {
+            shared: Arc::new(Shared::default()),
+            completion_budget: Duration::from_millis(2),
+            stats: TaskStats::default(),
+        }
+    }
+}
+
+impl TaskExecutor {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Time completion callbacks may take per frame. At least one callback runs every frame so
+    /// completions always make progress.
+    pub fn set_completion_budget(&mut self, budget: Duration) {
+        self.completion_budget = budget;
+    }
+
+    pub fn stats(&self) -> TaskStats {
+        self.stats
+    }
+
+    pub fn spawn<F>(&self, future: F) -> TaskHandle<F::Output>
+    where
+        F: Future + Send + 'static,
+        F::Output: Send + 'static,
+    {
+        let slot = Arc::new(Slot(Mutex::new(SlotState::Pending(None))));
+        let task_slot = slot.clone();
+        self.spawn_boxed(Box::pin(PanicGuard {
+            future: Box::pin(future),
+            on_output: Some(Box::new(move |output| {
+                task_slot.finish(match output {
+                    Some(output) => SlotState::Ready(output),
+                    None => SlotState::Panicked,
+                })
+            })),
+        }));
+        TaskHandle(slot)
+    }
+
+    /// Spawns `future` and runs `callback` with its output at the start of the first frame after
+    /// it finished.
+    pub fn spawn_then<F, C>(&self, future: F, callback: C)
+    where
+        F: Future + Send + 'static,
+        F::Output: Send + 'static,
+        C: FnOnce(F::Output, &mut World, &mut Resources) + Send + 'static,
+    {
+        let shared = self.shared.clone();
+        self.spawn_boxed(Box::pin(PanicGuard {
+            future: Box::pin(future),
+            on_output: Some(Box::new(move |output| {
+                if let Some(output) = output {
+                    shared.completions.lock().unwrap().push_back(Box::new(
+                        move |world: &mut World, resources: &mut Resources| {
+                            callback(output, world, resources)
+                        },
+                    ));
+                }
+            })),
+        }));
+    }
+
+    /// Runs a function that blocks, such as synchronous file reads, on a thread of its own so it
+    /// occupies neither the frame thread nor a job worker.
+    pub fn spawn_blocking<F, T>(&self, f: F) -> TaskHandle<T>
+    where
+        F: FnOnce() -> T + Send + 'static,
+        T: Send + 'static,
+    {
+        let slot = Arc::new(Slot(Mutex::new(SlotState::Pending(None))));
+        let task_slot = slot.clone();
+        let run = move || {
+            task_slot.finish(match catch_unwind(AssertUnwindSafe(f)) {
+                Ok(output) => SlotState::Ready(output),
+                Err(_) => {
+                    log::error!("Blocking task panicked");
+                    SlotState::Panicked
+                }
+            })
+        };
+        #[cfg(not(target_arch = "wasm32"))]
+        std::thread::Builder::new()
+            .name("tempeh-blocking-task".to_owned())
+            .spawn(run)
+            .expect("Unable to spawn blocking task thread");
+        #[cfg(target_arch = "wasm32")]
+        run();
+        TaskHandle(slot)
+    }
+
+    fn spawn_boxed(&self, future: BoxFuture) {
+        Arc::new(Task {
+            future: Mutex::new(Some(future)),
+            scheduled: AtomicBool::new(false),
+            #[cfg(target_arch = "wasm32")]
+            shared: self.shared.clone(),
+        })
+        .schedule();
+    }
+
+    /// Runs completion callbacks within the budget. Called by `AppBuilder` at the start of every
+    /// frame.
+    pub fn run_frame_point(world: &mut World, resources: &mut Resources) {
+        let (shared, budget) = match resources.get::<TaskExecutor>() {
+            Some(executor) => (executor.shared.clone(), executor.completion_budget),
+            None => return,
+        };
+
+        #[cfg(target_arch = "wasm32")]
+        loop {
+            let task = shared.ready.lock().unwrap().pop_front();
+            match task {
+                Some(task) => task.run(),
+                None => break,
+            }
+        }
+
+        let start = Instant::now();
+        let mut completions_run = 0;
+        loop {
+            // Not holding the lock while the callback runs, since it may spawn more tasks
+            let completion = shared.completions.lock().unwrap().pop_front();
+            match completion {
+                Some(completion) => completion(world, resources),
+                None => break,
+            }
+            completions_run += 1;
+            if start.elapsed() >= budget {
+                break;
+            }
+        }
+
+        let completions_pending = shared.completions.lock().unwrap().len();
+        if let Some(mut executor) = resources.get_mut::<TaskExecutor>() {
+            executor.stats = TaskStats {
+                completions_run,
+                completions_pending,
+                completion_time: start.elapsed(),
+            };
+        }
+    }
+}
+
+/// Hands the output of `future` to `on_output`, or `None` if polling it panicked. A panicking
+/// future is logged and dropped instead of taking down a worker thread.
+struct PanicGuard<F: Future> {
+    future: Pin<Box<F>>,
+    on_output: Option<Box<dyn FnOnce(Option<F::Output>) + Send>>,
+}
+
+impl<F: Future> Future for PanicGuard<F> {
+    type Output = ();
+
+    fn poll(self: Pin<&mut Self>, context: &mut Context<'_>) -> Poll<()> {
+        let this = self.get_mut();
+        let output = match catch_unwind(AssertUnwindSafe(|| this.future.as_mut().poll(context))) {
+            Ok(Poll::Pending) => return Poll::Pending,
+            Ok(Poll::Ready(output)) => Some(output),
+            Err(_) => {
+                log::error!("Async task panicked");
+                None
+            }
+        };
+        if let Some(on_output) = this.on_output.take() {
+            on_output(output);
+        }
+        Poll::Ready(())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Pending until its flag is set from another thread.
+    struct Gate(Arc<Mutex<(bool, Option<Waker>)>>);
+
+    impl Future for Gate {
+        type Output = ();
+
+        fn poll(self: Pin<&mut Self>, context: &mut Context<'_>) -> Poll<()> {
+            let mut gate = self.0.lock().unwrap();
+            if gate.0 {
+                Poll::Ready(())
+            } else {
+                gate.1 = Some(context.waker().clone());
+                Poll::Pending
+            }
+        }
+    }
+
+    fn open(gate: &Arc<Mutex<(bool, Option<Waker>)>>) {
+        let waker = {
+            let mut gate = gate.lock().unwrap();
+            gate.0 = true;
+            gate.1.take()
+        };
+        if let Some(waker) = waker {
+            waker.wake();
+        }
+    }
+
+    #[test]
+    fn tasks_await_each_other() {
+        let executor = TaskExecutor::new();
+        let gate = Arc::new(Mutex::new((false, None)));
+        let first = executor.spawn(Gate(gate.clone()));
+        let mut second = executor.spawn(async move {
+            first.await;
+            42
+        });
+        assert!(!second.is_finished());
+        open(&gate);
+        assert_eq!(block_on(async { (&mut second).await }), 42);
+        assert!(second.try_take().is_none());
+
+        let mut blocking = executor.spawn_blocking(|| 7);
+        while !blocking.is_finished() {
+            std::thread::yield_now();
+        }
+        assert_eq!(blocking.try_take(), Some(7));
+    }
+
+    #[test]
+    fn completions_respect_budget() {
+        let mut world = World::default();
+        let mut resources = Resources::default();
+        let mut executor = TaskExecutor::new();
+        executor.set_completion_budget(Duration::from_millis(0));
+        for i in 0..3_u32 {
+            executor.spawn_then(async move { i }, |i, _world, resources| {
+                resources.get_mut::<Vec<u32>>().unwrap().push(i)
+            });
+        }
+        resources.insert(executor);
+        resources.insert(Vec::<u32>::new());
+
+        // Completions are queued from worker threads, wait until all of them arrived
+        while resources
+            .get::<TaskExecutor>()
+            .unwrap()
+            .shared
+            .completions
+            .lock()
+            .unwrap()
+            .len()
+            < 3
+        {
+            std::thread::yield_now();
+        }
+        for frame in 1..=3 {
+            TaskExecutor::run_frame_point(&mut world, &mut resources);
+            assert_eq!(resources.get::<Vec<u32>>().unwrap().len(), frame);
+        }
+        let stats = resources.get::<TaskExecutor>().unwrap().stats();
+        assert_eq!((stats.completions_run, stats.completions_pending), (1, 0));
+    }
+}
@@ -0,0 +1,98 @@
+//! Serial vs. parallel `for_each` over a transform-like workload.
+//!
+//! Run with `cargo bench -p tempeh-ecs --bench par_for_each`.
+
+use std::time::{Duration, Instant};
+
+use tempeh_ecs::systems::ParallelRunnable;
+use tempeh_ecs::{system, Resources, Schedule, World};
+
+#[derive(Clone, Copy)]
+struct Position {
+    x: f32,
+    y: f32,
+    rotation: f32,
+}
+
+#[derive(Clone, Copy)]
+struct Velocity {
+    x: f32,
+    y: f32,
+    angular: f32,
+}
+
+fn integrate(position: &mut Position, velocity: &Velocity) {
+    position.x += velocity.x * 0.016;
+    position.y += velocity.y * 0.016;
+    position.rotation = (position.rotation + velocity.angular * 0.016)
+        .sin()
+        .atan2(1.0);
+}
+
+#[system(for_each)]
+fn serial(position: &mut Position, velocity: &Velocity) {
+    integrate(position, velocity);
+}
+
+#[system(par_for_each)]
+fn per_chunk(position: &mut Position, velocity: &Velocity) {
+    integrate(position, velocity);
+}
+
+#[system(par_for_each, min_batch = 1024)]
+fn batched(position: &mut Position, velocity: &Velocity) {
+    integrate(position, velocity);
+}
+
+#[system(par_for_each, adaptive)]
+fn adaptive(position: &mut Position, velocity: &Velocity) {
+    integrate(position, velocity);
+}
+
+fn measure<S: ParallelRunnable + 'static>(entity_count: usize, system: S) -> Duration {
+    let mut world = World::default();
+    world.extend((0..entity_count).map(|i| {
+        (
+            Position {
+                x: i as f32,
+                y: 0.0,
+                rotation: 0.0,
+            },
+            Velocity {
+                x: 1.0,
+                y: -1.0,
+                angular: 0.5,
+            },
+        )
+    }));
+    let mut resources = Resources::default();
+    let mut schedule = Schedule::builder().add_system(system).build();
+
+    // Warm up caches and let the adaptive tuner settle
+    for _ in 0..10 {
+        schedule.execute(&mut world, &mut resources);
+    }
+    let iterations = (2_000_000 / entity_count).max(10);
+    let start = Instant::now();
+    for _ in 0..iterations {
+        schedule.execute(&mut world, &mut resources);
+    }
+    start.elapsed() / iterations as u32
+}
+
+fn main() {
+    println!(
+        "{:>10} {:>12} {:>12} {:>12} {:>12}",
+        "entities", "serial", "per chunk", "min_batch", "adaptive"
+    );
+    for &entity_count in &[1_000, 10_000, 100_000, 1_000_000] {
+        println!(
+            "{:>10} {:>12?} {:>12?} {:>12?} {:>12?}",
+            entity_count,
+            measure(entity_count, serial_system()),
+            measure(entity_count, per_chunk_system()),
+            measure(entity_count, batched_system()),
+            measure(entity_count, adaptive_system()),
+        );
+    }
+}
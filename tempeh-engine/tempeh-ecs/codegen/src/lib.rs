@@ -3,8 +3,9 @@ use proc_macro::TokenStream;
 use proc_macro2::Span;
 use quote::{format_ident, quote, quote_spanned};
 use syn::{
-    parse_macro_input, parse_quote, spanned::Spanned, Attribute, Expr, GenericArgument, Generics,
-    Ident, Index, ItemFn, Lit, Meta, PathArguments, Signature, Type, TypePath, Visibility,
+    parse_macro_input, parse_quote, spanned::Spanned, Attribute, AttributeArgs, Expr, GenericArgument, Generics,
+    Ident, Index, ItemFn, Lit, LitInt, Meta, NestedMeta, PathArguments, Signature, Type, TypePath,
+    Visibility,
 };
 
 /// Wraps a function in a system, and generates a new function which constructs that system.
@@ -119,6 +120,27 @@ use syn::{
 /// }
 /// ```
 ///
+/// `par_for_each` normally splits work per legion chunk. `min_batch = N` additionally spreads every
+/// chunk over the worker threads, which lets a few large archetypes use every core, in tasks of at
+/// least `N` entities (except the remainder at the end of a chunk). With `adaptive` the task size
+/// is picked at runtime from the measured cost per entity, again never below `min_batch` if given.
+/// Optional component references cannot be combined with either option.
+///
+/// ```ignore
+/// # use tempeh_ecs_codegen::system;
+/// # struct Position { x: f32 }
+/// # struct Velocity { x: f32 }
+/// #[system(par_for_each, min_batch = 256)]
+/// fn update_positions(pos: &mut Position, vel: &Velocity) {
+///     pos.x += vel.x;
+/// }
+///
+/// #[system(par_for_each, adaptive)]
+/// fn update_positions_adaptive(pos: &mut Position, vel: &Velocity) {
+///     pos.x += vel.x;
+/// }
+/// ```
+///
 /// Systems can contain their own state. Add a reference marked with the `#[state]` parameter to
 /// your function. This state will be initialized when you construct the system.
 ///
@@ -161,8 +183,8 @@ pub fn system(attr: TokenStream, item: TokenStream) -> TokenStream {
     let attr = if attr.is_empty() {
         Ok(SystemAttr::default())
     } else {
-        let meta = parse_macro_input!(attr as Meta);
-        SystemAttr::parse_meta(&meta)
+        let args = parse_macro_input!(attr as AttributeArgs);
+        SystemAttr::parse_args(&args)
     };
 
     let result = attr
@@ -191,6 +213,10 @@ enum Error {
     DuplicateConstructorName,
     #[error("duplicate system type")]
     DuplicateSystemType,
+    #[error("duplicate min_batch")]
+    DuplicateMinBatch,
+    #[error("min_batch must be a positive integer literal")]
+    InvalidMinBatch(Span),
     #[error("invalid key")]
     InvalidKey(Span),
     #[error("system functions must not recieve self")]
@@ -222,6 +248,7 @@ impl Error {
         match self {
             Error::UnexpectedSystemType(span) => *span,
             Error::InvalidKey(span) => *span,
+            Error::InvalidMinBatch(span) => *span,
             Error::InvalidOptionArgument(span, _) => *span,
             Error::InvalidArgument(span) => *span,
             Error::ExpectedComponentType(span) => *span,
@@ -241,6 +268,8 @@ impl Error {
 struct SystemAttr {
     constructor_name: Option<Lit>,
     system_type: Option<SystemType>,
+    min_batch: Option<LitInt>,
+    adaptive: bool,
 }
 
 impl SystemAttr {
@@ -248,7 +277,40 @@ impl SystemAttr {
         Self {
             constructor_name,
             system_type,
+            ..Self::default()
+        }
+    }
+
+    fn parse_args(args: &[NestedMeta]) -> Result<Self, Error> {
+        let mut result = Self::default();
+        for item in args {
+            let attr = match item {
+                NestedMeta::Meta(meta) => Self::parse_meta(meta)?,
+                NestedMeta::Lit(_) => panic!("unexpected literal"),
+            };
+            result.merge(attr)?;
+        }
+        Ok(result)
+    }
+
+    fn merge(&mut self, other: Self) -> Result<(), Error> {
+        if let Some(constructor_name) = other.constructor_name {
+            if self.constructor_name.replace(constructor_name).is_some() {
+                return Err(Error::DuplicateConstructorName);
+            }
+        }
+        if let Some(system_type) = other.system_type {
+            if self.system_type.replace(system_type).is_some() {
+                return Err(Error::DuplicateSystemType);
+            }
+        }
+        if let Some(min_batch) = other.min_batch {
+            if self.min_batch.replace(min_batch).is_some() {
+                return Err(Error::DuplicateMinBatch);
+            }
         }
+        self.adaptive |= other.adaptive;
+        Ok(())
     }
 
     fn parse_meta(meta: &Meta) -> Result<Self, Error> {
@@ -261,36 +323,30 @@ impl SystemAttr {
                     Self::new(None, Some(SystemType::ParForEach))
                 } else if ident == "simple" {
                     Self::new(None, Some(SystemType::Simple))
+                } else if ident == "adaptive" {
+                    Self {
+                        adaptive: true,
+                        ..Self::default()
+                    }
                 } else {
                     return Err(Error::UnexpectedSystemType(ident.span()));
                 }
             }
             Meta::List(items) => {
-                let mut n = None;
-                let mut s = None;
-                for item in &items.nested {
-                    let Self {
-                        constructor_name,
-                        system_type,
-                    } = match item {
-                        syn::NestedMeta::Meta(meta) => Self::parse_meta(&meta)?,
-                        syn::NestedMeta::Lit(_) => panic!("unexpected literal"),
-                    };
-                    if let Some(constructor_name) = constructor_name {
-                        if n.replace(constructor_name).is_some() {
-                            return Err(Error::DuplicateConstructorName);
-                        }
-                    }
-                    if let Some(system_type) = system_type {
-                        if s.replace(system_type).is_some() {
-                            return Err(Error::DuplicateSystemType);
-                        }
-                    }
-                }
-                Self::new(n, s)
+                let items = items.nested.iter().cloned().collect::<Vec<_>>();
+                Self::parse_args(&items)?
             }
             Meta::NameValue(name_value) => match name_value.path.get_ident() {
                 Some(ident) if ident == "ctor" => Self::new(Some(name_value.lit.clone()), None),
+                Some(ident) if ident == "min_batch" => match &name_value.lit {
+                    Lit::Int(min_batch) if min_batch.base10_parse::<usize>().unwrap_or(0) > 0 => {
+                        Self {
+                            min_batch: Some(min_batch.clone()),
+                            ..Self::default()
+                        }
+                    }
+                    lit => return Err(Error::InvalidMinBatch(lit.span())),
+                },
                 Some(ident) => return Err(Error::InvalidKey(ident.span())),
                 _ => return Err(Error::InvalidKey(Span::call_site())),
             },
@@ -298,12 +354,17 @@ impl SystemAttr {
 
         Ok(result)
     }
+
+    fn is_batched(&self) -> bool {
+        self.min_batch.is_some() || self.adaptive
+    }
 }
 
 struct Sig {
     ident: Ident,
     parameters: Vec<Parameter>,
     query: Vec<Type>,
+    query_access: Vec<ViewAccess>,
     read_resources: Vec<Type>,
     write_resources: Vec<Type>,
     state_args: Vec<Type>,
@@ -314,6 +375,7 @@ impl Sig {
     fn parse(item: &mut Signature) -> Result<Self, Error> {
         let mut parameters = Vec::new();
         let mut query = Vec::<Type>::new();
+        let mut query_access = Vec::new();
         let mut read_resources = Vec::new();
         let mut write_resources = Vec::new();
         let mut state_args = Vec::new();
@@ -332,6 +394,7 @@ impl Sig {
                                             let mutable = ty.mutability.is_some();
                                             parameters.push(Parameter::Component(query.len()));
                                             let elem = &ty.elem;
+                                            query_access.push(ViewAccess::Optional);
                                             if mutable {
                                                 query.push(
                                                     parse_quote!(::tempeh_ecs::TryWrite<#elem>),
@@ -395,6 +458,7 @@ impl Sig {
                             || is_type(&ty.elem, &["tempeh_ecs", "world", "Entity"]) =>
                     {
                         parameters.push(Parameter::Component(query.len()));
+                        query_access.push(ViewAccess::Read);
                         query.push(parse_quote!(::tempeh_ecs::Entity));
                     }
                     Type::Reference(ty)
@@ -433,8 +497,10 @@ impl Sig {
                                 parameters.push(Parameter::Component(query.len()));
                                 let elem = &ty.elem;
                                 if mutable {
+                                    query_access.push(ViewAccess::Write);
                                     query.push(parse_quote!(::tempeh_ecs::Write<#elem>));
                                 } else {
+                                    query_access.push(ViewAccess::Read);
                                     query.push(parse_quote!(::tempeh_ecs::Read<#elem>));
                                 }
                             }
@@ -450,6 +516,7 @@ impl Sig {
             generics: item.generics.clone(),
             parameters,
             query,
+            query_access,
             read_resources,
             write_resources,
             state_args,
@@ -479,6 +546,13 @@ enum ArgAttr {
     State,
 }
 
+#[derive(Copy, Clone, PartialEq)]
+enum ViewAccess {
+    Read,
+    Write,
+    Optional,
+}
+
 fn is_type(ty: &Type, segments: &[&str]) -> bool {
     if let Type::Path(path) = ty {
         path_match(path, segments)
@@ -634,6 +708,20 @@ impl Config {
             }
         }
 
+        if self.attr.is_batched() {
+            if system_type != SystemType::ParForEach {
+                return Err(Error::Message(
+                    "min_batch and adaptive can only be used with par_for_each systems".to_string(),
+                ));
+            }
+            if self.signature.query_access.contains(&ViewAccess::Optional) {
+                return Err(Error::Message(
+                    "min_batch and adaptive par_for_each systems cannot accept optional components"
+                        .to_string(),
+                ));
+            }
+        }
+
         if system_type == SystemType::ParForEach {
             if self
                 .signature
@@ -684,6 +772,10 @@ impl Config {
         } = self;
 
         let system_type = attr.system_type.unwrap_or_default();
+        let min_batch_lower = match &attr.min_batch {
+            Some(min_batch) => quote!(#min_batch),
+            None => quote!(1),
+        };
 
         // declare query
         let query = if system_type.requires_query() {
@@ -799,15 +891,39 @@ impl Config {
                     });
                 }
             }
+            SystemType::ParForEach if attr.is_batched() => {
+                let batched = batched_for_each(attr, &signature.query_access, &fn_call);
+                quote! {
+                    #world
+                    #[cfg(not(target_arch = "wasm32"))]
+                    {
+                        #batched
+                    }
+                    #[cfg(target_arch = "wasm32")]
+                    query.for_each_mut(for_query, |components| {
+                        #fn_call
+                    });
+                }
+            }
             SystemType::ParForEach => {
                 quote! {
                     #world
+                    #[cfg(not(target_arch = "wasm32"))]
                     query.par_for_each_mut(for_query, |components| {
                         #fn_call
                     });
+                    #[cfg(target_arch = "wasm32")]
+                    query.for_each_mut(for_query, |components| {
+                        #fn_call
+                    });
                 }
             }
         };
+        let tuner = if attr.adaptive {
+            quote!(let batch_tuner = ::tempeh_ecs::parallel::BatchTuner::new(#min_batch_lower);)
+        } else {
+            quote!()
+        };
 
         // construct our system
         let system_name = fn_id.to_string();
@@ -830,6 +946,7 @@ impl Config {
         let builder = quote! {
             use tempeh_ecs::IntoQuery;
             #generic_parameter_names
+            #tuner
             ::tempeh_ecs::systems::SystemBuilder::new(format!("{}{}", #system_name, generic_names))
                 #(.read_component::<#read_components>())*
                 #(.write_component::<#write_components>())*
@@ -869,3 +986,79 @@ impl Config {
         Ok(result)
     }
 }
+
+/// Splits every chunk into batches and runs them on the rayon pool. Components are zipped from the
+/// chunk's column slices so each batch is a contiguous range of every column.
+fn batched_for_each(
+    attr: &SystemAttr,
+    access: &[ViewAccess],
+    fn_call: &proc_macro2::TokenStream,
+) -> proc_macro2::TokenStream {
+    let columns = (0..access.len())
+        .map(|i| format_ident!("column_{}", i))
+        .collect::<Vec<_>>();
+    let splits = columns
+        .iter()
+        .zip(access)
+        .map(|(column, access)| match access {
+            ViewAccess::Write => quote!(#column.par_chunks_mut(batch_size)),
+            _ => quote!(#column.par_chunks(batch_size)),
+        })
+        .collect::<Vec<_>>();
+    let elements = columns
+        .iter()
+        .zip(access)
+        .map(|(column, access)| match access {
+            ViewAccess::Write => quote!(&mut #column[index]),
+            _ => quote!(&#column[index]),
+        })
+        .collect::<Vec<_>>();
+    let first_column = &columns[0];
+
+    let (pattern, batches, components) = if columns.len() == 1 {
+        (
+            quote!(#first_column),
+            quote!(#(#splits)*),
+            quote!(#(#elements)*),
+        )
+    } else {
+        (
+            quote!((#(#columns),*)),
+            quote!((#(#splits),*).into_par_iter()),
+            quote!((#(#elements),*)),
+        )
+    };
+    let batch_size = match (&attr.min_batch, attr.adaptive) {
+        (_, true) => quote!(batch_tuner.batch_size()),
+        (Some(min_batch), false) => {
+            quote!(::tempeh_ecs::parallel::fixed_batch_size(#first_column.len(), #min_batch))
+        }
+        (None, false) => unreachable!(),
+    };
+    let (start_timer, record_timer, retune) = if attr.adaptive {
+        (
+            quote!(let batch_start = ::std::time::Instant::now();),
+            quote!(batch_tuner.record(#first_column.len(), batch_start.elapsed());),
+            quote!(batch_tuner.retune();),
+        )
+    } else {
+        (quote!(), quote!(), quote!())
+    };
+
+    quote! {
+        use ::tempeh_ecs::rayon::prelude::*;
+        query.par_for_each_chunk_mut(for_query, |chunk| {
+            let #pattern = chunk.into_components();
+            let batch_size: usize = #batch_size;
+            #batches.for_each(|#pattern| {
+                #start_timer
+                for index in 0..#first_column.len() {
+                    let components = #components;
+                    #fn_call
+                }
+                #record_timer
+            });
+        });
+        #retune
+    }
+}
@@ -0,0 +1,309 @@
+//! Per-component `Added`/`Changed`/`Removed` event streams.
+//!
+//! `ChangeTracker` subscribes to legion's world events, which are raised whenever an entity enters
+//! or leaves an archetype containing the tracked component, and combines them with a
+//! `maybe_changed` query to detect write borrows. Once per frame the collected changes are
+//! published into a `ComponentEvents<T>` resource, which systems consume through a
+//! `ComponentEventReader<T>` cursor. Systems that only care about changes therefore do work
+//! proportional to the number of changes instead of the number of entities.
+
+use std::any::TypeId;
+use std::collections::{HashMap, HashSet};
+use std::marker::PhantomData;
+use std::sync::{Arc, Mutex};
+
+use legion::storage::Component;
+use legion::world::{Event, EventSender};
+use legion::{component, maybe_changed, Entity, IntoQuery, Read, Resources, World};
+
+#[derive(Debug, Copy, Clone, PartialEq, Eq, Hash)]
+pub enum ComponentEvent {
+    Added(Entity),
+    /// The chunk holding the entity was borrowed for writing. Legion tracks writes per chunk, so
+    /// this may also be reported for neighbours of the entity that was actually written to.
+    Changed(Entity),
+    Removed(Entity),
+}
+
+impl ComponentEvent {
+    pub fn entity(&self) -> Entity {
+        match self {
+            ComponentEvent::Added(entity)
+            | ComponentEvent::Changed(entity)
+            | ComponentEvent::Removed(entity) => *entity,
+        }
+    }
+}
+
+/// Double buffered event stream for component `T`. Events stay readable for the frame they were
+/// published in and the one after, so a reader running once per frame never misses one regardless
+/// of where its system is scheduled.
+pub struct ComponentEvents<T> {
+    events: Vec<ComponentEvent>,
+    first_sequence: u64,
+    previous_frame_len: usize,
+    _marker: PhantomData<fn() -> T>,
+}
+
+impl<T> Default for ComponentEvents<T> {
+    fn default() -> Self {
+        Self {
+            events: Vec::new(),
+            first_sequence: 0,
+            previous_frame_len: 0,
+            _marker: PhantomData,
+        }
+    }
+}
+
+impl<T> ComponentEvents<T> {
+    fn begin_frame(&mut self) {
+        self.events.drain(..self.previous_frame_len);
+        self.first_sequence += self.previous_frame_len as u64;
+        self.previous_frame_len = self.events.len();
+    }
+
+    fn push(&mut self, event: ComponentEvent) {
+        self.events.push(event);
+    }
+
+    fn end_sequence(&self) -> u64 {
+        self.first_sequence + self.events.len() as u64
+    }
+
+    /// Number of events currently buffered, across both frames.
+    pub fn len(&self) -> usize {
+        self.events.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.events.is_empty()
+    }
+}
+
+/// Cursor into a `ComponentEvents<T>` stream, usually kept as `#[state]` of a system.
+pub struct ComponentEventReader<T> {
+    next_sequence: u64,
+    _marker: PhantomData<fn() -> T>,
+}
+
+impl<T> Default for ComponentEventReader<T> {
+    fn default() -> Self {
+        Self {
+            next_sequence: 0,
+            _marker: PhantomData,
+        }
+    }
+}
+
+impl<T> ComponentEventReader<T> {
+    /// Returns every event published since the previous call.
+    pub fn read<'a>(
+        &mut self,
+        events: &'a ComponentEvents<T>,
+    ) -> impl Iterator<Item = &'a ComponentEvent> + 'a {
+        let start = self.next_sequence.max(events.first_sequence);
+        if start > self.next_sequence {
+            log::warn!(
+                "Component event reader for {} skipped {} events",
+                std::any::type_name::<T>(),
+                start - self.next_sequence
+            );
+        }
+        self.next_sequence = events.end_sequence();
+        events.events[(start - events.first_sequence) as usize..].iter()
+    }
+}
+
+#[derive(Default)]
+struct EntityMoves(Mutex<Vec<(Entity, i32)>>);
+
+/// Legion calls `send` synchronously from whichever thread mutates the world, so this only has to
+/// append to a vector.
+struct MoveSender(Arc<EntityMoves>);
+
+impl EventSender for MoveSender {
+    fn send(&self, event: Event) -> bool {
+        let delta = match event {
+            Event::EntityInserted(entity, _) => (entity, 1),
+            Event::EntityRemoved(entity, _) => (entity, -1),
+            _ => return true,
+        };
+        self.0 .0.lock().unwrap().push(delta);
+        true
+    }
+}
+
+trait Tracker {
+    fn update(&mut self, world: &World, resources: &mut Resources);
+}
+
+struct ComponentTracker<T: Component> {
+    moves: Arc<EntityMoves>,
+    moves_scratch: Vec<(Entity, i32)>,
+    net_moves: HashMap<Entity, i32>,
+    added: HashSet<Entity>,
+    changed_scratch: Vec<Entity>,
+    find_changed: Box<dyn FnMut(&World, &mut Vec<Entity>)>,
+    _marker: PhantomData<fn() -> T>,
+}
+
+impl<T: Component> ComponentTracker<T> {
+    fn new(world: &mut World, resources: &mut Resources) -> Self {
+        let moves = Arc::new(EntityMoves::default());
+        world.subscribe(MoveSender(moves.clone()), component::<T>());
+
+        let mut changed_query = <(Entity, Read<T>)>::query().filter(maybe_changed::<T>());
+        let mut find_changed: Box<dyn FnMut(&World, &mut Vec<Entity>)> =
+            Box::new(move |world, out| {
+                out.extend(changed_query.iter(world).map(|(entity, _)| *entity));
+            });
+
+        // Entities that existed before the subscription are reported as added. The first run of
+        // the changed query reports every chunk, so it is primed here and its result discarded.
+        let mut existing = Vec::new();
+        find_changed(world, &mut existing);
+        let mut events = ComponentEvents::<T>::default();
+        for entity in existing {
+            events.push(ComponentEvent::Added(entity));
+        }
+        resources.insert(events);
+
+        Self {
+            moves,
+            moves_scratch: Vec::new(),
+            net_moves: HashMap::new(),
+            added: HashSet::new(),
+            changed_scratch: Vec::new(),
+            find_changed,
+            _marker: PhantomData,
+        }
+    }
+}
+
+impl<T: Component> Tracker for ComponentTracker<T> {
+    fn update(&mut self, world: &World, resources: &mut Resources) {
+        std::mem::swap(&mut *self.moves.0.lock().unwrap(), &mut self.moves_scratch);
+
+        // An entity that moves between two archetypes that both contain T is removed from one and
+        // inserted into the other, which nets out to no event
+        self.net_moves.clear();
+        for (entity, delta) in self.moves_scratch.drain(..) {
+            *self.net_moves.entry(entity).or_insert(0) += delta;
+        }
+
+        let mut events = resources
+            .get_mut::<ComponentEvents<T>>()
+            .expect("ComponentEvents resource was removed while being tracked");
+        events.begin_frame();
+
+        self.added.clear();
+        for (entity, net) in &self.net_moves {
+            if *net > 0 {
+                self.added.insert(*entity);
+                events.push(ComponentEvent::Added(*entity));
+            } else if *net < 0 {
+                events.push(ComponentEvent::Removed(*entity));
+            }
+        }
+
+        self.changed_scratch.clear();
+        (self.find_changed)(world, &mut self.changed_scratch);
+        for entity in &self.changed_scratch {
+            if !self.added.contains(entity) {
+                events.push(ComponentEvent::Changed(*entity));
+            }
+        }
+    }
+}
+
+/// Owns the trackers of every component type that has change events enabled. `update` has to run
+/// once per frame with exclusive world access, after all systems that may modify tracked
+/// components.
+#[derive(Default)]
+pub struct ChangeTracker {
+    tracked: HashSet<TypeId>,
+    trackers: Vec<Box<dyn Tracker>>,
+}
+
+impl ChangeTracker {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Starts publishing `ComponentEvents<T>` into `resources`. Tracking the same type twice is a
+    /// no-op.
+    pub fn track<T: Component>(&mut self, world: &mut World, resources: &mut Resources) {
+        if self.tracked.insert(TypeId::of::<T>()) {
+            self.trackers
+                .push(Box::new(ComponentTracker::<T>::new(world, resources)));
+        }
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.trackers.is_empty()
+    }
+
+    pub fn update(&mut self, world: &World, resources: &mut Resources) {
+        for tracker in &mut self.trackers {
+            tracker.update(world, resources);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[derive(Clone, Copy, Debug, PartialEq)]
+    struct Health(u32);
+
+    fn read_all(
+        reader: &mut ComponentEventReader<Health>,
+        resources: &Resources,
+    ) -> Vec<ComponentEvent> {
+        let events = resources.get::<ComponentEvents<Health>>().unwrap();
+        reader.read(&events).copied().collect()
+    }
+
+    #[test]
+    fn reports_added_changed_and_removed() {
+        let mut world = World::default();
+        let mut resources = Resources::default();
+        let existing = world.push((Health(10),));
+
+        let mut tracker = ChangeTracker::new();
+        tracker.track::<Health>(&mut world, &mut resources);
+        let mut reader = ComponentEventReader::<Health>::default();
+        assert_eq!(
+            read_all(&mut reader, &resources),
+            vec![ComponentEvent::Added(existing)]
+        );
+
+        let spawned = world.push((Health(20),));
+        tracker.update(&world, &mut resources);
+        assert_eq!(
+            read_all(&mut reader, &resources),
+            vec![ComponentEvent::Added(spawned)]
+        );
+
+        // Moving to another archetype that still has Health is not an add or a remove
+        world.entry(existing).unwrap().add_component(1_u8);
+        tracker.update(&world, &mut resources);
+        assert!(read_all(&mut reader, &resources)
+            .iter()
+            .all(|event| matches!(event, ComponentEvent::Changed(_))));
+
+        for health in <&mut Health>::query().iter_mut(&mut world) {
+            health.0 -= 1;
+        }
+        world.remove(spawned);
+        tracker.update(&world, &mut resources);
+        let events = read_all(&mut reader, &resources);
+        assert!(events.contains(&ComponentEvent::Changed(existing)));
+        assert!(events.contains(&ComponentEvent::Removed(spawned)));
+
+        tracker.update(&world, &mut resources);
+        assert!(read_all(&mut reader, &resources).is_empty());
+    }
+}
@@ -1,6 +1,13 @@
 pub use legion::*;
 pub use legion_codegen::system;
 
+pub mod events;
+pub mod parallel;
+
+#[cfg(not(target_arch = "wasm32"))]
+pub use rayon;
+
 pub mod prelude {
+    pub use crate::events::{ComponentEvent, ComponentEventReader, ComponentEvents};
     pub use crate::system;
 }
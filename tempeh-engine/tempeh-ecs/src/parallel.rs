@@ -0,0 +1,108 @@
+//! Runtime support for batched `par_for_each` systems, see `#[system(par_for_each, adaptive)]`.
+
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::time::Duration;
+
+/// Entities per batch of a `min_batch = N` system: a chunk is spread over every worker, but no
+/// batch holds fewer than `min_batch` entities, except the remainder at the end of the chunk.
+pub fn fixed_batch_size(len: usize, min_batch: usize) -> usize {
+    #[cfg(not(target_arch = "wasm32"))]
+    let threads = rayon::current_num_threads().max(1);
+    #[cfg(target_arch = "wasm32")]
+    let threads = 1;
+    min_batch.max((len + threads - 1) / threads).max(1)
+}
+
+/// Picks the number of entities per parallel batch from the cost per entity measured on previous
+/// runs of a system.
+///
+/// A batch should be large enough to amortize the cost of handing it to another worker and small
+/// enough that every core gets work. The tuner aims for batches of about `TARGET_BATCH_COST` and
+/// smooths its estimate over several runs so a single slow frame does not swing the split.
+pub struct BatchTuner {
+    min_batch: usize,
+    batch_size: AtomicUsize,
+    measured_nanos: AtomicU64,
+    measured_entities: AtomicU64,
+}
+
+impl BatchTuner {
+    pub const TARGET_BATCH_COST: Duration = Duration::from_micros(50);
+    pub const MAX_BATCH: usize = 1 << 16;
+    const INITIAL_BATCH: usize = 1024;
+
+    pub fn new(min_batch: usize) -> Self {
+        let min_batch = min_batch.max(1);
+        Self {
+            min_batch,
+            batch_size: AtomicUsize::new(Self::INITIAL_BATCH.max(min_batch)),
+            measured_nanos: AtomicU64::new(0),
+            measured_entities: AtomicU64::new(0),
+        }
+    }
+
+    pub fn batch_size(&self) -> usize {
+        self.batch_size.load(Ordering::Relaxed)
+    }
+
+    /// Called by every batch after it has finished, from any worker thread.
+    pub fn record(&self, entities: usize, elapsed: Duration) {
+        self.measured_nanos
+            .fetch_add(elapsed.as_nanos() as u64, Ordering::Relaxed);
+        self.measured_entities
+            .fetch_add(entities as u64, Ordering::Relaxed);
+    }
+
+    /// Folds the measurements of the last run into the batch size. Called once per run, after all
+    /// batches have finished.
+    pub fn retune(&self) {
+        let nanos = self.measured_nanos.swap(0, Ordering::Relaxed);
+        let entities = self.measured_entities.swap(0, Ordering::Relaxed);
+        if entities == 0 {
+            return;
+        }
+        let nanos_per_entity = (nanos as f64 / entities as f64).max(1.0);
+        let ideal = (Self::TARGET_BATCH_COST.as_nanos() as f64 / nanos_per_entity) as usize;
+        let ideal = ideal.max(self.min_batch).min(Self::MAX_BATCH);
+        let current = self.batch_size();
+        // Move a quarter of the way each run
+        let next = if ideal > current {
+            current + (ideal - current + 3) / 4
+        } else {
+            current - (current - ideal + 3) / 4
+        };
+        self.batch_size.store(next, Ordering::Relaxed);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn fixed_batches_are_never_smaller_than_min_batch() {
+        assert_eq!(fixed_batch_size(10, 256), 256);
+        let threads = rayon::current_num_threads();
+        let batch = fixed_batch_size(1_000_000, 256);
+        assert!(batch >= 256);
+        assert!(batch * threads >= 1_000_000);
+    }
+
+    #[test]
+    fn converges_towards_target_cost() {
+        let tuner = BatchTuner::new(16);
+        for _ in 0..64 {
+            // 100ns per entity, so 500 entities fill the 50us target
+            let entities = tuner.batch_size();
+            tuner.record(entities, Duration::from_nanos(100 * entities as u64));
+            tuner.retune();
+        }
+        assert!((490..=510).contains(&tuner.batch_size()));
+
+        for _ in 0..64 {
+            tuner.record(1, Duration::from_millis(1));
+            tuner.retune();
+        }
+        assert_eq!(tuner.batch_size(), 16);
+    }
+}
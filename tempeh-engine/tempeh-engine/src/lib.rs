@@ -1,3 +1,5 @@
+pub mod ring;
+
 use rapier2d::prelude::*;
 use tempeh_ecs::{Resources, Schedule, World};
 
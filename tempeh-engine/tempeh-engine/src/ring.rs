@@ -0,0 +1,216 @@
+//! Bounded lock-free single producer, single consumer queue.
+//!
+//! Used to hand events from a thread that must never block (the window event loop, the audio
+//! callback) to a thread that consumes them at its own pace. Both ends only touch their own index
+//! and read the other one, so pushing and popping are a couple of atomic loads and one store.
+
+use std::cell::UnsafeCell;
+use std::mem::MaybeUninit;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Arc;
+
+/// Keeps the producer and consumer indices on separate cache lines.
+#[repr(align(64))]
+struct CachePadded<T>(T);
+
+struct Shared<T> {
+    slots: Box<[UnsafeCell<MaybeUninit<T>>]>,
+    mask: usize,
+    /// Next slot to be written, only stored by the producer
+    head: CachePadded<AtomicUsize>,
+    /// Next slot to be read, only stored by the consumer
+    tail: CachePadded<AtomicUsize>,
+}
+
+// Safety: a slot is only accessed by the producer before `head` is published past it and by the
+// consumer before `tail` is published past it, never by both at once
+unsafe impl<T: Send> Sync for Shared<T> {}
+unsafe impl<T: Send> Send for Shared<T> {}
+
+impl<T> Drop for Shared<T> {
+    fn drop(&mut self) {
+        let head = *self.head.0.get_mut();
+        let mut tail = *self.tail.0.get_mut();
+        while tail != head {
+            // Safety: slots between tail and head hold initialized values
+            unsafe {
+                (*self.slots[tail & self.mask].get())
+                    .as_mut_ptr()
+                    .drop_in_place()
+            };
+            tail = tail.wrapping_add(1);
+        }
+    }
+}
+
+/// Creates a queue holding up to `capacity` values, rounded up to a power of two.
+pub fn ring_buffer<T: Send>(capacity: usize) -> (Producer<T>, Consumer<T>) {
+    let capacity = capacity.max(1).next_power_of_two();
+    let slots = (0..capacity)
+        .map(|_| UnsafeCell::new(MaybeUninit::uninit()))
+        .collect::<Vec<_>>()
+        .into_boxed_slice();
+    let shared = Arc::new(Shared {
+        slots,
+        mask: capacity - 1,
+        head: CachePadded(AtomicUsize::new(0)),
+        tail: CachePadded(AtomicUsize::new(0)),
+    });
+    (
+        Producer {
+            shared: shared.clone(),
+        },
+        Consumer { shared },
+    )
+}
+
+pub struct Producer<T> {
+    shared: Arc<Shared<T>>,
+}
+
+impl<T> Producer<T> {
+    /// Appends `value`, or hands it back if the queue is full.
+    pub fn push(&mut self, value: T) -> Result<(), T> {
+        let head = self.shared.head.0.load(Ordering::Relaxed);
+        let tail = self.shared.tail.0.load(Ordering::Acquire);
+        if head.wrapping_sub(tail) == self.capacity() {
+            return Err(value);
+        }
+        // Safety: the slot is outside of the consumer's readable range until head is published
+        unsafe {
+            (*self.shared.slots[head & self.shared.mask].get())
+                .as_mut_ptr()
+                .write(value)
+        };
+        self.shared
+            .head
+            .0
+            .store(head.wrapping_add(1), Ordering::Release);
+        Ok(())
+    }
+
+    pub fn capacity(&self) -> usize {
+        self.shared.slots.len()
+    }
+
+    pub fn len(&self) -> usize {
+        let tail = self.shared.tail.0.load(Ordering::Acquire);
+        self.shared
+            .head
+            .0
+            .load(Ordering::Relaxed)
+            .wrapping_sub(tail)
+    }
+
+    pub fn is_full(&self) -> bool {
+        self.len() == self.capacity()
+    }
+}
+
+pub struct Consumer<T> {
+    shared: Arc<Shared<T>>,
+}
+
+impl<T> Consumer<T> {
+    /// Oldest value in the queue, without removing it.
+    pub fn peek(&self) -> Option<&T> {
+        let tail = self.shared.tail.0.load(Ordering::Relaxed);
+        let head = self.shared.head.0.load(Ordering::Acquire);
+        if tail == head {
+            return None;
+        }
+        // Safety: the slot was published by the producer and stays valid until tail moves past it,
+        // which needs `&mut self`
+        Some(unsafe { &*(*self.shared.slots[tail & self.shared.mask].get()).as_ptr() })
+    }
+
+    pub fn pop(&mut self) -> Option<T> {
+        let tail = self.shared.tail.0.load(Ordering::Relaxed);
+        let head = self.shared.head.0.load(Ordering::Acquire);
+        if tail == head {
+            return None;
+        }
+        // Safety: the slot was published by the producer, and is given back to it by the store
+        // below only after the value has been moved out
+        let value = unsafe {
+            (*self.shared.slots[tail & self.shared.mask].get())
+                .as_ptr()
+                .read()
+        };
+        self.shared
+            .tail
+            .0
+            .store(tail.wrapping_add(1), Ordering::Release);
+        Some(value)
+    }
+
+    /// Pops values as long as `predicate` accepts the oldest one.
+    pub fn pop_while<'a, F: FnMut(&T) -> bool + 'a>(
+        &'a mut self,
+        mut predicate: F,
+    ) -> impl Iterator<Item = T> + 'a {
+        std::iter::from_fn(move || {
+            if predicate(self.peek()?) {
+                self.pop()
+            } else {
+                None
+            }
+        })
+    }
+
+    pub fn capacity(&self) -> usize {
+        self.shared.slots.len()
+    }
+
+    pub fn len(&self) -> usize {
+        let head = self.shared.head.0.load(Ordering::Acquire);
+        head.wrapping_sub(self.shared.tail.0.load(Ordering::Relaxed))
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn preserves_order_across_threads() {
+        let (mut producer, mut consumer) = ring_buffer::<u64>(64);
+        let count = 100_000;
+        let thread = std::thread::spawn(move || {
+            for i in 0..count {
+                let mut value = i;
+                while let Err(rejected) = producer.push(value) {
+                    value = rejected;
+                    std::thread::yield_now();
+                }
+            }
+        });
+        let mut expected = 0;
+        while expected < count {
+            match consumer.pop() {
+                Some(value) => {
+                    assert_eq!(value, expected);
+                    expected += 1;
+                }
+                None => std::thread::yield_now(),
+            }
+        }
+        thread.join().unwrap();
+        assert!(consumer.is_empty());
+    }
+
+    #[test]
+    fn drops_unread_values() {
+        let value = Arc::new(());
+        let (mut producer, consumer) = ring_buffer(2);
+        producer.push(value.clone()).unwrap();
+        producer.push(value.clone()).unwrap();
+        assert!(producer.push(value.clone()).is_err());
+        drop((producer, consumer));
+        assert_eq!(Arc::strong_count(&value), 1);
+    }
+}
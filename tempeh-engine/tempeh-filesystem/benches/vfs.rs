@@ -0,0 +1,103 @@
+//! Loading 2000 small assets from loose files, a stored pack and an LZ4 pack.
+//!
+//! The cold pass is the first read after mounting, which pays for opening files or faulting in
+//! the mapped pages; the warm pass reads everything again. The OS page cache is not dropped, so
+//! cold numbers are a lower bound for a real first launch.
+//!
+//! Run with `cargo bench -p tempeh-filesystem --bench vfs`.
+
+use std::time::{Duration, Instant};
+
+use tempeh_filesystem::{Compression, PackBuilder, Vfs};
+
+const ASSETS: usize = 2_000;
+
+fn asset(index: usize) -> (String, Vec<u8>) {
+    // Half noise, half runs, roughly what textures and meshes compress like
+    let len = 4096 + (index % 16) * 1024;
+    let mut seed = index as u32 + 1;
+    let data = (0..len)
+        .map(|i| {
+            if i % 64 < 32 {
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                seed as u8
+            } else {
+                (i / 64) as u8
+            }
+        })
+        .collect();
+    (asset_path(index), data)
+}
+
+fn load_all(vfs: &Vfs) -> (Duration, usize) {
+    let start = Instant::now();
+    let mut bytes = 0;
+    for index in 0..ASSETS {
+        bytes += vfs.read(&asset_path(index)).unwrap().len();
+    }
+    (start.elapsed(), bytes)
+}
+
+fn asset_path(index: usize) -> String {
+    format!("bench/{}/{}.bin", index % 32, index)
+}
+
+fn bench(name: &str, mount: impl Fn(&mut Vfs)) {
+    let mut vfs = Vfs::new();
+    let start = Instant::now();
+    mount(&mut vfs);
+    let mount_time = start.elapsed();
+    let (cold, bytes) = load_all(&vfs);
+    let (warm, _) = load_all(&vfs);
+    println!(
+        "{:<12} mount {:>10?}  cold {:>10?}  warm {:>10?}  ({} assets, {} KiB)",
+        name,
+        mount_time,
+        cold,
+        warm,
+        ASSETS,
+        bytes / 1024
+    );
+}
+
+fn main() {
+    let root = std::env::temp_dir().join("tempeh-vfs-bench");
+    let loose = root.join("loose");
+    let _ = std::fs::remove_dir_all(&root);
+
+    let mut stored = PackBuilder::new();
+    let mut compressed = PackBuilder::new();
+    for index in 0..ASSETS {
+        let (path, data) = asset(index);
+        let file = loose.join(&path);
+        std::fs::create_dir_all(file.parent().unwrap()).unwrap();
+        std::fs::write(&file, &data).unwrap();
+        stored.add(&path, &data, Compression::None).unwrap();
+        compressed.add(&path, &data, Compression::Lz4).unwrap();
+    }
+    let stored_path = root.join("stored.pak");
+    let compressed_path = root.join("lz4.pak");
+    stored.write_to_file(&stored_path).unwrap();
+    compressed.write_to_file(&compressed_path).unwrap();
+    for path in [&stored_path, &compressed_path].iter() {
+        println!(
+            "{}: {} KiB",
+            path.file_name().unwrap().to_string_lossy(),
+            std::fs::metadata(path).unwrap().len() / 1024
+        );
+    }
+
+    bench("loose", |vfs| {
+        vfs.mount_dir("", &loose);
+    });
+    bench("pack", |vfs| {
+        vfs.mount_pack("", &stored_path).unwrap();
+    });
+    bench("pack lz4", |vfs| {
+        vfs.mount_pack("", &compressed_path).unwrap();
+    });
+
+    let _ = std::fs::remove_dir_all(&root);
+}
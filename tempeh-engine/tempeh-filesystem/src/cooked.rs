@@ -0,0 +1,121 @@
+//! Runtime-ready asset formats written by `tempeh-cooker`.
+//!
+//! A cooked asset keeps the path of its source, so code loading `image/tree.png` works the same
+//! with loose source files during development and with a cooked pack in a shipping build. Readers
+//! tell the two apart by the magic at the start of the data.
+
+use bytemuck::{Pod, Zeroable};
+
+pub const TEXTURE_MAGIC: [u8; 4] = *b"TPTX";
+pub const AUDIO_MAGIC: [u8; 4] = *b"TPAU";
+
+#[repr(u32)]
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub enum TextureFormat {
+    /// 8 bit sRGB RGBA, tightly packed rows
+    Rgba8Srgb = 0,
+}
+
+/// Followed by the pixels of the texture, which start 16 byte aligned in a pack.
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Pod, Zeroable)]
+pub struct TextureHeader {
+    pub magic: [u8; 4],
+    pub format: u32,
+    pub width: u32,
+    pub height: u32,
+}
+
+/// Followed by `frame_count * channels` interleaved signed 16 bit samples.
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Pod, Zeroable)]
+pub struct AudioHeader {
+    pub magic: [u8; 4],
+    pub sample_rate: u32,
+    pub channels: u32,
+    pub _reserved: u32,
+    pub frame_count: u64,
+}
+
+pub struct CookedTexture<'a> {
+    pub format: TextureFormat,
+    pub width: u32,
+    pub height: u32,
+    pub pixels: &'a [u8],
+}
+
+pub struct CookedAudio<'a> {
+    pub sample_rate: u32,
+    pub channels: u32,
+    pub frame_count: u64,
+    /// Native-endian `i16` samples; use `bytemuck::cast_slice` if the data is aligned
+    pub samples: &'a [u8],
+}
+
+fn split_header<H: Pod>(bytes: &[u8], magic: [u8; 4]) -> Option<(H, &[u8])> {
+    let header_size = std::mem::size_of::<H>();
+    if bytes.len() < header_size || bytes[..4] != magic {
+        return None;
+    }
+    let header = bytemuck::pod_read_unaligned(&bytes[..header_size]);
+    Some((header, &bytes[header_size..]))
+}
+
+impl<'a> CookedTexture<'a> {
+    pub fn encode(width: u32, height: u32, rgba: &[u8]) -> Vec<u8> {
+        let header = TextureHeader {
+            magic: TEXTURE_MAGIC,
+            format: TextureFormat::Rgba8Srgb as u32,
+            width,
+            height,
+        };
+        let mut bytes = bytemuck::bytes_of(&header).to_vec();
+        bytes.extend_from_slice(rgba);
+        bytes
+    }
+
+    /// Returns `None` if `bytes` is not a valid cooked texture, for example a source image.
+    pub fn parse(bytes: &'a [u8]) -> Option<Self> {
+        let (header, pixels) = split_header::<TextureHeader>(bytes, TEXTURE_MAGIC)?;
+        let format = match header.format {
+            0 => TextureFormat::Rgba8Srgb,
+            _ => return None,
+        };
+        let len = header.width as usize * header.height as usize * 4;
+        Some(Self {
+            format,
+            width: header.width,
+            height: header.height,
+            pixels: pixels.get(..len)?,
+        })
+    }
+}
+
+impl<'a> CookedAudio<'a> {
+    pub fn encode(sample_rate: u32, channels: u32, samples: &[i16]) -> Vec<u8> {
+        let header = AudioHeader {
+            magic: AUDIO_MAGIC,
+            sample_rate,
+            channels,
+            _reserved: 0,
+            frame_count: (samples.len() / channels.max(1) as usize) as u64,
+        };
+        let mut bytes = bytemuck::bytes_of(&header).to_vec();
+        bytes.extend_from_slice(bytemuck::cast_slice(samples));
+        bytes
+    }
+
+    pub fn parse(bytes: &'a [u8]) -> Option<Self> {
+        let (header, samples) = split_header::<AudioHeader>(bytes, AUDIO_MAGIC)?;
+        if header.channels == 0 || header.sample_rate == 0 {
+            return None;
+        }
+        let len = (header.frame_count as usize).checked_mul(header.channels as usize * 2)?;
+        Some(Self {
+            sample_rate: header.sample_rate,
+            channels: header.channels,
+            frame_count: header.frame_count,
+            samples: samples.get(..len)?,
+        })
+    }
+}
@@ -0,0 +1,43 @@
+use std::fmt;
+use std::io;
+
+#[derive(Debug)]
+pub enum VfsError {
+    Io(io::Error),
+    NotFound(String),
+    /// The path leaves its mount point through `..`
+    InvalidPath(String),
+    InvalidMagic,
+    UnsupportedVersion(u32),
+    EndianMismatch,
+    Corrupted(&'static str),
+}
+
+impl fmt::Display for VfsError {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            VfsError::Io(error) => write!(f, "asset I/O error: {}", error),
+            VfsError::NotFound(path) => write!(f, "asset `{}` not found in any mount", path),
+            VfsError::InvalidPath(path) => write!(f, "invalid asset path `{}`", path),
+            VfsError::InvalidMagic => write!(f, "not a tempeh asset pack"),
+            VfsError::UnsupportedVersion(version) => {
+                write!(f, "unsupported asset pack version {}", version)
+            }
+            VfsError::EndianMismatch => {
+                write!(
+                    f,
+                    "asset pack was written on a machine with different endianness"
+                )
+            }
+            VfsError::Corrupted(reason) => write!(f, "corrupted asset pack: {}", reason),
+        }
+    }
+}
+
+impl std::error::Error for VfsError {}
+
+impl From<io::Error> for VfsError {
+    fn from(error: io::Error) -> Self {
+        VfsError::Io(error)
+    }
+}
@@ -0,0 +1,246 @@
+//! On-disk layout of an asset pack.
+//!
+//! ```text
+//! Header
+//! entry data, each entry starting on a DATA_ALIGN boundary
+//! EntryRecord[entry_count], sorted by (hash, path)
+//! u32[bucket_count], open addressing index into the entry table
+//! string table (paths)
+//! ```
+//!
+//! Entries are looked up by the hash of their normalized path through the index, which uses
+//! linear probing over a power-of-two bucket count of at least twice the entry count. Lookups work
+//! directly on the mapped file, so opening a pack does not build anything. All integers are
+//! native-endian; `Header::endian` is used to reject packs written on a machine with a different
+//! byte order.
+
+use bytemuck::{Pod, Zeroable};
+
+use crate::error::VfsError;
+
+pub const MAGIC: [u8; 4] = *b"TPAK";
+/// Bumped whenever the layout changes. 2 added the hash index.
+pub const VERSION: u32 = 2;
+pub const ENDIAN_TAG: u32 = 0x0102_0304;
+/// Alignment of every entry, so uncompressed data can be reinterpreted as vertices or texels
+/// without a copy
+pub const DATA_ALIGN: usize = 16;
+/// Index bucket without an entry
+pub const EMPTY_BUCKET: u32 = u32::MAX;
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Pod, Zeroable)]
+pub struct Header {
+    pub magic: [u8; 4],
+    pub version: u32,
+    pub endian: u32,
+    pub entry_count: u32,
+    pub entries_offset: u64,
+    pub index_offset: u64,
+    pub bucket_count: u32,
+    pub _reserved: u32,
+    pub strings_offset: u64,
+    pub strings_len: u64,
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Pod, Zeroable)]
+pub struct EntryRecord {
+    pub hash: u64,
+    pub offset: u64,
+    /// Size of the data in the pack
+    pub stored_len: u64,
+    /// Size of the data once decompressed
+    pub len: u64,
+    pub path_offset: u32,
+    pub path_len: u16,
+    pub compression: u8,
+    pub _reserved: u8,
+}
+
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub enum Compression {
+    /// Served straight from the mapped pack
+    None,
+    /// LZ4 block, for entries that compress well and are read rarely enough to pay for it
+    Lz4,
+}
+
+impl Compression {
+    pub(crate) fn from_tag(tag: u8) -> Result<Self, VfsError> {
+        match tag {
+            0 => Ok(Compression::None),
+            1 => Ok(Compression::Lz4),
+            _ => Err(VfsError::Corrupted("unknown compression")),
+        }
+    }
+
+    pub(crate) fn tag(self) -> u8 {
+        match self {
+            Compression::None => 0,
+            Compression::Lz4 => 1,
+        }
+    }
+}
+
+/// FNV-1a over the normalized path.
+pub fn path_hash(path: &str) -> u64 {
+    path.bytes().fold(0xcbf2_9ce4_8422_2325, |hash, byte| {
+        (hash ^ byte as u64).wrapping_mul(0x0100_0000_01b3)
+    })
+}
+
+pub fn bucket_count(entry_count: usize) -> usize {
+    (entry_count * 2).max(1).next_power_of_two()
+}
+
+/// Builds the index for `entries`, which must be in table order.
+pub(crate) fn build_index(entries: &[EntryRecord]) -> Vec<u32> {
+    let mut buckets = vec![EMPTY_BUCKET; bucket_count(entries.len())];
+    let mask = buckets.len() - 1;
+    for (index, entry) in entries.iter().enumerate() {
+        let mut bucket = entry.hash as usize & mask;
+        while buckets[bucket] != EMPTY_BUCKET {
+            bucket = (bucket + 1) & mask;
+        }
+        buckets[bucket] = index as u32;
+    }
+    buckets
+}
+
+pub(crate) fn align_up(value: usize, align: usize) -> usize {
+    (value + align - 1) & !(align - 1)
+}
+
+/// Borrowed, validated view over the table of contents of a pack.
+pub(crate) struct Toc<'a> {
+    pub entries: &'a [EntryRecord],
+    buckets: &'a [u32],
+    strings: &'a [u8],
+    bytes: &'a [u8],
+}
+
+impl<'a> Toc<'a> {
+    pub fn parse(bytes: &'a [u8]) -> Result<Self, VfsError> {
+        let header_size = std::mem::size_of::<Header>();
+        if bytes.len() < header_size {
+            return Err(VfsError::Corrupted("file is smaller than the header"));
+        }
+        let header: &Header = bytemuck::try_from_bytes(&bytes[..header_size])
+            .map_err(|_| VfsError::Corrupted("misaligned header"))?;
+        if header.magic != MAGIC {
+            return Err(VfsError::InvalidMagic);
+        }
+        if header.endian != ENDIAN_TAG {
+            return Err(VfsError::EndianMismatch);
+        }
+        if header.version != VERSION {
+            return Err(VfsError::UnsupportedVersion(header.version));
+        }
+
+        let len = header.entry_count as u64 * std::mem::size_of::<EntryRecord>() as u64;
+        let entries = bytemuck::try_cast_slice(range(bytes, header.entries_offset, len)?)
+            .map_err(|_| VfsError::Corrupted("misaligned entry table"))?;
+        if !(header.bucket_count as usize).is_power_of_two()
+            || (header.bucket_count as usize) < bucket_count(header.entry_count as usize)
+        {
+            return Err(VfsError::Corrupted("invalid index size"));
+        }
+        let len = header.bucket_count as u64 * std::mem::size_of::<u32>() as u64;
+        let buckets = bytemuck::try_cast_slice(range(bytes, header.index_offset, len)?)
+            .map_err(|_| VfsError::Corrupted("misaligned index"))?;
+        let strings = range(bytes, header.strings_offset, header.strings_len)?;
+
+        Ok(Self {
+            entries,
+            buckets,
+            strings,
+            bytes,
+        })
+    }
+
+    /// Checks every entry once, so lookups afterwards only fail on missing paths.
+    pub fn validate(&self) -> Result<(), VfsError> {
+        let mut previous: Option<(u64, &str)> = None;
+        for entry in self.entries {
+            let path = self.path(entry)?;
+            if path_hash(path) != entry.hash {
+                return Err(VfsError::Corrupted("path hash mismatch"));
+            }
+            if previous.map_or(false, |previous| previous >= (entry.hash, path)) {
+                return Err(VfsError::Corrupted("entry table is not sorted"));
+            }
+            previous = Some((entry.hash, path));
+            if entry.offset as usize % DATA_ALIGN != 0 {
+                return Err(VfsError::Corrupted("misaligned entry data"));
+            }
+            self.data(entry)?;
+            let compression = Compression::from_tag(entry.compression)?;
+            if compression == Compression::None && entry.stored_len != entry.len {
+                return Err(VfsError::Corrupted("stored entry size mismatch"));
+            }
+        }
+
+        // Every entry has to be reachable, and probing has to end at an empty bucket
+        let mut indexed = 0;
+        for &bucket in self.buckets {
+            if bucket == EMPTY_BUCKET {
+                continue;
+            }
+            if bucket as usize >= self.entries.len() {
+                return Err(VfsError::Corrupted("index refers to an unknown entry"));
+            }
+            indexed += 1;
+        }
+        if indexed != self.entries.len() || indexed == self.buckets.len() {
+            return Err(VfsError::Corrupted("index does not match the entry table"));
+        }
+        for entry in self.entries {
+            if self.find(self.path(entry)?).is_none() {
+                return Err(VfsError::Corrupted(
+                    "entry is not reachable through the index",
+                ));
+            }
+        }
+        Ok(())
+    }
+
+    pub fn path(&self, entry: &EntryRecord) -> Result<&'a str, VfsError> {
+        let path = range(
+            self.strings,
+            entry.path_offset as u64,
+            entry.path_len as u64,
+        )?;
+        std::str::from_utf8(path).map_err(|_| VfsError::Corrupted("path is not UTF-8"))
+    }
+
+    pub fn data(&self, entry: &EntryRecord) -> Result<&'a [u8], VfsError> {
+        range(self.bytes, entry.offset, entry.stored_len)
+    }
+
+    pub fn find(&self, path: &str) -> Option<&'a EntryRecord> {
+        let hash = path_hash(path);
+        let mask = self.buckets.len() - 1;
+        let mut bucket = hash as usize & mask;
+        loop {
+            let entry = match self.buckets[bucket] {
+                EMPTY_BUCKET => return None,
+                index => &self.entries[index as usize],
+            };
+            if entry.hash == hash && self.path(entry).map_or(false, |name| name == path) {
+                return Some(entry);
+            }
+            bucket = (bucket + 1) & mask;
+        }
+    }
+}
+
+fn range(bytes: &[u8], offset: u64, len: u64) -> Result<&[u8], VfsError> {
+    let start = offset as usize;
+    let end = start
+        .checked_add(len as usize)
+        .ok_or(VfsError::Corrupted("range overflow"))?;
+    bytes
+        .get(start..end)
+        .ok_or(VfsError::Corrupted("range out of bounds"))
+}
@@ -1 +1,219 @@
-struct File {}
+//! Virtual filesystem for assets.
+//!
+//! A `Vfs` is a stack of mounts, each serving the paths under a prefix. Development builds mount
+//! the loose `assets` directory; shipping builds mount `assets.pak`, a packed archive (see
+//! `format`) that is memory-mapped and serves uncompressed entries as slices of the mapping.
+//! Reads return `Cow<[u8]>`, which is only owned when the data had to be read from a loose file or
+//! decompressed. Packs produced by `tempeh-cooker` hold assets in the formats of `cooked`.
+
+pub mod cooked;
+mod error;
+pub mod format;
+mod mount;
+mod pack;
+
+use std::borrow::Cow;
+use std::path::{Path, PathBuf};
+
+pub use error::VfsError;
+pub use format::Compression;
+pub use mount::{Directory, Embedded};
+pub use pack::{PackArchive, PackBuilder};
+
+pub const DEFAULT_ASSET_DIR: &str = "assets";
+pub const DEFAULT_ASSET_PACK: &str = "assets.pak";
+
+/// Source of assets for a `Vfs`. Paths passed to a mount are normalized and relative to its mount
+/// point.
+pub trait Mount: Send + Sync {
+    /// Returns `Ok(None)` if the mount has no such asset, so the next mount is tried.
+    fn read(&self, path: &str) -> Result<Option<Cow<'_, [u8]>>, VfsError>;
+
+    fn contains(&self, path: &str) -> bool;
+
+    /// The file on disk that `path` is read from, if it is a loose file that can be watched for
+    /// changes.
+    fn file_path(&self, _path: &str) -> Option<PathBuf> {
+        None
+    }
+}
+
+/// Turns `path` into the form used for lookups: `/` separated, without empty or `.` components.
+/// `..` is rejected so a path can never leave its mount.
+pub fn normalize_path(path: &str) -> Result<Cow<'_, str>, VfsError> {
+    let is_normal = !path.is_empty()
+        && !path.contains('\\')
+        && path
+            .split('/')
+            .all(|component| !matches!(component, "" | "." | ".."));
+    if is_normal {
+        return Ok(Cow::Borrowed(path));
+    }
+
+    let mut normalized = String::with_capacity(path.len());
+    for component in path.split(|c| c == '/' || c == '\\') {
+        match component {
+            "" | "." => {}
+            ".." => return Err(VfsError::InvalidPath(path.to_owned())),
+            component => {
+                if !normalized.is_empty() {
+                    normalized.push('/');
+                }
+                normalized.push_str(component);
+            }
+        }
+    }
+    Ok(Cow::Owned(normalized))
+}
+
+struct MountPoint {
+    prefix: String,
+    mount: Box<dyn Mount>,
+}
+
+impl MountPoint {
+    fn relative<'p>(&self, path: &'p str) -> Option<&'p str> {
+        if self.prefix.is_empty() {
+            return Some(path);
+        }
+        path.strip_prefix(self.prefix.as_str())?.strip_prefix('/')
+    }
+}
+
+/// Engine resource serving assets by path, see the crate documentation.
+#[derive(Default)]
+pub struct Vfs {
+    mounts: Vec<MountPoint>,
+}
+
+impl Vfs {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Mounts the asset directory and, on top of it, the asset pack, if they exist in the working
+    /// directory or next to the executable.
+    pub fn with_default_mounts() -> Self {
+        let mut vfs = Self::new();
+        let search_dirs: Vec<PathBuf> = std::env::current_dir()
+            .ok()
+            .into_iter()
+            .chain(
+                std::env::current_exe()
+                    .ok()
+                    .and_then(|exe| exe.parent().map(Path::to_path_buf)),
+            )
+            .collect();
+
+        if let Some(dir) = search_dirs
+            .iter()
+            .map(|dir| dir.join(DEFAULT_ASSET_DIR))
+            .find(|dir| dir.is_dir())
+        {
+            log::info!("Mounting asset directory {}", dir.display());
+            vfs.mount_dir("", dir);
+        }
+        if let Some(pack) = search_dirs
+            .iter()
+            .map(|dir| dir.join(DEFAULT_ASSET_PACK))
+            .find(|pack| pack.is_file())
+        {
+            log::info!("Mounting asset pack {}", pack.display());
+            if let Err(error) = vfs.mount_pack("", &pack) {
+                log::error!("Unable to mount {}: {}", pack.display(), error);
+            }
+        }
+        vfs
+    }
+
+    /// Serves the paths under `prefix` from `mount`. Mounts added later take precedence, so a pack
+    /// of patched assets can be layered over the original one.
+    pub fn mount<M: Mount + 'static>(&mut self, prefix: &str, mount: M) -> &mut Self {
+        let prefix = if prefix.trim_matches(|c| c == '/' || c == '.').is_empty() {
+            String::new()
+        } else {
+            normalize_path(prefix)
+                .expect("Mount prefix must not contain `..`")
+                .into_owned()
+        };
+        self.mounts.push(MountPoint {
+            prefix,
+            mount: Box::new(mount),
+        });
+        self
+    }
+
+    pub fn mount_dir<P: Into<PathBuf>>(&mut self, prefix: &str, dir: P) -> &mut Self {
+        self.mount(prefix, Directory::new(dir))
+    }
+
+    pub fn mount_pack<P: AsRef<Path>>(
+        &mut self,
+        prefix: &str,
+        path: P,
+    ) -> Result<&mut Self, VfsError> {
+        let pack = PackArchive::open(path)?;
+        Ok(self.mount(prefix, pack))
+    }
+
+    pub fn read(&self, path: &str) -> Result<Cow<'_, [u8]>, VfsError> {
+        let normalized = normalize_path(path)?;
+        for mount_point in self.mounts.iter().rev() {
+            if let Some(relative) = mount_point.relative(&normalized) {
+                if let Some(bytes) = mount_point.mount.read(relative)? {
+                    return Ok(bytes);
+                }
+            }
+        }
+        Err(VfsError::NotFound(normalized.into_owned()))
+    }
+
+    /// The loose file that `read` would return `path` from, `None` if it is served from a pack or
+    /// does not exist.
+    pub fn file_path(&self, path: &str) -> Option<PathBuf> {
+        let normalized = normalize_path(path).ok()?;
+        self.mounts.iter().rev().find_map(|mount_point| {
+            let relative = mount_point.relative(&normalized)?;
+            if mount_point.mount.contains(relative) {
+                Some(mount_point.mount.file_path(relative))
+            } else {
+                None
+            }
+        })?
+    }
+
+    pub fn exists(&self, path: &str) -> bool {
+        let normalized = match normalize_path(path) {
+            Ok(normalized) => normalized,
+            Err(_) => return false,
+        };
+        self.mounts.iter().any(|mount_point| {
+            mount_point
+                .relative(&normalized)
+                .map_or(false, |relative| mount_point.mount.contains(relative))
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn later_mounts_take_precedence() {
+        let mut vfs = Vfs::new();
+        vfs.mount("", Embedded::new(&[("a.txt", b"base"), ("b.txt", b"base")]))
+            .mount("./", Embedded::new(&[("a.txt", b"patch")]))
+            .mount("/sounds/", Embedded::new(&[("hit.wav", b"wav")]));
+
+        assert_eq!(&vfs.read("a.txt").unwrap()[..], b"patch");
+        assert_eq!(&vfs.read("./b.txt").unwrap()[..], b"base");
+        assert_eq!(&vfs.read("sounds\\hit.wav").unwrap()[..], b"wav");
+        assert!(vfs.exists("sounds/hit.wav") && !vfs.exists("hit.wav"));
+        assert!(matches!(vfs.read("c.txt"), Err(VfsError::NotFound(_))));
+        assert!(matches!(
+            vfs.read("sounds/../a.txt"),
+            Err(VfsError::InvalidPath(_))
+        ));
+    }
+}
@@ -0,0 +1,62 @@
+use std::borrow::Cow;
+use std::collections::HashMap;
+use std::io::ErrorKind;
+use std::path::PathBuf;
+
+use crate::error::VfsError;
+use crate::Mount;
+
+/// Loose files under a directory, for development: an edited asset is picked up on the next read
+/// without rebuilding anything.
+pub struct Directory {
+    root: PathBuf,
+}
+
+impl Directory {
+    pub fn new<P: Into<PathBuf>>(root: P) -> Self {
+        Self { root: root.into() }
+    }
+}
+
+impl Mount for Directory {
+    fn read(&self, path: &str) -> Result<Option<Cow<'_, [u8]>>, VfsError> {
+        match std::fs::read(self.root.join(path)) {
+            Ok(bytes) => Ok(Some(Cow::Owned(bytes))),
+            Err(error) if error.kind() == ErrorKind::NotFound => Ok(None),
+            Err(error) => Err(error.into()),
+        }
+    }
+
+    fn contains(&self, path: &str) -> bool {
+        self.root.join(path).is_file()
+    }
+
+    fn file_path(&self, path: &str) -> Option<PathBuf> {
+        Some(self.root.join(path))
+    }
+}
+
+/// Assets compiled into the binary, for platforms without a filesystem such as the web.
+#[derive(Default)]
+pub struct Embedded {
+    files: HashMap<&'static str, &'static [u8]>,
+}
+
+impl Embedded {
+    /// `files` pairs normalized paths with their contents, usually from `include_bytes!`.
+    pub fn new(files: &[(&'static str, &'static [u8])]) -> Self {
+        Self {
+            files: files.iter().copied().collect(),
+        }
+    }
+}
+
+impl Mount for Embedded {
+    fn read(&self, path: &str) -> Result<Option<Cow<'_, [u8]>>, VfsError> {
+        Ok(self.files.get(path).map(|bytes| Cow::Borrowed(*bytes)))
+    }
+
+    fn contains(&self, path: &str) -> bool {
+        self.files.contains_key(path)
+    }
+}
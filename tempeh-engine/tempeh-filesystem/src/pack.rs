@@ -0,0 +1,325 @@
+use std::borrow::Cow;
+use std::collections::BTreeMap;
+use std::io::Write;
+use std::path::Path;
+
+use crate::error::VfsError;
+use crate::format::{
+    align_up, build_index, path_hash, Compression, EntryRecord, Header, Toc, DATA_ALIGN,
+    ENDIAN_TAG, MAGIC, VERSION,
+};
+use crate::{normalize_path, Mount};
+
+enum PackBytes {
+    #[cfg(not(target_arch = "wasm32"))]
+    Mapped(memmap2::Mmap),
+    Owned(Vec<AlignedBlock>),
+}
+
+#[repr(C, align(16))]
+#[derive(Copy, Clone)]
+struct AlignedBlock([u8; DATA_ALIGN]);
+
+/// A packed asset archive, either memory-mapped from disk or held in an aligned buffer.
+///
+/// Uncompressed entries are returned as slices of the mapping, so reading them costs nothing
+/// beyond bringing their pages in. Compressed entries are decompressed into a new buffer on every
+/// read.
+pub struct PackArchive {
+    bytes: PackBytes,
+    len: usize,
+}
+
+impl PackArchive {
+    #[cfg(not(target_arch = "wasm32"))]
+    pub fn open<P: AsRef<Path>>(path: P) -> Result<Self, VfsError> {
+        let file = std::fs::File::open(path)?;
+        // Safety: the mapping is read-only, a pack that is rewritten while mounted is a user error
+        // we cannot defend against, the same as with any other mmap based loader
+        let mapped = unsafe { memmap2::Mmap::map(&file)? };
+        let pack = Self {
+            len: mapped.len(),
+            bytes: PackBytes::Mapped(mapped),
+        };
+        pack.toc()?.validate()?;
+        Ok(pack)
+    }
+
+    #[cfg(target_arch = "wasm32")]
+    pub fn open<P: AsRef<Path>>(path: P) -> Result<Self, VfsError> {
+        Self::from_bytes(&std::fs::read(path)?)
+    }
+
+    /// Copies `bytes` into a buffer aligned for every entry.
+    pub fn from_bytes(bytes: &[u8]) -> Result<Self, VfsError> {
+        let mut blocks =
+            vec![AlignedBlock([0; DATA_ALIGN]); (bytes.len() + DATA_ALIGN - 1) / DATA_ALIGN];
+        // Safety: AlignedBlock is a plain byte array without padding
+        let storage = unsafe {
+            std::slice::from_raw_parts_mut(
+                blocks.as_mut_ptr() as *mut u8,
+                blocks.len() * DATA_ALIGN,
+            )
+        };
+        storage[..bytes.len()].copy_from_slice(bytes);
+        let pack = Self {
+            len: bytes.len(),
+            bytes: PackBytes::Owned(blocks),
+        };
+        pack.toc()?.validate()?;
+        Ok(pack)
+    }
+
+    pub fn as_bytes(&self) -> &[u8] {
+        match &self.bytes {
+            #[cfg(not(target_arch = "wasm32"))]
+            PackBytes::Mapped(mapped) => &mapped[..],
+            PackBytes::Owned(blocks) => {
+                // Safety: AlignedBlock is a plain byte array
+                let bytes = unsafe {
+                    std::slice::from_raw_parts(
+                        blocks.as_ptr() as *const u8,
+                        blocks.len() * DATA_ALIGN,
+                    )
+                };
+                &bytes[..self.len]
+            }
+        }
+    }
+
+    fn toc(&self) -> Result<Toc<'_>, VfsError> {
+        Toc::parse(self.as_bytes())
+    }
+
+    fn validated_toc(&self) -> Toc<'_> {
+        self.toc().expect("Pack was validated on construction")
+    }
+
+    pub fn entry_count(&self) -> usize {
+        self.validated_toc().entries.len()
+    }
+
+    /// Paths of every entry, in table order.
+    pub fn paths(&self) -> impl Iterator<Item = &str> + '_ {
+        let toc = self.validated_toc();
+        toc.entries
+            .iter()
+            .map(move |entry| toc.path(entry).expect("Pack was validated on construction"))
+    }
+
+    /// Reads the entry at the already normalized `path`.
+    pub fn read_normalized(&self, path: &str) -> Result<Option<Cow<'_, [u8]>>, VfsError> {
+        let toc = self.validated_toc();
+        let entry = match toc.find(path) {
+            Some(entry) => entry,
+            None => return Ok(None),
+        };
+        let data = toc.data(entry)?;
+        match Compression::from_tag(entry.compression)? {
+            Compression::None => Ok(Some(Cow::Borrowed(data))),
+            Compression::Lz4 => {
+                let decompressed = lz4_flex::block::decompress(data, entry.len as usize)
+                    .map_err(|_| VfsError::Corrupted("invalid LZ4 block"))?;
+                if decompressed.len() as u64 != entry.len {
+                    return Err(VfsError::Corrupted("decompressed size mismatch"));
+                }
+                Ok(Some(Cow::Owned(decompressed)))
+            }
+        }
+    }
+}
+
+impl Mount for PackArchive {
+    fn read(&self, path: &str) -> Result<Option<Cow<'_, [u8]>>, VfsError> {
+        self.read_normalized(path)
+    }
+
+    fn contains(&self, path: &str) -> bool {
+        self.validated_toc().find(path).is_some()
+    }
+}
+
+struct PendingEntry {
+    stored: Vec<u8>,
+    len: u64,
+    compression: Compression,
+}
+
+/// Writes asset packs, see `format` for the layout.
+#[derive(Default)]
+pub struct PackBuilder {
+    entries: BTreeMap<String, PendingEntry>,
+}
+
+impl PackBuilder {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Adds `data` as `path`, replacing an earlier entry with the same path. Entries that do not
+    /// get smaller when compressed are stored uncompressed, so they can be served without a copy.
+    pub fn add(
+        &mut self,
+        path: &str,
+        data: &[u8],
+        compression: Compression,
+    ) -> Result<&mut Self, VfsError> {
+        let path = normalize_path(path)?.into_owned();
+        if path.len() > u16::MAX as usize {
+            return Err(VfsError::InvalidPath(path));
+        }
+        let entry = match compression {
+            Compression::Lz4 => {
+                let compressed = lz4_flex::block::compress(data);
+                if compressed.len() < data.len() {
+                    Some(PendingEntry {
+                        stored: compressed,
+                        len: data.len() as u64,
+                        compression: Compression::Lz4,
+                    })
+                } else {
+                    None
+                }
+            }
+            Compression::None => None,
+        };
+        let entry = entry.unwrap_or_else(|| PendingEntry {
+            stored: data.to_vec(),
+            len: data.len() as u64,
+            compression: Compression::None,
+        });
+        self.entries.insert(path, entry);
+        Ok(self)
+    }
+
+    pub fn len(&self) -> usize {
+        self.entries.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    pub fn write<W: Write>(&self, mut out: W) -> Result<(), VfsError> {
+        let mut entries: Vec<(&str, &PendingEntry)> = self
+            .entries
+            .iter()
+            .map(|(path, entry)| (path.as_str(), entry))
+            .collect();
+        entries.sort_by_key(|(path, _)| (path_hash(path), *path));
+
+        let mut offset = align_up(std::mem::size_of::<Header>(), DATA_ALIGN);
+        let mut records = Vec::with_capacity(entries.len());
+        let mut strings = Vec::new();
+        for (path, entry) in &entries {
+            records.push(EntryRecord {
+                hash: path_hash(path),
+                offset: offset as u64,
+                stored_len: entry.stored.len() as u64,
+                len: entry.len,
+                path_offset: strings.len() as u32,
+                path_len: path.len() as u16,
+                compression: entry.compression.tag(),
+                _reserved: 0,
+            });
+            strings.extend_from_slice(path.as_bytes());
+            offset = align_up(offset + entry.stored.len(), DATA_ALIGN);
+        }
+        let buckets = build_index(&records);
+        let entries_offset = offset;
+        let index_offset = entries_offset + std::mem::size_of_val(records.as_slice());
+        let strings_offset = index_offset + std::mem::size_of_val(buckets.as_slice());
+
+        let header = Header {
+            magic: MAGIC,
+            version: VERSION,
+            endian: ENDIAN_TAG,
+            entry_count: records.len() as u32,
+            entries_offset: entries_offset as u64,
+            index_offset: index_offset as u64,
+            bucket_count: buckets.len() as u32,
+            _reserved: 0,
+            strings_offset: strings_offset as u64,
+            strings_len: strings.len() as u64,
+        };
+        let mut written = 0;
+        write_counted(&mut out, bytemuck::bytes_of(&header), &mut written)?;
+        for ((_, entry), record) in entries.iter().zip(&records) {
+            pad_to(&mut out, record.offset as usize, &mut written)?;
+            write_counted(&mut out, &entry.stored, &mut written)?;
+        }
+        pad_to(&mut out, entries_offset, &mut written)?;
+        write_counted(&mut out, bytemuck::cast_slice(&records), &mut written)?;
+        write_counted(&mut out, bytemuck::cast_slice(&buckets), &mut written)?;
+        write_counted(&mut out, &strings, &mut written)?;
+        Ok(())
+    }
+
+    pub fn write_to_file<P: AsRef<Path>>(&self, path: P) -> Result<(), VfsError> {
+        let file = std::fs::File::create(path)?;
+        let mut out = std::io::BufWriter::new(file);
+        self.write(&mut out)?;
+        out.flush()?;
+        Ok(())
+    }
+}
+
+fn write_counted<W: Write>(out: &mut W, bytes: &[u8], written: &mut usize) -> Result<(), VfsError> {
+    out.write_all(bytes)?;
+    *written += bytes.len();
+    Ok(())
+}
+
+fn pad_to<W: Write>(out: &mut W, offset: usize, written: &mut usize) -> Result<(), VfsError> {
+    const ZEROES: [u8; DATA_ALIGN] = [0; DATA_ALIGN];
+    while *written < offset {
+        let len = (offset - *written).min(DATA_ALIGN);
+        write_counted(out, &ZEROES[..len], written)?;
+    }
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn round_trip() {
+        let repetitive = vec![7_u8; 4096];
+        let noise: Vec<u8> = (0..100_u32)
+            .map(|i| (i.wrapping_mul(2_654_435_761) >> 24) as u8)
+            .collect();
+
+        let mut builder = PackBuilder::new();
+        builder
+            .add("image/tree.png", &noise, Compression::Lz4)
+            .unwrap()
+            .add("./music\\theme.ogg", &repetitive, Compression::Lz4)
+            .unwrap()
+            .add("empty", &[], Compression::None)
+            .unwrap();
+        let mut bytes = Vec::new();
+        builder.write(&mut bytes).unwrap();
+        let pack = PackArchive::from_bytes(&bytes).unwrap();
+
+        assert_eq!(pack.entry_count(), 3);
+        let tree = pack.read_normalized("image/tree.png").unwrap().unwrap();
+        assert!(matches!(tree, Cow::Borrowed(_)));
+        assert_eq!(tree.as_ptr() as usize % DATA_ALIGN, 0);
+        assert_eq!(&tree[..], &noise[..]);
+        let theme = pack.read_normalized("music/theme.ogg").unwrap().unwrap();
+        assert!(matches!(theme, Cow::Owned(_)));
+        assert_eq!(&theme[..], &repetitive[..]);
+        assert_eq!(
+            &pack.read_normalized("empty").unwrap().unwrap()[..],
+            &[] as &[u8]
+        );
+        assert!(pack.read_normalized("image/missing.png").unwrap().is_none());
+
+        bytes[0] = b'X';
+        assert!(matches!(
+            PackArchive::from_bytes(&bytes),
+            Err(VfsError::InvalidMagic)
+        ));
+    }
+}
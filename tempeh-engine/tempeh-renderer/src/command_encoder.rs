@@ -2,5 +2,5 @@ use crate::renderer::Renderer;
 
 
 pub trait CommandBufferGenerator {
-    fn command_buffer(&self, renderer: &Renderer);
+    fn command_buffer(&self, renderer: &mut Renderer);
 }
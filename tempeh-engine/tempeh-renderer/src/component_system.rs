@@ -1,78 +1,183 @@
+use std::collections::HashMap;
+
+use tempeh_core::assets::{AssetEvent, AssetId, Assets, LoadPriority, LoadState};
+use tempeh_core_component::batch::BatchKernel;
 use tempeh_core_component::prelude::*;
 use tempeh_ecs::prelude::*;
-use tempeh_ecs::Entity;
-
-
 
-use crate::command_encoder::CommandBufferGenerator;
-use crate::renderer::Renderer;
+use crate::frame::RenderFrame;
+use crate::renderer::RenderDevice;
 use crate::sprite::{SpriteRenderer, SpriteRendererPipeline};
 
-
-
-use crate::{Vertex};
+use crate::Vertex;
 
 use tempeh_ecs::systems::CommandBuffer;
+use tempeh_ecs::world::SubWorld;
+use tempeh_ecs::{EntityStore, Query};
 
-
-
+/// Only visits sprites that were added since the last frame instead of querying every entity.
+/// Sprites whose texture is still loading are retried every frame until it is, and the pipeline
+/// of every sprite using a texture is rebuilt when that texture is reloaded.
 #[system]
-pub fn render(#[resource] _renderer: &mut Renderer) {
-    // renderer
-    //     .state
-    //     .queue
-    //     .submit(renderer.command_buffer_queue.take().unwrap().into_iter());
-    // renderer.command_buffer_queue = Some(vec![]);
-}
-
-#[system(for_each)]
+#[read_component(SpriteRenderer)]
 pub fn sprite_renderer_initialization(
-    entity: &Entity,
+    world: &SubWorld,
+    query: &mut Query<(Entity, &SpriteRenderer)>,
     command: &mut CommandBuffer,
-    _sprite_renderer: &mut SpriteRenderer,
-    #[resource] renderer: &Renderer,
+    #[state] reader: &mut ComponentEventReader<SpriteRenderer>,
+    #[state] waiting: &mut Vec<Entity>,
+    #[resource] sprite_events: &ComponentEvents<SpriteRenderer>,
+    #[resource] images: &Assets<image::DynamicImage>,
+    #[resource] device: &RenderDevice,
 ) {
-    command.add_component(*entity, SpriteRendererPipeline::new(renderer));
-    command.remove_component::<SpriteRenderer>(*entity);
+    for event in reader.read(sprite_events) {
+        if let ComponentEvent::Added(entity) = event {
+            waiting.push(*entity);
+        }
+    }
+    waiting.retain(|entity| {
+        let entry = match world.entry_ref(*entity) {
+            Ok(entry) => entry,
+            Err(_) => return false,
+        };
+        let sprite = match entry.get_component::<SpriteRenderer>() {
+            Ok(sprite) => sprite,
+            Err(_) => return false,
+        };
+        match images.state(&sprite.texture) {
+            Some(LoadState::Loaded) => {}
+            Some(LoadState::Loading) => return true,
+            Some(LoadState::Failed(error)) => {
+                log::error!("Sprite texture failed to load: {}", error);
+                return false;
+            }
+            None => return false,
+        }
+        if let Some(texture) = images.get(&sprite.texture) {
+            command.add_component(*entity, SpriteRendererPipeline::new(device, texture));
+        }
+        false
+    });
+
+    for event in images.events() {
+        if let AssetEvent::Modified(id) = event {
+            let texture = match images.get_by_id(*id) {
+                Some(texture) => texture,
+                None => continue,
+            };
+            for (entity, sprite) in query.iter(world) {
+                if sprite.texture.id() == *id {
+                    command.add_component(*entity, SpriteRendererPipeline::new(device, texture));
+                }
+            }
+        }
+    }
+}
+
+/// Textures of sprites close to the camera, which looks at the origin, are loaded first. A texture
+/// shared by several sprites takes the priority of the nearest one, and priorities are only ever
+/// raised, so the load queue is not refilled with stale entries every frame.
+///
+/// Only sprites whose texture is still loading are visited. They are picked up when added, grouped
+/// by texture, and the group is dropped once its texture is done loading.
+#[system]
+#[read_component(SpriteRenderer)]
+#[read_component(GlobalTransform)]
+pub fn sprite_texture_priority(
+    world: &SubWorld,
+    #[state] reader: &mut ComponentEventReader<SpriteRenderer>,
+    #[state] waiting: &mut HashMap<AssetId, Vec<Entity>>,
+    #[resource] sprite_events: &ComponentEvents<SpriteRenderer>,
+    #[resource] images: &mut Assets<image::DynamicImage>,
+) {
+    for event in reader.read(sprite_events) {
+        if let ComponentEvent::Added(entity) = event {
+            let texture = world.entry_ref(*entity).ok().and_then(|entry| {
+                let sprite = entry.get_component::<SpriteRenderer>().ok()?;
+                match images.state(&sprite.texture) {
+                    Some(LoadState::Loading) => Some(sprite.texture.id()),
+                    _ => None,
+                }
+            });
+            if let Some(texture) = texture {
+                waiting.entry(texture).or_default().push(*entity);
+            }
+        }
+    }
+
+    waiting.retain(|texture, sprites| {
+        let mut handle = None;
+        let mut nearest = None;
+        sprites.retain(|entity| {
+            let entry = match world.entry_ref(*entity) {
+                Ok(entry) => entry,
+                Err(_) => return false,
+            };
+            let sprite = match entry.get_component::<SpriteRenderer>() {
+                Ok(sprite) if sprite.texture.id() == *texture => sprite,
+                _ => return false,
+            };
+            if handle.is_none() {
+                handle = Some(sprite.texture.clone());
+            }
+            // Sprites added during the last frame are not in the hierarchy yet
+            if let Ok(global) = entry.get_component::<GlobalTransform>() {
+                let [x, y] = global.0.translation;
+                let priority = LoadPriority::from_distance(x.hypot(y));
+                nearest = Some(nearest.map_or(priority, |nearest| priority.max(nearest)));
+            }
+            true
+        });
+        let handle = match handle {
+            Some(handle) => handle,
+            None => return false,
+        };
+        if !matches!(images.state(&handle), Some(LoadState::Loading)) {
+            return false;
+        }
+        if let Some(priority) = nearest {
+            images.raise_priority(&handle, priority);
+        }
+        true
+    });
 }
 
-#[system(for_each)]
-pub fn sprite_render_queue(
-    sprite_renderer: &SpriteRendererPipeline,
-    transform: &mut Transform,
-    #[resource] renderer: &mut Renderer,
+/// Texture coordinates of the quad corners, in the order of `QUAD_CORNERS`.
+const QUAD_TEX_COORDS: [[f32; 2]; 4] = [[1.0, 1.0], [1.0, 0.0], [0.0, 1.0], [0.0, 0.0]];
+
+/// Copies what the renderer needs out of the world: the corners of every sprite in a chunk are
+/// computed in one batch from its world matrix and written straight into the frame's vertices.
+///
+/// The hierarchy propagates at the end of the update, before post-update systems run, so a sprite
+/// moved during the update is drawn where it was moved to. Spawning and re-parenting reach the
+/// hierarchy through change events, which are published at the end of the frame: such a sprite
+/// gets its `GlobalTransform`, and is drawn, from the next frame on.
+#[system]
+pub fn sprite_extract(
+    world: &SubWorld,
+    query: &mut Query<(&SpriteRendererPipeline, &GlobalTransform)>,
+    #[state] kernel: &BatchKernel,
+    #[resource] frame: &mut RenderFrame,
 ) {
-    log::warn!("render_queue");
-    renderer.state.queue.write_buffer(
-        &sprite_renderer.vertex_buffer,
-        0,
-        bytemuck::cast_slice(&[
-            Vertex {
-                position: [1.0 + transform.position.x, 1.0 - transform.position.y, 0.0],
-                tex_coord: [1.0, 1.0],
-            },
-            Vertex {
-                position: [1.0 + transform.position.x, -1.0 - transform.position.y, 0.0],
-                tex_coord: [1.0, 0.0],
-            },
-            Vertex {
-                position: [-1.0 + transform.position.x, 1.0 - transform.position.y, 0.0],
-                tex_coord: [0.0, 1.0],
-            },
-            Vertex {
-                position: [
-                    -1.0 + transform.position.x,
-                    -1.0 - transform.position.y,
-                    0.0,
-                ],
-                tex_coord: [0.0, 0.0],
-            },
-        ]),
-    );
-    sprite_renderer.command_buffer(renderer);
-    // renderer
-    //     .command_buffer_queue
-    //     .as_mut()
-    //     .unwrap()
-    //     .push(command_buffer);
+    frame.clear();
+    for chunk in query.iter_chunks(world) {
+        let (sprite_renderers, globals) = chunk.into_components();
+        let first_vertex = frame.vertices.len();
+        frame.vertices.extend(globals.iter().flat_map(|_| {
+            QUAD_TEX_COORDS.iter().map(|tex_coord| Vertex {
+                position: [0.0; 3],
+                tex_coord: *tex_coord,
+            })
+        }));
+        kernel.write_affine_quad_corners(
+            bytemuck::cast_slice(globals),
+            bytemuck::cast_slice_mut(&mut frame.vertices[first_vertex..]),
+            std::mem::size_of::<Vertex>() / std::mem::size_of::<f32>(),
+        );
+        frame.sprites.extend(
+            sprite_renderers
+                .iter()
+                .map(|sprite_renderer| sprite_renderer.gpu.clone()),
+        );
+    }
 }
@@ -0,0 +1,33 @@
+use std::sync::Arc;
+
+use tempeh_window::ScreenSize;
+
+use crate::sprite::SpriteGpu;
+use crate::Vertex;
+
+/// Everything the renderer needs to draw one frame, copied out of the world at the end of the
+/// simulation tick.
+///
+/// Holding only render data lets the renderer work on frame N, on its own thread, while the
+/// simulation is already updating the world for frame N+1. The vectors keep their capacity when a
+/// frame is recycled, so steady state extraction does not allocate.
+#[derive(Default)]
+pub struct RenderFrame {
+    /// Surface size requested since the previous frame, applied by the renderer before drawing
+    pub resize: Option<ScreenSize>,
+    pub(crate) sprites: Vec<Arc<SpriteGpu>>,
+    /// Four vertices per sprite, in the order of `sprites`
+    pub(crate) vertices: Vec<Vertex>,
+}
+
+impl RenderFrame {
+    /// Drops the extracted draws but keeps the capacity.
+    pub fn clear(&mut self) {
+        self.sprites.clear();
+        self.vertices.clear();
+    }
+
+    pub fn sprite_count(&self) -> usize {
+        self.sprites.len()
+    }
+}
@@ -1,7 +1,11 @@
 pub mod camera;
 pub mod command_encoder;
 pub mod component_system;
+pub mod frame;
 pub mod plugins;
+pub mod present;
+#[cfg(not(target_arch = "wasm32"))]
+pub mod render_thread;
 pub mod renderer;
 pub mod sprite;
 pub mod state;
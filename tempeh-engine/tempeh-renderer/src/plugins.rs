@@ -1,11 +1,23 @@
+use std::collections::HashMap;
+
+use tempeh_core::hierarchy::HierarchyPlugin;
 use tempeh_core::plugins::Plugin;
 use tempeh_core::AppBuilder;
 
 use crate::component_system::{
-    render_system, sprite_render_queue_system, sprite_renderer_initialization_system,
+    sprite_extract_system, sprite_renderer_initialization_system, sprite_texture_priority_system,
 };
+use crate::frame::RenderFrame;
 use crate::sprite::SpriteRenderer;
+use crate::texture::{image_size, load_image};
+use tempeh_core::assets::{AssetCategory, AssetResidency, Assets};
+use tempeh_core_component::batch::BatchKernel;
 use tempeh_core_component::Transform;
+use tempeh_ecs::events::ComponentEventReader;
+#[cfg(target_arch = "wasm32")]
+use tempeh_filesystem::{Embedded, Vfs};
+
+const DEMO_SPRITE: &str = "image/tree.png";
 
 pub struct RendererPlugin {}
 
@@ -17,18 +29,50 @@ impl Default for RendererPlugin {
 
 impl<W: tempeh_window::TempehWindow + tempeh_window::Runner> Plugin<W> for RendererPlugin {
     fn inject(&self, app: &mut AppBuilder<W>) {
-        app.add_preupdate_system(sprite_renderer_initialization_system());
-        app.add_postupdate_system(sprite_render_queue_system());
+        // Sprites are drawn at their `GlobalTransform`
+        app.add_plugin(HierarchyPlugin);
+        app.track_changes::<SpriteRenderer>();
+        app.add_asset::<image::DynamicImage, _>(load_image);
+        let residency = app
+            .get_resource::<AssetResidency>()
+            .map(|residency| AssetResidency::clone(&residency));
+        if let (Some(residency), Some(mut images)) = (
+            residency,
+            app.get_resource_mut::<Assets<image::DynamicImage>>(),
+        ) {
+            images.track_residency(residency, AssetCategory::Texture, image_size);
+        }
+        app.add_preupdate_system(sprite_texture_priority_system(
+            ComponentEventReader::default(),
+            HashMap::new(),
+        ));
+        app.add_preupdate_system(sprite_renderer_initialization_system(
+            ComponentEventReader::default(),
+            Vec::new(),
+        ));
+        app.add_resource(RenderFrame::default());
+        app.add_postupdate_system(sprite_extract_system(BatchKernel::detect()));
         // app.add_resource::<Option<Renderer>>(None);
         log::warn!("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa!");
-        app.add_postupdate_system(render_system());
-
-        app.add_component((
-            SpriteRenderer {
-                texture: image::load_from_memory(include_bytes!("../../../assets/image/tree.png"))
-                    .unwrap(),
-            },
-            Transform::default(),
-        ));
+
+        // There is no filesystem to read assets from on the web
+        #[cfg(target_arch = "wasm32")]
+        if let Some(mut vfs) = app.get_resource_mut::<Vfs>() {
+            vfs.mount(
+                "",
+                Embedded::new(&[(
+                    DEMO_SPRITE,
+                    include_bytes!("../../../assets/image/tree.png"),
+                )]),
+            );
+        }
+
+        // Loaded at the start of the first frame, the sprite is initialized once it is
+        let texture = app
+            .get_resource_mut::<Assets<image::DynamicImage>>()
+            .map(|mut images| images.load(DEMO_SPRITE));
+        if let Some(texture) = texture {
+            app.add_component((SpriteRenderer::new(texture), Transform::default()));
+        }
     }
 }
@@ -0,0 +1,117 @@
+use instant::{Duration, Instant};
+use wgpu::{Backend, PresentMode};
+
+/// Present modes the backend is known to implement. wgpu 0.12 cannot query a surface for its
+/// supported modes, so this mirrors what each wgpu-hal backend advertises.
+fn supported_present_modes(backend: Backend) -> &'static [PresentMode] {
+    match backend {
+        Backend::Vulkan | Backend::Dx12 => &[
+            PresentMode::Fifo,
+            PresentMode::Mailbox,
+            PresentMode::Immediate,
+        ],
+        Backend::Metal | Backend::Dx11 => &[PresentMode::Fifo, PresentMode::Immediate],
+        _ => &[PresentMode::Fifo],
+    }
+}
+
+/// Picks `requested` if the backend supports it. Otherwise falls back to the closest mode that
+/// does not tear if one was asked for, and to `Fifo`, which every backend supports, as a last
+/// resort.
+pub fn select_present_mode(requested: PresentMode, backend: Backend) -> PresentMode {
+    let fallbacks: &[PresentMode] = match requested {
+        PresentMode::Immediate => &[PresentMode::Immediate, PresentMode::Mailbox],
+        PresentMode::Mailbox => &[PresentMode::Mailbox],
+        PresentMode::Fifo => &[],
+    };
+    let supported = supported_present_modes(backend);
+    let selected = fallbacks
+        .iter()
+        .copied()
+        .find(|mode| supported.contains(mode))
+        .unwrap_or(PresentMode::Fifo);
+    if selected != requested {
+        log::info!(
+            "Present mode {:?} is not supported by {:?}, using {:?}",
+            requested,
+            backend,
+            selected
+        );
+    }
+    selected
+}
+
+/// Smoothing factor of the moving averages, about the last 16 frames.
+const SMOOTHING: f64 = 1.0 / 16.0;
+
+/// Timings of the most recent presents, as seen from the CPU.
+#[derive(Debug, Default, Clone, Copy)]
+pub struct PresentStats {
+    /// Time spent blocked waiting for a swapchain image. Under `Fifo` this is where the CPU waits
+    /// for vertical blank when it is ahead of the display.
+    pub acquire_wait: Duration,
+    /// Time from requesting the swapchain image to returning from present.
+    pub present_latency: Duration,
+    /// Time between the last two presents.
+    pub frame_interval: Duration,
+    /// Exponential moving averages of the values above.
+    pub average_acquire_wait: Duration,
+    pub average_present_latency: Duration,
+    pub average_frame_interval: Duration,
+    pub presented_frames: u64,
+}
+
+fn smooth(average: Duration, sample: Duration, first: bool) -> Duration {
+    if first {
+        return sample;
+    }
+    let average = average.as_secs_f64();
+    Duration::from_secs_f64(average + (sample.as_secs_f64() - average) * SMOOTHING)
+}
+
+#[derive(Default)]
+pub(crate) struct PresentTimer {
+    acquire_start: Option<Instant>,
+    last_present: Option<Instant>,
+    pub(crate) stats: PresentStats,
+}
+
+impl PresentTimer {
+    pub(crate) fn begin_acquire(&mut self) -> Instant {
+        let now = Instant::now();
+        self.acquire_start = Some(now);
+        now
+    }
+
+    pub(crate) fn end_acquire(&mut self, acquire_start: Instant) {
+        let first = self.stats.presented_frames == 0;
+        self.stats.acquire_wait = acquire_start.elapsed();
+        self.stats.average_acquire_wait = smooth(
+            self.stats.average_acquire_wait,
+            self.stats.acquire_wait,
+            first,
+        );
+    }
+
+    pub(crate) fn presented(&mut self) {
+        let now = Instant::now();
+        let first = self.stats.presented_frames == 0;
+        if let Some(acquire_start) = self.acquire_start.take() {
+            self.stats.present_latency = now - acquire_start;
+            self.stats.average_present_latency = smooth(
+                self.stats.average_present_latency,
+                self.stats.present_latency,
+                first,
+            );
+        }
+        if let Some(last_present) = self.last_present.replace(now) {
+            self.stats.frame_interval = now - last_present;
+            self.stats.average_frame_interval = smooth(
+                self.stats.average_frame_interval,
+                self.stats.frame_interval,
+                self.stats.presented_frames == 1,
+            );
+        }
+        self.stats.presented_frames += 1;
+    }
+}
@@ -0,0 +1,68 @@
+use std::sync::mpsc::{channel, sync_channel, Receiver, SyncSender};
+use std::thread::JoinHandle;
+
+use crate::frame::RenderFrame;
+use crate::renderer::Renderer;
+
+/// Runs a `Renderer` on its own thread, so that rendering and presenting frame N overlaps with the
+/// simulation of frame N+1.
+///
+/// Two frames circulate between the threads: the one the simulation extracts into and the one
+/// being rendered. `submit` hands over the extracted frame and returns the other one once the
+/// renderer is done with it, which keeps the simulation at most one frame ahead.
+pub struct RenderThread {
+    frames: Option<SyncSender<RenderFrame>>,
+    recycled: Receiver<RenderFrame>,
+    handle: Option<JoinHandle<()>>,
+}
+
+impl RenderThread {
+    pub fn spawn(mut renderer: Renderer) -> Self {
+        let (frames, frame_receiver) = sync_channel::<RenderFrame>(1);
+        let (recycle_sender, recycled) = channel();
+        recycle_sender
+            .send(RenderFrame::default())
+            .expect("Receiver is alive");
+        let handle = std::thread::Builder::new()
+            .name("tempeh-render".to_owned())
+            .spawn(move || {
+                for mut frame in frame_receiver {
+                    renderer.render(&mut frame);
+                    frame.clear();
+                    if recycle_sender.send(frame).is_err() {
+                        break;
+                    }
+                }
+            })
+            .expect("Unable to spawn render thread");
+
+        Self {
+            frames: Some(frames),
+            recycled,
+            handle: Some(handle),
+        }
+    }
+
+    /// Queues `frame` for rendering and returns an empty frame to extract the next one into.
+    /// Blocks while the render thread is still busy with the previously submitted frame.
+    pub fn submit(&mut self, frame: RenderFrame) -> RenderFrame {
+        self.frames
+            .as_ref()
+            .unwrap()
+            .send(frame)
+            .expect("Render thread has stopped");
+        self.recycled.recv().expect("Render thread has stopped")
+    }
+}
+
+impl Drop for RenderThread {
+    fn drop(&mut self) {
+        // Closing the channel ends the render loop once the queued frame is done
+        self.frames.take();
+        if let Some(handle) = self.handle.take() {
+            if handle.join().is_err() {
+                log::error!("Render thread panicked");
+            }
+        }
+    }
+}
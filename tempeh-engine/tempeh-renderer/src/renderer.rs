@@ -1,23 +1,151 @@
+use std::sync::Arc;
+
+use crate::frame::RenderFrame;
+use crate::present::{PresentStats, PresentTimer};
 use crate::state::State;
-use async_std::task;
 use tempeh_window::ScreenSize;
 
+/// The parts of the renderer needed to create GPU resources, which can be shared with the
+/// simulation while the renderer itself lives on the render thread.
+#[derive(Clone)]
+pub struct RenderDevice {
+    pub(crate) device: Arc<wgpu::Device>,
+    pub(crate) queue: Arc<wgpu::Queue>,
+    pub(crate) surface_format: wgpu::TextureFormat,
+}
+
 pub struct Renderer {
     pub state: State,
     pub clear_color: wgpu::Color,
     pub command_buffer_queue: Option<Vec<wgpu::CommandBuffer>>,
+    present_timer: PresentTimer,
 }
 
 impl Renderer {
+    /// Creates a renderer presenting with `Fifo`, which waits for vertical blank instead of
+    /// rendering frames that are never shown.
     pub fn new(
         window: &impl tempeh_window::HasRawWindowHandle,
         screen_size: ScreenSize,
         clear_color: wgpu::Color,
+    ) -> Self {
+        Self::with_present_mode(window, screen_size, clear_color, wgpu::PresentMode::Fifo)
+    }
+
+    /// Falls back to a mode the backend supports if `present_mode` is not, see
+    /// `present::select_present_mode`.
+    pub fn with_present_mode(
+        window: &impl tempeh_window::HasRawWindowHandle,
+        screen_size: ScreenSize,
+        clear_color: wgpu::Color,
+        present_mode: wgpu::PresentMode,
     ) -> Self {
         Self {
-            state: task::block_on(State::new(window, screen_size)),
+            state: tempeh_core::tasks::block_on(State::new(window, screen_size, present_mode)),
             clear_color,
             command_buffer_queue: Some(vec![]),
+            present_timer: PresentTimer::default(),
+        }
+    }
+
+    /// Applies pending resizes and acquires the next swapchain image. Returns `None` when there is
+    /// nothing to render to this frame: the window is minimized or the swapchain could not be
+    /// recovered in time. An outdated or lost swapchain is recreated and acquired again once.
+    pub fn acquire_frame(&mut self) -> Option<wgpu::SurfaceTexture> {
+        if !self.state.apply_pending_resize() {
+            return None;
+        }
+        let acquire_start = self.present_timer.begin_acquire();
+        let mut retried = false;
+        let frame = loop {
+            match self.state.surface.get_current_texture() {
+                Ok(frame) => {
+                    if frame.suboptimal {
+                        self.state.invalidate();
+                    }
+                    break Some(frame);
+                }
+                Err(wgpu::SurfaceError::Outdated) | Err(wgpu::SurfaceError::Lost) if !retried => {
+                    self.state.reconfigure();
+                    retried = true;
+                }
+                Err(wgpu::SurfaceError::OutOfMemory) => {
+                    panic!("Out of memory while acquiring a swapchain image")
+                }
+                Err(error) => {
+                    log::warn!("Skipping frame, unable to acquire swapchain image: {}", error);
+                    self.state.invalidate();
+                    break None;
+                }
+            }
+        };
+        self.present_timer.end_acquire(acquire_start);
+        frame
+    }
+
+    pub fn present(&mut self, frame: wgpu::SurfaceTexture) {
+        frame.present();
+        self.present_timer.presented();
+    }
+
+    pub fn present_stats(&self) -> PresentStats {
+        self.present_timer.stats
+    }
+
+    pub fn device(&self) -> RenderDevice {
+        RenderDevice {
+            device: self.state.device.clone(),
+            queue: self.state.queue.clone(),
+            surface_format: self.state.surface_format,
+        }
+    }
+
+    /// Draws every sprite of `frame` in a single render pass and presents once.
+    pub fn render(&mut self, frame: &mut RenderFrame) {
+        if let Some(size) = frame.resize.take() {
+            self.state.resize(size);
+        }
+        let surface_texture = match self.acquire_frame() {
+            Some(surface_texture) => surface_texture,
+            None => return,
+        };
+        let view = surface_texture
+            .texture
+            .create_view(&wgpu::TextureViewDescriptor::default());
+
+        for (sprite, quad) in frame.sprites.iter().zip(frame.vertices.chunks(4)) {
+            sprite.update_camera(&self.state);
+            self.state
+                .queue
+                .write_buffer(&sprite.vertex_buffer, 0, bytemuck::cast_slice(quad));
+        }
+
+        let mut command_encoder = self
+            .state
+            .device
+            .create_command_encoder(&wgpu::CommandEncoderDescriptor { label: None });
+        {
+            let mut render_pass = command_encoder.begin_render_pass(&wgpu::RenderPassDescriptor {
+                label: None,
+                color_attachments: &[wgpu::RenderPassColorAttachment {
+                    ops: wgpu::Operations {
+                        store: true,
+                        load: wgpu::LoadOp::Clear(self.clear_color),
+                    },
+                    resolve_target: None,
+                    view: &view,
+                }],
+                depth_stencil_attachment: None,
+            });
+            for sprite in &frame.sprites {
+                render_pass.set_pipeline(&sprite.render_pipeline);
+                render_pass.set_bind_group(0, &sprite.uniform_bind_group, &[]);
+                render_pass.set_bind_group(1, &sprite.texture_bind_group, &[]);
+                render_pass.set_vertex_buffer(0, sprite.vertex_buffer.slice(..));
+                render_pass.draw(0..4, 0..1);
+            }
         }
+        self.state.queue.submit(Some(command_encoder.finish()));
+        self.present(surface_texture);
     }
 }
@@ -1,54 +1,72 @@
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+
 use wgpu::util::{BufferInitDescriptor, DeviceExt};
 use wgpu::{PrimitiveState, RenderPipelineDescriptor, SamplerBindingType};
 
+use tempeh_core::assets::Handle;
 use tempeh_window::ScreenSize;
 
 use crate::camera::Camera2D;
-use crate::command_encoder::CommandBufferGenerator;
 use crate::prelude::State;
-use crate::renderer::Renderer;
+use crate::renderer::RenderDevice;
 use crate::uniform::Uniform;
 use crate::{Vertex, VERTICES};
 
 pub struct SpriteRenderer {
-    pub(crate) texture: image::DynamicImage,
+    pub texture: Handle<image::DynamicImage>,
+}
+
+impl SpriteRenderer {
+    pub fn new(texture: Handle<image::DynamicImage>) -> Self {
+        Self { texture }
+    }
 }
 
+/// GPU resources of a sprite, shared between the sprite's entity and the frames extracted from it
+/// that are still waiting to be rendered.
 pub struct SpriteRendererPipeline {
-    render_pipeline: wgpu::RenderPipeline,
+    pub(crate) gpu: Arc<SpriteGpu>,
+}
+
+pub(crate) struct SpriteGpu {
+    pub(crate) render_pipeline: wgpu::RenderPipeline,
     pub(crate) vertex_buffer: wgpu::Buffer,
-    uniform_bind_group: wgpu::BindGroup,
-    texture_bind_group: wgpu::BindGroup,
+    uniform_buffer: wgpu::Buffer,
+    pub(crate) uniform_bind_group: wgpu::BindGroup,
+    pub(crate) texture_bind_group: wgpu::BindGroup,
+    /// Surface generation the camera uniform was last written for
+    camera_generation: AtomicU64,
 }
 
 impl SpriteRendererPipeline {
-    pub fn new(renderer: &Renderer) -> Self {
-        let Renderer {
-            state: State { queue, device, .. },
-            ..
-        } = renderer;
+    pub fn new(render_device: &RenderDevice, texture: &image::DynamicImage) -> Self {
+        let RenderDevice {
+            device,
+            queue,
+            surface_format,
+        } = render_device;
 
         let shader_vertex =
             device.create_shader_module(&wgpu::include_spirv!("./shaders/test.vert.spv"));
         let shader_fragment =
             device.create_shader_module(&wgpu::include_spirv!("./shaders/test.frag.spv"));
 
+        // The real viewport is only known to the renderer, which writes it before the first draw
         let camera = Camera2D::new(ScreenSize {
-            width: 720,
-            height: 480,
+            width: 1,
+            height: 1,
         });
         let camera_uniform = Uniform::new(&camera);
         let uniform_buffer = device.create_buffer_init(&BufferInitDescriptor {
             label: None,
-            usage: wgpu::BufferUsages::UNIFORM | wgpu::BufferUsages::COPY_SRC,
+            usage: wgpu::BufferUsages::UNIFORM
+                | wgpu::BufferUsages::COPY_SRC
+                | wgpu::BufferUsages::COPY_DST,
             contents: bytemuck::cast_slice(&[camera_uniform]),
         });
 
-        let res = crate::texture::Texture::from_image(
-            &device,
-            &queue,
-            &image::load_from_memory(include_bytes!("../../../assets/image/tree.png")).unwrap(),
-        );
+        let res = crate::texture::Texture::from_image(&device, &queue, texture);
 
         let texture_bind_group_layout =
             device.create_bind_group_layout(&wgpu::BindGroupLayoutDescriptor {
@@ -129,7 +147,7 @@ impl SpriteRendererPipeline {
                 entry_point: "main",
                 module: &shader_fragment,
                 targets: &[wgpu::ColorTargetState {
-                    format: renderer.state.surface_format,
+                    format: *surface_format,
                     blend: Some(wgpu::BlendState::REPLACE),
                     write_mask: wgpu::ColorWrites::ALL,
                 }],
@@ -158,44 +176,37 @@ impl SpriteRendererPipeline {
         });
 
         Self {
-            vertex_buffer,
-            texture_bind_group,
-            render_pipeline,
-            uniform_bind_group,
+            gpu: Arc::new(SpriteGpu {
+                vertex_buffer,
+                texture_bind_group,
+                render_pipeline,
+                uniform_buffer,
+                uniform_bind_group,
+                camera_generation: AtomicU64::new(u64::MAX),
+            }),
         }
     }
 }
 
-impl CommandBufferGenerator for SpriteRendererPipeline {
-    fn command_buffer(&self, renderer: &Renderer) {
-        let frame = renderer.state.surface.get_current_texture().unwrap();
-        let view = frame
-            .texture
-            .create_view(&wgpu::TextureViewDescriptor::default());
-        let mut command_encoder = renderer
-            .state
-            .device
-            .create_command_encoder(&wgpu::CommandEncoderDescriptor { label: None });
-        {
-            let mut render_pass = command_encoder.begin_render_pass(&wgpu::RenderPassDescriptor {
-                label: None,
-                color_attachments: &[wgpu::RenderPassColorAttachment {
-                    ops: wgpu::Operations {
-                        store: true,
-                        load: wgpu::LoadOp::Clear(renderer.clear_color),
-                    },
-                    resolve_target: None,
-                    view: &view,
-                }],
-                depth_stencil_attachment: None,
-            });
-            render_pass.set_pipeline(&self.render_pipeline);
-            render_pass.set_bind_group(0, &self.uniform_bind_group, &[]);
-            render_pass.set_bind_group(1, &self.texture_bind_group, &[]);
-            render_pass.set_vertex_buffer(0, self.vertex_buffer.slice(..));
-            render_pass.draw(0..VERTICES.len() as u32, 0..1);
+impl SpriteGpu {
+    /// Rewrites the camera uniform if the surface was reconfigured since it was last written.
+    pub(crate) fn update_camera(&self, state: &State) {
+        let generation = state.surface_generation();
+        if self.camera_generation.swap(generation, Ordering::Relaxed) != generation {
+            let camera = Camera2D::new(camera_viewport(state.size()));
+            state.queue.write_buffer(
+                &self.uniform_buffer,
+                0,
+                bytemuck::cast_slice(&[Uniform::new(&camera)]),
+            );
         }
-        renderer.state.queue.submit(Some(command_encoder.finish()));
-        frame.present();
+    }
+}
+
+/// The surface has no area until the first resize on some platforms.
+fn camera_viewport(size: ScreenSize) -> ScreenSize {
+    ScreenSize {
+        width: size.width.max(1),
+        height: size.height.max(1),
     }
 }
@@ -1,19 +1,29 @@
+use std::sync::Arc;
+
 use tempeh_window::ScreenSize;
 use wgpu::{RequestAdapterOptions, SurfaceConfiguration};
 
+use crate::present::select_present_mode;
+
 pub struct State {
-    pub(crate) device: wgpu::Device,
+    pub(crate) device: Arc<wgpu::Device>,
     pub(crate) surface: wgpu::Surface,
     pub(crate) surface_format: wgpu::TextureFormat,
-    pub(crate) queue: wgpu::Queue,
+    pub(crate) queue: Arc<wgpu::Queue>,
     pub(crate) adapter: wgpu::Adapter,
     pub(crate) clear_color: wgpu::Color,
+    pub(crate) present_mode: wgpu::PresentMode,
+    config: SurfaceConfiguration,
+    pending_size: Option<ScreenSize>,
+    needs_reconfigure: bool,
+    generation: u64,
 }
 
 impl State {
     pub async fn new(
         window: &impl tempeh_window::HasRawWindowHandle,
         screen_size: ScreenSize,
+        present_mode: wgpu::PresentMode,
     ) -> Self {
         let instance = wgpu::Instance::new(if cfg!(target_arch = "wasm32") {
             wgpu::Backends::all()
@@ -185,27 +195,33 @@ impl State {
         let surface_format = surface
             .get_preferred_format(&adapter)
             .unwrap_or(wgpu::TextureFormat::Bgra8Unorm);
+        let present_mode = select_present_mode(present_mode, adapter.get_info().backend);
 
-        surface.configure(
-            &device,
-            &SurfaceConfiguration {
-                format: surface_format,
-                present_mode: wgpu::PresentMode::Mailbox,
-                usage: wgpu::TextureUsages::RENDER_ATTACHMENT,
-                width: screen_size.width,
-                height: screen_size.height,
-            },
-        );
+        let config = SurfaceConfiguration {
+            format: surface_format,
+            present_mode,
+            usage: wgpu::TextureUsages::RENDER_ATTACHMENT,
+            width: screen_size.width,
+            height: screen_size.height,
+        };
+        if config.width != 0 && config.height != 0 {
+            surface.configure(&device, &config);
+        }
 
         Self {
             // swapchain_texture_view: swapchain.get_current_frame().unwrap().output.view,
             // swapchain,
             surface_format,
+            present_mode,
+            config,
+            pending_size: None,
+            needs_reconfigure: false,
+            generation: 0,
             adapter,
             surface,
             // swapchain_descriptor,
-            device,
-            queue,
+            device: Arc::new(device),
+            queue: Arc::new(queue),
             // render_pipeline,
             // vertex_buffer,
             // uniform_bind_group,
@@ -249,12 +265,63 @@ impl State {
     //     Ok(())
     // }
 
-    pub fn resize(&mut self, _size: ScreenSize) {
-        // self.swapchain_descriptor.width = size.width;
-        // self.swapchain_descriptor.height = size.height;
-        // self.swapchain = self
-        //     .device
-        //     .create_swap_chain(&self.surface, &self.swapchain_descriptor)
+    /// Requests the surface to be resized. Only the last size requested before the next frame is
+    /// applied, so dragging a window edge reconfigures the surface once per frame instead of once
+    /// per resize event.
+    pub fn resize(&mut self, size: ScreenSize) {
+        self.pending_size = Some(size);
+    }
+
+    /// Current size of the surface.
+    pub fn size(&self) -> ScreenSize {
+        ScreenSize {
+            width: self.config.width,
+            height: self.config.height,
+        }
+    }
+
+    /// Incremented every time the surface is reconfigured, so resources that depend on its size
+    /// can tell when they have to be updated.
+    pub fn surface_generation(&self) -> u64 {
+        self.generation
+    }
+
+    /// Applies a pending resize or reconfiguration. Returns false if the surface has no area, e.g.
+    /// while the window is minimized, in which case nothing should be rendered.
+    pub(crate) fn apply_pending_resize(&mut self) -> bool {
+        if let Some(size) = self.pending_size {
+            if size.width == 0 || size.height == 0 {
+                return false;
+            }
+            self.pending_size = None;
+            if size != self.size() {
+                self.config.width = size.width;
+                self.config.height = size.height;
+                self.needs_reconfigure = true;
+            }
+        }
+        if self.needs_reconfigure {
+            self.reconfigure();
+        }
+        self.config.width != 0 && self.config.height != 0
+    }
+
+    /// Reconfigures the surface with its current configuration, which is also how a lost or
+    /// outdated swapchain is recreated.
+    pub(crate) fn reconfigure(&mut self) {
+        self.surface.configure(&self.device, &self.config);
+        self.generation += 1;
+        self.needs_reconfigure = false;
+    }
+
+    /// Schedules a reconfiguration before the next frame.
+    pub(crate) fn invalidate(&mut self) {
+        self.needs_reconfigure = true;
+    }
+
+    /// The present mode in use, after falling back from the requested one.
+    pub fn present_mode(&self) -> wgpu::PresentMode {
+        self.present_mode
     }
 
     pub fn set_clear_color(&mut self, clear_color: wgpu::Color) {
@@ -1,5 +1,28 @@
-use image::{GenericImageView};
+use image::GenericImageView;
+use tempeh_core::assets::AssetSize;
+use tempeh_filesystem::cooked::CookedTexture;
 
+/// Asset loader for images, either textures cooked by `tempeh-cooker` or source images that still
+/// have to be decoded.
+pub fn load_image(path: &str, bytes: &[u8]) -> Result<image::DynamicImage, String> {
+    if let Some(cooked) = CookedTexture::parse(bytes) {
+        let texture =
+            image::RgbaImage::from_raw(cooked.width, cooked.height, cooked.pixels.to_vec())
+                .ok_or_else(|| format!("cooked texture `{}` is truncated", path))?;
+        return Ok(image::DynamicImage::ImageRgba8(texture));
+    }
+    image::load_from_memory(bytes)
+        .map_err(|error| format!("unable to decode `{}`: {}", path, error))
+}
+
+/// Memory of a loaded image, and of the RGBA8 texture it is uploaded to.
+pub fn image_size(image: &image::DynamicImage) -> AssetSize {
+    let (width, height) = image.dimensions();
+    AssetSize::new(
+        image.as_bytes().len() as u64,
+        width as u64 * height as u64 * 4,
+    )
+}
 
 pub struct Texture {
     pub texture: wgpu::Texture,
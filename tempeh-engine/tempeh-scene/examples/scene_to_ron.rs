@@ -0,0 +1,13 @@
+use tempeh_scene::{SceneFile, TypeRegistry};
+
+// Usage: cargo run -p tempeh-scene --example scene_to_ron -- path/to/level.tscn
+fn main() {
+    let path = std::env::args()
+        .nth(1)
+        .expect("Usage: scene_to_ron <scene file>");
+    let scene = SceneFile::open(&path).unwrap();
+    print!(
+        "{}",
+        scene.to_ron(&TypeRegistry::with_core_components()).unwrap()
+    );
+}
@@ -0,0 +1,53 @@
+use std::fmt;
+use std::io;
+
+#[derive(Debug)]
+pub enum SceneError {
+    Io(io::Error),
+    Ron(ron::Error),
+    InvalidMagic,
+    UnsupportedVersion(u32),
+    EndianMismatch,
+    Corrupted(&'static str),
+    UnknownType(String),
+    TypeMismatch { name: String, size: u32, align: u32 },
+}
+
+impl fmt::Display for SceneError {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            SceneError::Io(error) => write!(f, "scene I/O error: {}", error),
+            SceneError::Ron(error) => write!(f, "scene RON export error: {}", error),
+            SceneError::InvalidMagic => write!(f, "not a tempeh scene file"),
+            SceneError::UnsupportedVersion(version) => {
+                write!(f, "unsupported scene version {}", version)
+            }
+            SceneError::EndianMismatch => {
+                write!(f, "scene was written on a machine with different endianness")
+            }
+            SceneError::Corrupted(reason) => write!(f, "corrupted scene file: {}", reason),
+            SceneError::UnknownType(name) => {
+                write!(f, "component type `{}` is not registered", name)
+            }
+            SceneError::TypeMismatch { name, size, align } => write!(
+                f,
+                "component type `{}` is stored with size {} and align {}, which does not match the registered type",
+                name, size, align
+            ),
+        }
+    }
+}
+
+impl std::error::Error for SceneError {}
+
+impl From<io::Error> for SceneError {
+    fn from(error: io::Error) -> Self {
+        SceneError::Io(error)
+    }
+}
+
+impl From<ron::Error> for SceneError {
+    fn from(error: ron::Error) -> Self {
+        SceneError::Ron(error)
+    }
+}
@@ -0,0 +1,48 @@
+use std::fmt::Write;
+
+use crate::error::SceneError;
+use crate::format::VERSION;
+use crate::reader::{resolve_types, SceneFile};
+use crate::registry::TypeRegistry;
+
+impl SceneFile {
+    /// Renders the scene as RON with one component per line, meant for reviewing scene changes
+    /// with regular diff tools. The binary file stays the source of truth, there is no RON import.
+    pub fn to_ron(&self, registry: &TypeRegistry) -> Result<String, SceneError> {
+        let tables = self.tables();
+        let registrations = resolve_types(&tables, registry)?;
+
+        let mut out = String::new();
+        writeln!(out, "Scene(").unwrap();
+        writeln!(out, "    version: {},", VERSION).unwrap();
+        writeln!(out, "    archetypes: [").unwrap();
+        for archetype in tables.archetypes {
+            writeln!(out, "        (").unwrap();
+            writeln!(out, "            entities: {},", archetype.entity_count).unwrap();
+            writeln!(out, "            components: {{").unwrap();
+            for column in tables.archetype_columns(archetype)? {
+                let registration = *registrations
+                    .get(column.type_index as usize)
+                    .ok_or(SceneError::Corrupted("column refers to an unknown type"))?;
+                writeln!(out, "                {:?}: [", registration.name()).unwrap();
+                let data = tables.column_data(column)?;
+                if registration.size() > 0 {
+                    for value in data.chunks_exact(registration.size()) {
+                        writeln!(
+                            out,
+                            "                    {},",
+                            (registration.to_ron)(value)?
+                        )
+                        .unwrap();
+                    }
+                }
+                writeln!(out, "                ],").unwrap();
+            }
+            writeln!(out, "            }},").unwrap();
+            writeln!(out, "        ),").unwrap();
+        }
+        writeln!(out, "    ],").unwrap();
+        writeln!(out, ")").unwrap();
+        Ok(out)
+    }
+}
@@ -0,0 +1,159 @@
+//! On-disk layout of a binary scene.
+//!
+//! ```text
+//! Header
+//! TypeRecord[type_count]
+//! ArchetypeRecord[archetype_count]
+//! ColumnRecord[column_count]
+//! string table (type names)
+//! column blobs, each starting on a BLOB_ALIGN boundary
+//! ```
+//!
+//! Every archetype stores its components column-major: one blob per component type holding
+//! `entity_count` tightly packed values, so a column can be copied into a legion archetype with a
+//! single memcpy. All integers are native-endian; `Header::endian` is used to reject files written
+//! on a machine with a different byte order.
+
+use bytemuck::{Pod, Zeroable};
+
+use crate::error::SceneError;
+
+pub const MAGIC: [u8; 4] = *b"TPSC";
+pub const VERSION: u32 = 1;
+pub const ENDIAN_TAG: u32 = 0x0102_0304;
+pub const BLOB_ALIGN: usize = 64;
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Pod, Zeroable)]
+pub struct Header {
+    pub magic: [u8; 4],
+    pub version: u32,
+    pub endian: u32,
+    pub type_count: u32,
+    pub archetype_count: u32,
+    pub column_count: u32,
+    pub types_offset: u64,
+    pub archetypes_offset: u64,
+    pub columns_offset: u64,
+    pub strings_offset: u64,
+    pub strings_len: u64,
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Pod, Zeroable)]
+pub struct TypeRecord {
+    pub name_offset: u64,
+    pub name_len: u32,
+    pub size: u32,
+    pub align: u32,
+    pub _reserved: u32,
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Pod, Zeroable)]
+pub struct ArchetypeRecord {
+    pub entity_count: u64,
+    pub first_column: u32,
+    pub column_count: u32,
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Pod, Zeroable)]
+pub struct ColumnRecord {
+    pub type_index: u32,
+    pub _reserved: u32,
+    pub offset: u64,
+    pub len: u64,
+}
+
+pub(crate) fn align_up(value: usize, align: usize) -> usize {
+    (value + align - 1) & !(align - 1)
+}
+
+/// Borrowed, validated view over the tables of a scene.
+pub(crate) struct Tables<'a> {
+    pub types: &'a [TypeRecord],
+    pub archetypes: &'a [ArchetypeRecord],
+    pub columns: &'a [ColumnRecord],
+    strings: &'a [u8],
+    bytes: &'a [u8],
+}
+
+impl<'a> Tables<'a> {
+    pub fn parse(bytes: &'a [u8]) -> Result<Self, SceneError> {
+        let header_size = std::mem::size_of::<Header>();
+        if bytes.len() < header_size {
+            return Err(SceneError::Corrupted("file is smaller than the header"));
+        }
+        let header: &Header = bytemuck::try_from_bytes(&bytes[..header_size])
+            .map_err(|_| SceneError::Corrupted("misaligned header"))?;
+        if header.magic != MAGIC {
+            return Err(SceneError::InvalidMagic);
+        }
+        if header.endian != ENDIAN_TAG {
+            return Err(SceneError::EndianMismatch);
+        }
+        if header.version != VERSION {
+            return Err(SceneError::UnsupportedVersion(header.version));
+        }
+
+        let types = table::<TypeRecord>(bytes, header.types_offset, header.type_count)?;
+        let archetypes =
+            table::<ArchetypeRecord>(bytes, header.archetypes_offset, header.archetype_count)?;
+        let columns = table::<ColumnRecord>(bytes, header.columns_offset, header.column_count)?;
+        let strings = range(bytes, header.strings_offset, header.strings_len)?;
+
+        Ok(Self {
+            types,
+            archetypes,
+            columns,
+            strings,
+            bytes,
+        })
+    }
+
+    pub fn type_name(&self, type_index: u32) -> Result<&'a str, SceneError> {
+        let record = self
+            .types
+            .get(type_index as usize)
+            .ok_or(SceneError::Corrupted("column refers to an unknown type"))?;
+        let name = range(self.strings, record.name_offset, record.name_len as u64)?;
+        std::str::from_utf8(name).map_err(|_| SceneError::Corrupted("type name is not UTF-8"))
+    }
+
+    pub fn archetype_columns(
+        &self,
+        archetype: &ArchetypeRecord,
+    ) -> Result<&'a [ColumnRecord], SceneError> {
+        let start = archetype.first_column as usize;
+        let end = start
+            .checked_add(archetype.column_count as usize)
+            .ok_or(SceneError::Corrupted("range overflow"))?;
+        self.columns.get(start..end).ok_or(SceneError::Corrupted(
+            "archetype column range out of bounds",
+        ))
+    }
+
+    pub fn column_data(&self, column: &ColumnRecord) -> Result<&'a [u8], SceneError> {
+        if column.offset as usize % BLOB_ALIGN != 0 {
+            return Err(SceneError::Corrupted("misaligned column blob"));
+        }
+        range(self.bytes, column.offset, column.len)
+    }
+}
+
+fn range(bytes: &[u8], offset: u64, len: u64) -> Result<&[u8], SceneError> {
+    let start = offset as usize;
+    let end = start
+        .checked_add(len as usize)
+        .ok_or(SceneError::Corrupted("range overflow"))?;
+    bytes
+        .get(start..end)
+        .ok_or(SceneError::Corrupted("range out of bounds"))
+}
+
+fn table<T: Pod>(bytes: &[u8], offset: u64, count: u32) -> Result<&[T], SceneError> {
+    let len = count as u64 * std::mem::size_of::<T>() as u64;
+    bytemuck::try_cast_slice(range(bytes, offset, len)?)
+        .map_err(|_| SceneError::Corrupted("misaligned table"))
+}
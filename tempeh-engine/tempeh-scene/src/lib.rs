@@ -0,0 +1,23 @@
+pub mod error;
+pub mod export;
+pub mod format;
+pub mod plugins;
+pub mod reader;
+pub mod registry;
+#[cfg(not(target_arch = "wasm32"))]
+pub mod stream;
+pub mod writer;
+
+pub use error::SceneError;
+pub use reader::SceneFile;
+pub use registry::TypeRegistry;
+pub use writer::save_world;
+
+pub mod prelude {
+    #[cfg(not(target_arch = "wasm32"))]
+    pub use crate::plugins::LevelStreamingPlugin;
+    pub use crate::plugins::ScenePlugin;
+    #[cfg(not(target_arch = "wasm32"))]
+    pub use crate::stream::LevelStreamer;
+    pub use crate::{SceneFile, TypeRegistry};
+}
@@ -0,0 +1,77 @@
+use std::path::PathBuf;
+
+use tempeh_core::plugins::Plugin;
+use tempeh_core::AppBuilder;
+
+use crate::reader::SceneFile;
+use crate::registry::TypeRegistry;
+#[cfg(not(target_arch = "wasm32"))]
+use crate::stream::LevelStreamer;
+
+pub struct ScenePlugin {
+    path: PathBuf,
+    registry: TypeRegistry,
+}
+
+impl ScenePlugin {
+    pub fn new<P: Into<PathBuf>>(path: P) -> Self {
+        Self::with_registry(path, TypeRegistry::with_core_components())
+    }
+
+    pub fn with_registry<P: Into<PathBuf>>(path: P, registry: TypeRegistry) -> Self {
+        Self {
+            path: path.into(),
+            registry,
+        }
+    }
+}
+
+impl<W: tempeh_window::Runner> Plugin<W> for ScenePlugin {
+    fn inject(&self, app: &mut AppBuilder<W>) {
+        let loaded = SceneFile::open(&self.path)
+            .and_then(|scene| scene.load_into(app.world_mut(), &self.registry));
+        match loaded {
+            Ok(entities) => log::info!(
+                "Loaded {} entities from {}",
+                entities.len(),
+                self.path.display()
+            ),
+            Err(error) => log::error!("Failed to load {}: {}", self.path.display(), error),
+        }
+    }
+}
+
+#[cfg(not(target_arch = "wasm32"))]
+pub struct LevelStreamingPlugin {
+    budget: std::time::Duration,
+    registry: fn() -> TypeRegistry,
+}
+
+#[cfg(not(target_arch = "wasm32"))]
+impl LevelStreamingPlugin {
+    pub fn new(budget: std::time::Duration, registry: fn() -> TypeRegistry) -> Self {
+        Self { budget, registry }
+    }
+}
+
+#[cfg(not(target_arch = "wasm32"))]
+impl Default for LevelStreamingPlugin {
+    fn default() -> Self {
+        Self::new(
+            std::time::Duration::from_millis(2),
+            TypeRegistry::with_core_components,
+        )
+    }
+}
+
+#[cfg(not(target_arch = "wasm32"))]
+impl<W: tempeh_window::Runner> Plugin<W> for LevelStreamingPlugin {
+    fn inject(&self, app: &mut AppBuilder<W>) {
+        app.add_resource(LevelStreamer::new((self.registry)(), self.budget));
+        app.add_frame_end_fn(|world, resources| {
+            if let Some(mut streamer) = resources.get_mut::<LevelStreamer>() {
+                streamer.update(world);
+            }
+        });
+    }
+}
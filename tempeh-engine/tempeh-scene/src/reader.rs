@@ -0,0 +1,351 @@
+use std::convert::TryFrom;
+use std::path::Path;
+
+use tempeh_ecs::query::{FilterResult, LayoutFilter};
+use tempeh_ecs::storage::{
+    ArchetypeSource, ArchetypeWriter, ComponentSource, ComponentTypeId, EntityLayout,
+};
+use tempeh_ecs::{Entity, World};
+
+use crate::error::SceneError;
+use crate::format::{ArchetypeRecord, Tables, BLOB_ALIGN};
+use crate::registry::{TypeRegistration, TypeRegistry};
+
+enum SceneBytes {
+    #[cfg(not(target_arch = "wasm32"))]
+    Mapped(memmap2::Mmap),
+    Owned(Vec<AlignedBlock>),
+}
+
+#[repr(C, align(64))]
+#[derive(Copy, Clone)]
+struct AlignedBlock([u8; BLOB_ALIGN]);
+
+/// A binary scene, either memory-mapped from disk or held in an aligned buffer.
+///
+/// Loading never deserializes entities one by one: every column blob is handed to legion as a
+/// single memcpy into the destination archetype, so load time is bounded by how fast the pages of
+/// the file can be brought in.
+pub struct SceneFile {
+    bytes: SceneBytes,
+    len: usize,
+}
+
+impl SceneFile {
+    #[cfg(not(target_arch = "wasm32"))]
+    pub fn open<P: AsRef<Path>>(path: P) -> Result<Self, SceneError> {
+        let file = std::fs::File::open(path)?;
+        // Safety: the mapping is read-only, a scene that is truncated while mapped is a user error
+        // we cannot defend against, the same as with any other mmap based loader
+        let mapped = unsafe { memmap2::Mmap::map(&file)? };
+        let scene = Self {
+            len: mapped.len(),
+            bytes: SceneBytes::Mapped(mapped),
+        };
+        Tables::parse(scene.as_bytes())?;
+        Ok(scene)
+    }
+
+    #[cfg(target_arch = "wasm32")]
+    pub fn open<P: AsRef<Path>>(path: P) -> Result<Self, SceneError> {
+        Self::from_bytes(&std::fs::read(path)?)
+    }
+
+    /// Copies `bytes` into a buffer aligned for every column blob.
+    pub fn from_bytes(bytes: &[u8]) -> Result<Self, SceneError> {
+        let mut blocks =
+            vec![AlignedBlock([0; BLOB_ALIGN]); (bytes.len() + BLOB_ALIGN - 1) / BLOB_ALIGN];
+        let storage: &mut [u8] = bytemuck_blocks_mut(&mut blocks);
+        storage[..bytes.len()].copy_from_slice(bytes);
+        let scene = Self {
+            len: bytes.len(),
+            bytes: SceneBytes::Owned(blocks),
+        };
+        Tables::parse(scene.as_bytes())?;
+        Ok(scene)
+    }
+
+    pub fn as_bytes(&self) -> &[u8] {
+        match &self.bytes {
+            #[cfg(not(target_arch = "wasm32"))]
+            SceneBytes::Mapped(mapped) => &mapped[..],
+            SceneBytes::Owned(blocks) => {
+                // Safety: AlignedBlock is a plain byte array
+                let bytes = unsafe {
+                    std::slice::from_raw_parts(
+                        blocks.as_ptr() as *const u8,
+                        blocks.len() * BLOB_ALIGN,
+                    )
+                };
+                &bytes[..self.len]
+            }
+        }
+    }
+
+    pub fn entity_count(&self) -> u64 {
+        self.tables()
+            .archetypes
+            .iter()
+            .map(|archetype| archetype.entity_count)
+            .fold(0, u64::saturating_add)
+    }
+
+    pub(crate) fn tables(&self) -> Tables<'_> {
+        Tables::parse(self.as_bytes()).expect("Scene was validated on construction")
+    }
+
+    /// Pushes every archetype of the scene into `world` and returns the created entities in file
+    /// order.
+    pub fn load_into(
+        &self,
+        world: &mut World,
+        registry: &TypeRegistry,
+    ) -> Result<Vec<Entity>, SceneError> {
+        let tables = self.tables();
+        let registrations = resolve_types(&tables, registry)?;
+
+        // Every archetype is checked before anything sized by the file is allocated or pushed
+        let mut sources = Vec::with_capacity(tables.archetypes.len());
+        let mut entity_count = 0_usize;
+        for archetype in tables.archetypes {
+            let source = self.column_source(&tables, &registrations, archetype)?;
+            entity_count = entity_count
+                .checked_add(source.entity_count)
+                .ok_or(SceneError::Corrupted("entity count overflow"))?;
+            sources.push(source);
+        }
+
+        let mut entities = Vec::with_capacity(entity_count);
+        for source in sources {
+            entities.extend_from_slice(world.extend(source));
+        }
+        Ok(entities)
+    }
+
+    fn column_source<'a>(
+        &self,
+        tables: &Tables<'a>,
+        registrations: &[&'a TypeRegistration],
+        archetype: &ArchetypeRecord,
+    ) -> Result<ColumnSource<'a>, SceneError> {
+        let entity_count = usize::try_from(archetype.entity_count)
+            .map_err(|_| SceneError::Corrupted("entity count overflow"))?;
+        let records = tables.archetype_columns(archetype)?;
+        let mut columns = Vec::with_capacity(records.len());
+        for (index, column) in records.iter().enumerate() {
+            if records[..index]
+                .iter()
+                .any(|other| other.type_index == column.type_index)
+            {
+                return Err(SceneError::Corrupted("archetype stores a component twice"));
+            }
+            let registration = *registrations
+                .get(column.type_index as usize)
+                .ok_or(SceneError::Corrupted("column refers to an unknown type"))?;
+            let data = tables.column_data(column)?;
+            let len = registration
+                .size
+                .checked_mul(entity_count)
+                .ok_or(SceneError::Corrupted("column length overflow"))?;
+            if data.len() != len {
+                return Err(SceneError::Corrupted(
+                    "column length does not match entity count",
+                ));
+            }
+            columns.push(Column { registration, data });
+        }
+        // Zero-sized components take no space in the file, so nothing else bounds the entities
+        // of an archetype made of those only
+        if columns.iter().all(|column| column.registration.size == 0) && entity_count > self.len {
+            return Err(SceneError::Corrupted(
+                "more entities than the file has bytes",
+            ));
+        }
+        Ok(ColumnSource {
+            columns,
+            entity_count,
+        })
+    }
+}
+
+fn bytemuck_blocks_mut(blocks: &mut [AlignedBlock]) -> &mut [u8] {
+    // Safety: AlignedBlock is a plain byte array without padding
+    unsafe {
+        std::slice::from_raw_parts_mut(blocks.as_mut_ptr() as *mut u8, blocks.len() * BLOB_ALIGN)
+    }
+}
+
+/// Maps the type table of the file onto the registry, by name.
+pub(crate) fn resolve_types<'r>(
+    tables: &Tables,
+    registry: &'r TypeRegistry,
+) -> Result<Vec<&'r TypeRegistration>, SceneError> {
+    tables
+        .types
+        .iter()
+        .enumerate()
+        .map(|(index, record)| {
+            let name = tables.type_name(index as u32)?;
+            let registration = registry
+                .index_of_name(name)
+                .map(|index| registry.get(index))
+                .ok_or_else(|| SceneError::UnknownType(name.to_owned()))?;
+            if registration.size != record.size as usize
+                || registration.align != record.align as usize
+                || registration.align > BLOB_ALIGN
+            {
+                return Err(SceneError::TypeMismatch {
+                    name: name.to_owned(),
+                    size: record.size,
+                    align: record.align,
+                });
+            }
+            Ok(registration)
+        })
+        .collect()
+}
+
+struct Column<'a> {
+    registration: &'a TypeRegistration,
+    data: &'a [u8],
+}
+
+struct ColumnSource<'a> {
+    columns: Vec<Column<'a>>,
+    entity_count: usize,
+}
+
+#[derive(Clone)]
+struct ExactLayout(Vec<ComponentTypeId>);
+
+impl LayoutFilter for ExactLayout {
+    fn matches_layout(&self, components: &[ComponentTypeId]) -> FilterResult {
+        FilterResult::Match(
+            components.len() == self.0.len()
+                && self.0.iter().all(|type_id| components.contains(type_id)),
+        )
+    }
+}
+
+impl<'a> ArchetypeSource for ColumnSource<'a> {
+    type Filter = ExactLayout;
+
+    fn filter(&self) -> Self::Filter {
+        ExactLayout(
+            self.columns
+                .iter()
+                .map(|column| column.registration.type_id)
+                .collect(),
+        )
+    }
+
+    fn layout(&mut self) -> EntityLayout {
+        let mut layout = EntityLayout::default();
+        for column in &self.columns {
+            (column.registration.register_layout)(&mut layout);
+        }
+        layout
+    }
+}
+
+impl<'a> ComponentSource for ColumnSource<'a> {
+    fn push_components<'b>(
+        &mut self,
+        writer: &mut ArchetypeWriter<'b>,
+        mut entities: impl Iterator<Item = Entity>,
+    ) {
+        for _ in 0..self.entity_count {
+            writer.push(entities.next().unwrap());
+        }
+        for column in &self.columns {
+            // Safety: the registration was checked against the size and alignment stored in the
+            // file, the blob holds exactly `entity_count` values and starts on a BLOB_ALIGN
+            // boundary, and registered types are Pod so any bit pattern is valid
+            unsafe {
+                (column.registration.extend_column)(writer, column.data.as_ptr(), self.entity_count)
+            };
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::format::{ColumnRecord, Header};
+    use crate::writer::save_world;
+    use std::mem::size_of;
+    use tempeh_core_component::Transform;
+    use tempeh_ecs::{IntoQuery, Read};
+    use tempeh_math::Point2;
+
+    #[test]
+    fn save_and_load_round_trip() {
+        let registry = TypeRegistry::with_core_components();
+        let mut world = World::default();
+        for i in 0..1000 {
+            world.push((Transform {
+                position: Point2::new(i as f32, -(i as f32)),
+                scale: Point2::new(1.0, 2.0),
+                rotation: 0.5,
+            },));
+        }
+        // Not registered, must be skipped without dropping the Transform
+        world.push((Transform::default(), 42_u64));
+
+        let mut bytes = Vec::new();
+        save_world(&world, &registry, &mut bytes).unwrap();
+        let scene = SceneFile::from_bytes(&bytes).unwrap();
+        assert_eq!(scene.entity_count(), 1001);
+
+        let mut loaded = World::default();
+        let entities = scene.load_into(&mut loaded, &registry).unwrap();
+        assert_eq!(entities.len(), 1001);
+
+        let mut expected = <Read<Transform>>::query()
+            .iter(&world)
+            .copied()
+            .collect::<Vec<_>>();
+        let mut actual = <Read<Transform>>::query()
+            .iter(&loaded)
+            .copied()
+            .collect::<Vec<_>>();
+        let key = |t: &Transform| (t.position.x as i64, t.position.y as i64);
+        expected.sort_by_key(key);
+        actual.sort_by_key(key);
+        assert_eq!(expected, actual);
+
+        assert!(scene
+            .to_ron(&registry)
+            .unwrap()
+            .contains("\"tempeh::Transform\""));
+    }
+
+    #[test]
+    fn rejects_columns_that_do_not_match_the_file() {
+        let mut registry = TypeRegistry::with_core_components();
+        registry.register::<u64>("u64");
+        let mut world = World::default();
+        world.push((Transform::default(), 7_u64));
+        let mut bytes = Vec::new();
+        save_world(&world, &registry, &mut bytes).unwrap();
+        let header: Header = bytemuck::pod_read_unaligned(&bytes[..size_of::<Header>()]);
+        let load = |bytes: &[u8]| {
+            let scene = SceneFile::from_bytes(bytes).unwrap();
+            match scene.load_into(&mut World::default(), &registry) {
+                Err(SceneError::Corrupted(reason)) => reason,
+                _ => panic!("Corrupted scene was loaded"),
+            }
+        };
+
+        // `size * entity_count` would wrap around
+        let mut huge = bytes.clone();
+        let entity_count = header.archetypes_offset as usize;
+        huge[entity_count..entity_count + 8].copy_from_slice(&u64::MAX.to_ne_bytes());
+        assert_eq!(load(&huge), "column length overflow");
+
+        let mut twice = bytes.clone();
+        let type_index = header.columns_offset as usize + size_of::<ColumnRecord>();
+        twice[type_index..type_index + 4].copy_from_slice(&0_u32.to_ne_bytes());
+        assert_eq!(load(&twice), "archetype stores a component twice");
+    }
+}
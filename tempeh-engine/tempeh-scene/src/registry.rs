@@ -0,0 +1,133 @@
+use std::collections::HashMap;
+
+use bytemuck::Pod;
+use serde::Serialize;
+use tempeh_core_component::Transform;
+use tempeh_ecs::storage::{ArchetypeWriter, Component, ComponentTypeId, EntityLayout};
+use tempeh_ecs::world::EntryRef;
+
+/// Type-erased operations for a component type that can be stored in a scene.
+///
+/// Only plain-old-data components are registrable, which is what allows a column to be moved
+/// between the file and a legion archetype as raw bytes.
+pub struct TypeRegistration {
+    pub(crate) name: String,
+    pub(crate) size: usize,
+    pub(crate) align: usize,
+    pub(crate) type_id: ComponentTypeId,
+    pub(crate) register_layout: fn(&mut EntityLayout),
+    pub(crate) extend_column: unsafe fn(&mut ArchetypeWriter, *const u8, usize),
+    pub(crate) append_bytes: fn(&EntryRef, &mut Vec<u8>) -> bool,
+    pub(crate) to_ron: fn(&[u8]) -> ron::Result<String>,
+}
+
+impl TypeRegistration {
+    pub fn name(&self) -> &str {
+        &self.name
+    }
+
+    pub fn size(&self) -> usize {
+        self.size
+    }
+
+    pub fn align(&self) -> usize {
+        self.align
+    }
+}
+
+#[derive(Default)]
+pub struct TypeRegistry {
+    registrations: Vec<TypeRegistration>,
+    by_name: HashMap<String, usize>,
+    by_type: HashMap<ComponentTypeId, usize>,
+}
+
+impl TypeRegistry {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Registry containing the components shipped with the engine.
+    pub fn with_core_components() -> Self {
+        let mut registry = Self::new();
+        registry.register::<Transform>("tempeh::Transform");
+        registry
+    }
+
+    /// Registers `T` under a stable `name`. The name, not the Rust type path, is what ends up in
+    /// the file, so renaming or moving a type does not invalidate existing scenes.
+    pub fn register<T: Component + Pod + Serialize>(&mut self, name: &str) -> &mut Self {
+        assert!(
+            !self.by_name.contains_key(name),
+            "component name `{}` is already registered",
+            name
+        );
+        let type_id = ComponentTypeId::of::<T>();
+        assert!(
+            !self.by_type.contains_key(&type_id),
+            "component type {} is already registered",
+            std::any::type_name::<T>()
+        );
+
+        let index = self.registrations.len();
+        self.registrations.push(TypeRegistration {
+            name: name.to_owned(),
+            size: std::mem::size_of::<T>(),
+            align: std::mem::align_of::<T>(),
+            type_id,
+            register_layout: register_layout::<T>,
+            extend_column: extend_column::<T>,
+            append_bytes: append_bytes::<T>,
+            to_ron: to_ron::<T>,
+        });
+        self.by_name.insert(name.to_owned(), index);
+        self.by_type.insert(type_id, index);
+        self
+    }
+
+    pub fn get(&self, index: usize) -> &TypeRegistration {
+        &self.registrations[index]
+    }
+
+    pub fn index_of_name(&self, name: &str) -> Option<usize> {
+        self.by_name.get(name).copied()
+    }
+
+    pub fn index_of_type(&self, type_id: &ComponentTypeId) -> Option<usize> {
+        self.by_type.get(type_id).copied()
+    }
+
+    pub fn len(&self) -> usize {
+        self.registrations.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.registrations.is_empty()
+    }
+}
+
+fn register_layout<T: Component>(layout: &mut EntityLayout) {
+    layout.register_component::<T>();
+}
+
+unsafe fn extend_column<T: Component>(writer: &mut ArchetypeWriter, data: *const u8, count: usize) {
+    writer
+        .claim_components::<T>()
+        .extend_memcopy(data as *const T, count);
+}
+
+fn append_bytes<T: Component + Pod>(entry: &EntryRef, out: &mut Vec<u8>) -> bool {
+    match entry.get_component::<T>() {
+        Ok(component) => {
+            out.extend_from_slice(bytemuck::bytes_of(component));
+            true
+        }
+        Err(_) => false,
+    }
+}
+
+fn to_ron<T: Pod + Serialize>(bytes: &[u8]) -> ron::Result<String> {
+    // Blobs are only guaranteed to be aligned when they come straight from a column
+    let value: T = bytemuck::pod_read_unaligned(bytes);
+    ron::to_string(&value)
+}
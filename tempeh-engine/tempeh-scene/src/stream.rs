@@ -0,0 +1,199 @@
+use std::collections::{HashMap, HashSet, VecDeque};
+use std::path::PathBuf;
+use std::sync::mpsc::{channel, Receiver, Sender, TryRecvError};
+use std::sync::Mutex;
+use std::thread::JoinHandle;
+use std::time::{Duration, Instant};
+
+use tempeh_ecs::{any, Entity, World};
+
+use crate::error::SceneError;
+use crate::reader::SceneFile;
+use crate::registry::TypeRegistry;
+
+pub type RegionId = u32;
+
+struct LoadRequest {
+    region: RegionId,
+    path: PathBuf,
+}
+
+struct LoadedSection {
+    region: RegionId,
+    result: Result<(World, Vec<Entity>), SceneError>,
+}
+
+#[derive(Debug, Default, Clone, Copy)]
+pub struct StreamingStats {
+    pub resident_regions: usize,
+    pub loading_regions: usize,
+    pub pending_merges: usize,
+    pub pending_removals: usize,
+    pub merged_last_frame: usize,
+    pub removed_last_frame: usize,
+    pub last_frame_time: Duration,
+}
+
+/// Loads scene sections on a background thread and merges them into the main world at the end of
+/// a frame, within a time budget.
+///
+/// Each section is deserialized into its own `World`, so the only work left on the main thread is
+/// `World::move_from`, which moves whole archetypes at once. Merges and region unloads are spread
+/// over several frames when they do not fit into the budget; at least one section is merged per
+/// frame so streaming always makes progress.
+pub struct LevelStreamer {
+    requests: Sender<LoadRequest>,
+    loaded: Mutex<Receiver<LoadedSection>>,
+    pending_merges: VecDeque<LoadedSection>,
+    pending_removals: VecDeque<Entity>,
+    loading: HashSet<RegionId>,
+    cancelled: HashSet<RegionId>,
+    resident: HashMap<RegionId, Vec<Entity>>,
+    budget: Duration,
+    stats: StreamingStats,
+    _worker: JoinHandle<()>,
+}
+
+impl LevelStreamer {
+    pub fn new(registry: TypeRegistry, budget: Duration) -> Self {
+        let (requests, request_receiver) = channel::<LoadRequest>();
+        let (loaded_sender, loaded) = channel();
+        let worker = std::thread::Builder::new()
+            .name("tempeh-level-streamer".to_owned())
+            .spawn(move || {
+                for request in request_receiver {
+                    let result = SceneFile::open(&request.path).and_then(|scene| {
+                        let mut world = World::default();
+                        let entities = scene.load_into(&mut world, &registry)?;
+                        Ok((world, entities))
+                    });
+                    let section = LoadedSection {
+                        region: request.region,
+                        result,
+                    };
+                    if loaded_sender.send(section).is_err() {
+                        break;
+                    }
+                }
+            })
+            .expect("Unable to spawn level streaming thread");
+
+        Self {
+            requests,
+            loaded: Mutex::new(loaded),
+            pending_merges: VecDeque::new(),
+            pending_removals: VecDeque::new(),
+            loading: HashSet::new(),
+            cancelled: HashSet::new(),
+            resident: HashMap::new(),
+            budget,
+            stats: StreamingStats::default(),
+            _worker: worker,
+        }
+    }
+
+    pub fn set_budget(&mut self, budget: Duration) {
+        self.budget = budget;
+    }
+
+    /// Queues `path` to be streamed in as `region`. Does nothing if the region is already resident
+    /// or loading.
+    pub fn load<P: Into<PathBuf>>(&mut self, region: RegionId, path: P) {
+        if self.resident.contains_key(&region) {
+            return;
+        }
+        // Loading a region again before its cancelled load arrived revives that load
+        if self.cancelled.remove(&region) || !self.loading.insert(region) {
+            return;
+        }
+        self.requests
+            .send(LoadRequest {
+                region,
+                path: path.into(),
+            })
+            .expect("Level streaming thread has stopped");
+    }
+
+    /// Removes every entity that was streamed in as `region`. A region that is still loading is
+    /// dropped as soon as it arrives instead of being merged.
+    pub fn unload(&mut self, region: RegionId) {
+        if let Some(entities) = self.resident.remove(&region) {
+            self.pending_removals.extend(entities);
+        } else if self.loading.contains(&region) {
+            self.cancelled.insert(region);
+        }
+    }
+
+    pub fn is_resident(&self, region: RegionId) -> bool {
+        self.resident.contains_key(&region)
+    }
+
+    pub fn region_entities(&self, region: RegionId) -> Option<&[Entity]> {
+        self.resident.get(&region).map(Vec::as_slice)
+    }
+
+    pub fn stats(&self) -> StreamingStats {
+        self.stats
+    }
+
+    /// Merges finished sections and performs pending removals. Must be called at a frame boundary,
+    /// see `LevelStreamingPlugin`.
+    pub fn update(&mut self, world: &mut World) {
+        let start = Instant::now();
+        {
+            let loaded = self.loaded.lock().unwrap();
+            loop {
+                match loaded.try_recv() {
+                    Ok(section) => self.pending_merges.push_back(section),
+                    Err(TryRecvError::Empty) => break,
+                    Err(TryRecvError::Disconnected) => {
+                        log::error!("Level streaming thread has stopped");
+                        break;
+                    }
+                }
+            }
+        }
+
+        let mut merged = 0;
+        while let Some(section) = self.pending_merges.pop_front() {
+            self.loading.remove(&section.region);
+            if self.cancelled.remove(&section.region) {
+                continue;
+            }
+            match section.result {
+                Ok((mut section_world, entities)) => {
+                    world.move_from(&mut section_world, &any());
+                    self.resident.insert(section.region, entities);
+                    merged += 1;
+                }
+                Err(error) => log::error!("Failed to stream region {}: {}", section.region, error),
+            }
+            if start.elapsed() >= self.budget {
+                break;
+            }
+        }
+
+        let mut removed = 0;
+        while start.elapsed() < self.budget {
+            // Check the clock every few removals instead of every single one
+            let batch = self.pending_removals.len().min(64);
+            if batch == 0 {
+                break;
+            }
+            for entity in self.pending_removals.drain(..batch) {
+                world.remove(entity);
+            }
+            removed += batch;
+        }
+
+        self.stats = StreamingStats {
+            resident_regions: self.resident.len(),
+            loading_regions: self.loading.len(),
+            pending_merges: self.pending_merges.len(),
+            pending_removals: self.pending_removals.len(),
+            merged_last_frame: merged,
+            removed_last_frame: removed,
+            last_frame_time: start.elapsed(),
+        };
+    }
+}
@@ -0,0 +1,161 @@
+use std::collections::BTreeMap;
+use std::fs::File;
+use std::io::{BufWriter, Write};
+use std::path::Path;
+
+use tempeh_ecs::{Entity, IntoQuery, World};
+
+use crate::error::SceneError;
+use crate::format::{
+    align_up, ArchetypeRecord, ColumnRecord, Header, TypeRecord, BLOB_ALIGN, ENDIAN_TAG, MAGIC,
+    VERSION,
+};
+use crate::registry::TypeRegistry;
+
+/// Serializes every registered component in `world` into the binary scene format.
+///
+/// Entities are grouped by the set of registered components they carry, which mirrors legion's
+/// archetypes minus any runtime-only components (GPU handles and the like). Components that are
+/// not in `registry` are skipped and entities without any registered component are not written.
+pub fn save_world<W: Write>(
+    world: &World,
+    registry: &TypeRegistry,
+    out: W,
+) -> Result<(), SceneError> {
+    // BTreeMap keeps archetypes in a deterministic order so re-saving an unchanged world produces
+    // an identical file
+    let mut archetypes = BTreeMap::<Vec<usize>, Vec<Entity>>::new();
+    let mut query = <Entity>::query();
+    for entity in query.iter(world) {
+        let entry = world
+            .entry_ref(*entity)
+            .expect("Queried entity is not in the world");
+        let mut key = entry
+            .archetype()
+            .layout()
+            .component_types()
+            .iter()
+            .filter_map(|type_id| registry.index_of_type(type_id))
+            .collect::<Vec<_>>();
+        if key.is_empty() {
+            continue;
+        }
+        key.sort_unstable();
+        archetypes.entry(key).or_default().push(*entity);
+    }
+
+    let used_types = {
+        let mut used_types = archetypes.keys().flatten().copied().collect::<Vec<_>>();
+        used_types.sort_unstable();
+        used_types.dedup();
+        used_types
+    };
+    let mut type_records = Vec::with_capacity(used_types.len());
+    let mut strings = Vec::new();
+    for index in &used_types {
+        let registration = registry.get(*index);
+        type_records.push(TypeRecord {
+            name_offset: strings.len() as u64,
+            name_len: registration.name.len() as u32,
+            size: registration.size as u32,
+            align: registration.align as u32,
+            _reserved: 0,
+        });
+        strings.extend_from_slice(registration.name.as_bytes());
+    }
+
+    let column_count = archetypes.keys().map(Vec::len).sum::<usize>();
+    let header_size = std::mem::size_of::<Header>();
+    let types_offset = header_size;
+    let archetypes_offset = types_offset + type_records.len() * std::mem::size_of::<TypeRecord>();
+    let columns_offset =
+        archetypes_offset + archetypes.len() * std::mem::size_of::<ArchetypeRecord>();
+    let strings_offset = columns_offset + column_count * std::mem::size_of::<ColumnRecord>();
+    let mut blob_offset = align_up(strings_offset + strings.len(), BLOB_ALIGN);
+
+    let mut archetype_records = Vec::with_capacity(archetypes.len());
+    let mut column_records = Vec::with_capacity(column_count);
+    let mut blobs = Vec::with_capacity(column_count);
+    for (key, entities) in &archetypes {
+        archetype_records.push(ArchetypeRecord {
+            entity_count: entities.len() as u64,
+            first_column: column_records.len() as u32,
+            column_count: key.len() as u32,
+        });
+        for index in key {
+            let registration = registry.get(*index);
+            let mut blob = Vec::with_capacity(registration.size * entities.len());
+            for entity in entities {
+                let entry = world.entry_ref(*entity).unwrap();
+                let written = (registration.append_bytes)(&entry, &mut blob);
+                debug_assert!(written, "Archetype key out of sync with entity components");
+            }
+            column_records.push(ColumnRecord {
+                type_index: used_types.binary_search(index).unwrap() as u32,
+                _reserved: 0,
+                offset: blob_offset as u64,
+                len: blob.len() as u64,
+            });
+            blob_offset = align_up(blob_offset + blob.len(), BLOB_ALIGN);
+            blobs.push(blob);
+        }
+    }
+
+    let header = Header {
+        magic: MAGIC,
+        version: VERSION,
+        endian: ENDIAN_TAG,
+        type_count: type_records.len() as u32,
+        archetype_count: archetype_records.len() as u32,
+        column_count: column_records.len() as u32,
+        types_offset: types_offset as u64,
+        archetypes_offset: archetypes_offset as u64,
+        columns_offset: columns_offset as u64,
+        strings_offset: strings_offset as u64,
+        strings_len: strings.len() as u64,
+    };
+
+    let mut out = CountingWriter {
+        inner: out,
+        written: 0,
+    };
+    out.write_all(bytemuck::bytes_of(&header))?;
+    out.write_all(bytemuck::cast_slice(&type_records))?;
+    out.write_all(bytemuck::cast_slice(&archetype_records))?;
+    out.write_all(bytemuck::cast_slice(&column_records))?;
+    out.write_all(&strings)?;
+    for (record, blob) in column_records.iter().zip(&blobs) {
+        out.pad_to(record.offset as usize)?;
+        out.write_all(blob)?;
+    }
+    out.inner.flush()?;
+    Ok(())
+}
+
+pub fn save_world_to_file<P: AsRef<Path>>(
+    world: &World,
+    registry: &TypeRegistry,
+    path: P,
+) -> Result<(), SceneError> {
+    save_world(world, registry, BufWriter::new(File::create(path)?))
+}
+
+struct CountingWriter<W: Write> {
+    inner: W,
+    written: usize,
+}
+
+impl<W: Write> CountingWriter<W> {
+    fn write_all(&mut self, bytes: &[u8]) -> std::io::Result<()> {
+        self.inner.write_all(bytes)?;
+        self.written += bytes.len();
+        Ok(())
+    }
+
+    fn pad_to(&mut self, offset: usize) -> std::io::Result<()> {
+        const ZEROES: [u8; BLOB_ALIGN] = [0; BLOB_ALIGN];
+        debug_assert!(offset >= self.written && offset - self.written < BLOB_ALIGN);
+        let padding = offset - self.written;
+        self.write_all(&ZEROES[..padding])
+    }
+}
@@ -0,0 +1,33 @@
+use tempeh_mono::object::GcHandle;
+
+/// Instance of a C# script class attached to an entity. The instance is created the first frame
+/// the entity is updated, and its `void Update(float deltaTime)` is called every frame after.
+pub struct Script {
+    /// `Namespace.Name` of the class, which needs a parameterless constructor
+    pub class: String,
+    pub(crate) state: ScriptState,
+}
+
+pub(crate) enum ScriptState {
+    Unresolved,
+    Running {
+        /// Index in `ScriptRuntime::classes`
+        class: usize,
+        instance: GcHandle,
+    },
+    /// The class is missing or threw, logged once
+    Failed,
+}
+
+impl Script {
+    pub fn new(class: &str) -> Self {
+        Self {
+            class: class.to_owned(),
+            state: ScriptState::Unresolved,
+        }
+    }
+
+    pub fn is_running(&self) -> bool {
+        matches!(self.state, ScriptState::Running { .. })
+    }
+}
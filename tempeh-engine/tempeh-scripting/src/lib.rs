@@ -0,0 +1,14 @@
+//! C# gameplay scripts for tempeh apps, run by the Mono runtime.
+//!
+//! Script classes are resolved lazily, the first time a `Script` names them, and cached from then
+//! on. Their `Update` method is called every frame through an unmanaged thunk: a native call into
+//! the compiled method, without the reflection, argument array and boxing of `mono_runtime_invoke`.
+
+pub mod component;
+pub mod plugins;
+pub mod runtime;
+
+pub mod prelude {
+    pub use crate::component::Script;
+    pub use crate::plugins::ScriptingPlugin;
+}
@@ -0,0 +1,54 @@
+use std::time::Duration;
+
+use tempeh_core::plugins::Plugin;
+use tempeh_core::AppBuilder;
+use tempeh_ecs::{IntoQuery, Resources, World};
+use tempeh_filesystem::Vfs;
+
+use crate::component::Script;
+use crate::runtime::ScriptRuntime;
+
+pub struct ScriptingPlugin {
+    /// Name of the Mono root domain
+    pub domain_name: String,
+    /// Asset paths of the gameplay assemblies, they have to be loose files
+    pub assemblies: Vec<String>,
+}
+
+impl Default for ScriptingPlugin {
+    fn default() -> Self {
+        Self {
+            domain_name: "tempeh".to_owned(),
+            assemblies: vec![],
+        }
+    }
+}
+
+impl<W: tempeh_window::Runner> Plugin<W> for ScriptingPlugin {
+    fn inject(&self, app: &mut AppBuilder<W>) {
+        let domain_name = self.domain_name.clone();
+        let assemblies = self.assemblies.clone();
+        let mut runtime: Option<ScriptRuntime> = None;
+        // After the update systems, so scripts see this frame's gameplay state, and before
+        // transform propagation, so what they move is drawn this frame
+        app.add_update_end_fn(move |world: &mut World, resources: &mut Resources| {
+            let runtime = runtime.get_or_insert_with(|| {
+                let mut runtime = ScriptRuntime::new(&domain_name);
+                let vfs = resources.get::<Vfs>();
+                for assembly in &assemblies {
+                    match vfs.as_ref().and_then(|vfs| vfs.file_path(assembly)) {
+                        Some(path) => runtime.load_assembly(&path),
+                        None => log::error!("Assembly `{}` is not a loose file", assembly),
+                    }
+                }
+                runtime
+            });
+            let delta_time = resources
+                .get::<Duration>()
+                .map_or(0.0, |delta_time| delta_time.as_secs_f32());
+            for script in <&mut Script>::query().iter_mut(world) {
+                runtime.update(script, delta_time);
+            }
+        });
+    }
+}
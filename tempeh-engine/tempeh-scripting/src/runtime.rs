@@ -0,0 +1,201 @@
+use std::collections::HashMap;
+use std::path::Path;
+
+use tempeh_mono::assembly::Assembly;
+use tempeh_mono::class::Class;
+use tempeh_mono::jit::JIT;
+use tempeh_mono::method::Method;
+use tempeh_mono::object::{Exception, GcHandle};
+use tempeh_mono::sys::{
+    MonoException, MonoObject, MonoTypeEnum_MONO_TYPE_R4, MonoTypeEnum_MONO_TYPE_VOID,
+};
+
+use crate::component::{Script, ScriptState};
+
+/// `void Update(float deltaTime)` of a script instance, see `Method::unmanaged_thunk`.
+type UpdateThunk = unsafe extern "system" fn(*mut MonoObject, f32, *mut *mut MonoException);
+
+struct ScriptClass {
+    class: Class,
+    update: Option<UpdateThunk>,
+}
+
+/// Gameplay assemblies loaded in the Mono runtime.
+///
+/// Mono only runs managed code on threads attached to it, so the runtime is not a resource
+/// systems could reach from the worker threads; the scripting plugin owns it and updates scripts
+/// on the main thread.
+pub struct ScriptRuntime {
+    /// Classes named by scripts, each resolved once; `None` when missing or unusable
+    class_indices: HashMap<String, Option<usize>>,
+    classes: Vec<ScriptClass>,
+    // Closed before the domain is cleaned up
+    assemblies: Vec<Assembly<'static>>,
+    jit: JIT<'static>,
+}
+
+impl ScriptRuntime {
+    pub fn new(domain_name: &str) -> Self {
+        Self {
+            class_indices: HashMap::new(),
+            classes: Vec::new(),
+            assemblies: Vec::new(),
+            jit: JIT::new(domain_name),
+        }
+    }
+
+    /// Loads an assembly. Its classes are resolved when a `Script` first names them.
+    pub fn load_assembly(&mut self, path: &Path) {
+        let assembly = self.jit.assembly_open(path);
+        self.assemblies.push(assembly);
+    }
+
+    pub fn attach_current_thread(&self) {
+        self.jit.attach_current_thread();
+    }
+
+    pub(crate) fn update(&mut self, script: &mut Script, delta_time: f32) {
+        if let ScriptState::Unresolved = script.state {
+            script.state = self.instantiate(&script.class);
+        }
+        let (class, instance) = match &script.state {
+            ScriptState::Running { class, instance } => (*class, instance),
+            _ => return,
+        };
+        let update = match self.classes[class].update {
+            Some(update) => update,
+            None => return,
+        };
+        let mut exception = std::ptr::null_mut();
+        unsafe { update(instance.target(), delta_time, &mut exception) };
+        if let Err(exception) = Exception::check(exception as *mut MonoObject) {
+            log::error!(
+                "{}.Update threw, the script is stopped: {}",
+                script.class,
+                exception
+            );
+            script.state = ScriptState::Failed;
+        }
+    }
+
+    fn instantiate(&mut self, name: &str) -> ScriptState {
+        let class = match self.resolve(name) {
+            Some(class) => class,
+            None => return ScriptState::Failed,
+        };
+        match self.classes[class].class.new_object(&self.jit) {
+            Ok(object) => ScriptState::Running {
+                class,
+                instance: GcHandle::new(object),
+            },
+            Err(exception) => {
+                log::error!("Unable to create script `{}`: {}", name, exception);
+                ScriptState::Failed
+            }
+        }
+    }
+
+    /// Finds the class named `Namespace.Name` and takes the thunks of its entry points, once per
+    /// class whatever the number of scripts using it.
+    fn resolve(&mut self, name: &str) -> Option<usize> {
+        if let Some(class) = self.class_indices.get(name) {
+            return *class;
+        }
+        let class = self.find_class(name).and_then(|class| {
+            let update = match class.method("Update", 1) {
+                Some(method) => Some(update_thunk(name, method)?),
+                None => None,
+            };
+            self.classes.push(ScriptClass { class, update });
+            Some(self.classes.len() - 1)
+        });
+        self.class_indices.insert(name.to_owned(), class);
+        class
+    }
+
+    fn find_class(&self, name: &str) -> Option<Class> {
+        let (namespace, class_name) = match name.rfind('.') {
+            Some(dot) => (&name[..dot], &name[dot + 1..]),
+            None => ("", name),
+        };
+        let class = self
+            .assemblies
+            .iter()
+            .find_map(|assembly| assembly.class_from_name(namespace, class_name));
+        if class.is_none() {
+            log::error!("Script class `{}` is not in any loaded assembly", name);
+        }
+        class
+    }
+}
+
+/// The thunk of `Update`, if it is `void Update(float)` on the instance: calling a thunk through
+/// any other function type is undefined behaviour.
+fn update_thunk(class: &str, method: Method) -> Option<UpdateThunk> {
+    let matches = method.signature().map_or(false, |signature| {
+        signature.is_instance
+            && signature.return_type == MonoTypeEnum_MONO_TYPE_VOID
+            && signature.params == [MonoTypeEnum_MONO_TYPE_R4]
+    });
+    if !matches {
+        log::warn!(
+            "{}.Update is not `void Update(float)` on the instance, the class is skipped",
+            class
+        );
+        return None;
+    }
+    let thunk = unsafe { method.unmanaged_thunk() };
+    if thunk.is_null() {
+        log::warn!("No thunk for {}.Update, the class is skipped", class);
+        return None;
+    }
+    // Safety: the signature was checked above
+    Some(unsafe { std::mem::transmute::<_, UpdateThunk>(thunk) })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn updates_scripts_with_a_checked_signature() {
+        let fixture = Path::new(env!("CARGO_MANIFEST_DIR"))
+            .join("../../tempeh-lib/tempeh-mono/test/fixtures/spinner/spinner.dll");
+        if !fixture.exists() {
+            eprintln!(
+                "{} is missing, see tempeh-mono's test/fixtures/README.md",
+                fixture.display()
+            );
+            return;
+        }
+        // Mono can only be initialized once per process, so everything is checked in one test
+        let mut runtime = ScriptRuntime::new("scripting-test");
+        runtime.load_assembly(&fixture);
+
+        let mut spinner = Script::new("Spinner");
+        let mut delta_check = Script::new("DeltaCheck");
+        let mut double_update = Script::new("DoubleUpdate");
+        let mut static_update = Script::new("StaticUpdate");
+        let mut missing = Script::new("Missing");
+        for _ in 0..3 {
+            for script in [
+                &mut spinner,
+                &mut delta_check,
+                &mut double_update,
+                &mut static_update,
+                &mut missing,
+            ]
+            .iter_mut()
+            {
+                runtime.update(script, 0.5);
+            }
+        }
+        assert!(spinner.is_running());
+        // Throws unless the float made it through the thunk
+        assert!(delta_check.is_running());
+        assert!(!double_update.is_running());
+        assert!(!static_update.is_running());
+        assert!(!missing.is_running());
+        assert_eq!(runtime.classes.len(), 2);
+    }
+}
@@ -0,0 +1,158 @@
+pub mod stats;
+
+use std::fs::File;
+use std::io::{self, BufReader};
+use std::path::Path;
+use std::time::{Duration, Instant};
+
+use tempeh_engine::Engine;
+use tempeh_window::input::event::InputEvent;
+use tempeh_window::input::record::InputReplay;
+use tempeh_window::input::InputManager;
+use tempeh_window::Runner;
+
+use crate::stats::TickHistogram;
+
+/// How far behind schedule a paced run may fall before it stops trying to catch up.
+const MAX_PACING_LAG: u32 = 4;
+
+/// Runs the engine without a window or surface, for dedicated servers and benchmarks.
+///
+/// Every tick advances the simulated clock by `tick_duration`, which is also inserted as the
+/// frame's `Duration` resource. By default ticks are paced to the wall clock like a server would;
+/// `unlimited` runs them back to back for benchmarking. The run stops at whichever comes first of
+/// `max_ticks`, the wall-clock `budget` and the end of the replayed recording, and prints tick-time
+/// percentiles on exit. Without any of those it runs until the process is killed.
+///
+/// Recorded input is applied on the simulated clock: each tick gets the events that happened
+/// before its end, so two runs of the same recording feed identical input to the same ticks
+/// regardless of how long each tick took.
+pub struct HeadlessRunner {
+    tick_duration: Duration,
+    paced: bool,
+    max_ticks: Option<u64>,
+    budget: Option<Duration>,
+    replay: Option<Vec<InputEvent>>,
+}
+
+impl HeadlessRunner {
+    pub fn new() -> Self {
+        Self {
+            tick_duration: Duration::from_secs(1) / 60,
+            paced: true,
+            max_ticks: None,
+            budget: None,
+            replay: None,
+        }
+    }
+
+    pub fn with_tick_rate(mut self, ticks_per_second: u32) -> Self {
+        self.tick_duration = Duration::from_secs(1) / ticks_per_second.max(1);
+        self
+    }
+
+    /// Runs ticks as fast as possible instead of pacing them to the tick rate.
+    pub fn unlimited(mut self) -> Self {
+        self.paced = false;
+        self
+    }
+
+    pub fn with_max_ticks(mut self, max_ticks: u64) -> Self {
+        self.max_ticks = Some(max_ticks);
+        self
+    }
+
+    /// Stops once this much wall-clock time has passed.
+    pub fn with_budget(mut self, budget: Duration) -> Self {
+        self.budget = Some(budget);
+        self
+    }
+
+    /// Replays an input recording written by `tempeh_window::input::record::InputRecorder`. The
+    /// run ends one tick after the last event.
+    pub fn with_replay<P: AsRef<Path>>(self, path: P) -> io::Result<Self> {
+        let events = InputReplay::new(BufReader::new(File::open(path)?))?.read_all()?;
+        Ok(self.with_replay_events(events))
+    }
+
+    pub fn with_replay_events(mut self, events: Vec<InputEvent>) -> Self {
+        self.replay = Some(events);
+        self
+    }
+
+    fn is_finished(&self, ticks: u64, simulated: Duration, start: Instant) -> bool {
+        let replay_finished = self.replay.as_ref().map_or(false, |events| {
+            simulated > events.last().map_or(Duration::ZERO, |event| event.time)
+        });
+        replay_finished
+            || self.max_ticks.map_or(false, |max_ticks| ticks >= max_ticks)
+            || self
+                .budget
+                .map_or(false, |budget| start.elapsed() >= budget)
+    }
+}
+
+impl Default for HeadlessRunner {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Runner for HeadlessRunner {
+    fn run(self, mut engine: Engine) {
+        engine.resources.insert(InputManager::new());
+        let replay = self.replay.as_deref().unwrap_or(&[]);
+
+        let mut histogram = TickHistogram::default();
+        let mut next_event = 0;
+        let mut ticks = 0;
+        let mut simulated = Duration::ZERO;
+        let start = Instant::now();
+        let mut deadline = start;
+        while !self.is_finished(ticks, simulated, start) {
+            if self.paced {
+                deadline += self.tick_duration;
+                let now = Instant::now();
+                if now < deadline {
+                    std::thread::sleep(deadline - now);
+                } else if now - deadline > self.tick_duration * MAX_PACING_LAG {
+                    // Drop the missed ticks instead of running them back to back
+                    deadline = now;
+                }
+            }
+
+            simulated += self.tick_duration;
+            let tick_start = Instant::now();
+            {
+                let mut input_manager = engine.resources.get_mut::<InputManager>().unwrap();
+                while let Some(event) = replay.get(next_event) {
+                    if event.time > simulated {
+                        break;
+                    }
+                    input_manager.apply(event);
+                    next_event += 1;
+                }
+            }
+            engine.resources.insert(self.tick_duration);
+            engine
+                .schedule
+                .execute(&mut engine.world, &mut engine.resources);
+            engine
+                .resources
+                .get_mut::<InputManager>()
+                .unwrap()
+                .end_frame();
+            histogram.record(tick_start.elapsed());
+            ticks += 1;
+        }
+
+        println!(
+            "Headless run finished in {:?}: {}",
+            start.elapsed(),
+            histogram
+        );
+        if !replay.is_empty() {
+            println!("Replayed {} of {} input events", next_event, replay.len());
+        }
+    }
+}
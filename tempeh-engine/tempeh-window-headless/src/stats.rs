@@ -0,0 +1,131 @@
+use std::fmt;
+use std::time::Duration;
+
+const SUB_BUCKET_BITS: u32 = 5;
+const SUB_BUCKETS: usize = 1 << SUB_BUCKET_BITS;
+const BUCKETS: usize = (64 - SUB_BUCKET_BITS as usize + 1) * SUB_BUCKETS;
+
+/// Log-linear histogram of tick durations in nanoseconds. Every power of two is split into 32
+/// buckets, so reported percentiles are within about 3% of the real value, and memory use stays
+/// constant however long a server runs.
+pub struct TickHistogram {
+    counts: Box<[u64; BUCKETS]>,
+    count: u64,
+    total: Duration,
+    max: Duration,
+}
+
+impl Default for TickHistogram {
+    fn default() -> Self {
+        Self {
+            counts: Box::new([0; BUCKETS]),
+            count: 0,
+            total: Duration::ZERO,
+            max: Duration::ZERO,
+        }
+    }
+}
+
+fn bucket_of(nanos: u64) -> usize {
+    if nanos < SUB_BUCKETS as u64 {
+        return nanos as usize;
+    }
+    let exponent = 63 - nanos.leading_zeros();
+    let mantissa = (nanos >> (exponent - SUB_BUCKET_BITS)) as usize;
+    (exponent - SUB_BUCKET_BITS + 1) as usize * SUB_BUCKETS + mantissa - SUB_BUCKETS
+}
+
+/// Upper bound of the values falling into `bucket`.
+fn bucket_upper_bound(bucket: usize) -> u64 {
+    if bucket < SUB_BUCKETS {
+        return bucket as u64;
+    }
+    let exponent = (bucket / SUB_BUCKETS) as u32 + SUB_BUCKET_BITS - 1;
+    let mantissa = (bucket % SUB_BUCKETS + SUB_BUCKETS) as u64;
+    let shift = exponent - SUB_BUCKET_BITS;
+    (mantissa << shift) + ((1 << shift) - 1)
+}
+
+impl TickHistogram {
+    pub fn record(&mut self, duration: Duration) {
+        let nanos = duration.as_nanos().min(u64::MAX as u128) as u64;
+        self.counts[bucket_of(nanos)] += 1;
+        self.count += 1;
+        self.total += duration;
+        self.max = self.max.max(duration);
+    }
+
+    pub fn count(&self) -> u64 {
+        self.count
+    }
+
+    pub fn mean(&self) -> Duration {
+        if self.count == 0 {
+            return Duration::ZERO;
+        }
+        Duration::from_nanos((self.total.as_nanos() / self.count as u128) as u64)
+    }
+
+    pub fn max(&self) -> Duration {
+        self.max
+    }
+
+    /// Smallest recorded duration that `percentile` percent of the ticks did not exceed.
+    pub fn percentile(&self, percentile: f64) -> Duration {
+        if self.count == 0 {
+            return Duration::ZERO;
+        }
+        let rank = ((percentile / 100.0 * self.count as f64).ceil() as u64).clamp(1, self.count);
+        let mut seen = 0;
+        for (bucket, count) in self.counts.iter().enumerate() {
+            seen += count;
+            if seen >= rank {
+                return Duration::from_nanos(bucket_upper_bound(bucket)).min(self.max);
+            }
+        }
+        self.max
+    }
+}
+
+impl fmt::Display for TickHistogram {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(
+            f,
+            "{} ticks, mean {:?}, p50 {:?}, p90 {:?}, p99 {:?}, p99.9 {:?}, max {:?}",
+            self.count,
+            self.mean(),
+            self.percentile(50.0),
+            self.percentile(90.0),
+            self.percentile(99.0),
+            self.percentile(99.9),
+            self.max
+        )
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn buckets_are_contiguous() {
+        for nanos in (0..100_000).chain([u64::MAX / 3, u64::MAX]) {
+            let bucket = bucket_of(nanos);
+            assert!(nanos <= bucket_upper_bound(bucket));
+            assert!(bucket == 0 || nanos > bucket_upper_bound(bucket - 1));
+        }
+    }
+
+    #[test]
+    fn percentiles_are_close() {
+        let mut histogram = TickHistogram::default();
+        for micros in 1..=1000 {
+            histogram.record(Duration::from_micros(micros));
+        }
+        let p50 = histogram.percentile(50.0).as_secs_f64();
+        let p99 = histogram.percentile(99.0).as_secs_f64();
+        assert!((p50 / 500e-6 - 1.0).abs() < 0.035);
+        assert!((p99 / 990e-6 - 1.0).abs() < 0.035);
+        assert_eq!(histogram.percentile(100.0), Duration::from_micros(1000));
+    }
+}
@@ -1,32 +1,30 @@
-use tempeh_window::input::keyboard::KeyboardInput;
-use tempeh_window::input::mouse::MouseInput;
+use std::time::Duration;
+
+use tempeh_window::input::event::{InputEvent, InputEventKind};
 use tempeh_window::input::touch::TouchInput;
 use tempeh_window::input::{
     keyboard::VirtualKeyCode as VirtualKeyCodeTempeh, mouse::MouseButton as MouseButtonTempeh,
     touch::TouchPhase as TouchPhaseTempeh,
 };
-use tempeh_window::input::{InputManager, KeyState};
 use winit::event::VirtualKeyCode;
 use winit::event::{ElementState, MouseButton, TouchPhase, WindowEvent};
 
-
-pub struct InputProcessor {
-    pub input_manager: InputManager,
-}
+/// Translates winit events into timestamped `InputEvent`s.
+pub struct InputProcessor;
 
 impl InputProcessor {
     pub fn new() -> Self {
-        Self {
-            input_manager: InputManager::new(),
-        }
-    }
-
-    pub fn reset(&mut self) {
-        self.input_manager.reset();
+        Self
     }
 
-    pub fn handle_input(&mut self, event: &winit::event::WindowEvent) {
-        match event {
+    /// `time` is when the event was received. winit does not expose the OS timestamp, so events
+    /// have to be stamped as soon as they come out of the event loop.
+    pub fn translate(
+        &mut self,
+        event: &winit::event::WindowEvent,
+        time: Duration,
+    ) -> Option<InputEvent> {
+        let kind = match event {
             WindowEvent::KeyboardInput { input, .. } => {
                 let virtual_keycode =
                     input
@@ -201,28 +199,11 @@ impl InputProcessor {
                             VirtualKeyCode::Plus => VirtualKeyCodeTempeh::Plus,
                         });
 
-                let keypress_state = match input.state {
-                    ElementState::Pressed => KeyState::Pressed,
-                    ElementState::Released => KeyState::Released,
-                };
-                if virtual_keycode.is_some() {
-                    match keypress_state {
-                        KeyState::Pressed => self
-                            .input_manager
-                            .keyboard_key_presses
-                            .insert(virtual_keycode.as_ref().unwrap().clone()),
-                        KeyState::Released => self
-                            .input_manager
-                            .keyboard_key_presses
-                            .remove(virtual_keycode.as_ref().unwrap()),
-                    };
-                    self.input_manager.keyboard_presses.insert(KeyboardInput {
-                        state: keypress_state,
-                        scancode: input.scancode,
-                        virtual_keycode,
-                    });
-                }
                 log::info!("Keypress {:?}", input);
+                InputEventKind::Key {
+                    key: virtual_keycode?,
+                    pressed: input.state == ElementState::Pressed,
+                }
             }
             WindowEvent::MouseInput { button, state, .. } => {
                 let button = match button {
@@ -231,53 +212,30 @@ impl InputProcessor {
                     MouseButton::Middle => MouseButtonTempeh::Middle,
                     MouseButton::Other(x) => MouseButtonTempeh::Other(*x),
                 };
-                let press_state = match state {
-                    ElementState::Pressed => KeyState::Pressed,
-                    ElementState::Released => KeyState::Released,
-                };
-
-                match state {
-                    ElementState::Pressed => self.input_manager.mouse_button.insert(button.clone()),
-                    ElementState::Released => self.input_manager.mouse_button.remove(&button),
-                };
                 log::info!("Mouse input button {:?} state {:?}", button, state);
-                self.input_manager.mouse_presses.insert(MouseInput {
-                    state: press_state,
+                InputEventKind::Mouse {
                     button,
-                });
+                    pressed: *state == ElementState::Pressed,
+                }
             }
             WindowEvent::Touch(touch) => {
-                match touch.phase {
-                    TouchPhase::Started => {
-                        self.input_manager.touch_presses.insert(
-                            touch.id,
-                            tempeh_math::Point2::<f64>::new(touch.location.x, touch.location.y),
-                        );
-                    }
-                    TouchPhase::Ended | TouchPhase::Cancelled => {
-                        self.input_manager.touch_presses.remove(&touch.id);
-                    }
-                    _ => {}
-                };
-                self.input_manager.touches.insert(
-                    touch.id,
-                    TouchInput {
-                        id: touch.id,
-                        logical_position: tempeh_math::Point2::<f64>::new(
-                            touch.location.x,
-                            touch.location.y,
-                        ),
-                        phase: match touch.phase {
-                            TouchPhase::Started => TouchPhaseTempeh::Started,
-                            TouchPhase::Moved => TouchPhaseTempeh::Moved,
-                            TouchPhase::Ended => TouchPhaseTempeh::Ended,
-                            TouchPhase::Cancelled => TouchPhaseTempeh::Cancelled,
-                        },
-                    },
-                );
                 log::info!("Touch on {:?} {:?}", touch.location, touch.phase);
+                InputEventKind::Touch(TouchInput {
+                    id: touch.id,
+                    logical_position: tempeh_math::Point2::<f64>::new(
+                        touch.location.x,
+                        touch.location.y,
+                    ),
+                    phase: match touch.phase {
+                        TouchPhase::Started => TouchPhaseTempeh::Started,
+                        TouchPhase::Moved => TouchPhaseTempeh::Moved,
+                        TouchPhase::Ended => TouchPhaseTempeh::Ended,
+                        TouchPhase::Cancelled => TouchPhaseTempeh::Cancelled,
+                    },
+                })
             }
-            _ => {}
-        }
+            _ => return None,
+        };
+        Some(InputEvent { time, kind })
     }
 }
@@ -1,20 +1,32 @@
 mod event;
+pub mod pacing;
 
 use crate::event::InputProcessor;
+use crate::pacing::{FramePacer, FramePacing};
 use instant::{Instant};
 
 
 
 
-use std::io::{Read};
+use std::fs::File;
+use std::io::{self, BufWriter, Read};
+use std::path::Path;
 
 
 
 use tempeh_engine::Engine;
+use tempeh_ecs::Resources;
+use tempeh_renderer::frame::RenderFrame;
+#[cfg(not(target_arch = "wasm32"))]
+use tempeh_renderer::render_thread::RenderThread;
 use tempeh_renderer::renderer::Renderer;
 
 
 
+use tempeh_engine::ring::ring_buffer;
+use tempeh_window::input::event::INPUT_QUEUE_CAPACITY;
+use tempeh_window::input::record::InputRecorder;
+use tempeh_window::input::InputManager;
 use tempeh_window::{Runner, ScreenSize, TempehWindow};
 use wgpu::Color;
 use winit::dpi::PhysicalSize;
@@ -30,6 +42,9 @@ use winit::{
 pub struct WinitWindow {
     event_loop: Option<EventLoop<()>>,
     window: Window,
+    input_recorder: Option<InputRecorder<BufWriter<File>>>,
+    frame_pacing: FramePacing,
+    render_thread: bool,
 }
 
 impl WinitWindow {
@@ -56,8 +71,47 @@ impl WinitWindow {
         Self {
             window,
             event_loop: Some(event_loop),
+            input_recorder: None,
+            frame_pacing: FramePacing::default(),
+            render_thread: false,
         }
     }
+
+    /// Renders on a dedicated thread, overlapping the simulation of a frame with rendering the
+    /// previous one. Not available on the web, where this is ignored.
+    pub fn set_render_thread(&mut self, enabled: bool) {
+        self.render_thread = enabled && cfg!(not(target_arch = "wasm32"));
+    }
+
+    fn create_renderer(&self, resources: &mut Resources) {
+        let size = self.window.inner_size();
+        let renderer = Renderer::with_present_mode(
+            &self.window,
+            ScreenSize {
+                width: size.width,
+                height: size.height,
+            },
+            Color {
+                r: 0.8,
+                g: 0.8,
+                b: 0.8,
+                a: 1.0,
+            },
+            self.frame_pacing.present_mode,
+        );
+        resources.insert(renderer.device());
+        resources.insert(renderer);
+    }
+
+    pub fn set_frame_pacing(&mut self, frame_pacing: FramePacing) {
+        self.frame_pacing = frame_pacing;
+    }
+
+    /// Records every input event of the session into `path`, for replay with the headless runner.
+    pub fn record_input<P: AsRef<Path>>(&mut self, path: P) -> io::Result<()> {
+        self.input_recorder = Some(InputRecorder::new(BufWriter::new(File::create(path)?))?);
+        Ok(())
+    }
 }
 
 impl TempehWindow for WinitWindow {
@@ -85,41 +139,62 @@ impl Runner for WinitWindow {
     fn run(mut self, mut engine: Engine) {
         let mut size = self.window.inner_size();
         if cfg!(not(target_os = "android")) {
-            engine
-                .resources
-                .insert(tempeh_renderer::renderer::Renderer::new(
-                    &self.window,
-                    ScreenSize {
-                        width: size.width,
-                        height: size.height,
-                    },
-                    Color {
-                        r: 0.8,
-                        g: 0.8,
-                        b: 0.8,
-                        a: 1.0,
-                    },
-                ));
+            self.create_renderer(&mut engine.resources);
         }
 
         let mut input_processor = InputProcessor::new();
+        let (mut input_producer, mut input_consumer) = ring_buffer(INPUT_QUEUE_CAPACITY);
+        let input_epoch = Instant::now();
+        let mut frame_pacer = FramePacer::new(self.frame_pacing.limit);
+        engine.resources.insert(InputManager::new());
+        #[cfg(not(target_arch = "wasm32"))]
+        let mut render_thread: Option<RenderThread> = None;
+        let use_render_thread = self.render_thread;
         let mut time = Instant::now();
         #[cfg(target_os = "android")]
         let mut is_ready = false;
         self.event_loop.take().unwrap().run(
             move |event, _even_loop_window_target, control_flow| {
-                *control_flow = ControlFlow::Poll;
                 time = Instant::now();
 
                 let mut update = || {
                     engine
                         .resources
-                        .insert(input_processor.input_manager.clone());
+                        .get_mut::<InputManager>()
+                        .unwrap()
+                        .apply_until(&mut input_consumer, input_epoch.elapsed());
                     engine.resources.insert(time.elapsed());
                     engine
                         .schedule
                         .execute(&mut engine.world, &mut engine.resources);
-                    input_processor.reset();
+                    engine
+                        .resources
+                        .get_mut::<InputManager>()
+                        .unwrap()
+                        .end_frame();
+
+                    #[cfg(not(target_arch = "wasm32"))]
+                    if use_render_thread {
+                        // The renderer is created with the surface, which is late on Android and
+                        // again after every resume there
+                        if let Some(renderer) = engine.resources.remove::<Renderer>() {
+                            render_thread = Some(RenderThread::spawn(renderer));
+                        }
+                        if let (Some(render_thread), Some(mut frame)) = (
+                            render_thread.as_mut(),
+                            engine.resources.get_mut::<RenderFrame>(),
+                        ) {
+                            let next_frame = render_thread.submit(std::mem::take(&mut *frame));
+                            *frame = next_frame;
+                        }
+                        return;
+                    }
+                    if let (Some(mut renderer), Some(mut frame)) = (
+                        engine.resources.get_mut::<Renderer>(),
+                        engine.resources.get_mut::<RenderFrame>(),
+                    ) {
+                        renderer.render(&mut frame);
+                    }
                 };
 
                 match event {
@@ -130,45 +205,51 @@ impl Runner for WinitWindow {
                             log::warn!("STARTED");
                             is_ready = true;
                             size = self.window.inner_size();
-                            engine
-                                .resources
-                                .insert(tempeh_renderer::renderer::Renderer::new(
-                                    &self.window,
-                                    ScreenSize {
-                                        width: size.width,
-                                        height: size.height,
-                                    },
-                                    Color {
-                                        r: 0.8,
-                                        g: 0.8,
-                                        b: 0.8,
-                                        a: 1.0,
-                                    },
-                                ));
+                            self.create_renderer(&mut engine.resources);
                         }
                     }
                     Event::WindowEvent { event, window_id } if window_id == self.window.id() => {
+                        frame_pacer.request_redraw();
                         match event {
                             WindowEvent::CloseRequested => {
                                 *control_flow = ControlFlow::Exit;
                             }
-                            WindowEvent::Resized(size_) => {
-                                size = size_;
-                                if size.height != 0 && size.width != 0 {
-                                    engine
-                                        .resources
-                                        .get_mut::<Renderer>()
-                                        .unwrap()
-                                        .state
-                                        .resize(ScreenSize {
-                                            width: size.width,
-                                            height: size.height,
-                                        });
+                            WindowEvent::Resized(new_size)
+                            | WindowEvent::ScaleFactorChanged {
+                                new_inner_size: &mut new_size,
+                                ..
+                            } => {
+                                // Only recorded here, the surface is reconfigured once before the
+                                // next frame however many resize events arrive in between
+                                size = new_size;
+                                let new_size = ScreenSize {
+                                    width: size.width,
+                                    height: size.height,
+                                };
+                                if let Some(mut renderer) = engine.resources.get_mut::<Renderer>() {
+                                    renderer.state.resize(new_size);
+                                } else if let Some(mut frame) =
+                                    engine.resources.get_mut::<RenderFrame>()
+                                {
+                                    // The renderer lives on the render thread
+                                    frame.resize = Some(new_size);
                                 }
                             }
                             _ => {}
                         };
-                        input_processor.handle_input(&event);
+                        if let Some(input_event) =
+                            input_processor.translate(&event, input_epoch.elapsed())
+                        {
+                            if let Some(recorder) = &mut self.input_recorder {
+                                if let Err(error) = recorder.record(&input_event) {
+                                    log::error!("Unable to record input: {}", error);
+                                    self.input_recorder = None;
+                                }
+                            }
+                            if input_producer.push(input_event).is_err() {
+                                log::warn!("Input queue is full, dropping {:?}", input_event);
+                            }
+                        }
                     }
                     Event::RedrawRequested(_window_id) => {
                         update();
@@ -190,7 +271,17 @@ impl Runner for WinitWindow {
                         //     Err(SwapChainError::Timeout) => eprintln!("Swapchain timeout"),
                         // }
                     }
+                    Event::LoopDestroyed => {
+                        if let Some(recorder) = self.input_recorder.take() {
+                            if let Err(error) = recorder.finish() {
+                                log::error!("Unable to finish input recording: {}", error);
+                            }
+                        }
+                    }
                     Event::MainEventsCleared => {
+                        if *control_flow == ControlFlow::Exit || !frame_pacer.poll(control_flow) {
+                            return;
+                        }
                         #[cfg(not(target_os = "android"))]
                         self.window.request_redraw();
                         #[cfg(target_os = "android")]
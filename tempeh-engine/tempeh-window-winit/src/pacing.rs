@@ -0,0 +1,98 @@
+use instant::{Duration, Instant};
+use winit::event_loop::ControlFlow;
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum FrameLimit {
+    /// Redraw continuously, as fast as the present mode allows.
+    Unlimited,
+    /// Redraw continuously, but at most this many times per second.
+    Fps(u32),
+    /// Only redraw after a window or input event, for editor-like apps that are idle most of the
+    /// time.
+    OnEvent,
+}
+
+#[derive(Debug, Clone, Copy)]
+pub struct FramePacing {
+    /// Requested present mode, the renderer falls back to a supported one if needed.
+    pub present_mode: wgpu::PresentMode,
+    pub limit: FrameLimit,
+}
+
+impl Default for FramePacing {
+    fn default() -> Self {
+        Self {
+            present_mode: wgpu::PresentMode::Fifo,
+            limit: FrameLimit::Unlimited,
+        }
+    }
+}
+
+/// OS sleeps overshoot by up to a scheduler quantum, so the event loop wakes up this long before a
+/// frame is due and spins for the rest. Browsers do not allow blocking, so there it just sleeps.
+#[cfg(not(target_arch = "wasm32"))]
+const SPIN_THRESHOLD: Duration = Duration::from_micros(1500);
+#[cfg(target_arch = "wasm32")]
+const SPIN_THRESHOLD: Duration = Duration::from_micros(0);
+
+/// Decides when the event loop renders a frame and how it waits in between.
+pub struct FramePacer {
+    limit: FrameLimit,
+    next_frame: Instant,
+    redraw_pending: bool,
+}
+
+impl FramePacer {
+    pub fn new(limit: FrameLimit) -> Self {
+        Self {
+            limit,
+            next_frame: Instant::now(),
+            redraw_pending: true,
+        }
+    }
+
+    /// Makes the next `poll` render a frame in `FrameLimit::OnEvent` mode.
+    pub fn request_redraw(&mut self) {
+        self.redraw_pending = true;
+    }
+
+    /// Called once the event queue has been drained. Sets how the event loop waits for the next
+    /// frame and returns whether a frame should be rendered now.
+    pub fn poll(&mut self, control_flow: &mut ControlFlow) -> bool {
+        match self.limit {
+            FrameLimit::Unlimited => {
+                *control_flow = ControlFlow::Poll;
+                true
+            }
+            FrameLimit::OnEvent => {
+                *control_flow = ControlFlow::Wait;
+                std::mem::take(&mut self.redraw_pending)
+            }
+            FrameLimit::Fps(fps) => {
+                let interval = Duration::from_secs(1) / fps.max(1);
+                if Instant::now() + SPIN_THRESHOLD < self.next_frame {
+                    *control_flow = ControlFlow::WaitUntil(self.wake_time());
+                    return false;
+                }
+                while Instant::now() < self.next_frame {
+                    std::hint::spin_loop();
+                }
+
+                let now = Instant::now();
+                self.next_frame += interval;
+                if self.next_frame < now {
+                    // Too far behind to catch up, skip the missed frames instead of bursting
+                    self.next_frame = now + interval;
+                }
+                *control_flow = ControlFlow::WaitUntil(self.wake_time());
+                true
+            }
+        }
+    }
+
+    fn wake_time(&self) -> Instant {
+        self.next_frame
+            .checked_sub(SPIN_THRESHOLD)
+            .unwrap_or(self.next_frame)
+    }
+}
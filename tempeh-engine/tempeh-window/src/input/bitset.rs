@@ -0,0 +1,85 @@
+/// Fixed-size set of small integers, stored inline.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct BitSet<const WORDS: usize>([u64; WORDS]);
+
+impl<const WORDS: usize> Default for BitSet<WORDS> {
+    fn default() -> Self {
+        Self([0; WORDS])
+    }
+}
+
+impl<const WORDS: usize> BitSet<WORDS> {
+    pub const CAPACITY: usize = WORDS * 64;
+
+    pub fn insert(&mut self, index: usize) {
+        self.0[index / 64] |= 1 << (index % 64);
+    }
+
+    pub fn remove(&mut self, index: usize) {
+        self.0[index / 64] &= !(1 << (index % 64));
+    }
+
+    pub fn contains(&self, index: usize) -> bool {
+        self.0[index / 64] & (1 << (index % 64)) != 0
+    }
+
+    pub fn clear(&mut self) {
+        self.0 = [0; WORDS];
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.0.iter().all(|word| *word == 0)
+    }
+
+    pub fn len(&self) -> usize {
+        self.0.iter().map(|word| word.count_ones() as usize).sum()
+    }
+
+    /// Elements of `self` that are not in `other`.
+    pub fn difference(&self, other: &Self) -> Self {
+        let mut result = *self;
+        for (word, other) in result.0.iter_mut().zip(&other.0) {
+            *word &= !other;
+        }
+        result
+    }
+
+    /// Set elements in increasing order.
+    pub fn iter(&self) -> impl Iterator<Item = usize> + '_ {
+        self.0.iter().enumerate().flat_map(|(word_index, word)| {
+            let mut word = *word;
+            std::iter::from_fn(move || {
+                if word == 0 {
+                    return None;
+                }
+                let bit = word.trailing_zeros() as usize;
+                word &= word - 1;
+                Some(word_index * 64 + bit)
+            })
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn insert_remove_iter() {
+        let mut set = BitSet::<3>::default();
+        for index in [0, 63, 64, 130, 191] {
+            set.insert(index);
+        }
+        set.remove(63);
+        assert!(set.contains(130) && !set.contains(63));
+        assert_eq!(set.len(), 4);
+        assert_eq!(set.iter().collect::<Vec<_>>(), vec![0, 64, 130, 191]);
+
+        let mut other = BitSet::<3>::default();
+        other.insert(64);
+        assert_eq!(
+            set.difference(&other).iter().collect::<Vec<_>>(),
+            vec![0, 130, 191]
+        );
+    }
+}
@@ -0,0 +1,25 @@
+use std::time::Duration;
+
+use crate::input::keyboard::VirtualKeyCode;
+use crate::input::mouse::MouseButton;
+use crate::input::touch::TouchInput;
+
+#[derive(Debug, Clone, Copy)]
+pub enum InputEventKind {
+    Key { key: VirtualKeyCode, pressed: bool },
+    Mouse { button: MouseButton, pressed: bool },
+    Touch(TouchInput),
+}
+
+/// A single input transition, stamped with the time it was received relative to the start of the
+/// window's event loop. Events are applied to the `InputManager` in timestamp order, so a tick
+/// only sees the events that happened before its end.
+#[derive(Debug, Clone, Copy)]
+pub struct InputEvent {
+    pub time: Duration,
+    pub kind: InputEventKind,
+}
+
+/// Number of events buffered between the window and the simulation. A frame would need to receive
+/// more than this many events for any of them to be dropped.
+pub const INPUT_QUEUE_CAPACITY: usize = 1024;
@@ -8,7 +8,8 @@ pub struct KeyboardInput {
     pub virtual_keycode: Option<VirtualKeyCode>,
 }
 
-#[derive(Debug, PartialOrd, PartialEq, Eq, Hash, Clone)]
+#[repr(u8)]
+#[derive(Debug, PartialOrd, PartialEq, Eq, Hash, Clone, Copy)]
 pub enum VirtualKeyCode {
     Key1,
     Key2,
@@ -174,3 +175,21 @@ pub enum VirtualKeyCode {
     Paste,
     Cut,
 }
+
+impl VirtualKeyCode {
+    /// Number of variants, every discriminant is below this.
+    pub const COUNT: usize = VirtualKeyCode::Cut as usize + 1;
+
+    pub fn index(self) -> usize {
+        self as usize
+    }
+
+    pub fn from_index(index: usize) -> Option<Self> {
+        if index < Self::COUNT {
+            // Safety: the enum is repr(u8) with implicit, contiguous discriminants
+            Some(unsafe { std::mem::transmute(index as u8) })
+        } else {
+            None
+        }
+    }
+}
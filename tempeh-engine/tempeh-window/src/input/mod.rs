@@ -1,12 +1,18 @@
-use crate::input::keyboard::{KeyboardInput, VirtualKeyCode};
-use crate::input::mouse::{MouseButton, MouseInput};
-use crate::input::touch::TouchInput;
-use std::collections::hash_set::Iter;
-use std::collections::{hash_map, HashMap, HashSet};
+use std::time::Duration;
 
+use tempeh_engine::ring::Consumer;
 
+use crate::input::bitset::BitSet;
+use crate::input::event::{InputEvent, InputEventKind};
+use crate::input::keyboard::VirtualKeyCode;
+use crate::input::mouse::MouseButton;
+use crate::input::touch::{TouchInput, TouchPhase};
+
+pub mod bitset;
+pub mod event;
 pub mod keyboard;
 pub mod mouse;
+pub mod record;
 pub mod touch;
 
 #[derive(Debug, PartialOrd, PartialEq, Eq, Hash, Clone)]
@@ -15,51 +21,273 @@ pub enum KeyState {
     Released,
 }
 
+const KEY_WORDS: usize = (VirtualKeyCode::COUNT + 63) / 64;
+
+/// Maximum number of simultaneous touches that are tracked, further touches are ignored.
+pub const MAX_TOUCHES: usize = 10;
+
+#[derive(Debug, Clone, Copy, Default)]
+struct ButtonState {
+    keys: BitSet<KEY_WORDS>,
+    mouse_buttons: BitSet<1>,
+}
+
+/// Keyboard, mouse and touch state, kept as a persistent resource and updated in place by the
+/// window.
+///
+/// Besides the current state, every press and release since the last `end_frame` is recorded, so
+/// a key that was pressed and released within one tick still reports `just_pressed` and
+/// `just_released`, and both queries are a single bit test. Everything is stored inline, updating
+/// and advancing the state never allocates.
 #[derive(Debug, Clone)]
 pub struct InputManager {
-    pub touch_presses: HashMap<u64, tempeh_math::Point2<f64>>,
-    pub touches: HashMap<u64, TouchInput>,
-    pub mouse_button: HashSet<MouseButton>,
-    pub mouse_presses: HashSet<MouseInput>,
-    pub keyboard_presses: HashSet<KeyboardInput>,
-    pub keyboard_key_presses: HashSet<VirtualKeyCode>,
+    current: ButtonState,
+    pressed: ButtonState,
+    released: ButtonState,
+    touches: [Option<TouchInput>; MAX_TOUCHES],
+    last_event_time: Duration,
+}
+
+impl Default for InputManager {
+    fn default() -> Self {
+        Self::new()
+    }
 }
 
 impl InputManager {
     pub fn new() -> Self {
         Self {
-            touch_presses: HashMap::new(),
-            touches: HashMap::new(),
-            mouse_button: HashSet::new(),
-            mouse_presses: HashSet::new(),
-            keyboard_presses: HashSet::new(),
-            keyboard_key_presses: HashSet::new(),
+            current: ButtonState::default(),
+            pressed: ButtonState::default(),
+            released: ButtonState::default(),
+            touches: [None; MAX_TOUCHES],
+            last_event_time: Duration::ZERO,
+        }
+    }
+
+    /// Forgets the presses and releases of the tick that just ran. Called by the window once the
+    /// schedule has run.
+    pub fn end_frame(&mut self) {
+        self.pressed = ButtonState::default();
+        self.released = ButtonState::default();
+        for slot in &mut self.touches {
+            match slot.as_ref().map(|touch| touch.phase) {
+                Some(TouchPhase::Ended) | Some(TouchPhase::Cancelled) => *slot = None,
+                Some(TouchPhase::Started) => slot.as_mut().unwrap().phase = TouchPhase::Moved,
+                _ => {}
+            }
+        }
+    }
+
+    /// Releases everything, e.g. when the window loses focus.
+    pub fn clear(&mut self) {
+        self.released.keys = self.current.keys;
+        self.released.mouse_buttons = self.current.mouse_buttons;
+        self.current = ButtonState::default();
+        self.touches = [None; MAX_TOUCHES];
+    }
+
+    /// Applies every queued event that happened at or before `until`, in order, and returns how
+    /// many were applied. Later events stay queued for the next tick.
+    pub fn apply_until(&mut self, events: &mut Consumer<InputEvent>, until: Duration) -> usize {
+        let mut applied = 0;
+        for event in events.pop_while(|event| event.time <= until) {
+            self.apply(&event);
+            applied += 1;
+        }
+        applied
+    }
+
+    pub fn apply(&mut self, event: &InputEvent) {
+        self.last_event_time = event.time;
+        match event.kind {
+            InputEventKind::Key { key, pressed: true } => self.press_key(key),
+            InputEventKind::Key {
+                key,
+                pressed: false,
+            } => self.release_key(key),
+            InputEventKind::Mouse {
+                button,
+                pressed: true,
+            } => self.press_mouse(button),
+            InputEventKind::Mouse {
+                button,
+                pressed: false,
+            } => self.release_mouse(button),
+            InputEventKind::Touch(touch) => self.touch(touch),
+        }
+    }
+
+    /// Timestamp of the most recently applied event.
+    pub fn last_event_time(&self) -> Duration {
+        self.last_event_time
+    }
+
+    pub fn press_key(&mut self, key: VirtualKeyCode) {
+        // Key repeat sends presses for keys that are already down
+        if !self.current.keys.contains(key.index()) {
+            self.current.keys.insert(key.index());
+            self.pressed.keys.insert(key.index());
+        }
+    }
+
+    pub fn release_key(&mut self, key: VirtualKeyCode) {
+        if self.current.keys.contains(key.index()) {
+            self.current.keys.remove(key.index());
+            self.released.keys.insert(key.index());
         }
     }
 
-    pub fn reset(&mut self) {
-        self.touches.clear();
-        self.mouse_presses.clear();
-        self.keyboard_presses.clear();
+    pub fn press_mouse(&mut self, button: MouseButton) {
+        if let Some(index) = button.index() {
+            if !self.current.mouse_buttons.contains(index) {
+                self.current.mouse_buttons.insert(index);
+                self.pressed.mouse_buttons.insert(index);
+            }
+        }
+    }
+
+    pub fn release_mouse(&mut self, button: MouseButton) {
+        if let Some(index) = button.index() {
+            if self.current.mouse_buttons.contains(index) {
+                self.current.mouse_buttons.remove(index);
+                self.released.mouse_buttons.insert(index);
+            }
+        }
+    }
+
+    /// Updates the touch with the same id, or starts tracking a new one if a slot is free.
+    pub fn touch(&mut self, touch: TouchInput) {
+        let slot = match self.touches.iter().position(|slot| {
+            slot.as_ref()
+                .map_or(false, |existing| existing.id == touch.id)
+        }) {
+            Some(index) => index,
+            None => match self.touches.iter().position(Option::is_none) {
+                Some(index) => index,
+                None => return,
+            },
+        };
+        self.touches[slot] = Some(touch);
+    }
+
+    pub fn is_key_pressed(&self, key: &VirtualKeyCode) -> bool {
+        self.current.keys.contains(key.index())
+    }
+
+    pub fn is_key_just_pressed(&self, key: &VirtualKeyCode) -> bool {
+        self.pressed.keys.contains(key.index())
+    }
+
+    pub fn is_key_just_released(&self, key: &VirtualKeyCode) -> bool {
+        self.released.keys.contains(key.index())
+    }
+
+    pub fn is_mouse_pressed(&self, button: &MouseButton) -> bool {
+        button
+            .index()
+            .map_or(false, |index| self.current.mouse_buttons.contains(index))
     }
 
-    pub fn touches(&self) -> hash_map::Iter<'_, u64, TouchInput> {
-        self.touches.iter()
+    pub fn is_mouse_just_pressed(&self, button: &MouseButton) -> bool {
+        button
+            .index()
+            .map_or(false, |index| self.pressed.mouse_buttons.contains(index))
     }
 
-    pub fn mouse_buttons(&self) -> Iter<'_, MouseButton> {
-        self.mouse_button.iter()
+    pub fn is_mouse_just_released(&self, button: &MouseButton) -> bool {
+        button
+            .index()
+            .map_or(false, |index| self.released.mouse_buttons.contains(index))
     }
 
-    pub fn keyboard_pressed_key(&self) -> Iter<'_, VirtualKeyCode> {
-        self.keyboard_key_presses.iter()
+    pub fn pressed_keys(&self) -> impl Iterator<Item = VirtualKeyCode> + '_ {
+        self.current
+            .keys
+            .iter()
+            .filter_map(VirtualKeyCode::from_index)
     }
 
-    pub fn is_key_pressed(&self, virtual_keycode: &VirtualKeyCode) -> bool {
-        self.keyboard_key_presses.contains(virtual_keycode)
+    pub fn mouse_buttons(&self) -> impl Iterator<Item = MouseButton> + '_ {
+        self.current
+            .mouse_buttons
+            .iter()
+            .map(MouseButton::from_index)
     }
 
-    pub fn is_mouse_pressed(&self, mouse_button: &MouseButton) -> bool {
-        self.mouse_button.contains(mouse_button)
+    /// Every tracked touch, including those that ended during this frame.
+    pub fn touches(&self) -> impl Iterator<Item = &TouchInput> {
+        self.touches.iter().flatten()
+    }
+
+    /// Number of fingers currently down.
+    pub fn touch_count(&self) -> usize {
+        self.touches()
+            .filter(|touch| matches!(touch.phase, TouchPhase::Started | TouchPhase::Moved))
+            .count()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn just_pressed_and_released() {
+        let mut input = InputManager::new();
+        input.press_key(VirtualKeyCode::Space);
+        input.press_mouse(MouseButton::Other(4));
+        assert!(input.is_key_just_pressed(&VirtualKeyCode::Space));
+        assert!(input.is_mouse_just_pressed(&MouseButton::Other(4)));
+        assert_eq!(
+            input.pressed_keys().collect::<Vec<_>>(),
+            vec![VirtualKeyCode::Space]
+        );
+
+        input.end_frame();
+        assert!(input.is_key_pressed(&VirtualKeyCode::Space));
+        assert!(!input.is_key_just_pressed(&VirtualKeyCode::Space));
+
+        input.release_key(VirtualKeyCode::Space);
+        assert!(input.is_key_just_released(&VirtualKeyCode::Space));
+        input.end_frame();
+        assert!(!input.is_key_just_released(&VirtualKeyCode::Space));
+        assert_eq!(
+            input.mouse_buttons().collect::<Vec<_>>(),
+            vec![MouseButton::Other(4)]
+        );
+    }
+
+    #[test]
+    fn taps_within_a_tick_are_not_lost() {
+        let (mut producer, mut consumer) = tempeh_engine::ring::ring_buffer(16);
+        let key = |ms, pressed| InputEvent {
+            time: Duration::from_millis(ms),
+            kind: InputEventKind::Key {
+                key: VirtualKeyCode::Space,
+                pressed,
+            },
+        };
+        for event in [key(1, true), key(5, false), key(20, true)] {
+            producer.push(event).unwrap();
+        }
+
+        let mut input = InputManager::new();
+        assert_eq!(
+            input.apply_until(&mut consumer, Duration::from_millis(16)),
+            2
+        );
+        assert!(!input.is_key_pressed(&VirtualKeyCode::Space));
+        assert!(input.is_key_just_pressed(&VirtualKeyCode::Space));
+        assert!(input.is_key_just_released(&VirtualKeyCode::Space));
+        input.end_frame();
+
+        assert_eq!(
+            input.apply_until(&mut consumer, Duration::from_millis(32)),
+            1
+        );
+        assert!(input.is_key_just_pressed(&VirtualKeyCode::Space));
+        assert!(!input.is_key_just_released(&VirtualKeyCode::Space));
+        assert_eq!(input.last_event_time(), Duration::from_millis(20));
     }
 }
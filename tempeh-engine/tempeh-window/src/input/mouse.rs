@@ -6,10 +6,33 @@ pub struct MouseInput {
     pub button: MouseButton,
 }
 
-#[derive(Debug, PartialOrd, PartialEq, Eq, Hash, Clone)]
+#[derive(Debug, PartialOrd, PartialEq, Eq, Hash, Clone, Copy)]
 pub enum MouseButton {
     Left,
     Right,
     Middle,
     Other(u16),
 }
+
+impl MouseButton {
+    /// Slot of the button in `InputManager`'s button set. `Other` buttons past the set's capacity
+    /// are not tracked.
+    pub(crate) fn index(self) -> Option<usize> {
+        match self {
+            MouseButton::Left => Some(0),
+            MouseButton::Right => Some(1),
+            MouseButton::Middle => Some(2),
+            MouseButton::Other(n) if (n as usize) < 61 => Some(3 + n as usize),
+            MouseButton::Other(_) => None,
+        }
+    }
+
+    pub(crate) fn from_index(index: usize) -> Self {
+        match index {
+            0 => MouseButton::Left,
+            1 => MouseButton::Right,
+            2 => MouseButton::Middle,
+            n => MouseButton::Other((n - 3) as u16),
+        }
+    }
+}
@@ -0,0 +1,271 @@
+//! Compact binary recording of an input event stream, for replaying real sessions in automated
+//! runs.
+//!
+//! The file starts with `MAGIC` and a version byte, followed by one record per event: the time
+//! since the previous event in microseconds as a LEB128 varint, a tag byte and the tag's payload.
+//! A typical key or mouse event takes three to five bytes.
+
+use std::io::{self, Read, Write};
+use std::time::Duration;
+
+use crate::input::event::{InputEvent, InputEventKind};
+use crate::input::keyboard::VirtualKeyCode;
+use crate::input::mouse::MouseButton;
+use crate::input::touch::{TouchInput, TouchPhase};
+
+pub const MAGIC: [u8; 4] = *b"TPIR";
+pub const VERSION: u8 = 1;
+
+const TAG_KEY_RELEASED: u8 = 0;
+const TAG_KEY_PRESSED: u8 = 1;
+const TAG_MOUSE_RELEASED: u8 = 2;
+const TAG_MOUSE_PRESSED: u8 = 3;
+const TAG_TOUCH: u8 = 4;
+
+pub struct InputRecorder<W: Write> {
+    writer: W,
+    last_micros: u64,
+}
+
+impl<W: Write> InputRecorder<W> {
+    pub fn new(mut writer: W) -> io::Result<Self> {
+        writer.write_all(&MAGIC)?;
+        writer.write_all(&[VERSION])?;
+        Ok(Self {
+            writer,
+            last_micros: 0,
+        })
+    }
+
+    /// Appends `event`. Events have to be recorded in timestamp order.
+    pub fn record(&mut self, event: &InputEvent) -> io::Result<()> {
+        let micros = event.time.as_micros() as u64;
+        write_varint(&mut self.writer, micros.saturating_sub(self.last_micros))?;
+        self.last_micros = micros.max(self.last_micros);
+
+        match event.kind {
+            InputEventKind::Key { key, pressed } => {
+                let tag = if pressed {
+                    TAG_KEY_PRESSED
+                } else {
+                    TAG_KEY_RELEASED
+                };
+                self.writer.write_all(&[tag, key.index() as u8])
+            }
+            InputEventKind::Mouse { button, pressed } => {
+                let tag = if pressed {
+                    TAG_MOUSE_PRESSED
+                } else {
+                    TAG_MOUSE_RELEASED
+                };
+                match button {
+                    MouseButton::Left => self.writer.write_all(&[tag, 0]),
+                    MouseButton::Right => self.writer.write_all(&[tag, 1]),
+                    MouseButton::Middle => self.writer.write_all(&[tag, 2]),
+                    MouseButton::Other(n) => {
+                        self.writer.write_all(&[tag, 3])?;
+                        self.writer.write_all(&n.to_le_bytes())
+                    }
+                }
+            }
+            InputEventKind::Touch(touch) => {
+                self.writer.write_all(&[TAG_TOUCH])?;
+                write_varint(&mut self.writer, touch.id)?;
+                self.writer
+                    .write_all(&touch.logical_position.x.to_le_bytes())?;
+                self.writer
+                    .write_all(&touch.logical_position.y.to_le_bytes())?;
+                let phase = match touch.phase {
+                    TouchPhase::Started => 0,
+                    TouchPhase::Moved => 1,
+                    TouchPhase::Ended => 2,
+                    TouchPhase::Cancelled => 3,
+                };
+                self.writer.write_all(&[phase])
+            }
+        }
+    }
+
+    pub fn flush(&mut self) -> io::Result<()> {
+        self.writer.flush()
+    }
+
+    pub fn finish(mut self) -> io::Result<W> {
+        self.writer.flush()?;
+        Ok(self.writer)
+    }
+}
+
+/// Reads back the events written by an `InputRecorder`.
+pub struct InputReplay<R: Read> {
+    reader: R,
+    last_micros: u64,
+}
+
+impl<R: Read> InputReplay<R> {
+    pub fn new(mut reader: R) -> io::Result<Self> {
+        let mut header = [0; 5];
+        reader.read_exact(&mut header)?;
+        if header[..4] != MAGIC {
+            return Err(invalid_data("not an input recording"));
+        }
+        if header[4] != VERSION {
+            return Err(invalid_data("unsupported input recording version"));
+        }
+        Ok(Self {
+            reader,
+            last_micros: 0,
+        })
+    }
+
+    /// Returns `None` at the end of the recording.
+    pub fn next_event(&mut self) -> io::Result<Option<InputEvent>> {
+        let delta = match read_varint(&mut self.reader) {
+            Ok(delta) => delta,
+            Err(error) if error.kind() == io::ErrorKind::UnexpectedEof => return Ok(None),
+            Err(error) => return Err(error),
+        };
+        self.last_micros += delta;
+
+        let kind = match read_u8(&mut self.reader)? {
+            tag @ (TAG_KEY_RELEASED | TAG_KEY_PRESSED) => InputEventKind::Key {
+                key: VirtualKeyCode::from_index(read_u8(&mut self.reader)? as usize)
+                    .ok_or_else(|| invalid_data("invalid key code"))?,
+                pressed: tag == TAG_KEY_PRESSED,
+            },
+            tag @ (TAG_MOUSE_RELEASED | TAG_MOUSE_PRESSED) => InputEventKind::Mouse {
+                button: match read_u8(&mut self.reader)? {
+                    0 => MouseButton::Left,
+                    1 => MouseButton::Right,
+                    2 => MouseButton::Middle,
+                    3 => {
+                        let mut bytes = [0; 2];
+                        self.reader.read_exact(&mut bytes)?;
+                        MouseButton::Other(u16::from_le_bytes(bytes))
+                    }
+                    _ => return Err(invalid_data("invalid mouse button")),
+                },
+                pressed: tag == TAG_MOUSE_PRESSED,
+            },
+            TAG_TOUCH => {
+                let id = read_varint(&mut self.reader)?;
+                let x = read_f64(&mut self.reader)?;
+                let y = read_f64(&mut self.reader)?;
+                let phase = match read_u8(&mut self.reader)? {
+                    0 => TouchPhase::Started,
+                    1 => TouchPhase::Moved,
+                    2 => TouchPhase::Ended,
+                    3 => TouchPhase::Cancelled,
+                    _ => return Err(invalid_data("invalid touch phase")),
+                };
+                InputEventKind::Touch(TouchInput {
+                    id,
+                    logical_position: tempeh_math::Point2::new(x, y),
+                    phase,
+                })
+            }
+            _ => return Err(invalid_data("invalid event tag")),
+        };
+        Ok(Some(InputEvent {
+            time: Duration::from_micros(self.last_micros),
+            kind,
+        }))
+    }
+
+    /// Reads the remaining events into memory.
+    pub fn read_all(mut self) -> io::Result<Vec<InputEvent>> {
+        let mut events = Vec::new();
+        while let Some(event) = self.next_event()? {
+            events.push(event);
+        }
+        Ok(events)
+    }
+}
+
+fn invalid_data(message: &str) -> io::Error {
+    io::Error::new(io::ErrorKind::InvalidData, message)
+}
+
+fn write_varint<W: Write>(writer: &mut W, mut value: u64) -> io::Result<()> {
+    let mut bytes = [0; 10];
+    let mut len = 0;
+    loop {
+        let byte = (value & 0x7f) as u8;
+        value >>= 7;
+        if value == 0 {
+            bytes[len] = byte;
+            len += 1;
+            break;
+        }
+        bytes[len] = byte | 0x80;
+        len += 1;
+    }
+    writer.write_all(&bytes[..len])
+}
+
+fn read_varint<R: Read>(reader: &mut R) -> io::Result<u64> {
+    let mut value = 0;
+    for shift in (0..64).step_by(7) {
+        let byte = read_u8(reader)?;
+        value |= ((byte & 0x7f) as u64) << shift;
+        if byte & 0x80 == 0 {
+            return Ok(value);
+        }
+    }
+    Err(invalid_data("varint is too long"))
+}
+
+fn read_u8<R: Read>(reader: &mut R) -> io::Result<u8> {
+    let mut byte = [0];
+    reader.read_exact(&mut byte)?;
+    Ok(byte[0])
+}
+
+fn read_f64<R: Read>(reader: &mut R) -> io::Result<f64> {
+    let mut bytes = [0; 8];
+    reader.read_exact(&mut bytes)?;
+    Ok(f64::from_le_bytes(bytes))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn round_trip() {
+        let events = vec![
+            InputEvent {
+                time: Duration::from_micros(1_500),
+                kind: InputEventKind::Key {
+                    key: VirtualKeyCode::Cut,
+                    pressed: true,
+                },
+            },
+            InputEvent {
+                time: Duration::from_micros(20_000),
+                kind: InputEventKind::Mouse {
+                    button: MouseButton::Other(300),
+                    pressed: false,
+                },
+            },
+            InputEvent {
+                time: Duration::from_secs(90),
+                kind: InputEventKind::Touch(TouchInput {
+                    id: 7,
+                    logical_position: tempeh_math::Point2::new(10.5, -3.25),
+                    phase: TouchPhase::Moved,
+                }),
+            },
+        ];
+
+        let mut recorder = InputRecorder::new(Vec::new()).unwrap();
+        for event in &events {
+            recorder.record(event).unwrap();
+        }
+        let bytes = recorder.finish().unwrap();
+        let replayed = InputReplay::new(&bytes[..]).unwrap().read_all().unwrap();
+
+        assert_eq!(format!("{:?}", replayed), format!("{:?}", events));
+        assert!(InputReplay::new(&bytes[1..]).is_err());
+    }
+}
@@ -1,13 +1,13 @@
 use tempeh_math::prelude::*;
 
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Copy)]
 pub struct TouchInput {
     pub id: u64,
     pub logical_position: Point2<f64>,
     pub phase: TouchPhase,
 }
 
-#[derive(Debug, PartialOrd, PartialEq, Eq, Hash, Clone)]
+#[derive(Debug, PartialOrd, PartialEq, Eq, Hash, Clone, Copy)]
 pub enum TouchPhase {
     Started,
     Moved,
@@ -4,6 +4,7 @@ use tempeh_engine::Engine;
 
 pub use raw_window_handle::HasRawWindowHandle;
 
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
 pub struct ScreenSize {
     pub width: u32,
     pub height: u32,
@@ -1,8 +1,78 @@
+use std::env;
+
+/// Cargo feature and the `MA_ENABLE_*` switch of each backend.
+const BACKENDS: &[(&str, &str)] = &[
+    ("BACKEND_WASAPI", "MA_ENABLE_WASAPI"),
+    ("BACKEND_DSOUND", "MA_ENABLE_DSOUND"),
+    ("BACKEND_WINMM", "MA_ENABLE_WINMM"),
+    ("BACKEND_COREAUDIO", "MA_ENABLE_COREAUDIO"),
+    ("BACKEND_ALSA", "MA_ENABLE_ALSA"),
+    ("BACKEND_PULSEAUDIO", "MA_ENABLE_PULSEAUDIO"),
+    ("BACKEND_JACK", "MA_ENABLE_JACK"),
+    ("BACKEND_SNDIO", "MA_ENABLE_SNDIO"),
+    ("BACKEND_AUDIO4", "MA_ENABLE_AUDIO4"),
+    ("BACKEND_OSS", "MA_ENABLE_OSS"),
+    ("BACKEND_AAUDIO", "MA_ENABLE_AAUDIO"),
+    ("BACKEND_OPENSL", "MA_ENABLE_OPENSL"),
+    ("BACKEND_WEBAUDIO", "MA_ENABLE_WEBAUDIO"),
+    ("BACKEND_NULL", "MA_ENABLE_NULL"),
+];
+
+/// Cargo feature and the `MA_NO_*` switch turning it off.
+const OPTIONAL: &[(&str, &str)] = &[
+    ("SSE2", "MA_NO_SSE2"),
+    ("NEON", "MA_NO_NEON"),
+    ("WAV", "MA_NO_WAV"),
+    ("FLAC", "MA_NO_FLAC"),
+    ("MP3", "MA_NO_MP3"),
+    ("ENCODING", "MA_NO_ENCODING"),
+];
+
+fn feature(name: &str) -> bool {
+    env::var_os(format!("CARGO_FEATURE_{}", name)).is_some()
+}
+
 fn main() {
     println!("cargo:rerun-if-changed=miniaudio/miniaudio.c");
 
-    cc::Build::new()
+    let mut build = cc::Build::new();
+    build
         .file("miniaudio/miniaudio.c")
         .define("MINIAUDIO_IMPLEMENTATION", "")
-        .compile("miniaudio");
+        // The mixer runs on a real time deadline, an unoptimized one glitches even in debug builds
+        .opt_level(2);
+
+    // Every backend of the platform is compiled unless some are picked
+    let backends: Vec<&str> = BACKENDS
+        .iter()
+        .filter(|(name, _)| feature(name))
+        .map(|(_, define)| *define)
+        .collect();
+    if !backends.is_empty() {
+        build.define("MA_ENABLE_ONLY_SPECIFIC_BACKENDS", None);
+        for define in backends {
+            build.define(define, None);
+        }
+    }
+
+    for (name, define) in OPTIONAL {
+        if !feature(name) {
+            build.define(define, None);
+        }
+    }
+
+    // miniaudio picks SSE2 and NEON up from the target, but GCC and Clang only expose the AVX2
+    // intrinsics when the whole file may use them, which then requires an AVX2 CPU
+    let arch = env::var("CARGO_CFG_TARGET_ARCH").unwrap_or_default();
+    let x86 = arch == "x86" || arch == "x86_64";
+    if !feature("AVX2") {
+        build.define("MA_NO_AVX2", None);
+    } else if x86 && !build.get_compiler().is_like_msvc() {
+        build.flag("-mavx2");
+    }
+    if arch == "arm" && feature("NEON") && !build.get_compiler().is_like_msvc() {
+        build.flag_if_supported("-mfpu=neon");
+    }
+
+    build.compile("miniaudio");
 }
@@ -1,10 +1,15 @@
+use std::ffi::CString;
+
 use tempeh_miniaudio::engine::Engine;
 
 fn main() {
-    let mut engine = Engine::new().unwrap();
-    engine.play_sound();
+    let path = std::env::args()
+        .nth(1)
+        .unwrap_or_else(|| "starwars.wav".to_owned());
+    let engine = Engine::new().unwrap();
+    engine.play_sound(&CString::new(path).unwrap()).unwrap();
 
     println!("Press anything to stop");
     let mut line = String::new();
     std::io::stdin().read_line(&mut line).unwrap();
-}
\ No newline at end of file
+}
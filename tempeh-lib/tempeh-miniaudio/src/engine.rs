@@ -1,52 +1,418 @@
-use core::ffi::CStr;
+use core::ffi::{c_void, CStr};
+use core::mem::MaybeUninit;
+use std::sync::Arc;
+use std::time::Instant;
 
-use crate::sound::Sound;
-use tempeh_miniaudio_sys::{ma_engine, ma_engine_init, ma_result_MA_SUCCESS, ma_engine_uninit, ma_engine_play_sound, ma_sound, ma_sound_init_from_file};
 use crate::error::Error;
+use crate::load::MixerLoad;
+use crate::sound::{Sound, SoundFlags};
+use tempeh_miniaudio_sys::{
+    ma_device, ma_engine, ma_engine_config_init, ma_engine_get_channels, ma_engine_get_device,
+    ma_engine_get_resource_manager, ma_engine_get_sample_rate, ma_engine_init,
+    ma_engine_listener_set_position, ma_engine_play_sound, ma_engine_read_pcm_frames,
+    ma_engine_set_volume, ma_engine_start, ma_engine_uninit, ma_format_ma_format_s16,
+    ma_resource_manager_register_decoded_data, ma_resource_manager_register_encoded_data,
+    ma_resource_manager_unregister_data, ma_result, ma_sound, ma_sound_init_copy,
+    ma_sound_init_from_file,
+};
+#[cfg(all(feature = "encoding", feature = "wav"))]
+use tempeh_miniaudio_sys::{
+    ma_encoder, ma_encoder_config_init, ma_encoder_init_file, ma_encoder_uninit,
+    ma_encoder_write_pcm_frames, ma_encoding_format_ma_encoding_format_wav,
+    ma_format_ma_format_f32,
+};
 
+/// Frames mixed per call by `Engine::render_to_wav`.
+#[cfg(all(feature = "encoding", feature = "wav"))]
+const RENDER_CHUNK_FRAMES: usize = 4096;
+
+/// High level miniaudio engine, mixing every sound into the default playback device, or into
+/// buffers of the caller for an offline engine.
 pub struct Engine {
-    engine: ma_engine,
+    /// miniaudio keeps pointers to the engine (device user data, node graph), so it is boxed to
+    /// never move
+    engine: Box<ma_engine>,
+    /// User data of the device callback, it must outlive the device. `None` for an offline engine
+    callback: Option<Box<CallbackData>>,
+    load: Arc<MixerLoad>,
+}
+
+struct CallbackData {
+    engine: *mut ma_engine,
+    load: Arc<MixerLoad>,
+}
+
+/// Replaces the data callback of the engine's device, doing the same as miniaudio's while
+/// measuring the time spent mixing each period.
+unsafe extern "C" fn data_callback(
+    device: *mut ma_device,
+    output: *mut c_void,
+    _input: *const c_void,
+    frame_count: u32,
+) {
+    let data = &*((*device).pUserData as *const CallbackData);
+    let start = Instant::now();
+    ma_engine_read_pcm_frames(
+        data.engine,
+        output,
+        frame_count as u64,
+        core::ptr::null_mut(),
+    );
+    data.load
+        .record(start.elapsed(), frame_count, (*device).sampleRate);
 }
 
-impl<'a> Engine {
+// Safety: the engine's API is thread safe, miniaudio synchronizes with its device thread itself
+unsafe impl Send for Engine {}
+
+impl Engine {
     pub fn new() -> Result<Self, Error> {
-        let mut engine = unsafe { core::mem::MaybeUninit::uninit().assume_init() };
-        let result = unsafe { ma_engine_init(core::ptr::null(), &mut engine as *mut ma_engine) };
-        Error::from(result).map(|_| Self { engine })
+        let mut engine = Box::new(MaybeUninit::<ma_engine>::uninit());
+        let result = unsafe {
+            let mut config = ma_engine_config_init();
+            // The callback is swapped before the device starts
+            config.noAutoStart = 1;
+            ma_engine_init(&config, engine.as_mut_ptr())
+        };
+        Error::from(result)?;
+        // Safety: initialized by `ma_engine_init`
+        let mut engine = unsafe { Box::from_raw(Box::into_raw(engine) as *mut ma_engine) };
+
+        let load = Arc::new(MixerLoad::default());
+        let callback = Box::new(CallbackData {
+            engine: &mut *engine,
+            load: load.clone(),
+        });
+        unsafe {
+            // Only the leading fields of `ma_device` are touched, the rest of its layout depends on
+            // the backends compiled in
+            let device = ma_engine_get_device(&mut *engine);
+            (*device).onData = Some(data_callback);
+            (*device).pUserData = &*callback as *const CallbackData as *mut c_void;
+        }
+        let engine = Self {
+            engine,
+            callback: Some(callback),
+            load,
+        };
+        Error::from(unsafe { ma_engine_start(engine.as_ptr()) })?;
+        Ok(engine)
     }
 
-    pub fn play_sound(&mut self, file_path: CStr) -> Result<Sound<'a>, Error> {
-        let mut sound = unsafe { core::mem::MaybeUninit::uninit().assume_init() };
+    /// An engine without a device, which only mixes when `render` is called, as fast as the CPU
+    /// allows. For tests and benchmarks on machines without sound hardware.
+    ///
+    /// The output is deterministic: sounds created from files are loaded before
+    /// `create_sound_from_file` returns, ignoring `SoundFlags::ASYNC` and `SoundFlags::STREAM`,
+    /// so no job thread races the mix. `play_sound` always loads in the background, so it is not.
+    pub fn new_offline(channels: u32, sample_rate: u32) -> Result<Self, Error> {
+        let mut engine = Box::new(MaybeUninit::<ma_engine>::uninit());
         let result = unsafe {
-            ma_engine_play_sound(
-                &mut self.engine as *mut ma_engine,
-                file_path,
-                &mut sound as *mut ma_sound,
+            let mut config = ma_engine_config_init();
+            config.noDevice = 1;
+            config.channels = channels;
+            config.sampleRate = sample_rate;
+            ma_engine_init(&config, engine.as_mut_ptr())
+        };
+        Error::from(result)?;
+        // Safety: initialized by `ma_engine_init`
+        let engine = unsafe { Box::from_raw(Box::into_raw(engine) as *mut ma_engine) };
+        Ok(Self {
+            engine,
+            callback: None,
+            load: Arc::new(MixerLoad::default()),
+        })
+    }
+
+    pub fn is_offline(&self) -> bool {
+        self.callback.is_none()
+    }
+
+    pub fn channels(&self) -> u32 {
+        unsafe { ma_engine_get_channels(&*self.engine) }
+    }
+
+    pub fn sample_rate(&self) -> u32 {
+        unsafe { ma_engine_get_sample_rate(&*self.engine) }
+    }
+
+    /// Mixes the next frames of an offline engine into `output`, interleaved `f32` samples of
+    /// `channels` channels. Returns the number of frames written. The time spent is recorded in
+    /// `load` as if a device had asked for them.
+    pub fn render(&self, output: &mut [f32]) -> Result<u64, Error> {
+        debug_assert!(
+            self.is_offline(),
+            "The device is already mixing this engine"
+        );
+        let channels = self.channels().max(1) as usize;
+        let frame_count = (output.len() / channels) as u64;
+        let mut frames_read = 0;
+        let start = Instant::now();
+        let result = unsafe {
+            ma_engine_read_pcm_frames(
+                self.as_ptr(),
+                output.as_mut_ptr() as *mut c_void,
+                frame_count,
+                &mut frames_read,
             )
         };
-        Error::from(result).map(|_| Sound::from_ma_sound(sound))
+        self.load
+            .record(start.elapsed(), frames_read as u32, self.sample_rate());
+        Error::from(result)?;
+        Ok(frames_read)
     }
 
-    pub fn create_sound_from_file(&mut self, file_path: CStr) -> Sound<'a> {
-        let mut sound = unsafe { core::mem::MaybeUninit::uninit().assume_init() };
+    /// Mixes `frame_count` frames of an offline engine into a 32-bit float WAV file. miniaudio
+    /// only builds its WAV encoder along with the WAV decoder, hence the `wav` feature.
+    #[cfg(all(feature = "encoding", feature = "wav"))]
+    pub fn render_to_wav(&self, file_path: &CStr, frame_count: u64) -> Result<(), Error> {
+        let channels = self.channels();
+        let mut encoder = Box::new(MaybeUninit::<ma_encoder>::uninit());
         let result = unsafe {
-            ma_sound_init_from_file(
-                &mut self.engine as *mut ma_engine,
-                file_path,
-                0,
-                Optionalma_sound_group,
-                Optionalma_fence,
-                &mut sound as *mut ma_sound,
+            let config = ma_encoder_config_init(
+                ma_encoding_format_ma_encoding_format_wav,
+                ma_format_ma_format_f32,
+                channels,
+                self.sample_rate(),
             );
+            ma_encoder_init_file(file_path.as_ptr(), &config, encoder.as_mut_ptr())
+        };
+        Error::from(result)?;
+        // Safety: initialized by `ma_encoder_init_file`, and boxed as drwav points back into it
+        let mut encoder = unsafe { Box::from_raw(Box::into_raw(encoder) as *mut ma_encoder) };
+
+        let mut buffer = vec![0.0; RENDER_CHUNK_FRAMES * channels as usize];
+        let mut remaining = frame_count;
+        let mut result = Ok(());
+        while remaining > 0 {
+            let frames = remaining.min(RENDER_CHUNK_FRAMES as u64) as usize;
+            let samples = &mut buffer[..frames * channels as usize];
+            result = self.render(samples).and_then(|_| {
+                Error::from(unsafe {
+                    ma_encoder_write_pcm_frames(
+                        &mut *encoder,
+                        samples.as_ptr() as *const c_void,
+                        frames as u64,
+                        core::ptr::null_mut(),
+                    )
+                })
+            });
+            if result.is_err() {
+                break;
+            }
+            remaining -= frames as u64;
+        }
+        unsafe { ma_encoder_uninit(&mut *encoder) };
+        result
+    }
+
+    /// Mixing cost measured by the device callback, or by `render`.
+    pub fn load(&self) -> &Arc<MixerLoad> {
+        &self.load
+    }
+
+    pub(crate) fn as_ptr(&self) -> *mut ma_engine {
+        &*self.engine as *const ma_engine as *mut ma_engine
+    }
+
+    /// Plays the file at `file_path` once, without a handle to control it.
+    pub fn play_sound(&self, file_path: &CStr) -> Result<(), Error> {
+        let result = unsafe {
+            ma_engine_play_sound(self.as_ptr(), file_path.as_ptr(), core::ptr::null_mut())
         };
-        Error::from(result).map(|_| Sound::from_ma_sound(sound))
+        Error::from(result)
+    }
+
+    pub fn create_sound_from_file(
+        &self,
+        file_path: &CStr,
+        flags: SoundFlags,
+    ) -> Result<Sound<'_>, Error> {
+        let flags = if self.is_offline() {
+            flags.without(SoundFlags::ASYNC | SoundFlags::STREAM)
+        } else {
+            flags
+        };
+        self.init_sound(|sound| unsafe {
+            ma_sound_init_from_file(
+                self.as_ptr(),
+                file_path.as_ptr(),
+                flags.bits(),
+                core::ptr::null_mut(),
+                core::ptr::null_mut(),
+                sound,
+            )
+        })
+    }
+
+    /// Makes `data`, the bytes of an encoded sound file, loadable by `create_sound_from_file` as
+    /// `name`, for sounds that are not files on disk. Such sounds cannot use `SoundFlags::STREAM`;
+    /// without `SoundFlags::DECODE` they are decoded from `data` while playing instead.
+    ///
+    /// # Safety
+    ///
+    /// `data` is not copied, it must stay alive and in place until `name` is unregistered and
+    /// every sound created from it is dropped.
+    pub unsafe fn register_encoded_data(&self, name: &CStr, data: &[u8]) -> Result<(), Error> {
+        Error::from(ma_resource_manager_register_encoded_data(
+            ma_engine_get_resource_manager(self.as_ptr()),
+            name.as_ptr(),
+            data.as_ptr() as *const c_void,
+            data.len(),
+        ))
+    }
+
+    /// Makes `samples`, interleaved PCM of `channels` channels at `sample_rate`, loadable by
+    /// `create_sound_from_file` as `name`. Like `register_encoded_data`, but nothing is left to
+    /// decode.
+    ///
+    /// # Safety
+    ///
+    /// The same as for `register_encoded_data`.
+    pub unsafe fn register_decoded_data(
+        &self,
+        name: &CStr,
+        samples: &[i16],
+        channels: u32,
+        sample_rate: u32,
+    ) -> Result<(), Error> {
+        Error::from(ma_resource_manager_register_decoded_data(
+            ma_engine_get_resource_manager(self.as_ptr()),
+            name.as_ptr(),
+            samples.as_ptr() as *const c_void,
+            (samples.len() / channels.max(1) as usize) as u64,
+            ma_format_ma_format_s16,
+            channels,
+            sample_rate,
+        ))
+    }
+
+    /// Forgets the data registered as `name`.
+    pub fn unregister_data(&self, name: &CStr) {
+        unsafe {
+            ma_resource_manager_unregister_data(
+                ma_engine_get_resource_manager(self.as_ptr()),
+                name.as_ptr(),
+            )
+        };
+    }
+
+    /// A new sound sharing the data of `sound`, which must not be streamed. Decoded data stays in
+    /// the resource manager for as long as a sound refers to it, so copies cost no decoding.
+    pub fn create_sound_copy(&self, sound: &Sound, flags: SoundFlags) -> Result<Sound<'_>, Error> {
+        self.init_sound(|copy| unsafe {
+            ma_sound_init_copy(
+                self.as_ptr(),
+                &*sound.sound,
+                flags.bits(),
+                core::ptr::null_mut(),
+                copy,
+            )
+        })
+    }
+
+    fn init_sound(
+        &self,
+        init: impl FnOnce(*mut ma_sound) -> ma_result,
+    ) -> Result<Sound<'_>, Error> {
+        let mut sound = Box::new(MaybeUninit::<ma_sound>::uninit());
+        Error::from(init(sound.as_mut_ptr()))?;
+        // Safety: initialized by `init`
+        let sound = unsafe { Box::from_raw(Box::into_raw(sound) as *mut ma_sound) };
+        Ok(Sound::from_ma_sound(sound))
+    }
+
+    pub fn set_volume(&self, volume: f32) -> Result<(), Error> {
+        Error::from(unsafe { ma_engine_set_volume(self.as_ptr(), volume) })
+    }
+
+    pub fn set_listener_position(&self, listener: u32, position: [f32; 3]) {
+        let [x, y, z] = position;
+        unsafe { ma_engine_listener_set_position(self.as_ptr(), listener, x, y, z) };
     }
 }
 
 impl Drop for Engine {
     fn drop(&mut self) {
         unsafe {
-            ma_engine_uninit(&mut self.engine as *mut ma_engine);
+            ma_engine_uninit(&mut *self.engine as *mut ma_engine);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::ffi::CString;
+
+    use super::*;
+
+    fn render_starwars() -> Vec<f32> {
+        let engine = Engine::new_offline(2, 48000).unwrap();
+        let path =
+            CString::new(concat!(env!("CARGO_MANIFEST_DIR"), "/../../starwars.wav")).unwrap();
+        let mut sound = engine
+            .create_sound_from_file(&path, SoundFlags::STREAM | SoundFlags::ASYNC)
+            .unwrap();
+        sound.set_position([2.0, 0.0, 1.0]);
+        sound.start().unwrap();
+        let mut output = vec![0.0; 48000 * 2];
+        assert_eq!(engine.render(&mut output).unwrap(), 48000);
+        output
+    }
+
+    #[test]
+    fn offline_render_is_deterministic() {
+        let first = render_starwars();
+        assert!(first.iter().any(|sample| *sample != 0.0));
+        assert_eq!(first, render_starwars());
+    }
+
+    #[test]
+    fn registered_data_plays_like_the_file() {
+        let path = concat!(env!("CARGO_MANIFEST_DIR"), "/../../starwars.wav");
+        let bytes = std::fs::read(path).unwrap();
+        let name = CString::new("memory:starwars.wav").unwrap();
+        let render = |file: &CStr, flags| {
+            let engine = Engine::new_offline(2, 48000).unwrap();
+            unsafe { engine.register_encoded_data(&name, &bytes).unwrap() };
+            let mut output = vec![0.0; 48000 * 2];
+            {
+                let mut sound = engine.create_sound_from_file(file, flags).unwrap();
+                sound.start().unwrap();
+                engine.render(&mut output).unwrap();
+            }
+            engine.unregister_data(&name);
+            output
+        };
+
+        let file = render(&CString::new(path).unwrap(), SoundFlags::DECODE);
+        assert!(file.iter().any(|sample| *sample != 0.0));
+        assert_eq!(file, render(&name, SoundFlags::DECODE));
+        assert_eq!(file, render(&name, SoundFlags::NONE));
+    }
+
+    #[test]
+    fn registered_pcm_plays_unchanged() {
+        let samples: Vec<i16> = (0..4800).map(|i| (i % 100 * 300 - 15000) as i16).collect();
+        let name = CString::new("memory:saw").unwrap();
+        let engine = Engine::new_offline(1, 48000).unwrap();
+        unsafe {
+            engine
+                .register_decoded_data(&name, &samples, 1, 48000)
+                .unwrap()
+        };
+        let mut output = vec![0.0; samples.len()];
+        {
+            let mut sound = engine
+                .create_sound_from_file(&name, SoundFlags::DECODE | SoundFlags::NO_SPATIALIZATION)
+                .unwrap();
+            sound.start().unwrap();
+            engine.render(&mut output).unwrap();
+        }
+        engine.unregister_data(&name);
+        // The sound's first frame is mixed one frame late
+        for (sample, output) in samples.iter().zip(&output[1..]) {
+            assert!((*sample as f32 / 32768.0 - output).abs() < 1e-4);
         }
     }
 }
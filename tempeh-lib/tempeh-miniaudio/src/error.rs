@@ -81,7 +81,7 @@ impl Error {
         if num == ma_result_MA_SUCCESS {
             Ok(())
         } else {
-            Err(unsafe { Error::from_i32(num).unwrap_unchecked() })
+            Err(Error::from_i32(num).unwrap_or(Error::UnknownError))
         }
     }
 }
@@ -1,3 +1,6 @@
 pub mod engine;
+pub mod error;
+pub mod load;
+pub mod pool;
 pub mod sound;
-pub mod error;
\ No newline at end of file
+pub mod voice;
@@ -0,0 +1,56 @@
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::Duration;
+
+/// Mixing cost measured in the device callback. Only atomics are touched there, so measuring
+/// never blocks the audio deadline.
+#[derive(Default)]
+pub struct MixerLoad {
+    callbacks: AtomicU64,
+    busy_nanos: AtomicU64,
+    budget_nanos: AtomicU64,
+    /// Highest busy/budget ratio, in millionths
+    peak: AtomicU64,
+    /// Callbacks that took longer than the audio they produced, each one a likely glitch
+    overruns: AtomicU64,
+}
+
+/// Mixer load over the window since the last `MixerLoad::take`.
+#[derive(Debug, Copy, Clone, Default, PartialEq)]
+pub struct LoadStats {
+    pub callbacks: u64,
+    /// Time spent mixing over the duration of the audio mixed, 1.0 is the real time limit
+    pub average: f32,
+    pub peak: f32,
+    pub overruns: u64,
+}
+
+impl MixerLoad {
+    pub(crate) fn record(&self, busy: Duration, frames: u32, sample_rate: u32) {
+        let busy = busy.as_nanos() as u64;
+        let budget = frames as u64 * 1_000_000_000 / sample_rate.max(1) as u64;
+        self.callbacks.fetch_add(1, Ordering::Relaxed);
+        self.busy_nanos.fetch_add(busy, Ordering::Relaxed);
+        self.budget_nanos.fetch_add(budget, Ordering::Relaxed);
+        self.peak
+            .fetch_max(busy * 1_000_000 / budget.max(1), Ordering::Relaxed);
+        if busy > budget {
+            self.overruns.fetch_add(1, Ordering::Relaxed);
+        }
+    }
+
+    /// Returns the load since the previous call and starts a new window.
+    pub fn take(&self) -> LoadStats {
+        let busy = self.busy_nanos.swap(0, Ordering::Relaxed);
+        let budget = self.budget_nanos.swap(0, Ordering::Relaxed);
+        LoadStats {
+            callbacks: self.callbacks.swap(0, Ordering::Relaxed),
+            average: if budget == 0 {
+                0.0
+            } else {
+                busy as f32 / budget as f32
+            },
+            peak: self.peak.swap(0, Ordering::Relaxed) as f32 / 1_000_000.0,
+            overruns: self.overruns.swap(0, Ordering::Relaxed),
+        }
+    }
+}
@@ -0,0 +1,109 @@
+use std::collections::HashMap;
+use std::ffi::{CStr, CString};
+
+use crate::engine::Engine;
+use crate::error::Error;
+use crate::sound::{Sound, SoundFlags};
+
+/// Decoded clip, and its voices that are not playing.
+struct Clip<'a> {
+    /// Never played, it keeps the decoded data in the resource manager and is copied into new
+    /// voices
+    prototype: Sound<'a>,
+    idle: Vec<Sound<'a>>,
+}
+
+#[derive(Debug, Copy, Clone, Default, PartialEq, Eq)]
+pub struct PoolStats {
+    pub clips: usize,
+    /// Voices initialized because no idle one was left
+    pub created: u64,
+    pub reused: u64,
+}
+
+/// Voices of short clips that are played over and over (gunfire, footsteps).
+///
+/// A clip is decoded once, the first time it is played or preloaded, and every voice of it shares
+/// that PCM data. Voices are returned to the pool when they are done and restarted from there
+/// instead of being uninitialized, so playing a clip again costs no file access, no decoding and
+/// no node graph setup.
+pub struct VoicePool<'a> {
+    engine: &'a Engine,
+    clips: HashMap<CString, Clip<'a>>,
+    max_idle_per_clip: usize,
+    stats: PoolStats,
+}
+
+impl<'a> VoicePool<'a> {
+    pub fn new(engine: &'a Engine, max_idle_per_clip: usize) -> Self {
+        Self {
+            engine,
+            clips: HashMap::new(),
+            max_idle_per_clip,
+            stats: PoolStats::default(),
+        }
+    }
+
+    /// Decodes the clip at `path` ahead of its first play.
+    pub fn preload(&mut self, path: &CStr) -> Result<(), Error> {
+        self.clip(path).map(|_| ())
+    }
+
+    fn clip(&mut self, path: &CStr) -> Result<&mut Clip<'a>, Error> {
+        if !self.clips.contains_key(path) {
+            let prototype = self
+                .engine
+                .create_sound_from_file(path, SoundFlags::DECODE)?;
+            self.clips.insert(
+                path.to_owned(),
+                Clip {
+                    prototype,
+                    idle: Vec::new(),
+                },
+            );
+            self.stats.clips += 1;
+        }
+        Ok(self.clips.get_mut(path).expect("Clip was inserted above"))
+    }
+
+    /// Frees the decoded data of the clip once its playing voices are released.
+    pub fn unload(&mut self, path: &CStr) {
+        if self.clips.remove(path).is_some() {
+            self.stats.clips -= 1;
+        }
+    }
+
+    /// A stopped voice of the clip at `path`, rewound to its start.
+    pub fn acquire(&mut self, path: &CStr) -> Result<Sound<'a>, Error> {
+        let engine = self.engine;
+        let clip = self.clip(path)?;
+        match clip.idle.pop() {
+            Some(voice) => {
+                self.stats.reused += 1;
+                Ok(voice)
+            }
+            None => {
+                let voice = engine.create_sound_copy(&clip.prototype, SoundFlags::NONE)?;
+                self.stats.created += 1;
+                Ok(voice)
+            }
+        }
+    }
+
+    /// Takes back a voice acquired for `path`.
+    pub fn release(&mut self, path: &CStr, mut voice: Sound<'a>) {
+        let max_idle = self.max_idle_per_clip;
+        if let Some(clip) = self.clips.get_mut(path) {
+            if clip.idle.len() < max_idle {
+                let _ = voice.stop();
+                if voice.seek_to_pcm_frame(0).is_ok() {
+                    clip.idle.push(voice);
+                }
+            }
+        }
+    }
+
+    pub fn stats(&self) -> PoolStats {
+        self.stats
+    }
+}
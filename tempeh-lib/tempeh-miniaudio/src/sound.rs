@@ -1,37 +1,142 @@
 use core::marker::PhantomData;
-use tempeh_miniaudio_sys::{ma_sound, ma_sound_start, ma_sound_set_looping, ma_sound_set_position, ma_sound_uninit};
+use core::ops::BitOr;
 
+use crate::error::Error;
+use tempeh_miniaudio_sys::{
+    ma_sound, ma_sound_at_end, ma_sound_flags_MA_SOUND_FLAG_ASYNC,
+    ma_sound_flags_MA_SOUND_FLAG_DECODE, ma_sound_flags_MA_SOUND_FLAG_NO_SPATIALIZATION,
+    ma_sound_flags_MA_SOUND_FLAG_STREAM, ma_sound_get_cursor_in_pcm_frames,
+    ma_sound_get_data_format, ma_sound_get_length_in_pcm_frames, ma_sound_is_playing,
+    ma_sound_seek_to_pcm_frame, ma_sound_set_looping, ma_sound_set_pitch, ma_sound_set_position,
+    ma_sound_set_spatialization_enabled, ma_sound_set_volume, ma_sound_start, ma_sound_stop,
+    ma_sound_uninit,
+};
+
+/// How a sound is loaded, see `MA_SOUND_FLAG_*`.
+#[derive(Debug, Copy, Clone, Default, PartialEq, Eq)]
+pub struct SoundFlags(u32);
+
+impl SoundFlags {
+    pub const NONE: Self = Self(0);
+    /// Decodes while playing instead of loading the whole file first
+    pub const STREAM: Self = Self(ma_sound_flags_MA_SOUND_FLAG_STREAM as u32);
+    /// Decodes the whole file up front instead of while playing
+    pub const DECODE: Self = Self(ma_sound_flags_MA_SOUND_FLAG_DECODE as u32);
+    /// Loads on miniaudio's job thread instead of blocking
+    pub const ASYNC: Self = Self(ma_sound_flags_MA_SOUND_FLAG_ASYNC as u32);
+    pub const NO_SPATIALIZATION: Self = Self(ma_sound_flags_MA_SOUND_FLAG_NO_SPATIALIZATION as u32);
+
+    pub fn bits(self) -> u32 {
+        self.0
+    }
+
+    pub fn without(self, other: Self) -> Self {
+        Self(self.0 & !other.0)
+    }
+}
+
+impl BitOr for SoundFlags {
+    type Output = Self;
+
+    fn bitor(self, other: Self) -> Self {
+        Self(self.0 | other.0)
+    }
+}
+
+/// A sound of an `Engine`, which it must not outlive.
 pub struct Sound<'a> {
-    pub(crate) sound: ma_sound,
+    /// Boxed for the same reason as the engine, miniaudio's node graph points into it
+    pub(crate) sound: Box<ma_sound>,
     pub(crate) _engine_lifetime: PhantomData<&'a ()>,
 }
 
 impl<'a> Sound<'a> {
-    pub(crate) fn from_ma_sound(sound: ma_sound) -> Self {
+    pub(crate) fn from_ma_sound(sound: Box<ma_sound>) -> Self {
         Self {
             sound,
             _engine_lifetime: PhantomData::default(),
         }
     }
 
-    pub fn start(&mut self) {
-        unsafe { ma_sound_start(&mut self.sound as *mut ma_sound) };
+    fn as_ptr(&mut self) -> *mut ma_sound {
+        &mut *self.sound as *mut ma_sound
+    }
+
+    pub fn start(&mut self) -> Result<(), Error> {
+        Error::from(unsafe { ma_sound_start(self.as_ptr()) })
+    }
+
+    pub fn stop(&mut self) -> Result<(), Error> {
+        Error::from(unsafe { ma_sound_stop(self.as_ptr()) })
+    }
+
+    pub fn seek_to_pcm_frame(&mut self, frame: u64) -> Result<(), Error> {
+        Error::from(unsafe { ma_sound_seek_to_pcm_frame(self.as_ptr(), frame) })
     }
 
     pub fn set_looping(&mut self, is_looping: bool) {
-        unsafe { ma_sound_set_looping(&mut self.sound as *mut ma_sound, is_looping) };
+        unsafe { ma_sound_set_looping(self.as_ptr(), is_looping as u32) };
     }
 
-    pub fn set_position(&mut self) {
-        unsafe {
-            ma_sound_set_position(&mut self.sound as *mut ma_sound)
-        };
+    pub fn set_volume(&mut self, volume: f32) {
+        unsafe { ma_sound_set_volume(self.as_ptr(), volume) };
+    }
+
+    /// Playback speed, resampling the sound; 1.0 is the original pitch.
+    pub fn set_pitch(&mut self, pitch: f32) {
+        unsafe { ma_sound_set_pitch(self.as_ptr(), pitch) };
+    }
+
+    pub fn set_spatialization_enabled(&mut self, enabled: bool) {
+        unsafe { ma_sound_set_spatialization_enabled(self.as_ptr(), enabled as u32) };
+    }
+
+    pub fn set_position(&mut self, position: [f32; 3]) {
+        let [x, y, z] = position;
+        unsafe { ma_sound_set_position(self.as_ptr(), x, y, z) };
+    }
+
+    /// Playback position, in frames of the sound's data.
+    pub fn cursor_in_pcm_frames(&mut self) -> Result<u64, Error> {
+        let mut cursor = 0;
+        Error::from(unsafe { ma_sound_get_cursor_in_pcm_frames(self.as_ptr(), &mut cursor) })?;
+        Ok(cursor)
+    }
+
+    /// Fails while an asynchronously loaded sound is not ready yet, and for some streams.
+    pub fn length_in_pcm_frames(&mut self) -> Result<u64, Error> {
+        let mut length = 0;
+        Error::from(unsafe { ma_sound_get_length_in_pcm_frames(self.as_ptr(), &mut length) })?;
+        Ok(length)
+    }
+
+    /// Sample rate of the sound's data, which is what its frame counts are in.
+    pub fn sample_rate(&mut self) -> Result<u32, Error> {
+        let mut sample_rate = 0;
+        Error::from(unsafe {
+            ma_sound_get_data_format(
+                self.as_ptr(),
+                core::ptr::null_mut(),
+                core::ptr::null_mut(),
+                &mut sample_rate,
+                core::ptr::null_mut(),
+                0,
+            )
+        })?;
+        Ok(sample_rate)
+    }
+
+    pub fn is_playing(&self) -> bool {
+        unsafe { ma_sound_is_playing(&*self.sound) != 0 }
+    }
+
+    pub fn at_end(&self) -> bool {
+        unsafe { ma_sound_at_end(&*self.sound) != 0 }
     }
 }
 
 impl<'a> Drop for Sound<'a> {
     fn drop(&mut self) {
-        unsafe { ma_sound_uninit(&mut self.sound as *mut ma_sound) };
+        unsafe { ma_sound_uninit(self.as_ptr()) };
     }
 }
-
@@ -0,0 +1,420 @@
+use std::collections::HashMap;
+use std::hash::Hash;
+use std::time::{Duration, Instant};
+
+use crate::sound::Sound;
+
+/// Group of sounds sharing a voice limit (music, ambience, weapons), defined by the game.
+#[derive(Debug, Copy, Clone, Default, PartialEq, Eq, Hash)]
+pub struct VoiceCategory(pub u8);
+
+#[derive(Debug, Clone)]
+pub struct VoiceLimits {
+    /// Voices mixed at once, everything else is virtual
+    pub max_voices: usize,
+    pub per_category: HashMap<VoiceCategory, usize>,
+    /// Estimated gain below which a voice is virtual even when there is room for it
+    pub audibility_threshold: f32,
+}
+
+impl Default for VoiceLimits {
+    fn default() -> Self {
+        Self {
+            max_voices: 32,
+            per_category: HashMap::new(),
+            audibility_threshold: 0.001,
+        }
+    }
+}
+
+#[derive(Debug, Copy, Clone, PartialEq)]
+pub struct VoiceParams {
+    /// Weight of the voice when the limits are reached, relative to other voices
+    pub priority: f32,
+    pub category: VoiceCategory,
+    pub volume: f32,
+    /// World position of a spatialized voice
+    pub position: Option<[f32; 3]>,
+    pub looping: bool,
+}
+
+impl Default for VoiceParams {
+    fn default() -> Self {
+        Self {
+            priority: 1.0,
+            category: VoiceCategory::default(),
+            volume: 1.0,
+            position: None,
+            looping: false,
+        }
+    }
+}
+
+#[derive(Debug, Copy, Clone, Default, PartialEq, Eq)]
+pub struct VoiceStats {
+    /// Voices being mixed
+    pub real: usize,
+    /// Voices that keep time without being mixed
+    pub virtual_voices: usize,
+    pub paused: usize,
+    /// Real voices that became virtual, since the last `take_transitions`
+    pub virtualized: u64,
+    pub devirtualized: u64,
+}
+
+enum State {
+    Real,
+    /// Stopped in miniaudio, the position it would be at is derived from the time since `since`
+    Virtual {
+        since: Instant,
+        cursor: u64,
+    },
+    Paused {
+        cursor: u64,
+    },
+    Finished,
+}
+
+struct Voice<'a> {
+    sound: Sound<'a>,
+    params: VoiceParams,
+    state: State,
+    /// Frame counts of the sound's data, looked up once they are known
+    length: Option<u64>,
+    sample_rate: Option<u32>,
+}
+
+impl<'a> Voice<'a> {
+    fn audibility(&self, listener: [f32; 3]) -> f32 {
+        let attenuation = match self.params.position {
+            Some(position) => {
+                let distance = position
+                    .iter()
+                    .zip(listener.iter())
+                    .map(|(a, b)| (a - b) * (a - b))
+                    .sum::<f32>()
+                    .sqrt();
+                inverse_attenuation(distance)
+            }
+            None => 1.0,
+        };
+        self.params.priority * self.params.volume * attenuation
+    }
+
+    fn cursor(&mut self) -> u64 {
+        self.sound.cursor_in_pcm_frames().unwrap_or(0)
+    }
+
+    fn virtualize(&mut self, now: Instant) {
+        let cursor = self.cursor();
+        let _ = self.sound.stop();
+        self.state = State::Virtual { since: now, cursor };
+    }
+
+    /// Resumes mixing where the voice would be had it kept playing.
+    fn realize(&mut self, now: Instant) {
+        let target = match self.state {
+            State::Virtual { since, cursor } => cursor + self.frames_in(now - since),
+            _ => return,
+        };
+        if self.length.is_none() {
+            self.length = self
+                .sound
+                .length_in_pcm_frames()
+                .ok()
+                .filter(|length| *length > 0);
+        }
+        let target = match self.length {
+            Some(length) if self.params.looping => target % length,
+            Some(length) if target >= length => {
+                self.state = State::Finished;
+                return;
+            }
+            _ => target,
+        };
+        if target > 0 {
+            let _ = self.sound.seek_to_pcm_frame(target);
+        }
+        let _ = self.sound.start();
+        self.state = State::Real;
+    }
+
+    fn frames_in(&mut self, duration: Duration) -> u64 {
+        if self.sample_rate.is_none() {
+            self.sample_rate = self.sound.sample_rate().ok().filter(|rate| *rate > 0);
+        }
+        let sample_rate = self.sample_rate.unwrap_or(48000) as u128;
+        (duration.as_nanos() * sample_rate / 1_000_000_000) as u64
+    }
+}
+
+/// miniaudio's default inverse distance model, minimum distance 1 and rolloff 1.
+fn inverse_attenuation(distance: f32) -> f32 {
+    1.0 / distance.max(1.0)
+}
+
+/// Voice limiting for a mixer that has to stay within its deadline whatever gameplay triggers.
+///
+/// Every voice is given an audibility, its priority times its volume times the distance
+/// attenuation to the listener. On `update`, the most audible voices within the global and
+/// per-category limits are mixed; the others become virtual: they are stopped in miniaudio, which
+/// then skips them entirely, and keep time on the side so they resume at the right position
+/// when they become audible again. The mixing cost is bounded by `max_voices`, and the cost of
+/// the bookkeeping stays on the thread calling `update`, away from the device callback.
+pub struct VoiceManager<'a, K> {
+    voices: HashMap<K, Voice<'a>>,
+    limits: VoiceLimits,
+    listener: [f32; 3],
+    /// Scratch space for `update`
+    ranked: Vec<(f32, K)>,
+    virtualized: u64,
+    devirtualized: u64,
+}
+
+impl<'a, K: Copy + Eq + Hash> VoiceManager<'a, K> {
+    pub fn new(limits: VoiceLimits) -> Self {
+        Self {
+            voices: HashMap::new(),
+            limits,
+            listener: [0.0; 3],
+            ranked: Vec::new(),
+            virtualized: 0,
+            devirtualized: 0,
+        }
+    }
+
+    pub fn set_limits(&mut self, limits: VoiceLimits) {
+        self.limits = limits;
+    }
+
+    pub fn set_listener_position(&mut self, position: [f32; 3]) {
+        self.listener = position;
+    }
+
+    /// Adds a stopped sound, which starts playing at the next `update` if it is audible enough.
+    /// Returns the sound previously under `key`.
+    pub fn insert(
+        &mut self,
+        key: K,
+        mut sound: Sound<'a>,
+        params: VoiceParams,
+    ) -> Option<Sound<'a>> {
+        sound.set_volume(params.volume);
+        sound.set_looping(params.looping);
+        if let Some(position) = params.position {
+            sound.set_position(position);
+        }
+        let length = sound
+            .length_in_pcm_frames()
+            .ok()
+            .filter(|length| *length > 0);
+        let sample_rate = sound.sample_rate().ok().filter(|rate| *rate > 0);
+        let voice = Voice {
+            sound,
+            params,
+            state: State::Virtual {
+                since: Instant::now(),
+                cursor: 0,
+            },
+            length,
+            sample_rate,
+        };
+        self.voices.insert(key, voice).map(|voice| voice.sound)
+    }
+
+    /// Takes the voice out, stopped, for the caller to reuse or drop.
+    pub fn remove(&mut self, key: K) -> Option<Sound<'a>> {
+        let mut voice = self.voices.remove(&key)?;
+        let _ = voice.sound.stop();
+        Some(voice.sound)
+    }
+
+    pub fn set_volume(&mut self, key: K, volume: f32) {
+        if let Some(voice) = self.voices.get_mut(&key) {
+            voice.params.volume = volume;
+            voice.sound.set_volume(volume);
+        }
+    }
+
+    pub fn set_position(&mut self, key: K, position: [f32; 3]) {
+        if let Some(voice) = self.voices.get_mut(&key) {
+            voice.params.position = Some(position);
+            voice.sound.set_position(position);
+        }
+    }
+
+    pub fn pause(&mut self, key: K) {
+        if let Some(voice) = self.voices.get_mut(&key) {
+            let cursor = match voice.state {
+                State::Real => voice.cursor(),
+                State::Virtual { since, cursor } => cursor + voice.frames_in(since.elapsed()),
+                _ => return,
+            };
+            let _ = voice.sound.stop();
+            voice.state = State::Paused { cursor };
+        }
+    }
+
+    pub fn resume(&mut self, key: K) {
+        if let Some(voice) = self.voices.get_mut(&key) {
+            if let State::Paused { cursor } = voice.state {
+                voice.state = State::Virtual {
+                    since: Instant::now(),
+                    cursor,
+                };
+            }
+        }
+    }
+
+    /// Whether the voice played to its end, virtual or not. Looping voices never finish.
+    pub fn is_finished(&self, key: K) -> bool {
+        match self.voices.get(&key) {
+            Some(voice) => match voice.state {
+                State::Finished => true,
+                State::Real => !voice.params.looping && voice.sound.at_end(),
+                _ => false,
+            },
+            None => true,
+        }
+    }
+
+    /// Keys of the voices that played to their end.
+    pub fn finished(&self) -> impl Iterator<Item = K> + '_ {
+        self.voices
+            .keys()
+            .copied()
+            .filter(move |key| self.is_finished(*key))
+    }
+
+    /// Decides which voices are mixed, see the type documentation.
+    pub fn update(&mut self) {
+        let now = Instant::now();
+        let listener = self.listener;
+        self.ranked.clear();
+        for (key, voice) in &mut self.voices {
+            match voice.state {
+                // Finished while virtual
+                State::Virtual { since, cursor } if !voice.params.looping => {
+                    if let Some(length) = voice.length {
+                        if cursor + voice.frames_in(now - since) >= length {
+                            voice.state = State::Finished;
+                        }
+                    }
+                }
+                // Finished while mixed, its slot goes to the next voice
+                State::Real if !voice.params.looping && voice.sound.at_end() => {
+                    voice.state = State::Finished;
+                }
+                _ => {}
+            }
+            if let State::Real | State::Virtual { .. } = voice.state {
+                self.ranked.push((voice.audibility(listener), *key));
+            }
+        }
+        self.ranked
+            .sort_unstable_by(|a, b| b.0.partial_cmp(&a.0).unwrap_or(std::cmp::Ordering::Equal));
+
+        let mut real = 0;
+        let mut per_category: HashMap<VoiceCategory, usize> = HashMap::new();
+        for (audibility, key) in &self.ranked {
+            let voice = self.voices.get_mut(key).expect("Ranked voices exist");
+            let category = voice.params.category;
+            let category_count = per_category.entry(category).or_insert(0);
+            let mixed = *audibility >= self.limits.audibility_threshold
+                && real < self.limits.max_voices
+                && self
+                    .limits
+                    .per_category
+                    .get(&category)
+                    .map_or(true, |limit| *category_count < *limit);
+            match (&voice.state, mixed) {
+                (State::Virtual { .. }, true) => {
+                    voice.realize(now);
+                    if let State::Real = voice.state {
+                        self.devirtualized += 1;
+                    }
+                }
+                (State::Real, false) => {
+                    voice.virtualize(now);
+                    self.virtualized += 1;
+                }
+                _ => {}
+            }
+            if let State::Real = voice.state {
+                real += 1;
+                *category_count += 1;
+            }
+        }
+    }
+
+    pub fn stats(&self) -> VoiceStats {
+        let mut stats = VoiceStats {
+            virtualized: self.virtualized,
+            devirtualized: self.devirtualized,
+            ..VoiceStats::default()
+        };
+        for voice in self.voices.values() {
+            match voice.state {
+                State::Real => stats.real += 1,
+                State::Virtual { .. } => stats.virtual_voices += 1,
+                State::Paused { .. } => stats.paused += 1,
+                State::Finished => {}
+            }
+        }
+        stats
+    }
+
+    /// Resets the transition counters of `stats`.
+    pub fn take_transitions(&mut self) -> (u64, u64) {
+        (
+            std::mem::take(&mut self.virtualized),
+            std::mem::take(&mut self.devirtualized),
+        )
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::ffi::CString;
+
+    use super::*;
+    use crate::engine::Engine;
+    use crate::sound::SoundFlags;
+
+    #[test]
+    fn finished_voices_free_their_slots() {
+        let engine = Engine::new_offline(1, 22050).unwrap();
+        let path =
+            CString::new(concat!(env!("CARGO_MANIFEST_DIR"), "/../../starwars.wav")).unwrap();
+        let mut voices = VoiceManager::new(VoiceLimits {
+            max_voices: 1,
+            ..VoiceLimits::default()
+        });
+        let louder = VoiceParams {
+            priority: 2.0,
+            ..VoiceParams::default()
+        };
+        for (key, params) in [(0, louder), (1, VoiceParams::default())] {
+            let sound = engine
+                .create_sound_from_file(&path, SoundFlags::DECODE)
+                .unwrap();
+            voices.insert(key, sound, params);
+        }
+        voices.update();
+        let stats = voices.stats();
+        assert_eq!((stats.real, stats.virtual_voices), (1, 1));
+
+        let mut output = vec![0.0; 22050];
+        for _ in 0..100 {
+            if voices.is_finished(0) {
+                break;
+            }
+            engine.render(&mut output).unwrap();
+        }
+        assert!(voices.is_finished(0));
+        voices.update();
+        let stats = voices.stats();
+        assert_eq!((stats.real, stats.virtual_voices), (1, 0));
+        assert!(!voices.is_finished(1));
+    }
+}
@@ -0,0 +1,74 @@
+//! Calls per second of `Spinner.Update(float)` from `test/fixtures/spinner`, through a cached
+//! unmanaged thunk and through `mono_runtime_invoke_array`.
+//!
+//! The thunk is a native call into the compiled method. `invoke_array` allocates an `object[]`
+//! and boxes the argument for every call, then unpacks them by reflection, which is what the
+//! scripting plugin keeps off its per entity path.
+//!
+//! Build the fixture first, see `test/fixtures/README.md`, then run with
+//! `cargo bench -p tempeh-mono --bench thunk`.
+
+use std::path::Path;
+use std::time::{Duration, Instant};
+
+use mono_sys::{MonoException, MonoObject};
+use tempeh_mono::jit::JIT;
+use tempeh_mono::object::{box_f32, GcHandle};
+
+type UpdateThunk = unsafe extern "system" fn(*mut MonoObject, f32, *mut *mut MonoException);
+
+const CALLS: u32 = 1_000_000;
+const DELTA_TIME: f32 = 1.0 / 60.0;
+
+fn bench(name: &str, calls: u32, mut call: impl FnMut()) -> Duration {
+    // Compiles the method and the wrappers
+    call();
+    let start = Instant::now();
+    for _ in 0..calls {
+        call();
+    }
+    let elapsed = start.elapsed();
+    println!(
+        "{:<14} {:>12.0} calls/s  {:>10?}/call",
+        name,
+        calls as f64 / elapsed.as_secs_f64(),
+        elapsed / calls
+    );
+    elapsed / calls
+}
+
+fn main() {
+    let fixture = Path::new(env!("CARGO_MANIFEST_DIR")).join("test/fixtures/spinner/spinner.dll");
+    if !fixture.exists() {
+        eprintln!(
+            "{} is missing, see test/fixtures/README.md",
+            fixture.display()
+        );
+        return;
+    }
+
+    let mut jit = JIT::new("thunk-bench");
+    let assembly = jit.assembly_open(&fixture);
+    let class = assembly
+        .class_from_name("", "Spinner")
+        .expect("Spinner class");
+    let update = class.method("Update", 1).expect("Spinner.Update(float)");
+    let spinner = GcHandle::new(class.new_object(&jit).unwrap());
+    let thunk: UpdateThunk = unsafe { std::mem::transmute(update.unmanaged_thunk()) };
+
+    let thunk_call = bench("thunk", CALLS * 10, || {
+        let mut exception = std::ptr::null_mut();
+        unsafe { thunk(spinner.target(), DELTA_TIME, &mut exception) };
+        assert!(exception.is_null());
+    });
+    let invoke_call = bench("invoke_array", CALLS, || {
+        let delta_time = box_f32(&jit, DELTA_TIME);
+        update
+            .invoke_array(&jit, spinner.target(), &[delta_time])
+            .unwrap();
+    });
+    println!(
+        "thunk is {:.1}x faster",
+        invoke_call.as_secs_f64() / thunk_call.as_secs_f64()
+    );
+}
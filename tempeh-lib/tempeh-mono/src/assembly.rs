@@ -1,5 +1,11 @@
+use std::ffi::CString;
 use std::marker::PhantomData;
-use mono_sys::{mono_assembly_close, MonoAssembly};
+use mono_sys::{
+    mono_assembly_close, mono_assembly_get_image, mono_class_from_name, mono_class_get,
+    mono_image_get_table_rows, MonoAssembly, MonoImage, MonoMetaTableEnum_MONO_TABLE_TYPEDEF,
+    MonoTokenType_MONO_TOKEN_TYPE_DEF,
+};
+use crate::class::Class;
 
 pub struct Assembly<'a> {
     assembly: *mut MonoAssembly,
@@ -13,6 +19,38 @@ impl<'a> Assembly<'a> {
             _lifetime_annotation: Default::default(),
         }
     }
+
+    pub fn image(&self) -> *mut MonoImage {
+        unsafe { mono_assembly_get_image(self.assembly) }
+    }
+
+    /// Classes defined by the assembly, nested ones included.
+    pub fn classes(&self) -> Vec<Class> {
+        let image = self.image();
+        let rows = unsafe {
+            mono_image_get_table_rows(image, MonoMetaTableEnum_MONO_TABLE_TYPEDEF as i32)
+        };
+        // Row 1 is the `<Module>` pseudo class holding global members
+        (2..=rows.max(0) as u32)
+            .map(|row| unsafe {
+                mono_class_get(image, MonoTokenType_MONO_TOKEN_TYPE_DEF as u32 | row)
+            })
+            .filter(|class| !class.is_null())
+            .map(Class)
+            .collect()
+    }
+
+    pub fn class_from_name(&self, namespace: &str, name: &str) -> Option<Class> {
+        let namespace = CString::new(namespace).ok()?;
+        let name = CString::new(name).ok()?;
+        let class =
+            unsafe { mono_class_from_name(self.image(), namespace.as_ptr(), name.as_ptr()) };
+        if class.is_null() {
+            None
+        } else {
+            Some(Class(class))
+        }
+    }
 }
 
 impl Drop for Assembly<'_> {
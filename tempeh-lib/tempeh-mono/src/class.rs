@@ -0,0 +1,81 @@
+use std::ffi::{CStr, CString};
+use std::os::raw::c_char;
+
+use mono_sys::{
+    mono_class_get_method_from_name, mono_class_get_name, mono_class_get_namespace,
+    mono_class_is_subclass_of, mono_object_new, MonoClass, MonoObject,
+};
+
+use crate::jit::JIT;
+use crate::method::Method;
+use crate::object::Exception;
+
+/// A class loaded in a domain, valid for as long as the domain is.
+#[derive(Debug, Copy, Clone, PartialEq, Eq, Hash)]
+pub struct Class(pub(crate) *mut MonoClass);
+
+fn to_string(name: *const c_char) -> String {
+    if name.is_null() {
+        return String::new();
+    }
+    unsafe { CStr::from_ptr(name) }
+        .to_string_lossy()
+        .into_owned()
+}
+
+impl Class {
+    pub fn as_ptr(&self) -> *mut MonoClass {
+        self.0
+    }
+
+    pub fn name(&self) -> String {
+        to_string(unsafe { mono_class_get_name(self.0) })
+    }
+
+    pub fn namespace(&self) -> String {
+        to_string(unsafe { mono_class_get_namespace(self.0) })
+    }
+
+    /// `Namespace.Name`, or `Name` for a class of the global namespace.
+    pub fn full_name(&self) -> String {
+        let namespace = self.namespace();
+        if namespace.is_empty() {
+            self.name()
+        } else {
+            format!("{}.{}", namespace, self.name())
+        }
+    }
+
+    /// The method named `name` taking `param_count` parameters, searched in the class then in its
+    /// parents. This walks the class metadata, so the result should be kept rather than looked up
+    /// again for every call.
+    pub fn method(&self, name: &str, param_count: i32) -> Option<Method> {
+        let name = CString::new(name).ok()?;
+        let method = unsafe { mono_class_get_method_from_name(self.0, name.as_ptr(), param_count) };
+        if method.is_null() {
+            None
+        } else {
+            Some(Method(method))
+        }
+    }
+
+    pub fn is_subclass_of(&self, parent: &Class) -> bool {
+        unsafe { mono_class_is_subclass_of(self.0, parent.0, 1) != 0 }
+    }
+
+    /// Allocates an instance and runs its parameterless constructor, if it has one. The object is
+    /// only kept alive by the caller's stack until it is given a `GcHandle`.
+    pub fn new_object(&self, jit: &JIT) -> Result<*mut MonoObject, Exception> {
+        let object = unsafe { mono_object_new(jit.domain(), self.0) };
+        if object.is_null() {
+            return Err(Exception::new(format!(
+                "Unable to allocate an instance of {}",
+                self.full_name()
+            )));
+        }
+        if let Some(constructor) = self.method(".ctor", 0) {
+            constructor.invoke(object, &mut [])?;
+        }
+        Ok(object)
+    }
+}
@@ -1,11 +1,14 @@
-use std::ffi::OsStr;
-use std::os::raw::c_char;
+use std::ffi::CString;
 use std::path::Path;
-use mono_sys::{mono_domain_assembly_open, mono_jit_cleanup, mono_jit_init, MonoDomain};
+use mono_sys::{
+    mono_domain_assembly_open, mono_jit_cleanup, mono_jit_init, mono_thread_attach, MonoDomain,
+};
 use crate::assembly::Assembly;
 use crate::util::path_to_c_str;
 use std::marker::PhantomData;
 
+/// The root domain of the runtime. Mono can only be initialized once per process, so there is at
+/// most one `JIT`, and none can be created again after it is dropped.
 pub struct JIT<'a> {
     domain: *mut MonoDomain,
     _lifetime_annotation: PhantomData<&'a ()>,
@@ -13,7 +16,8 @@ pub struct JIT<'a> {
 
 impl<'a> JIT<'a> {
     pub fn new(name: &str) -> Self {
-        let maybe_internal = unsafe { mono_jit_init(name.as_ptr() as *const c_char) };
+        let name = CString::new(name).expect("Domain name contains a nul byte");
+        let maybe_internal = unsafe { mono_jit_init(name.as_ptr()) };
         if maybe_internal.is_null() {
             panic!("Domain creation failed");
         }
@@ -23,6 +27,16 @@ impl<'a> JIT<'a> {
         }
     }
 
+    pub fn domain(&self) -> *mut MonoDomain {
+        self.domain
+    }
+
+    /// Registers the calling thread with the runtime, which it has to be before calling managed
+    /// code. The thread that created the `JIT` already is.
+    pub fn attach_current_thread(&self) {
+        unsafe { mono_thread_attach(self.domain) };
+    }
+
     pub fn assembly_open<P: AsRef<Path>>(&mut self, file: P) -> Assembly<'a> {
         let maybe_assemby = unsafe {
             mono_domain_assembly_open(self.domain, path_to_c_str(file.as_ref()).as_ptr())
@@ -1,9 +1,14 @@
 extern crate core;
 
-mod jit;
-mod assembly;
+pub mod assembly;
+pub mod class;
+pub mod jit;
+pub mod method;
+pub mod object;
 mod util;
 
+pub use mono_sys as sys;
+
 #[cfg(test)]
 mod tests {
     #[test]
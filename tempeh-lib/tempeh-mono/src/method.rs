@@ -0,0 +1,121 @@
+use std::ffi::CStr;
+use std::os::raw::c_void;
+
+use mono_sys::{
+    mono_array_addr_with_size, mono_array_new, mono_gc_wbarrier_set_arrayref,
+    mono_get_object_class, mono_method_get_name, mono_method_get_unmanaged_thunk,
+    mono_method_signature, mono_runtime_invoke, mono_runtime_invoke_array,
+    mono_signature_get_params, mono_signature_get_return_type, mono_signature_is_instance,
+    mono_type_get_type, MonoMethod, MonoObject, MonoTypeEnum,
+};
+
+use crate::jit::JIT;
+use crate::object::Exception;
+
+/// A method of a loaded class, valid for as long as its domain is.
+#[derive(Debug, Copy, Clone, PartialEq, Eq, Hash)]
+pub struct Method(pub(crate) *mut MonoMethod);
+
+/// Parameter and return types of a method, as `MONO_TYPE_*` values. Enough to check a method
+/// matches the function type its thunk is transmuted to.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct Signature {
+    pub is_instance: bool,
+    pub return_type: MonoTypeEnum,
+    pub params: Vec<MonoTypeEnum>,
+}
+
+impl Method {
+    pub fn as_ptr(&self) -> *mut MonoMethod {
+        self.0
+    }
+
+    pub fn name(&self) -> String {
+        unsafe { CStr::from_ptr(mono_method_get_name(self.0)) }
+            .to_string_lossy()
+            .into_owned()
+    }
+
+    pub fn signature(&self) -> Option<Signature> {
+        unsafe {
+            let signature = mono_method_signature(self.0);
+            if signature.is_null() {
+                return None;
+            }
+            let mut params = Vec::new();
+            let mut iter = std::ptr::null_mut();
+            loop {
+                let param = mono_signature_get_params(signature, &mut iter);
+                if param.is_null() {
+                    break;
+                }
+                params.push(mono_type_get_type(param) as MonoTypeEnum);
+            }
+            Some(Signature {
+                is_instance: mono_signature_is_instance(signature) != 0,
+                return_type: mono_type_get_type(mono_signature_get_return_type(signature))
+                    as MonoTypeEnum,
+                params,
+            })
+        }
+    }
+
+    /// A native function pointer calling the method directly, without the reflection and
+    /// boxing of `invoke`. Creating it compiles a wrapper, so it is meant to be cached.
+    ///
+    /// # Safety
+    ///
+    /// Check `signature` first. The pointer must be transmuted to an `extern "system"` function
+    /// taking the instance first (for instance methods), then the managed parameters as their
+    /// native types, then a `*mut *mut MonoException` set to the exception thrown, if any; and
+    /// returning the managed return type. It may only be called from threads attached to the
+    /// domain.
+    pub unsafe fn unmanaged_thunk(&self) -> *mut c_void {
+        mono_method_get_unmanaged_thunk(self.0)
+    }
+
+    /// Calls the method through `mono_runtime_invoke`, with `args` pointing to each argument
+    /// (value types) or being the argument (reference types). Value results come back boxed.
+    pub fn invoke(
+        &self,
+        this: *mut MonoObject,
+        args: &mut [*mut c_void],
+    ) -> Result<*mut MonoObject, Exception> {
+        let mut exception = std::ptr::null_mut();
+        let result = unsafe {
+            mono_runtime_invoke(
+                self.0,
+                this as *mut c_void,
+                args.as_mut_ptr(),
+                &mut exception,
+            )
+        };
+        Exception::check(exception)?;
+        Ok(result)
+    }
+
+    /// Calls the method through `mono_runtime_invoke_array`, with every argument boxed into an
+    /// `object[]` allocated for the call.
+    pub fn invoke_array(
+        &self,
+        jit: &JIT,
+        this: *mut MonoObject,
+        args: &[*mut MonoObject],
+    ) -> Result<*mut MonoObject, Exception> {
+        let mut exception = std::ptr::null_mut();
+        let result = unsafe {
+            let array = mono_array_new(jit.domain(), mono_get_object_class(), args.len());
+            for (index, arg) in args.iter().enumerate() {
+                let slot = mono_array_addr_with_size(
+                    array,
+                    std::mem::size_of::<*mut MonoObject>() as i32,
+                    index,
+                );
+                mono_gc_wbarrier_set_arrayref(array, slot as *mut c_void, *arg);
+            }
+            mono_runtime_invoke_array(self.0, this as *mut c_void, array, &mut exception)
+        };
+        Exception::check(exception)?;
+        Ok(result)
+    }
+}
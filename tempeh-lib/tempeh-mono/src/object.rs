@@ -0,0 +1,81 @@
+use std::ffi::CStr;
+use std::fmt;
+
+use mono_sys::{
+    mono_free, mono_gchandle_free, mono_gchandle_get_target, mono_gchandle_new,
+    mono_get_single_class, mono_object_to_string, mono_string_to_utf8, mono_value_box, MonoObject,
+};
+
+use crate::jit::JIT;
+
+/// Keeps a managed object alive while native code refers to it. The collector may move the
+/// object, so it has to be fetched again with `target` after any managed code ran.
+#[derive(Debug)]
+pub struct GcHandle(u32);
+
+impl GcHandle {
+    pub fn new(object: *mut MonoObject) -> Self {
+        Self(unsafe { mono_gchandle_new(object, 0) })
+    }
+
+    pub fn target(&self) -> *mut MonoObject {
+        unsafe { mono_gchandle_get_target(self.0) }
+    }
+}
+
+impl Drop for GcHandle {
+    fn drop(&mut self) {
+        unsafe { mono_gchandle_free(self.0) };
+    }
+}
+
+/// A managed exception thrown by a call, described by its `ToString()`.
+#[derive(Debug, Clone)]
+pub struct Exception {
+    pub message: String,
+}
+
+impl Exception {
+    pub(crate) fn new(message: String) -> Self {
+        Self { message }
+    }
+
+    /// Turns the exception out parameter of a call into an error.
+    pub fn check(exception: *mut MonoObject) -> Result<(), Exception> {
+        if exception.is_null() {
+            return Ok(());
+        }
+        let message = unsafe {
+            let mut nested = std::ptr::null_mut();
+            let string = mono_object_to_string(exception, &mut nested);
+            if string.is_null() || !nested.is_null() {
+                "Exception thrown by ToString".to_owned()
+            } else {
+                let utf8 = mono_string_to_utf8(string);
+                let message = CStr::from_ptr(utf8).to_string_lossy().into_owned();
+                mono_free(utf8 as *mut _);
+                message
+            }
+        };
+        Err(Self { message })
+    }
+}
+
+impl fmt::Display for Exception {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str(&self.message)
+    }
+}
+
+impl std::error::Error for Exception {}
+
+/// A `System.Single` holding `value`, for `Method::invoke_array`.
+pub fn box_f32(jit: &JIT, mut value: f32) -> *mut MonoObject {
+    unsafe {
+        mono_value_box(
+            jit.domain(),
+            mono_get_single_class(),
+            &mut value as *mut f32 as *mut _,
+        )
+    }
+}
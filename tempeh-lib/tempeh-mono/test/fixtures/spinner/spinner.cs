@@ -0,0 +1,38 @@
+using System;
+
+public class Spinner
+{
+    public float Angle;
+    public int Updates;
+
+    public void Update(float deltaTime)
+    {
+        Angle = (Angle + deltaTime * 90.0f) % 360.0f;
+        Updates++;
+    }
+}
+
+public class DeltaCheck
+{
+    public void Update(float deltaTime)
+    {
+        if (deltaTime != 0.5f)
+        {
+            throw new ArgumentException("Unexpected deltaTime " + deltaTime);
+        }
+    }
+}
+
+public class DoubleUpdate
+{
+    public void Update(double deltaTime)
+    {
+    }
+}
+
+public class StaticUpdate
+{
+    public static void Update(float deltaTime)
+    {
+    }
+}